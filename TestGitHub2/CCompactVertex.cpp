@@ -0,0 +1,225 @@
+//-----------------------------------------------------------------------------
+// File: CCompactVertex.cpp
+//
+// Desc: Quantised 8 byte vertex format, alongside the 16 byte CVertex, plus
+//       the SIMD kernels used to encode and decode it.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CCompactVertex Specific Includes
+//-----------------------------------------------------------------------------
+#include "CCompactVertex.h"
+#include <emmintrin.h>
+
+//-----------------------------------------------------------------------------
+// Name : ComputeParams () (Static)
+// Desc : Computes the scale & bias which map the bounding box of the vertices
+//        specified onto the full signed 16 bit range.
+//-----------------------------------------------------------------------------
+void CVertexQuantizer::ComputeParams( const CVertex * pVertices, ULONG Count, QUANTIZE_PARAMS * pParams )
+{
+    D3DXVECTOR3 vecMin( 0.0f, 0.0f, 0.0f ), vecMax( 0.0f, 0.0f, 0.0f );
+
+    // Compute the bounding box
+    for ( ULONG i = 0; i < Count; i++ )
+    {
+        D3DXVECTOR3 vecPos( pVertices[i].x, pVertices[i].y, pVertices[i].z );
+        if ( i == 0 ) { vecMin = vecPos; vecMax = vecPos; continue; }
+        D3DXVec3Minimize( &vecMin, &vecMin, &vecPos );
+        D3DXVec3Maximize( &vecMax, &vecMax, &vecPos );
+
+    } // Next Vertex
+
+    // Centre the range on the box, and scale the half extents to fit
+    pParams->Bias  = (vecMin + vecMax) * 0.5f;
+    pParams->Scale = (vecMax - vecMin) * (0.5f / QUANTIZE_RANGE);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Encode () (Static)
+// Desc : SSE2 encode kernel, processes two vertices per iteration.
+//-----------------------------------------------------------------------------
+void CVertexQuantizer::Encode( const CVertex * pVertices, CCompactVertex * pOut, ULONG Count, const QUANTIZE_PARAMS & Params )
+{
+    ULONG   i = 0;
+    float   InvX = (Params.Scale.x != 0.0f) ? 1.0f / Params.Scale.x : 0.0f;
+    float   InvY = (Params.Scale.y != 0.0f) ? 1.0f / Params.Scale.y : 0.0f;
+    float   InvZ = (Params.Scale.z != 0.0f) ? 1.0f / Params.Scale.z : 0.0f;
+
+    // Lane 3 holds the diffuse colour, which is masked off and packed separately
+    __m128  vMask = _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) );
+    __m128  vBias = _mm_set_ps( 0.0f, Params.Bias.z, Params.Bias.y, Params.Bias.x );
+    __m128  vInv  = _mm_set_ps( 0.0f, InvZ, InvY, InvX );
+    __m128i vMin  = _mm_set1_epi16( -(SHORT)QUANTIZE_RANGE );
+
+    for ( ; i + 1 < Count; i += 2 )
+    {
+        // Load & quantise both positions
+        __m128  a = _mm_and_ps( _mm_loadu_ps( &pVertices[i].x ), vMask );
+        __m128  b = _mm_and_ps( _mm_loadu_ps( &pVertices[i + 1].x ), vMask );
+        a = _mm_mul_ps( _mm_sub_ps( a, vBias ), vInv );
+        b = _mm_mul_ps( _mm_sub_ps( b, vBias ), vInv );
+
+        // Round, narrow to 16 bits with saturation, and keep the range symmetric
+        __m128i q = _mm_packs_epi32( _mm_cvtps_epi32( a ), _mm_cvtps_epi32( b ) );
+        q = _mm_max_epi16( q, vMin );
+
+        // Insert the packed colours and store both vertices
+        q = _mm_insert_epi16( q, PackColor( pVertices[i].Diffuse ), 3 );
+        q = _mm_insert_epi16( q, PackColor( pVertices[i + 1].Diffuse ), 7 );
+        _mm_storeu_si128( (__m128i*)&pOut[i], q );
+
+    } // Next Vertex Pair
+
+    // Any remaining vertex
+    if ( i < Count ) EncodeScalar( &pVertices[i], &pOut[i], Count - i, Params );
+}
+
+//-----------------------------------------------------------------------------
+// Name : Decode () (Static)
+// Desc : SSE2 decode kernel, processes two vertices per iteration.
+//-----------------------------------------------------------------------------
+void CVertexQuantizer::Decode( const CCompactVertex * pVertices, CVertex * pOut, ULONG Count, const QUANTIZE_PARAMS & Params )
+{
+    ULONG   i = 0;
+    __m128  vScale = _mm_set_ps( 0.0f, Params.Scale.z, Params.Scale.y, Params.Scale.x );
+    __m128  vBias  = _mm_set_ps( 0.0f, Params.Bias.z, Params.Bias.y, Params.Bias.x );
+
+    for ( ; i + 1 < Count; i += 2 )
+    {
+        __m128i q = _mm_loadu_si128( (const __m128i*)&pVertices[i] );
+
+        // Sign extend each 16 bit component to 32 bits
+        __m128i lo = _mm_srai_epi32( _mm_unpacklo_epi16( q, q ), 16 );
+        __m128i hi = _mm_srai_epi32( _mm_unpackhi_epi16( q, q ), 16 );
+
+        // Scale & bias back into model space
+        _mm_storeu_ps( &pOut[i].x,     _mm_add_ps( _mm_mul_ps( _mm_cvtepi32_ps( lo ), vScale ), vBias ) );
+        _mm_storeu_ps( &pOut[i + 1].x, _mm_add_ps( _mm_mul_ps( _mm_cvtepi32_ps( hi ), vScale ), vBias ) );
+
+        // Lane 3 was overwritten above, so store the unpacked colours last
+        pOut[i].Diffuse     = UnpackColor( pVertices[i].Diffuse );
+        pOut[i + 1].Diffuse = UnpackColor( pVertices[i + 1].Diffuse );
+
+    } // Next Vertex Pair
+
+    // Any remaining vertex
+    if ( i < Count ) DecodeScalar( &pVertices[i], &pOut[i], Count - i, Params );
+}
+
+//-----------------------------------------------------------------------------
+// Name : EncodeScalar () (Static)
+// Desc : Scalar reference encode kernel.
+//-----------------------------------------------------------------------------
+void CVertexQuantizer::EncodeScalar( const CVertex * pVertices, CCompactVertex * pOut, ULONG Count, const QUANTIZE_PARAMS & Params )
+{
+    float Inv[3], Bias[3] = { Params.Bias.x, Params.Bias.y, Params.Bias.z };
+    Inv[0] = (Params.Scale.x != 0.0f) ? 1.0f / Params.Scale.x : 0.0f;
+    Inv[1] = (Params.Scale.y != 0.0f) ? 1.0f / Params.Scale.y : 0.0f;
+    Inv[2] = (Params.Scale.z != 0.0f) ? 1.0f / Params.Scale.z : 0.0f;
+
+    for ( ULONG i = 0; i < Count; i++ )
+    {
+        const float * pPos = &pVertices[i].x;
+        SHORT         q[3];
+
+        for ( ULONG k = 0; k < 3; k++ )
+        {
+            // Round to nearest using the same conversion as the SIMD kernel
+            int v = _mm_cvtss_si32( _mm_set_ss( (pPos[k] - Bias[k]) * Inv[k] ) );
+            if ( v < -(int)QUANTIZE_RANGE ) v = -(int)QUANTIZE_RANGE;
+            if ( v >  (int)QUANTIZE_RANGE ) v = (int)QUANTIZE_RANGE;
+            q[k] = (SHORT)v;
+
+        } // Next Component
+
+        pOut[i].x       = q[0];
+        pOut[i].y       = q[1];
+        pOut[i].z       = q[2];
+        pOut[i].Diffuse = PackColor( pVertices[i].Diffuse );
+
+    } // Next Vertex
+}
+
+//-----------------------------------------------------------------------------
+// Name : DecodeScalar () (Static)
+// Desc : Scalar reference decode kernel.
+//-----------------------------------------------------------------------------
+void CVertexQuantizer::DecodeScalar( const CCompactVertex * pVertices, CVertex * pOut, ULONG Count, const QUANTIZE_PARAMS & Params )
+{
+    for ( ULONG i = 0; i < Count; i++ )
+    {
+        pOut[i].x       = (float)pVertices[i].x * Params.Scale.x + Params.Bias.x;
+        pOut[i].y       = (float)pVertices[i].y * Params.Scale.y + Params.Bias.y;
+        pOut[i].z       = (float)pVertices[i].z * Params.Scale.z + Params.Bias.z;
+        pOut[i].Diffuse = UnpackColor( pVertices[i].Diffuse );
+
+    } // Next Vertex
+}
+
+//-----------------------------------------------------------------------------
+// Name : Measure () (Static)
+// Desc : Compares the compact vertices against their source vertices and
+//        fills out the error report.
+//-----------------------------------------------------------------------------
+void CVertexQuantizer::Measure( const CVertex * pVertices, const CCompactVertex * pCompact, ULONG Count, const QUANTIZE_PARAMS & Params, QUANTIZE_REPORT * pReport )
+{
+    double fTotalError = 0.0;
+
+    // Clear the report
+    ZeroMemory( pReport, sizeof(QUANTIZE_REPORT) );
+    pReport->BytesBefore = Count * sizeof(CVertex);
+    pReport->BytesAfter  = Count * sizeof(CCompactVertex);
+
+    for ( ULONG i = 0; i < Count; i++ )
+    {
+        CVertex Decoded;
+        DecodeScalar( &pCompact[i], &Decoded, 1, Params );
+
+        // Position error
+        D3DXVECTOR3 vecError( Decoded.x - pVertices[i].x, Decoded.y - pVertices[i].y, Decoded.z - pVertices[i].z );
+        float fError = D3DXVec3Length( &vecError );
+        if ( fError > pReport->MaxPositionError ) pReport->MaxPositionError = fError;
+        fTotalError += fError;
+
+        // Colour error, per 8 bit RGB channel (alpha is not stored)
+        for ( ULONG Shift = 0; Shift < 24; Shift += 8 )
+        {
+            LONG a = (LONG)((Decoded.Diffuse >> Shift) & 0xFF), b = (LONG)((pVertices[i].Diffuse >> Shift) & 0xFF);
+            ULONG Error = (ULONG)((a > b) ? a - b : b - a);
+            if ( Error > pReport->MaxColorError ) pReport->MaxColorError = Error;
+
+        } // Next Channel
+
+    } // Next Vertex
+
+    if ( Count > 0 ) pReport->MeanPositionError = (float)(fTotalError / Count);
+}
+
+//-----------------------------------------------------------------------------
+// Name : PackColor () (Static)
+// Desc : Packs an A8R8G8B8 colour into R5G6B5, rounding to nearest.
+//-----------------------------------------------------------------------------
+USHORT CVertexQuantizer::PackColor( ULONG Diffuse )
+{
+    ULONG r = (Diffuse >> 16) & 0xFF, g = (Diffuse >> 8) & 0xFF, b = Diffuse & 0xFF;
+    r = (r * 31 + 127) / 255;
+    g = (g * 63 + 127) / 255;
+    b = (b * 31 + 127) / 255;
+    return (USHORT)((r << 11) | (g << 5) | b);
+}
+
+//-----------------------------------------------------------------------------
+// Name : UnpackColor () (Static)
+// Desc : Expands an R5G6B5 colour back into opaque A8R8G8B8.
+//-----------------------------------------------------------------------------
+ULONG CVertexQuantizer::UnpackColor( USHORT Packed )
+{
+    ULONG r = (Packed >> 11) & 0x1F, g = (Packed >> 5) & 0x3F, b = Packed & 0x1F;
+    r = (r << 3) | (r >> 2);
+    g = (g << 2) | (g >> 4);
+    b = (b << 3) | (b >> 2);
+    return 0xFF000000 | (r << 16) | (g << 8) | b;
+}
@@ -0,0 +1,92 @@
+//-----------------------------------------------------------------------------
+// File: CCompactVertex.h
+//
+// Desc: Quantised 8 byte vertex format, alongside the 16 byte CVertex, plus
+//       the SIMD kernels used to encode and decode it.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CCOMPACTVERTEX_H_
+#define _CCOMPACTVERTEX_H_
+
+//-----------------------------------------------------------------------------
+// CCompactVertex Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CObject.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const float QUANTIZE_RANGE = 32767.0f;     // Largest quantised position magnitude
+
+//-----------------------------------------------------------------------------
+// Name : CCompactVertex (Class)
+// Desc : Compact vertex. Positions are signed 16 bit fixed point values,
+//        decoded through a per mesh scale & bias, and the diffuse colour is
+//        packed as R5G6B5 (alpha is always decoded as opaque).
+//-----------------------------------------------------------------------------
+class CCompactVertex
+{
+public:
+    //-------------------------------------------------------------------------
+	// Public Variables for This Class
+	//-------------------------------------------------------------------------
+    SHORT       x;          // Quantised Position X Component
+    SHORT       y;          // Quantised Position Y Component
+    SHORT       z;          // Quantised Position Z Component
+    USHORT      Diffuse;    // R5G6B5 packed diffuse colour
+
+};
+
+//-----------------------------------------------------------------------------
+// Name : QUANTIZE_PARAMS (Struct)
+// Desc : Per mesh decode parameters. Position = Quantised * Scale + Bias.
+//-----------------------------------------------------------------------------
+struct QUANTIZE_PARAMS
+{
+    D3DXVECTOR3     Scale;          // Per axis decode scale
+    D3DXVECTOR3     Bias;           // Per axis decode bias (mesh centre)
+};
+
+//-----------------------------------------------------------------------------
+// Name : QUANTIZE_REPORT (Struct)
+// Desc : Error and size report produced when quantising a mesh.
+//-----------------------------------------------------------------------------
+struct QUANTIZE_REPORT
+{
+    float       MaxPositionError;   // Largest position error (world units)
+    float       MeanPositionError;  // Mean position error (world units)
+    ULONG       MaxColorError;      // Largest error in any 8 bit RGB channel
+    ULONG       BytesBefore;        // Size of the CVertex data
+    ULONG       BytesAfter;         // Size of the CCompactVertex data
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CVertexQuantizer (Class)
+// Desc : Encode / decode kernels for the compact vertex format. The SIMD
+//        (SSE2) kernels process two vertices per iteration and produce
+//        results identical to the scalar versions.
+//-----------------------------------------------------------------------------
+class CVertexQuantizer
+{
+public:
+	//-------------------------------------------------------------------------
+	// Public Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static void     ComputeParams   ( const CVertex * pVertices, ULONG Count, QUANTIZE_PARAMS * pParams );
+    static void     Encode          ( const CVertex * pVertices, CCompactVertex * pOut, ULONG Count, const QUANTIZE_PARAMS & Params );
+    static void     Decode          ( const CCompactVertex * pVertices, CVertex * pOut, ULONG Count, const QUANTIZE_PARAMS & Params );
+    static void     EncodeScalar    ( const CVertex * pVertices, CCompactVertex * pOut, ULONG Count, const QUANTIZE_PARAMS & Params );
+    static void     DecodeScalar    ( const CCompactVertex * pVertices, CVertex * pOut, ULONG Count, const QUANTIZE_PARAMS & Params );
+    static void     Measure         ( const CVertex * pVertices, const CCompactVertex * pCompact, ULONG Count, const QUANTIZE_PARAMS & Params, QUANTIZE_REPORT * pReport );
+
+    static USHORT   PackColor       ( ULONG Diffuse );
+    static ULONG    UnpackColor     ( USHORT Packed );
+};
+
+#endif // _CCOMPACTVERTEX_H_
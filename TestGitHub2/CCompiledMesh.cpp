@@ -0,0 +1,484 @@
+//-----------------------------------------------------------------------------
+// File: CCompiledMesh.cpp
+//
+// Desc: Compiled (render ready) form of a CMesh. Polygon fans are flattened
+//       into a single welded vertex array and an indexed triangle list so
+//       that an entire mesh can be drawn with a single call.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CCompiledMesh Specific Includes
+//-----------------------------------------------------------------------------
+#include "CCompiledMesh.h"
+
+//-----------------------------------------------------------------------------
+// Local Structures & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const ULONG WELD_EMPTY = 0xFFFFFFFF;        // Unused hash table slot
+
+    //-------------------------------------------------------------------------
+    // Name : WELD_KEY (Struct)
+    // Desc : Hash key used to locate candidate vertices during welding. For
+    //        exact welding the position components hold the raw float bits,
+    //        otherwise they hold the grid cell containing the position.
+    //-------------------------------------------------------------------------
+    struct WELD_KEY
+    {
+        LONG    x, y, z;
+        ULONG   Diffuse;
+
+        bool operator==( const WELD_KEY & Key ) const
+            { return x == Key.x && y == Key.y && z == Key.z && Diffuse == Key.Diffuse; }
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : BuildKey ()
+    // Desc : Builds the welding key for the specified vertex.
+    //-------------------------------------------------------------------------
+    WELD_KEY BuildKey( const CVertex & v, float fCellScale )
+    {
+        WELD_KEY Key;
+        if ( fCellScale > 0.0f )
+        {
+            Key.x = (LONG)floorf( v.x * fCellScale );
+            Key.y = (LONG)floorf( v.y * fCellScale );
+            Key.z = (LONG)floorf( v.z * fCellScale );
+
+        } // End if grid key
+        else
+        {
+            // Adding zero folds -0.0 onto +0.0 so that both hash identically
+            float x = v.x + 0.0f, y = v.y + 0.0f, z = v.z + 0.0f;
+            memcpy( &Key.x, &x, sizeof(LONG) );
+            memcpy( &Key.y, &y, sizeof(LONG) );
+            memcpy( &Key.z, &z, sizeof(LONG) );
+
+        } // End if exact key
+
+        Key.Diffuse = v.Diffuse;
+        return Key;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : HashKey ()
+    // Desc : Hashes a welding key.
+    //-------------------------------------------------------------------------
+    ULONG HashKey( const WELD_KEY & Key )
+    {
+        ULONG h = (ULONG)Key.x * 73856093UL;
+        h ^= (ULONG)Key.y * 19349663UL;
+        h ^= (ULONG)Key.z * 83492791UL;
+        h ^= Key.Diffuse  * 2654435761UL;
+        return h ^ (h >> 15);
+    }
+
+}; // End Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CCompiledMesh () (Constructor)
+// Desc : CCompiledMesh Class Constructor
+//-----------------------------------------------------------------------------
+CCompiledMesh::CCompiledMesh()
+{
+	// Reset / Clear all required values
+    m_pVertex               = NULL;
+    m_nVertexCount          = 0;
+    m_pIndex                = NULL;
+    m_nIndexCount           = 0;
+    m_IndexFormat           = D3DFMT_INDEX16;
+    m_nSourceVertexCount    = 0;
+    m_pCompact              = NULL;
+    m_QuantizeParams.Scale  = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+    m_QuantizeParams.Bias   = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+    m_bBorrowed             = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CCompiledMesh () (Destructor)
+// Desc : CCompiledMesh Class Destructor
+//-----------------------------------------------------------------------------
+CCompiledMesh::~CCompiledMesh()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Releases all compiled data.
+//-----------------------------------------------------------------------------
+void CCompiledMesh::Release( )
+{
+    if ( m_pVertex  && !m_bBorrowed ) delete []m_pVertex;
+    if ( m_pIndex   && !m_bBorrowed ) delete [](UCHAR*)m_pIndex;
+    if ( m_pCompact ) delete []m_pCompact;
+
+    // Clear variables
+    m_pVertex               = NULL;
+    m_nVertexCount          = 0;
+    m_pIndex                = NULL;
+    m_nIndexCount           = 0;
+    m_IndexFormat           = D3DFMT_INDEX16;
+    m_nSourceVertexCount    = 0;
+    m_pCompact              = NULL;
+    m_bBorrowed             = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Attach ()
+// Desc : Releases any current data and references the vertex & index arrays
+//        specified directly, without copying them.
+// Note : The arrays must remain valid until this mesh is released or its data
+//        is replaced, and every index must address a valid vertex.
+//-----------------------------------------------------------------------------
+bool CCompiledMesh::Attach( CVertex * pVertices, ULONG VertexCount, void * pIndices, ULONG IndexCount, D3DFORMAT IndexFormat )
+{
+    // Validate
+    if ( !pVertices || !pIndices || IndexCount == 0 ) return false;
+    if ( IndexFormat != D3DFMT_INDEX16 && IndexFormat != D3DFMT_INDEX32 ) return false;
+
+    // Reference the data
+    Release();
+    m_pVertex            = pVertices;
+    m_nVertexCount       = VertexCount;
+    m_pIndex             = pIndices;
+    m_nIndexCount        = IndexCount;
+    m_IndexFormat        = IndexFormat;
+    m_nSourceVertexCount = VertexCount;
+    m_bBorrowed          = true;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Compile ()
+// Desc : Converts the polygon fans of the specified mesh into a welded vertex
+//        array and an indexed triangle list.
+// Note : Vertices are welded when their colours match exactly and their
+//        positions match to within fWeldEpsilon on every axis (0 = exact).
+//        16 bit indices are used whenever the vertex count allows it.
+//-----------------------------------------------------------------------------
+bool CCompiledMesh::Compile( const CMesh * pMesh, float fWeldEpsilon, bool bForce32Bit )
+{
+    ULONG   *pRemap = NULL, *pIndices = NULL;
+    ULONG    i, j, nSourceCount = 0, nIndexCount = 0, nTriangleCount = 0;
+    bool     bResult = false;
+
+    // Release any previous data
+    Release();
+    if ( !pMesh ) return false;
+
+    // Count source vertices and triangles
+    for ( i = 0; i < pMesh->m_nPolygonCount; i++ )
+    {
+        ULONG nCount = 0;
+        pMesh->GetPolygonVertices( i, &nCount );
+        nSourceCount += nCount;
+        if ( nCount >= 3 ) nTriangleCount += nCount - 2;
+
+    } // Next Polygon
+
+    // Nothing to compile?
+    if ( nSourceCount == 0 || nTriangleCount == 0 ) return false;
+
+    // Allocate working buffers
+    if (!( pRemap   = new ULONG[ nSourceCount ] )) goto Cleanup;
+    if (!( pIndices = new ULONG[ nTriangleCount * 3 ] )) goto Cleanup;
+
+    // Weld the vertices and obtain the source to welded remap table
+    if ( WeldVertices( pMesh, fWeldEpsilon, pRemap ) == 0 ) goto Cleanup;
+
+    // Triangulate each fan using the welded vertex indices
+    for ( nSourceCount = 0, i = 0; i < pMesh->m_nPolygonCount; i++ )
+    {
+        ULONG nCount = 0;
+        pMesh->GetPolygonVertices( i, &nCount );
+
+        for ( j = 1; j + 1 < nCount; j++ )
+        {
+            ULONG a = pRemap[ nSourceCount ], b = pRemap[ nSourceCount + j ], c = pRemap[ nSourceCount + j + 1 ];
+
+            // Skip triangles which welding has collapsed
+            if ( a == b || b == c || a == c ) continue;
+            pIndices[ nIndexCount++ ] = a;
+            pIndices[ nIndexCount++ ] = b;
+            pIndices[ nIndexCount++ ] = c;
+
+        } // Next Triangle
+
+        nSourceCount += nCount;
+
+    } // Next Polygon
+
+    // Pack the index buffer
+    if ( nIndexCount == 0 ) goto Cleanup;
+    if ( !SetData( NULL, 0, pIndices, nIndexCount, bForce32Bit ) ) goto Cleanup;
+
+    // Record the original vertex count for reporting
+    m_nSourceVertexCount = nSourceCount;
+    bResult = true;
+
+Cleanup:
+    if ( pRemap   ) delete []pRemap;
+    if ( pIndices ) delete []pIndices;
+    if ( !bResult ) Release();
+    return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetData ()
+// Desc : Replaces the compiled data with the vertex and index data specified.
+//        Passing NULL vertices keeps the vertex array currently stored.
+//-----------------------------------------------------------------------------
+bool CCompiledMesh::SetData( const CVertex * pVertices, ULONG VertexCount, const ULONG * pIndices, ULONG IndexCount, bool bForce32Bit )
+{
+    CVertex * pNewVertex = NULL;
+    UCHAR   * pNewIndex  = NULL;
+    D3DFORMAT Format;
+
+    // Replace the vertex array?
+    if ( pVertices )
+    {
+        if (!( pNewVertex = new CVertex[ VertexCount ] )) return false;
+        memcpy( pNewVertex, pVertices, VertexCount * sizeof(CVertex) );
+
+    } // End if new vertices
+    else
+    {
+        VertexCount = m_nVertexCount;
+
+        // Borrowed vertices are copied so that everything we hold is our own
+        if ( m_bBorrowed && m_pVertex )
+        {
+            if (!( pNewVertex = new CVertex[ VertexCount ] )) return false;
+            memcpy( pNewVertex, m_pVertex, VertexCount * sizeof(CVertex) );
+        
+        } // End if borrowed
+
+    } // End if keep vertices
+
+    // Select the smallest index format that can address every vertex
+    Format = ( bForce32Bit || VertexCount > 0xFFFF ) ? D3DFMT_INDEX32 : D3DFMT_INDEX16;
+
+    // Allocate & fill the index buffer
+    if (!( pNewIndex = new UCHAR[ IndexCount * (Format == D3DFMT_INDEX32 ? 4 : 2) ] )) { delete []pNewVertex; return false; }
+    if ( Format == D3DFMT_INDEX32 )
+    {
+        memcpy( pNewIndex, pIndices, IndexCount * sizeof(ULONG) );
+
+    } // End if 32 bit
+    else
+    {
+        USHORT * pIndex16 = (USHORT*)pNewIndex;
+        for ( ULONG i = 0; i < IndexCount; i++ ) pIndex16[i] = (USHORT)pIndices[i];
+
+    } // End if 16 bit
+
+    // Store the new data
+    if ( pNewVertex )
+    {
+        if ( m_pVertex && !m_bBorrowed ) delete []m_pVertex;
+        m_pVertex      = pNewVertex;
+        m_nVertexCount = VertexCount;
+
+    } // End if new vertices
+
+    // Any quantised copy is stale once the vertices are replaced
+    if ( pVertices )
+    {
+        if ( m_pCompact ) delete []m_pCompact;
+        m_pCompact = NULL;
+
+    } // End if replaced
+    if ( m_pIndex && !m_bBorrowed ) delete [](UCHAR*)m_pIndex;
+    m_pIndex      = pNewIndex;
+    m_nIndexCount = IndexCount;
+    m_IndexFormat = Format;
+    m_bBorrowed   = false;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Quantize ()
+// Desc : Builds the compact (quantised) copy of the vertex array, optionally
+//        reporting the error introduced and discarding the float vertices.
+// Note : Any reordering (see CMeshOptimizer) should be done beforehand.
+//-----------------------------------------------------------------------------
+bool CCompiledMesh::Quantize( QUANTIZE_REPORT * pReport, bool bDiscardSource )
+{
+    CCompactVertex * pCompact = NULL;
+
+    // Need float vertices to quantise from
+    if ( !m_pVertex || m_nVertexCount == 0 ) return false;
+
+    // Encode the vertices
+    if (!( pCompact = new CCompactVertex[ m_nVertexCount ] )) return false;
+    CVertexQuantizer::ComputeParams( m_pVertex, m_nVertexCount, &m_QuantizeParams );
+    CVertexQuantizer::Encode( m_pVertex, pCompact, m_nVertexCount, m_QuantizeParams );
+
+    // Report the error introduced
+    if ( pReport ) CVertexQuantizer::Measure( m_pVertex, pCompact, m_nVertexCount, m_QuantizeParams, pReport );
+
+    // Store compact vertices
+    if ( m_pCompact ) delete []m_pCompact;
+    m_pCompact = pCompact;
+
+    // Discard the float copy?
+    if ( bDiscardSource )
+    {
+        if ( !m_bBorrowed ) delete []m_pVertex;
+        m_pVertex = NULL;
+
+    } // End if discard
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DecodeVertices ()
+// Desc : Decodes the compact vertices into the CVertex array specified, which
+//        must have room for GetVertexCount() vertices.
+//-----------------------------------------------------------------------------
+bool CCompiledMesh::DecodeVertices( CVertex * pOut ) const
+{
+    if ( !m_pCompact ) return false;
+    CVertexQuantizer::Decode( m_pCompact, pOut, m_nVertexCount, m_QuantizeParams );
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetIndex ()
+// Desc : Retrieves a single index regardless of the index format in use.
+//-----------------------------------------------------------------------------
+ULONG CCompiledMesh::GetIndex( ULONG i ) const
+{
+    if ( m_IndexFormat == D3DFMT_INDEX32 ) return ((const ULONG*)m_pIndex)[i];
+    return ((const USHORT*)m_pIndex)[i];
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetIndex ()
+// Desc : Stores a single index regardless of the index format in use.
+//-----------------------------------------------------------------------------
+void CCompiledMesh::SetIndex( ULONG i, ULONG Value )
+{
+    if ( m_IndexFormat == D3DFMT_INDEX32 ) ((ULONG*)m_pIndex)[i] = Value;
+    else ((USHORT*)m_pIndex)[i] = (USHORT)Value;
+}
+
+//-----------------------------------------------------------------------------
+// Name : WeldVertices () (Private)
+// Desc : Builds the welded vertex array, filling pRemap with the welded index
+//        for each source vertex (in polygon order). Returns the number of
+//        unique vertices or 0 on failure.
+//-----------------------------------------------------------------------------
+ULONG CCompiledMesh::WeldVertices( const CMesh * pMesh, float fWeldEpsilon, ULONG * pRemap )
+{
+    CVertex  *pUnique = NULL;
+    WELD_KEY *pKeys   = NULL;
+    ULONG    *pTable  = NULL;
+    ULONG     i, j, nSourceCount = 0, nUniqueCount = 0, nTableSize = 1, nMask;
+    float     fCellScale = ( fWeldEpsilon > 0.0f ) ? 1.0f / fWeldEpsilon : 0.0f;
+
+    // Count the source vertices
+    for ( i = 0; i < pMesh->m_nPolygonCount; i++ )
+    {
+        ULONG nCount = 0;
+        pMesh->GetPolygonVertices( i, &nCount );
+        nSourceCount += nCount;
+
+    } // Next Polygon
+
+    // Size the table to keep the load factor at or below one half
+    while ( nTableSize < nSourceCount * 2 ) nTableSize <<= 1;
+    nMask = nTableSize - 1;
+
+    // Allocate working memory
+    pUnique = new CVertex[ nSourceCount ];
+    pKeys   = new WELD_KEY[ nSourceCount ];
+    pTable  = new ULONG[ nTableSize ];
+    if ( !pUnique || !pKeys || !pTable ) { nUniqueCount = 0; goto Cleanup; }
+    memset( pTable, 0xFF, nTableSize * sizeof(ULONG) );
+
+    // Process every source vertex in polygon order
+    for ( nSourceCount = 0, i = 0; i < pMesh->m_nPolygonCount; i++ )
+    {
+        ULONG           nCount   = 0;
+        const CVertex * pVertex  = pMesh->GetPolygonVertices( i, &nCount );
+
+        for ( j = 0; j < nCount; j++, nSourceCount++ )
+        {
+            const CVertex & v     = pVertex[j];
+            WELD_KEY        Key   = BuildKey( v, fCellScale );
+            ULONG           Match = WELD_EMPTY, Slot;
+
+            if ( fCellScale == 0.0f )
+            {
+                // Exact welding only ever needs to search the vertex's own key
+                for ( Slot = HashKey( Key ) & nMask; pTable[Slot] != WELD_EMPTY; Slot = (Slot + 1) & nMask )
+                {
+                    if ( pKeys[ pTable[Slot] ] == Key ) { Match = pTable[Slot]; break; }
+
+                } // Next Slot
+
+            } // End if exact
+            else
+            {
+                // A match within epsilon may lie in any neighbouring cell
+                for ( LONG n = 0; n < 27 && Match == WELD_EMPTY; n++ )
+                {
+                    WELD_KEY Cell = Key;
+                    Cell.x += (n % 3) - 1;
+                    Cell.y += ((n / 3) % 3) - 1;
+                    Cell.z += (n / 9) - 1;
+
+                    for ( Slot = HashKey( Cell ) & nMask; pTable[Slot] != WELD_EMPTY; Slot = (Slot + 1) & nMask )
+                    {
+                        const CVertex & u = pUnique[ pTable[Slot] ];
+                        if ( !(pKeys[ pTable[Slot] ] == Cell) ) continue;
+                        if ( fabsf( u.x - v.x ) > fWeldEpsilon || fabsf( u.y - v.y ) > fWeldEpsilon || fabsf( u.z - v.z ) > fWeldEpsilon ) continue;
+                        Match = pTable[Slot];
+                        break;
+
+                    } // Next Slot
+
+                } // Next Neighbour Cell
+
+            } // End if epsilon
+
+            // Add a new unique vertex if no match was found
+            if ( Match == WELD_EMPTY )
+            {
+                Match = nUniqueCount++;
+                pUnique[ Match ] = v;
+                pKeys  [ Match ] = Key;
+
+                for ( Slot = HashKey( Key ) & nMask; pTable[Slot] != WELD_EMPTY; Slot = (Slot + 1) & nMask );
+                pTable[ Slot ] = Match;
+
+            } // End if new vertex
+
+            pRemap[ nSourceCount ] = Match;
+
+        } // Next Vertex
+
+    } // Next Polygon
+
+    // Store the welded vertex array
+    if (!( m_pVertex = new CVertex[ nUniqueCount ] )) { nUniqueCount = 0; goto Cleanup; }
+    memcpy( m_pVertex, pUnique, nUniqueCount * sizeof(CVertex) );
+    m_nVertexCount = nUniqueCount;
+
+Cleanup:
+    if ( pUnique ) delete []pUnique;
+    if ( pKeys   ) delete []pKeys;
+    if ( pTable  ) delete []pTable;
+    return nUniqueCount;
+}
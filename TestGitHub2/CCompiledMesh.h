@@ -0,0 +1,94 @@
+//-----------------------------------------------------------------------------
+// File: CCompiledMesh.h
+//
+// Desc: Compiled (render ready) form of a CMesh. Polygon fans are flattened
+//       into a single welded vertex array and an indexed triangle list so
+//       that an entire mesh can be drawn with a single call.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CCOMPILEDMESH_H_
+#define _CCOMPILEDMESH_H_
+
+//-----------------------------------------------------------------------------
+// CCompiledMesh Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CObject.h"
+#include "CCompactVertex.h"
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CCompiledMesh (Class)
+// Desc : Stores a deduplicated vertex array plus a 16 or 32 bit index buffer
+//        describing a triangle list.
+// Note : The vertex array may optionally be quantised into the compact vertex
+//        format, in which case the float copy may be discarded. Meshes that
+//        have discarded their float vertices must be decoded before drawing.
+//        Attached (borrowed) data is never freed here, and is replaced with
+//        owned copies the first time SetData is called.
+//-----------------------------------------------------------------------------
+class CCompiledMesh
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CCompiledMesh();
+	virtual ~CCompiledMesh();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Compile         ( const CMesh * pMesh, float fWeldEpsilon = 0.0f, bool bForce32Bit = false );
+    bool            SetData         ( const CVertex * pVertices, ULONG VertexCount, const ULONG * pIndices, ULONG IndexCount, bool bForce32Bit = false );
+    void            Release         ( );
+    bool            Attach          ( CVertex * pVertices, ULONG VertexCount, void * pIndices, ULONG IndexCount, D3DFORMAT IndexFormat );
+    bool            Quantize        ( QUANTIZE_REPORT * pReport = NULL, bool bDiscardSource = false );
+    bool            DecodeVertices  ( CVertex * pOut ) const;
+
+    ULONG           GetIndex        ( ULONG i ) const;
+    void            SetIndex        ( ULONG i, ULONG Value );
+
+    const CVertex * GetVertices     ( ) const { return m_pVertex; }
+    CVertex       * GetVertices     ( )       { return m_pVertex; }
+    ULONG           GetVertexCount  ( ) const { return m_nVertexCount; }
+    const void    * GetIndices      ( ) const { return m_pIndex; }
+    ULONG           GetIndexCount   ( ) const { return m_nIndexCount; }
+    ULONG           GetTriangleCount( ) const { return m_nIndexCount / 3; }
+    D3DFORMAT       GetIndexFormat  ( ) const { return m_IndexFormat; }
+    ULONG           GetIndexStride  ( ) const { return (m_IndexFormat == D3DFMT_INDEX32) ? 4 : 2; }
+    ULONG           GetSourceVertexCount( ) const { return m_nSourceVertexCount; }
+    bool            IsQuantized     ( ) const { return m_pCompact != NULL; }
+    bool            IsBorrowed      ( ) const { return m_bBorrowed; }
+    const CCompactVertex  * GetCompactVertices( ) const { return m_pCompact; }
+    const QUANTIZE_PARAMS & GetQuantizeParams ( ) const { return m_QuantizeParams; }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    ULONG           WeldVertices    ( const CMesh * pMesh, float fWeldEpsilon, ULONG * pRemap );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    CVertex        *m_pVertex;              // Welded vertex array
+    ULONG           m_nVertexCount;         // Number of welded vertices
+    void           *m_pIndex;               // Triangle list indices (16 or 32 bit)
+    ULONG           m_nIndexCount;          // Number of indices stored
+    D3DFORMAT       m_IndexFormat;          // D3DFMT_INDEX16 or D3DFMT_INDEX32
+    ULONG           m_nSourceVertexCount;   // Vertex count of the mesh before welding
+    CCompactVertex *m_pCompact;             // Quantised copy of the vertex array (optional)
+    QUANTIZE_PARAMS m_QuantizeParams;       // Decode parameters for m_pCompact
+    bool            m_bBorrowed;            // Vertex & index arrays are externally owned
+
+    // Compiled meshes own raw memory, copying is not supported.
+    CCompiledMesh( const CCompiledMesh & );
+    CCompiledMesh & operator=( const CCompiledMesh & );
+};
+
+#endif // _CCOMPILEDMESH_H_
@@ -0,0 +1,182 @@
+//-----------------------------------------------------------------------------
+// File: CD3DDynamicBuffer.cpp
+//
+// Desc: Direct3D 9 dynamic vertex buffer, shared by all streamed geometry
+//       and managed as a frame fenced ring.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CD3DDynamicBuffer Specific Includes
+//-----------------------------------------------------------------------------
+#include "CD3DDynamicBuffer.h"
+
+//-----------------------------------------------------------------------------
+// Name : CD3DDynamicBuffer () (Constructor)
+// Desc : CD3DDynamicBuffer Class Constructor
+//-----------------------------------------------------------------------------
+CD3DDynamicBuffer::CD3DDynamicBuffer()
+{
+	// Reset / Clear all required values
+    m_pDevice    = NULL;
+    m_pBuffer    = NULL;
+    m_nSize      = 0;
+    m_nMaxFrames = 1;
+    m_nPollFrame = 0;
+    ZeroMemory( m_pFences, sizeof(m_pFences) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CD3DDynamicBuffer () (Destructor)
+// Desc : CD3DDynamicBuffer Class Destructor
+//-----------------------------------------------------------------------------
+CD3DDynamicBuffer::~CD3DDynamicBuffer()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Creates the buffer, along with a fence for each frame in flight.
+//-----------------------------------------------------------------------------
+bool CD3DDynamicBuffer::Create( LPDIRECT3DDEVICE9 pDevice, ULONG Size, ULONG MaxFramesInFlight )
+{
+    // Release any previous resources
+    Release();
+    if ( !pDevice || Size == 0 ) return false;
+
+    if ( MaxFramesInFlight < 1 ) MaxFramesInFlight = 1;
+    if ( MaxFramesInFlight > RING_MAX_FRAMES ) MaxFramesInFlight = RING_MAX_FRAMES;
+
+    m_pDevice    = pDevice;
+    m_nSize      = Size;
+    m_nMaxFrames = MaxFramesInFlight;
+    m_Ring.Create( Size, MaxFramesInFlight );
+
+    // Create the default pool resources
+    if ( !OnResetDevice() ) { Release(); return false; }
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Releases every resource we own.
+//-----------------------------------------------------------------------------
+void CD3DDynamicBuffer::Release( )
+{
+    OnLostDevice();
+    m_pDevice = NULL;
+    m_nSize   = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : OnLostDevice ()
+// Desc : Releases the buffer & fences prior to a device reset. Anything in
+//        flight is discarded along with them.
+//-----------------------------------------------------------------------------
+void CD3DDynamicBuffer::OnLostDevice( )
+{
+    if ( m_pBuffer ) m_pBuffer->Release();
+    m_pBuffer = NULL;
+
+    for ( ULONG i = 0; i < RING_MAX_FRAMES; i++ )
+    {
+        if ( m_pFences[i] ) m_pFences[i]->Release();
+        m_pFences[i] = NULL;
+
+    } // Next Fence
+
+    m_Ring.Reset();
+    m_nPollFrame = m_Ring.GetFrame();
+}
+
+//-----------------------------------------------------------------------------
+// Name : OnResetDevice ()
+// Desc : Recreates the buffer & fences following a device reset.
+//-----------------------------------------------------------------------------
+bool CD3DDynamicBuffer::OnResetDevice( )
+{
+    // Validate
+    if ( !m_pDevice ) return false;
+    if ( m_pBuffer ) return true;
+
+    if ( FAILED( m_pDevice->CreateVertexBuffer( m_nSize, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, 0, D3DPOOL_DEFAULT, &m_pBuffer, NULL ) ) ) return false;
+
+    // Fences are optional, the ring assumes the oldest frame is complete without them
+    for ( ULONG i = 0; i < m_nMaxFrames; i++ )
+    {
+        if ( FAILED( m_pDevice->CreateQuery( D3DQUERYTYPE_EVENT, &m_pFences[i] ) ) ) m_pFences[i] = NULL;
+
+    } // Next Fence
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Lock ()
+// Desc : Appends Size bytes to the buffer, returning a pointer to write
+//        them to and their offset from the start of the buffer.
+// Note : Returns NULL if the data couldn't be locked, in which case the
+//        caller should fall back to drawing from user memory.
+//-----------------------------------------------------------------------------
+void * CD3DDynamicBuffer::Lock( ULONG Size, ULONG Alignment, ULONG * pOffset )
+{
+    void * pLocked = NULL;
+    bool   bDiscard;
+
+    // Validate
+    if ( !m_pBuffer ) return NULL;
+
+    // Find out where it goes, and whether the buffer must be discarded first
+    PollFences();
+    if ( !m_Ring.Allocate( Size, Alignment, pOffset, &bDiscard ) ) return NULL;
+    if ( FAILED( m_pBuffer->Lock( *pOffset, Size, &pLocked, bDiscard ? D3DLOCK_DISCARD : D3DLOCK_NOOVERWRITE ) ) ) return NULL;
+
+    return pLocked;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Unlock ()
+// Desc : Unlocks the data returned by the previous Lock.
+//-----------------------------------------------------------------------------
+void CD3DDynamicBuffer::Unlock( )
+{
+    if ( m_pBuffer ) m_pBuffer->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndFrame ()
+// Desc : Fences the data appended during this frame. Should be called once
+//        the frame's draws have been submitted, prior to Present.
+//-----------------------------------------------------------------------------
+void CD3DDynamicBuffer::EndFrame( )
+{
+    ULONG Frame = m_Ring.GetFrame();
+
+    // The ring gives up on frames older than this, so stop polling them
+    if ( Frame - m_nPollFrame >= m_nMaxFrames ) m_nPollFrame = Frame - m_nMaxFrames + 1;
+
+    // Signal once the device reaches this point
+    if ( m_pFences[ Frame % m_nMaxFrames ] ) m_pFences[ Frame % m_nMaxFrames ]->Issue( D3DISSUE_END );
+    m_Ring.EndFrame();
+}
+
+//-----------------------------------------------------------------------------
+// Name : PollFences () (Private)
+// Desc : Retires each frame the device has finished with, oldest first,
+//        without waiting on any that are still in progress.
+//-----------------------------------------------------------------------------
+void CD3DDynamicBuffer::PollFences( )
+{
+    while ( m_nPollFrame != m_Ring.GetFrame() )
+    {
+        LPDIRECT3DQUERY9 pFence = m_pFences[ m_nPollFrame % m_nMaxFrames ];
+        if ( !pFence || pFence->GetData( NULL, 0, 0 ) != S_OK ) break;
+        m_Ring.RetireFrames( m_nPollFrame++ );
+
+    } // Next Frame
+}
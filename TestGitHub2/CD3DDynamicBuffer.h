@@ -0,0 +1,74 @@
+//-----------------------------------------------------------------------------
+// File: CD3DDynamicBuffer.h
+//
+// Desc: Direct3D 9 dynamic vertex buffer, shared by all streamed geometry
+//       and managed as a frame fenced ring.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CD3DDYNAMICBUFFER_H_
+#define _CD3DDYNAMICBUFFER_H_
+
+//-----------------------------------------------------------------------------
+// CD3DDynamicBuffer Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CRingAllocator.h"
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CD3DDynamicBuffer (Class)
+// Desc : A single default pool vertex buffer which vertex and instance data
+//        for many draws is appended to. An event query is issued at the end
+//        of each frame, and the space that frame used is reused once the
+//        query reports that the device has finished with it.
+// Note : Devices without event queries fall back to the ring's limit on the
+//        number of frames in flight.
+//-----------------------------------------------------------------------------
+class CD3DDynamicBuffer
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CD3DDynamicBuffer();
+	virtual ~CD3DDynamicBuffer();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Create          ( LPDIRECT3DDEVICE9 pDevice, ULONG Size, ULONG MaxFramesInFlight );
+    void            Release         ( );
+    void            OnLostDevice    ( );
+    bool            OnResetDevice   ( );
+
+    void          * Lock            ( ULONG Size, ULONG Alignment, ULONG * pOffset );
+    void            Unlock          ( );
+    void            EndFrame        ( );
+
+    LPDIRECT3DVERTEXBUFFER9 GetBuffer( ) const { return m_pBuffer; }
+    const RING_STATS & GetStats     ( ) const { return m_Ring.GetStats(); }
+    void            ResetStats      ( ) { m_Ring.ResetStats(); }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    void            PollFences      ( );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    LPDIRECT3DDEVICE9       m_pDevice;          // Device the buffer belongs to
+    LPDIRECT3DVERTEXBUFFER9 m_pBuffer;          // Dynamic, write only vertex buffer (default pool)
+    LPDIRECT3DQUERY9        m_pFences[ RING_MAX_FRAMES ]; // Event issued at the end of each frame in flight
+    ULONG                   m_nSize;            // Size of m_pBuffer in bytes
+    ULONG                   m_nMaxFrames;       // Frames that may be in flight
+    ULONG                   m_nPollFrame;       // Oldest frame whose fence has not been seen
+    CRingAllocator          m_Ring;             // Space in m_pBuffer
+};
+
+#endif // _CD3DDYNAMICBUFFER_H_
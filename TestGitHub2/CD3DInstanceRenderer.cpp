@@ -0,0 +1,296 @@
+//-----------------------------------------------------------------------------
+// File: CD3DInstanceRenderer.cpp
+//
+// Desc: Direct3D 9 hardware instancing renderer, drawing every instance of a
+//       compiled mesh with a single DrawIndexedPrimitive call.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CD3DInstanceRenderer Specific Includes
+//-----------------------------------------------------------------------------
+#include "CD3DInstanceRenderer.h"
+
+//-----------------------------------------------------------------------------
+// Module Local Constants
+//-----------------------------------------------------------------------------
+namespace
+{
+    // Stream 0 carries the mesh vertices, stream 1 the instance matrices
+    const D3DVERTEXELEMENT9 InstanceElements[] =
+    {
+        { 0,  0, D3DDECLTYPE_FLOAT3,   D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
+        { 0, 12, D3DDECLTYPE_D3DCOLOR, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_COLOR,    0 },
+        { 1,  0, D3DDECLTYPE_FLOAT4,   D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 0 },
+        { 1, 16, D3DDECLTYPE_FLOAT4,   D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 1 },
+        { 1, 32, D3DDECLTYPE_FLOAT4,   D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD, 2 },
+        D3DDECL_END()
+    };
+
+    // Transforms by the instance matrix columns, then the view / projection
+    const char InstanceVertexShader[] =
+        "float4x4 ViewProj : register(c0);\n"
+        "struct VS_OUTPUT { float4 Pos : POSITION; float4 Color : COLOR0; };\n"
+        "VS_OUTPUT main( float3 Pos : POSITION, float4 Color : COLOR0,\n"
+        "                float4 World0 : TEXCOORD0, float4 World1 : TEXCOORD1, float4 World2 : TEXCOORD2 )\n"
+        "{\n"
+        "    VS_OUTPUT Out;\n"
+        "    float4 Local = float4( Pos, 1.0f );\n"
+        "    Out.Pos   = mul( float4( dot( Local, World0 ), dot( Local, World1 ), dot( Local, World2 ), 1.0f ), ViewProj );\n"
+        "    Out.Color = Color;\n"
+        "    return Out;\n"
+        "}\n";
+
+    // vs_3_0 cannot be paired with the fixed function pixel pipeline
+    const char InstancePixelShader[] =
+        "float4 main( float4 Color : COLOR0 ) : COLOR0 { return Color; }\n";
+
+    //-------------------------------------------------------------------------
+    // Name : CompileShader ()
+    // Desc : Compiles one of the shaders above, returning its byte code.
+    //-------------------------------------------------------------------------
+    LPD3DXBUFFER CompileShader( const char * strSource, LPCSTR strProfile )
+    {
+        LPD3DXBUFFER pCode = NULL, pErrors = NULL;
+
+        HRESULT hRet = D3DXCompileShader( strSource, (UINT)strlen( strSource ), NULL, NULL, "main", strProfile, 0, &pCode, &pErrors, NULL );
+        if ( pErrors ) pErrors->Release();
+        if ( FAILED( hRet ) ) { if ( pCode ) pCode->Release(); return NULL; }
+
+        return pCode;
+    }
+
+}; // End Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CD3DInstanceRenderer () (Constructor)
+// Desc : CD3DInstanceRenderer Class Constructor
+//-----------------------------------------------------------------------------
+CD3DInstanceRenderer::CD3DInstanceRenderer()
+{
+	// Reset / Clear all required values
+    m_pDevice         = NULL;
+    m_pDeclaration    = NULL;
+    m_pVertexShader   = NULL;
+    m_pPixelShader    = NULL;
+    m_pStream         = NULL;
+    m_nMeshCount      = 0;
+    m_nDrawCount      = 0;
+    ZeroMemory( m_Meshes, sizeof(m_Meshes) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CD3DInstanceRenderer () (Destructor)
+// Desc : CD3DInstanceRenderer Class Destructor
+//-----------------------------------------------------------------------------
+CD3DInstanceRenderer::~CD3DInstanceRenderer()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Checks the device supports instancing, and creates the shaders &
+//        declaration. Instance data is streamed through the buffer specified.
+//-----------------------------------------------------------------------------
+bool CD3DInstanceRenderer::Create( LPDIRECT3DDEVICE9 pDevice, CD3DDynamicBuffer * pStream )
+{
+    LPD3DXBUFFER pCode = NULL;
+    D3DCAPS9     Caps;
+
+    // Release any previous resources
+    Release();
+    if ( !pDevice || !pStream ) return false;
+
+    // Instancing is only available to vs_3_0 hardware
+    if ( FAILED( pDevice->GetDeviceCaps( &Caps ) ) ) return false;
+    if ( Caps.VertexShaderVersion < D3DVS_VERSION(3,0) || Caps.PixelShaderVersion < D3DPS_VERSION(3,0) ) return false;
+    m_pDevice = pDevice;
+    m_pStream = pStream;
+
+    // Build the shaders
+    if (!( pCode = CompileShader( InstanceVertexShader, "vs_3_0" ) )) goto CreateError;
+    if ( FAILED( pDevice->CreateVertexShader( (const DWORD*)pCode->GetBufferPointer(), &m_pVertexShader ) ) ) goto CreateError;
+    pCode->Release();
+
+    if (!( pCode = CompileShader( InstancePixelShader, "ps_3_0" ) )) goto CreateError;
+    if ( FAILED( pDevice->CreatePixelShader( (const DWORD*)pCode->GetBufferPointer(), &m_pPixelShader ) ) ) goto CreateError;
+    pCode->Release();
+    pCode = NULL;
+
+    // Describe the streams
+    if ( FAILED( pDevice->CreateVertexDeclaration( InstanceElements, &m_pDeclaration ) ) ) goto CreateError;
+
+    // Success!
+    return true;
+
+CreateError:
+    if ( pCode ) pCode->Release();
+    Release();
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Releases every resource we own.
+//-----------------------------------------------------------------------------
+void CD3DInstanceRenderer::Release( )
+{
+    ReleaseMeshes();
+
+    if ( m_pDeclaration  ) m_pDeclaration->Release();
+    if ( m_pVertexShader ) m_pVertexShader->Release();
+    if ( m_pPixelShader  ) m_pPixelShader->Release();
+
+    m_pDevice       = NULL;
+    m_pStream       = NULL;
+    m_pDeclaration  = NULL;
+    m_pVertexShader = NULL;
+    m_pPixelShader  = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReleaseMeshes ()
+// Desc : Releases the buffers built for every mesh. Must be called whenever
+//        a compiled mesh we have drawn is released or modified.
+//-----------------------------------------------------------------------------
+void CD3DInstanceRenderer::ReleaseMeshes( )
+{
+    for ( ULONG i = 0; i < m_nMeshCount; i++ )
+    {
+        if ( m_Meshes[i].pVertexBuffer ) m_Meshes[i].pVertexBuffer->Release();
+        if ( m_Meshes[i].pIndexBuffer  ) m_Meshes[i].pIndexBuffer->Release();
+
+    } // Next Mesh
+
+    ZeroMemory( m_Meshes, sizeof(m_Meshes) );
+    m_nMeshCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Begin ()
+// Desc : Selects the instancing pipeline, ready for DrawInstances.
+//-----------------------------------------------------------------------------
+void CD3DInstanceRenderer::Begin( const D3DXMATRIX & mtxViewProj )
+{
+    D3DXMATRIX mtxConstant;
+
+    // Validate
+    m_nDrawCount = 0;
+    if ( !m_pDevice ) return;
+
+    // Shader matrices are column major
+    D3DXMatrixTranspose( &mtxConstant, &mtxViewProj );
+    m_pDevice->SetVertexShaderConstantF( 0, (const float*)&mtxConstant, 4 );
+
+    m_pDevice->SetVertexDeclaration( m_pDeclaration );
+    m_pDevice->SetVertexShader( m_pVertexShader );
+    m_pDevice->SetPixelShader( m_pPixelShader );
+}
+
+//-----------------------------------------------------------------------------
+// Name : End ()
+// Desc : Restores the fixed function pipeline and unit stream frequencies.
+//-----------------------------------------------------------------------------
+void CD3DInstanceRenderer::End( )
+{
+    // Validate
+    if ( !m_pDevice ) return;
+
+    m_pDevice->SetStreamSourceFreq( 0, 1 );
+    m_pDevice->SetStreamSourceFreq( 1, 1 );
+    m_pDevice->SetStreamSource( 1, NULL, 0, 0 );
+    m_pDevice->SetVertexShader( NULL );
+    m_pDevice->SetPixelShader( NULL );
+    m_pDevice->SetFVF( D3DFVF_XYZ | D3DFVF_DIFFUSE );
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawInstances ()
+// Desc : Draws every instance of the mesh, using one draw call for each
+//        INSTANCE_BUFFER_SIZE instances.
+//-----------------------------------------------------------------------------
+bool CD3DInstanceRenderer::DrawInstances( const CCompiledMesh * pMesh, const INSTANCE_DATA * pInstances, ULONG Count )
+{
+    const MESH_BUFFERS * pBuffers;
+    void               * pLocked = NULL;
+    ULONG                Offset;
+
+    // Validate
+    if ( !m_pDevice || !m_pStream || !pMesh || !pInstances || Count == 0 ) return false;
+    if (!( pBuffers = GetMeshBuffers( pMesh ) )) return false;
+
+    // Bind the mesh
+    m_pDevice->SetStreamSource( 0, pBuffers->pVertexBuffer, 0, sizeof(CVertex) );
+    m_pDevice->SetIndices( pBuffers->pIndexBuffer );
+
+    while ( Count > 0 )
+    {
+        ULONG Batch = (Count < INSTANCE_BUFFER_SIZE) ? Count : INSTANCE_BUFFER_SIZE;
+
+        // Append to the dynamic stream
+        if (!( pLocked = m_pStream->Lock( Batch * sizeof(INSTANCE_DATA), sizeof(INSTANCE_DATA), &Offset ) )) return false;
+        memcpy( pLocked, pInstances, Batch * sizeof(INSTANCE_DATA) );
+        m_pStream->Unlock();
+
+        // Repeat the mesh once for each instance
+        m_pDevice->SetStreamSourceFreq( 0, D3DSTREAMSOURCE_INDEXEDDATA | Batch );
+        m_pDevice->SetStreamSource( 1, m_pStream->GetBuffer(), Offset, sizeof(INSTANCE_DATA) );
+        m_pDevice->SetStreamSourceFreq( 1, D3DSTREAMSOURCE_INSTANCEDATA | 1 );
+        m_pDevice->DrawIndexedPrimitive( D3DPT_TRIANGLELIST, 0, 0, pMesh->GetVertexCount(), 0, pMesh->GetTriangleCount() );
+        m_nDrawCount++;
+
+        pInstances += Batch;
+        Count      -= Batch;
+
+    } // Next Batch
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetMeshBuffers () (Private)
+// Desc : Returns the buffers for the mesh, building them on first use.
+//-----------------------------------------------------------------------------
+const CD3DInstanceRenderer::MESH_BUFFERS * CD3DInstanceRenderer::GetMeshBuffers( const CCompiledMesh * pMesh )
+{
+    MESH_BUFFERS * pBuffers;
+    void         * pLocked = NULL;
+    ULONG          i;
+
+    // Already resident?
+    for ( i = 0; i < m_nMeshCount; i++ ) if ( m_Meshes[i].pMesh == pMesh ) return &m_Meshes[i];
+    if ( pMesh->GetVertexCount() == 0 || pMesh->GetIndexCount() == 0 ) return NULL;
+
+    // Start over if every slot has been taken
+    if ( m_nMeshCount == INSTANCE_MAX_MESHES ) ReleaseMeshes();
+    pBuffers = &m_Meshes[ m_nMeshCount ];
+
+    // Vertices (compact meshes are decoded directly into the buffer)
+    if ( FAILED( m_pDevice->CreateVertexBuffer( pMesh->GetVertexCount() * sizeof(CVertex), D3DUSAGE_WRITEONLY, 0,
+                                                D3DPOOL_MANAGED, &pBuffers->pVertexBuffer, NULL ) ) ) goto BuildError;
+    if ( FAILED( pBuffers->pVertexBuffer->Lock( 0, 0, &pLocked, 0 ) ) ) goto BuildError;
+    if ( pMesh->GetVertices() ) memcpy( pLocked, pMesh->GetVertices(), pMesh->GetVertexCount() * sizeof(CVertex) );
+    else pMesh->DecodeVertices( (CVertex*)pLocked );
+    pBuffers->pVertexBuffer->Unlock();
+
+    // Indices
+    if ( FAILED( m_pDevice->CreateIndexBuffer( pMesh->GetIndexCount() * pMesh->GetIndexStride(), D3DUSAGE_WRITEONLY, pMesh->GetIndexFormat(),
+                                               D3DPOOL_MANAGED, &pBuffers->pIndexBuffer, NULL ) ) ) goto BuildError;
+    if ( FAILED( pBuffers->pIndexBuffer->Lock( 0, 0, &pLocked, 0 ) ) ) goto BuildError;
+    memcpy( pLocked, pMesh->GetIndices(), pMesh->GetIndexCount() * pMesh->GetIndexStride() );
+    pBuffers->pIndexBuffer->Unlock();
+
+    // Success!
+    pBuffers->pMesh = pMesh;
+    m_nMeshCount++;
+    return pBuffers;
+
+BuildError:
+    if ( pBuffers->pVertexBuffer ) pBuffers->pVertexBuffer->Release();
+    if ( pBuffers->pIndexBuffer  ) pBuffers->pIndexBuffer->Release();
+    ZeroMemory( pBuffers, sizeof(MESH_BUFFERS) );
+    return NULL;
+}
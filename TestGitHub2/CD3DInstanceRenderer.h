@@ -0,0 +1,90 @@
+//-----------------------------------------------------------------------------
+// File: CD3DInstanceRenderer.h
+//
+// Desc: Direct3D 9 hardware instancing renderer, drawing every instance of a
+//       compiled mesh with a single DrawIndexedPrimitive call.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CD3DINSTANCERENDERER_H_
+#define _CD3DINSTANCERENDERER_H_
+
+//-----------------------------------------------------------------------------
+// CD3DInstanceRenderer Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CInstanceBatcher.h"
+#include "CD3DDynamicBuffer.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG INSTANCE_BUFFER_SIZE    = 16384;    // Most instances streamed for a single draw call
+const ULONG INSTANCE_MAX_MESHES     = 32;       // Meshes whose buffers are kept resident
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CD3DInstanceRenderer (Class)
+// Desc : Keeps a static vertex / index buffer pair for each compiled mesh it
+//        is asked to draw, and streams instance matrices through the
+//        backend's dynamic buffer using stream source frequencies.
+// Note : Hardware instancing requires vs_3_0, so Create fails on devices
+//        which do not support it and callers should fall back to drawing
+//        each object individually. Compact meshes are decoded only once, as
+//        their buffers are filled.
+//-----------------------------------------------------------------------------
+class CD3DInstanceRenderer : public IInstanceRenderer
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CD3DInstanceRenderer();
+	virtual ~CD3DInstanceRenderer();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Create          ( LPDIRECT3DDEVICE9 pDevice, CD3DDynamicBuffer * pStream );
+    void            Release         ( );
+    void            ReleaseMeshes   ( );
+
+    void            Begin           ( const D3DXMATRIX & mtxViewProj );
+    void            End             ( );
+    virtual bool    DrawInstances   ( const CCompiledMesh * pMesh, const INSTANCE_DATA * pInstances, ULONG Count );
+
+    ULONG           GetDrawCount    ( ) const { return m_nDrawCount; }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Structures for This Class
+	//-------------------------------------------------------------------------
+    struct MESH_BUFFERS
+    {
+        const CCompiledMesh       * pMesh;          // Mesh the buffers were built from
+        LPDIRECT3DVERTEXBUFFER9     pVertexBuffer;  // Mesh vertices (managed)
+        LPDIRECT3DINDEXBUFFER9      pIndexBuffer;   // Mesh indices (managed)
+    };
+
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    const MESH_BUFFERS * GetMeshBuffers( const CCompiledMesh * pMesh );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    LPDIRECT3DDEVICE9           m_pDevice;          // Device we draw with
+    LPDIRECT3DVERTEXDECLARATION9 m_pDeclaration;    // Mesh + instance stream layout
+    LPDIRECT3DVERTEXSHADER9     m_pVertexShader;    // Applies the instance matrix
+    LPDIRECT3DPIXELSHADER9      m_pPixelShader;     // Passes the vertex colour through
+    CD3DDynamicBuffer         * m_pStream;          // Dynamic buffer the instance data is streamed through
+    MESH_BUFFERS                m_Meshes[ INSTANCE_MAX_MESHES ];
+    ULONG                       m_nMeshCount;       // Number of m_Meshes entries in use
+    ULONG                       m_nDrawCount;       // Draw calls issued since Begin
+};
+
+#endif // _CD3DINSTANCERENDERER_H_
@@ -0,0 +1,422 @@
+//-----------------------------------------------------------------------------
+// File: CD3DRenderBackend.cpp
+//
+// Desc: Direct3D 9 implementation of the rendering backend interface.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CD3DRenderBackend Specific Includes
+//-----------------------------------------------------------------------------
+#include "CD3DRenderBackend.h"
+#include "CCompiledMesh.h"
+
+//-----------------------------------------------------------------------------
+// Name : CD3DRenderBackend () (Constructor)
+// Desc : CD3DRenderBackend Class Constructor
+//-----------------------------------------------------------------------------
+CD3DRenderBackend::CD3DRenderBackend()
+{
+	// Reset / Clear all required values
+    m_pD3D          = NULL;
+    m_pD3DDevice    = NULL;
+    m_nStreamStride = 0;
+    m_nBoundStride  = 0;
+    m_bInstancing   = false;
+    m_bLostDevice   = false;
+    ZeroMemory( &m_D3DPresentParams, sizeof(D3DPRESENT_PARAMETERS) );
+    ZeroMemory( &m_Stats, sizeof(RENDER_STATS) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CD3DRenderBackend () (Destructor)
+// Desc : CD3DRenderBackend Class Destructor
+//-----------------------------------------------------------------------------
+CD3DRenderBackend::~CD3DRenderBackend()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Performs a simple, non-enumerated, initialization of Direct3D, and
+//        creates the instancing renderer if requested.
+// Note : Instancing needs shader model 3, so SupportsInstancing reports false
+//        on devices without it.
+//-----------------------------------------------------------------------------
+bool CD3DRenderBackend::Create( HWND hWnd, bool bInstancing )
+{
+    HRESULT               hRet;
+    D3DPRESENT_PARAMETERS PresentParams;
+    D3DCAPS9              Caps;
+	D3DDISPLAYMODE        CurrentMode;
+
+    // First of all create our D3D Object
+    m_pD3D = Direct3DCreate9( D3D_SDK_VERSION );
+    if (!m_pD3D)
+    {
+        MessageBox( hWnd, _T("No compatible Direct3D object could be created."), _T("Fatal Error!"), MB_OK | MB_ICONSTOP | MB_APPLMODAL );
+        return false;
+
+    } // End if failure
+
+    // Fill out a simple set of present parameters
+    ZeroMemory( &PresentParams, sizeof(D3DPRESENT_PARAMETERS) );
+
+    // Select back buffer format etc
+	m_pD3D->GetAdapterDisplayMode( D3DADAPTER_DEFAULT, &CurrentMode);
+	PresentParams.BackBufferFormat = CurrentMode.Format;
+
+	// Setup remaining flags
+	PresentParams.AutoDepthStencilFormat = FindDepthStencilFormat( D3DADAPTER_DEFAULT, CurrentMode, D3DDEVTYPE_HAL );
+    PresentParams.SwapEffect			 = D3DSWAPEFFECT_DISCARD;
+    PresentParams.PresentationInterval   = D3DPRESENT_INTERVAL_IMMEDIATE;
+	PresentParams.Windowed				 = true;
+	PresentParams.EnableAutoDepthStencil = true;
+
+	// Set Creation Flags
+	unsigned long ulFlags = D3DCREATE_SOFTWARE_VERTEXPROCESSING;
+
+    // Check if Hardware T&L is available
+    ZeroMemory( &Caps, sizeof(D3DCAPS9) );
+    m_pD3D->GetDeviceCaps( D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, &Caps );
+    if ( Caps.DevCaps & D3DDEVCAPS_HWTRANSFORMANDLIGHT ) ulFlags = D3DCREATE_HARDWARE_VERTEXPROCESSING;
+
+    // Attempt to create a HAL device
+    if( FAILED( hRet = m_pD3D->CreateDevice( D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, hWnd, ulFlags, &PresentParams, &m_pD3DDevice ) ) )
+    {
+        MessageBox( hWnd, _T("Could not create a valid HAL Direct3D device object.\r\n\r\n")
+                          _T("The system will now attempt to create a device utilising the 'Reference Rasterizer' (D3DDEVTYPE_REF)"),
+                          _T("Fatal Error!"), MB_OK | MB_ICONINFORMATION | MB_APPLMODAL );
+
+        // Find REF depth buffer format
+        PresentParams.AutoDepthStencilFormat = FindDepthStencilFormat( D3DADAPTER_DEFAULT, CurrentMode, D3DDEVTYPE_REF );
+
+        // Check if Hardware T&L is available
+        ZeroMemory( &Caps, sizeof(D3DCAPS9) );
+        ulFlags = D3DCREATE_SOFTWARE_VERTEXPROCESSING;
+        m_pD3D->GetDeviceCaps( D3DADAPTER_DEFAULT, D3DDEVTYPE_REF, &Caps );
+        if ( Caps.DevCaps & D3DDEVCAPS_HWTRANSFORMANDLIGHT ) ulFlags = D3DCREATE_HARDWARE_VERTEXPROCESSING;
+
+        // Attempt to create a REF device
+        if( FAILED( hRet = m_pD3D->CreateDevice( D3DADAPTER_DEFAULT, D3DDEVTYPE_REF, hWnd, ulFlags, &PresentParams, &m_pD3DDevice ) ) )
+        {
+            MessageBox( hWnd, _T("Could not create a valid REF Direct3D device object.\r\n\r\nThe system will now exit."),
+                              _T("Fatal Error!"), MB_OK | MB_ICONSTOP | MB_APPLMODAL );
+
+            // Failed
+            return false;
+
+        } // End if Failure (REF)
+
+    } // End if Failure (HAL)
+
+    // Store the present parameters
+    m_D3DPresentParams = PresentParams;
+
+    // Create the dynamic stream, drawing from user memory without it
+    m_Stream.Create( m_pD3DDevice, DYNAMIC_STREAM_SIZE, DYNAMIC_FRAMES_IN_FLIGHT );
+
+    // Create the instancing renderer, falling back to per object drawing without it
+    if ( bInstancing && m_Stream.GetBuffer() ) m_bInstancing = m_InstanceRenderer.Create( m_pD3DDevice, &m_Stream );
+
+    // Success!!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Destroys the device and every resource created with it.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::Release( )
+{
+    m_InstanceRenderer.Release();
+    m_Stream.Release();
+    if ( m_pD3DDevice ) m_pD3DDevice->Release();
+    if ( m_pD3D       ) m_pD3D->Release();
+    m_pD3D         = NULL;
+    m_pD3DDevice   = NULL;
+    m_nBoundStride = 0;
+    m_bInstancing  = false;
+    m_bLostDevice  = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : FindDepthStencilFormat () (Private)
+// Desc : This function simply determines the best depth format that is
+//        available for the specified mode.
+// Note : No tests for stencil active depth buffers are made.
+//-----------------------------------------------------------------------------
+D3DFORMAT CD3DRenderBackend::FindDepthStencilFormat( ULONG AdapterOrdinal, D3DDISPLAYMODE Mode, D3DDEVTYPE DevType )
+{
+
+    // Test for 24 bith depth buffer
+    if (SUCCEEDED( m_pD3D->CheckDeviceFormat(AdapterOrdinal, DevType, Mode.Format, D3DUSAGE_DEPTHSTENCIL , D3DRTYPE_SURFACE , D3DFMT_D32 )))
+    {
+        if (SUCCEEDED( m_pD3D->CheckDepthStencilMatch ( AdapterOrdinal, DevType, Mode.Format, Mode.Format, D3DFMT_D32 ))) return D3DFMT_D32;
+
+    } // End if 32bpp Available
+
+    // Test for 24 bit depth buffer
+    if (SUCCEEDED( m_pD3D->CheckDeviceFormat(AdapterOrdinal, DevType, Mode.Format, D3DUSAGE_DEPTHSTENCIL , D3DRTYPE_SURFACE , D3DFMT_D24X8 )))
+    {
+        if (SUCCEEDED( m_pD3D->CheckDepthStencilMatch ( AdapterOrdinal, DevType, Mode.Format, Mode.Format, D3DFMT_D24X8 ))) return D3DFMT_D24X8;
+
+    } // End if 24bpp Available
+
+    // Test for 16 bit depth buffer
+    if (SUCCEEDED( m_pD3D->CheckDeviceFormat(AdapterOrdinal, DevType, Mode.Format, D3DUSAGE_DEPTHSTENCIL , D3DRTYPE_SURFACE , D3DFMT_D16 )))
+    {
+        if (SUCCEEDED( m_pD3D->CheckDepthStencilMatch ( AdapterOrdinal, DevType, Mode.Format, Mode.Format, D3DFMT_D16 ))) return D3DFMT_D16;
+
+    } // End if 16bpp Available
+
+    // No depth buffer supported
+    return D3DFMT_UNKNOWN;
+
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetDevice () (Private)
+// Desc : Resets the device with the current present parameters, releasing
+//        and recreating the default pool resources around it.
+//-----------------------------------------------------------------------------
+bool CD3DRenderBackend::ResetDevice( )
+{
+    HRESULT hRet;
+
+    m_Stream.OnLostDevice();
+    m_nBoundStride = 0;
+    hRet = m_pD3DDevice->Reset( &m_D3DPresentParams );
+    if ( FAILED( hRet ) ) return false;
+    m_Stream.OnResetDevice();
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Restore ()
+// Desc : Attempts to recover a lost device. Returns true once the device is
+//        usable again, at which point all states must be set again.
+//-----------------------------------------------------------------------------
+bool CD3DRenderBackend::Restore( )
+{
+    // Validate
+    if ( !m_pD3DDevice ) return false;
+    if ( !m_bLostDevice ) return true;
+
+    // Can we reset the device yet ?
+    if ( m_pD3DDevice->TestCooperativeLevel() != D3DERR_DEVICENOTRESET ) return false;
+    if ( !ResetDevice() ) return false;
+
+    m_bLostDevice = false;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Resize ()
+// Desc : Resizes the back buffer to match the new viewport.
+//-----------------------------------------------------------------------------
+bool CD3DRenderBackend::Resize( ULONG Width, ULONG Height )
+{
+    // Validate
+    if ( !m_pD3DDevice ) return false;
+
+    // Store new sizes
+    m_D3DPresentParams.BackBufferWidth  = Width;
+    m_D3DPresentParams.BackBufferHeight = Height;
+
+    // Reset the device
+    return ResetDevice();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Clear ()
+// Desc : Clears the current render target.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::Clear( ULONG Flags, D3DCOLOR Color, float fZ )
+{
+    m_pD3DDevice->Clear( 0, NULL, Flags, Color, fZ, 0 );
+    m_Stats.Clears++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BeginScene ()
+// Desc : Begins scene rendering.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::BeginScene( )
+{
+    m_pD3DDevice->BeginScene();
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndScene ()
+// Desc : Ends scene rendering.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::EndScene( )
+{
+    m_pD3DDevice->EndScene();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Present ()
+// Desc : Presents the back buffer, flagging the device as lost on failure.
+//-----------------------------------------------------------------------------
+bool CD3DRenderBackend::Present( )
+{
+    m_Stats.Frames++;
+    m_Stream.EndFrame();
+    if ( FAILED(m_pD3DDevice->Present( NULL, NULL, NULL, NULL )) ) { m_bLostDevice = true; return false; }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetRenderState ()
+// Desc : Sets a device render state.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::SetRenderState( D3DRENDERSTATETYPE State, ULONG Value )
+{
+    m_pD3DDevice->SetRenderState( State, Value );
+    m_Stats.StateChanges++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetTransform ()
+// Desc : Sets a device transform matrix.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::SetTransform( D3DTRANSFORMSTATETYPE State, const D3DXMATRIX & mtx )
+{
+    m_pD3DDevice->SetTransform( State, &mtx );
+    m_Stats.TransformChanges++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetFVF ()
+// Desc : Sets the fixed function vertex format.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::SetFVF( ULONG FVF )
+{
+    m_pD3DDevice->SetFVF( FVF );
+    m_Stats.StateChanges++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawPrimitiveUP ()
+// Desc : Draws non indexed primitives from user memory.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::DrawPrimitiveUP( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount, const void * pVertices, ULONG Stride )
+{
+    m_pD3DDevice->DrawPrimitiveUP( Type, PrimitiveCount, pVertices, Stride );
+    m_nBoundStride = 0;
+    m_Stats.DrawCalls++;
+    m_Stats.Primitives     += PrimitiveCount;
+    m_Stats.BytesSubmitted += (ULONGLONG)GetVertexCount( Type, PrimitiveCount ) * Stride;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawIndexedPrimitiveUP ()
+// Desc : Draws indexed primitives from user memory.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::DrawIndexedPrimitiveUP( D3DPRIMITIVETYPE Type, ULONG VertexCount, ULONG PrimitiveCount, const void * pIndices,
+                                                D3DFORMAT IndexFormat, const void * pVertices, ULONG Stride )
+{
+    ULONG IndexSize = (IndexFormat == D3DFMT_INDEX32) ? 4 : 2;
+
+    m_pD3DDevice->DrawIndexedPrimitiveUP( Type, 0, VertexCount, PrimitiveCount, pIndices, IndexFormat, pVertices, Stride );
+    m_nBoundStride = 0;
+    m_Stats.DrawCalls++;
+    m_Stats.Primitives     += PrimitiveCount;
+    m_Stats.BytesSubmitted += (ULONGLONG)VertexCount * Stride;
+    m_Stats.BytesSubmitted += (ULONGLONG)GetIndexCount( Type, PrimitiveCount ) * IndexSize;
+}
+
+//-----------------------------------------------------------------------------
+// Name : LockVertices ()
+// Desc : Appends VertexCount vertices to the dynamic stream, returning the
+//        memory to write them to and the index of the first one.
+// Note : UnlockVertices must be called before drawing.
+//-----------------------------------------------------------------------------
+void * CD3DRenderBackend::LockVertices( ULONG VertexCount, ULONG Stride, ULONG * pStartVertex )
+{
+    ULONG  Offset;
+    void * pData;
+
+    // Validate
+    if ( VertexCount == 0 || Stride == 0 ) return NULL;
+
+    // Vertices must start on a multiple of the stride to be addressed by index
+    if (!( pData = m_Stream.Lock( VertexCount * Stride, Stride, &Offset ) )) return NULL;
+    m_Stats.BytesSubmitted += (ULONGLONG)VertexCount * Stride;
+    m_nStreamStride = Stride;
+    *pStartVertex   = Offset / Stride;
+    return pData;
+}
+
+//-----------------------------------------------------------------------------
+// Name : UnlockVertices ()
+// Desc : Unlocks the vertices returned by LockVertices.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::UnlockVertices( )
+{
+    m_Stream.Unlock();
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawPrimitive ()
+// Desc : Draws non indexed primitives from the dynamic stream.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::DrawPrimitive( D3DPRIMITIVETYPE Type, ULONG StartVertex, ULONG PrimitiveCount )
+{
+    // Bind the stream if something else has replaced it
+    if ( m_nBoundStride != m_nStreamStride )
+    {
+        m_pD3DDevice->SetStreamSource( 0, m_Stream.GetBuffer(), 0, m_nStreamStride );
+        m_nBoundStride = m_nStreamStride;
+
+    } // End if rebind
+
+    m_pD3DDevice->DrawPrimitive( Type, StartVertex, PrimitiveCount );
+    m_Stats.DrawCalls++;
+    m_Stats.Primitives += PrimitiveCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BeginInstancing ()
+// Desc : Prepares the device for instanced drawing. Groups should then be
+//        passed to the returned renderer, followed by EndInstancing.
+//-----------------------------------------------------------------------------
+IInstanceRenderer * CD3DRenderBackend::BeginInstancing( const D3DXMATRIX & mtxViewProj )
+{
+    if ( !m_bInstancing ) return NULL;
+    m_InstanceRenderer.Begin( mtxViewProj );
+    return this;
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndInstancing ()
+// Desc : Restores the fixed function state, and records the draw calls the
+//        instancing renderer needed.
+//-----------------------------------------------------------------------------
+void CD3DRenderBackend::EndInstancing( )
+{
+    m_InstanceRenderer.End();
+    m_nBoundStride = 0;
+    m_Stats.DrawCalls += m_InstanceRenderer.GetDrawCount();
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawInstances ()
+// Desc : Passes a group through to the instancing renderer, recording the
+//        instance data streamed. Draw calls are recorded by EndInstancing.
+//-----------------------------------------------------------------------------
+bool CD3DRenderBackend::DrawInstances( const CCompiledMesh * pMesh, const INSTANCE_DATA * pInstances, ULONG Count )
+{
+    if ( !m_InstanceRenderer.DrawInstances( pMesh, pInstances, Count ) ) return false;
+
+    m_Stats.Instances      += Count;
+    m_Stats.Primitives     += (ULONGLONG)pMesh->GetTriangleCount() * Count;
+    m_Stats.BytesSubmitted += (ULONGLONG)Count * sizeof(INSTANCE_DATA);
+    return true;
+}
@@ -0,0 +1,98 @@
+//-----------------------------------------------------------------------------
+// File: CD3DRenderBackend.h
+//
+// Desc: Direct3D 9 implementation of the rendering backend interface.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CD3DRENDERBACKEND_H_
+#define _CD3DRENDERBACKEND_H_
+
+//-----------------------------------------------------------------------------
+// CD3DRenderBackend Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CRenderBackend.h"
+#include "CD3DInstanceRenderer.h"
+#include "CD3DDynamicBuffer.h"
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CD3DRenderBackend (Class)
+// Desc : Owns the Direct3D object, device and instancing renderer, passing
+//        each call straight through to the device while keeping the same
+//        statistics as the null backend.
+// Note : Streamed vertices and instance data share a single dynamic buffer,
+//        which is bound to stream 0 again on the first DrawPrimitive after a
+//        user pointer or instanced draw has replaced it.
+//-----------------------------------------------------------------------------
+class CD3DRenderBackend : public IRenderBackend, public IInstanceRenderer
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CD3DRenderBackend();
+	virtual ~CD3DRenderBackend();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Create          ( HWND hWnd, bool bInstancing );
+    void            Release         ( );
+
+    LPDIRECT3DDEVICE9 GetDevice     ( ) const { return m_pD3DDevice; }
+
+    // IRenderBackend
+    virtual void    Clear           ( ULONG Flags, D3DCOLOR Color, float fZ );
+    virtual void    BeginScene      ( );
+    virtual void    EndScene        ( );
+    virtual bool    Present         ( );
+    virtual bool    IsLost          ( ) const { return m_bLostDevice; }
+    virtual bool    Restore         ( );
+    virtual bool    Resize          ( ULONG Width, ULONG Height );
+    virtual void    SetRenderState  ( D3DRENDERSTATETYPE State, ULONG Value );
+    virtual void    SetTransform    ( D3DTRANSFORMSTATETYPE State, const D3DXMATRIX & mtx );
+    virtual void    SetFVF          ( ULONG FVF );
+    virtual void    DrawPrimitiveUP ( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount, const void * pVertices, ULONG Stride );
+    virtual void    DrawIndexedPrimitiveUP( D3DPRIMITIVETYPE Type, ULONG VertexCount, ULONG PrimitiveCount, const void * pIndices,
+                                            D3DFORMAT IndexFormat, const void * pVertices, ULONG Stride );
+    virtual void *  LockVertices    ( ULONG VertexCount, ULONG Stride, ULONG * pStartVertex );
+    virtual void    UnlockVertices  ( );
+    virtual void    DrawPrimitive   ( D3DPRIMITIVETYPE Type, ULONG StartVertex, ULONG PrimitiveCount );
+    virtual bool    SupportsInstancing( ) const { return m_bInstancing; }
+    virtual IInstanceRenderer * BeginInstancing( const D3DXMATRIX & mtxViewProj );
+    virtual void    EndInstancing   ( );
+    virtual const RENDER_STATS & GetStats( ) const { return m_Stats; }
+    virtual const RING_STATS & GetStreamStats( ) const { return m_Stream.GetStats(); }
+    virtual void    ResetStats      ( ) { ZeroMemory( &m_Stats, sizeof(RENDER_STATS) ); m_Stream.ResetStats(); }
+
+    // IInstanceRenderer
+    virtual bool    DrawInstances   ( const CCompiledMesh * pMesh, const INSTANCE_DATA * pInstances, ULONG Count );
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            ResetDevice     ( );
+    D3DFORMAT       FindDepthStencilFormat( ULONG AdapterOrdinal, D3DDISPLAYMODE Mode, D3DDEVTYPE DevType );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    LPDIRECT3D9             m_pD3D;             // Direct3D Object
+    LPDIRECT3DDEVICE9       m_pD3DDevice;       // Direct3D Device Object
+    D3DPRESENT_PARAMETERS   m_D3DPresentParams; // Direct3D Present Parameters
+    CD3DInstanceRenderer    m_InstanceRenderer; // Draws each group of instances with a single call
+    CD3DDynamicBuffer       m_Stream;           // Dynamic vertex & instance data
+    ULONG                   m_nStreamStride;    // Stride of the most recent LockVertices
+    ULONG                   m_nBoundStride;     // Stride m_Stream is bound to stream 0 with (0 if not bound)
+    RENDER_STATS            m_Stats;            // Work submitted since the last reset
+    bool                    m_bInstancing;      // Was the instancing renderer created ?
+    bool                    m_bLostDevice;      // Is the 3d device currently lost ?
+};
+
+#endif // _CD3DRENDERBACKEND_H_
@@ -0,0 +1,169 @@
+//-----------------------------------------------------------------------------
+// File: CFrameLog.cpp
+//
+// Desc: Binary log of everything a run's simulation depends upon (random
+//       seed, scene options, and each frame's time step & input), so that the
+//       run can be replayed to produce exactly the same scene.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CFrameLog Specific Includes
+//-----------------------------------------------------------------------------
+#include "CFrameLog.h"
+
+//-----------------------------------------------------------------------------
+// Name : CFrameLog () (Constructor)
+// Desc : CFrameLog Class Constructor
+//-----------------------------------------------------------------------------
+CFrameLog::CFrameLog()
+{
+	// Reset / Clear all required values
+    m_pFile   = NULL;
+    m_pBuffer = NULL;
+    m_pFrames = NULL;
+    m_nFrames = 0;
+    ZeroMemory( &m_Header, sizeof(FRAMELOG_HEADER) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CFrameLog () (Destructor)
+// Desc : CFrameLog Class Destructor
+//-----------------------------------------------------------------------------
+CFrameLog::~CFrameLog()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Closes any recording (without completing its header) and frees any
+//        frames loaded for replay.
+//-----------------------------------------------------------------------------
+void CFrameLog::Release( )
+{
+    if ( m_pFile   ) fclose( m_pFile );
+    if ( m_pBuffer ) delete []m_pBuffer;
+    if ( m_pFrames ) delete []m_pFrames;
+
+    m_pFile   = NULL;
+    m_pBuffer = NULL;
+    m_pFrames = NULL;
+    m_nFrames = 0;
+    ZeroMemory( &m_Header, sizeof(FRAMELOG_HEADER) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Starts recording to the file specified. The seed & scene options
+//        are taken from the header given, the rest is filled in here.
+//-----------------------------------------------------------------------------
+bool CFrameLog::Create( LPCTSTR strFileName, const FRAMELOG_HEADER & Header )
+{
+    Release();
+
+    // Open the file, buffered so that frames are written out in large blocks
+    if (!( m_pFile = _tfopen( strFileName, _T("wb") ) )) return false;
+    if (!( m_pBuffer = new char[ FRAMELOG_BUFFER ] )) { Release(); return false; }
+    setvbuf( m_pFile, m_pBuffer, _IOFBF, FRAMELOG_BUFFER );
+
+    // Write the header, to be completed by Close
+    m_Header           = Header;
+    m_Header.Magic     = FRAMELOG_MAGIC;
+    m_Header.Version   = FRAMELOG_VERSION;
+    m_Header.FrameSize = sizeof(FRAME_INPUT);
+    m_Header.Frames    = 0;
+    m_Header.Checksum  = 0;
+    if ( fwrite( &m_Header, sizeof(FRAMELOG_HEADER), 1, m_pFile ) != 1 ) { Release(); return false; }
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Write ()
+// Desc : Appends one frame to the recording.
+//-----------------------------------------------------------------------------
+bool CFrameLog::Write( const FRAME_INPUT & Frame )
+{
+    // Validate
+    if ( !m_pFile ) return false;
+
+    if ( fwrite( &Frame, sizeof(FRAME_INPUT), 1, m_pFile ) != 1 ) return false;
+    m_nFrames++;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Close ()
+// Desc : Completes the recording's header with the frame count & the final
+//        scene checksum, and closes the file.
+//-----------------------------------------------------------------------------
+bool CFrameLog::Close( ULONG Checksum )
+{
+    bool bResult;
+
+    // Validate
+    if ( !m_pFile ) return false;
+
+    m_Header.Frames   = m_nFrames;
+    m_Header.Checksum = Checksum;
+    bResult = ( fseek( m_pFile, 0, SEEK_SET ) == 0 && fwrite( &m_Header, sizeof(FRAMELOG_HEADER), 1, m_pFile ) == 1 );
+    if ( fclose( m_pFile ) != 0 ) bResult = false;
+    m_pFile = NULL;
+
+    Release();
+    return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Open ()
+// Desc : Loads every frame of the log specified, ready to replay. Logs
+//        whose scene options are out of range are rejected.
+// Note : A log whose recording was never closed (or which was cut short)
+//        is replayed as far as it goes, without the final checksum.
+//-----------------------------------------------------------------------------
+bool CFrameLog::Open( LPCTSTR strFileName )
+{
+    FILE * pFile = NULL;
+    long   FileSize;
+    ULONG  Frames;
+
+    Release();
+
+    // Open the file & read the header
+    if (!( pFile = _tfopen( strFileName, _T("rb") ) )) return false;
+    if ( fread( &m_Header, sizeof(FRAMELOG_HEADER), 1, pFile ) != 1 ) goto OpenError;
+    if ( m_Header.Magic != FRAMELOG_MAGIC || m_Header.Version != FRAMELOG_VERSION ||
+         m_Header.FrameSize != sizeof(FRAME_INPUT) ) goto OpenError;
+
+    // The scene options are applied without the command line's clamps, so
+    // refuse any the game could not build or simulate (NaN fails too)
+    if ( m_Header.ObjectCount < 2 || m_Header.ObjectCount > FRAMELOG_MAX_OBJECTS ) goto OpenError;
+    if ( !(m_Header.fTickRate >= 0.0f && m_Header.fTickRate <= FRAMELOG_MAX_TICK_RATE) ) goto OpenError;
+    if ( m_Header.MaxTicks < 1 || m_Header.MaxTicks > FRAMELOG_MAX_TICKS ) goto OpenError;
+
+    // How many frames are actually present?
+    if ( fseek( pFile, 0, SEEK_END ) != 0 || (FileSize = ftell( pFile )) < (long)sizeof(FRAMELOG_HEADER) ) goto OpenError;
+    Frames = (ULONG)((FileSize - sizeof(FRAMELOG_HEADER)) / sizeof(FRAME_INPUT));
+    if ( m_Header.Frames == 0 || m_Header.Frames > Frames ) { m_Header.Frames = Frames; m_Header.Checksum = 0; }
+    if ( m_Header.Frames == 0 ) goto OpenError;
+
+    // Read them all
+    if ( fseek( pFile, sizeof(FRAMELOG_HEADER), SEEK_SET ) != 0 ) goto OpenError;
+    if (!( m_pFrames = new FRAME_INPUT[ m_Header.Frames ] )) goto OpenError;
+    if ( fread( m_pFrames, sizeof(FRAME_INPUT), m_Header.Frames, pFile ) != m_Header.Frames ) goto OpenError;
+    m_nFrames = m_Header.Frames;
+    fclose( pFile );
+
+    // Success!
+    return true;
+
+OpenError:
+    fclose( pFile );
+    Release();
+    return false;
+}
@@ -0,0 +1,121 @@
+//-----------------------------------------------------------------------------
+// File: CFrameLog.h
+//
+// Desc: Binary log of everything a run's simulation depends upon (random
+//       seed, scene options, and each frame's time step & input), so that the
+//       run can be replayed to produce exactly the same scene.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CFRAMELOG_H_
+#define _CFRAMELOG_H_
+
+//-----------------------------------------------------------------------------
+// CFrameLog Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include <stdio.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG FRAMELOG_MAGIC          = 0x474F4C46;   // 'FLOG'
+const ULONG FRAMELOG_VERSION        = 1;            // Current log format version
+const ULONG FRAMELOG_BUFFER         = 65536;        // Bytes buffered before a recording is written out
+const ULONG FRAMELOG_MAX_OBJECTS    = 1048576;      // Largest scene a log may ask to be rebuilt
+const float FRAMELOG_MAX_TICK_RATE  = 10000.0f;     // Fastest simulation rate a log may ask for
+const ULONG FRAMELOG_MAX_TICKS      = 1000;         // Most steps per frame a log may ask for
+
+// Frame input flags
+const ULONG FRAMEINPUT_LEFT         = 0x00000001;   // Strafe left key held
+const ULONG FRAMEINPUT_RIGHT        = 0x00000002;   // Strafe right key held
+const ULONG FRAMEINPUT_ROTATION1    = 0x00000004;   // Object 1 rotation enabled
+const ULONG FRAMEINPUT_ROTATION2    = 0x00000008;   // Object 2 rotation enabled
+
+//-----------------------------------------------------------------------------
+// Name : FRAME_INPUT (Struct)
+// Desc : What the simulation consumed for one frame. Times are in seconds.
+//-----------------------------------------------------------------------------
+struct FRAME_INPUT
+{
+    float           fFrameTime;             // Unsmoothed frame time (fixed steps)
+    float           fTimeElapsed;           // Smoothed frame time (variable steps)
+    ULONG           Input;                  // FRAMEINPUT_ flags
+};
+
+//-----------------------------------------------------------------------------
+// Name : FRAMELOG_HEADER (Struct)
+// Desc : Found at the start of every log, followed by one FRAME_INPUT for
+//        each frame recorded.
+// Note : Frames & Checksum are filled in when the recording is closed, a log
+//        cut short is still replayed as far as it goes.
+//-----------------------------------------------------------------------------
+struct FRAMELOG_HEADER
+{
+    ULONG           Magic;                  // FRAMELOG_MAGIC
+    ULONG           Version;                // FRAMELOG_VERSION
+    ULONG           FrameSize;              // sizeof(FRAME_INPUT)
+    ULONG           Seed;                   // Random number seed the objects were built with
+    ULONG           ObjectCount;            // Objects in the scene
+    float           fTickRate;              // Simulation steps per second, or 0 for one per frame
+    ULONG           MaxTicks;               // Most steps simulated in one frame
+    ULONG           Frames;                 // Frames recorded
+    ULONG           Checksum;               // Scene checksum once the last frame was simulated
+    ULONG           Reserved[3];
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CFrameLog (Class)
+// Desc : Records frame inputs to a log file, or loads a log for replay.
+// Note : Replayed logs are read into memory in full when opened, so replays
+//        never wait on the disk. Recordings are written through a large
+//        buffer for the same reason.
+//-----------------------------------------------------------------------------
+class CFrameLog
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CFrameLog();
+	virtual ~CFrameLog();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    void            Release         ( );
+
+    // Recording
+    bool            Create          ( LPCTSTR strFileName, const FRAMELOG_HEADER & Header );
+    bool            Write           ( const FRAME_INPUT & Frame );
+    bool            Close           ( ULONG Checksum );
+    bool            IsRecording     ( ) const { return m_pFile != NULL; }
+
+    // Replay
+    bool            Open            ( LPCTSTR strFileName );
+    bool            IsReplaying     ( ) const { return m_pFrames != NULL; }
+    ULONG           GetFrameCount   ( ) const { return m_nFrames; }
+    const FRAME_INPUT & GetFrame    ( ULONG Index ) const { return m_pFrames[ Index ]; }
+
+    const FRAMELOG_HEADER & GetHeader( ) const { return m_Header; }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    FRAMELOG_HEADER     m_Header;           // Header of the log being recorded or replayed
+    FILE              * m_pFile;            // Log being recorded
+    char              * m_pBuffer;          // Write buffer for the recording
+    FRAME_INPUT       * m_pFrames;          // Frames of the log being replayed
+    ULONG               m_nFrames;          // Frames recorded, or held for replay
+
+    // Logs own their file & frames, copying is not supported.
+    CFrameLog( const CFrameLog & );
+    CFrameLog & operator=( const CFrameLog & );
+};
+
+#endif // _CFRAMELOG_H_
@@ -0,0 +1,174 @@
+//-----------------------------------------------------------------------------
+// File: CFrustum.cpp
+//
+// Desc: View frustum extraction and batched bounding box culling.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CFrustum Specific Includes
+//-----------------------------------------------------------------------------
+#include "CFrustum.h"
+#include <math.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <xmmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Name : CFrustum () (Constructor)
+// Desc : CFrustum Class Constructor
+//-----------------------------------------------------------------------------
+CFrustum::CFrustum()
+{
+    D3DXMATRIX mtxIdentity;
+
+	// Start out as the unit clip volume
+    D3DXMatrixIdentity( &mtxIdentity );
+    Extract( mtxIdentity );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CFrustum () (Destructor)
+// Desc : CFrustum Class Destructor
+//-----------------------------------------------------------------------------
+CFrustum::~CFrustum()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Name : Extract ()
+// Desc : Extracts the frustum planes from a combined view / projection
+//        matrix (Gribb & Hartmann), in the space the matrix transforms from.
+//-----------------------------------------------------------------------------
+void CFrustum::Extract( const D3DXMATRIX & mtxViewProj )
+{
+    const D3DXMATRIX & m = mtxViewProj;
+
+    // Left, right, bottom, top (column 4 +/- columns 1 & 2)
+    m_Planes[0] = D3DXPLANE( m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41 );
+    m_Planes[1] = D3DXPLANE( m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41 );
+    m_Planes[2] = D3DXPLANE( m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42 );
+    m_Planes[3] = D3DXPLANE( m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42 );
+
+    // Near (Direct3D clip space z starts at 0) & far
+    m_Planes[4] = D3DXPLANE( m._13, m._23, m._33, m._43 );
+    m_Planes[5] = D3DXPLANE( m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43 );
+
+    // Normalise the planes, and store their absolute normals
+    for ( ULONG i = 0; i < FRUSTUM_PLANE_COUNT; i++ )
+    {
+        D3DXPlaneNormalize( &m_Planes[i], &m_Planes[i] );
+        m_vecAbsNormal[i] = D3DXVECTOR3( fabsf( m_Planes[i].a ), fabsf( m_Planes[i].b ), fabsf( m_Planes[i].c ) );
+
+    } // Next Plane
+}
+
+//-----------------------------------------------------------------------------
+// Name : TestBox ()
+// Desc : Returns true if the box is at least partially inside the frustum.
+//-----------------------------------------------------------------------------
+bool CFrustum::TestBox( const D3DXVECTOR3 & vecCentre, const D3DXVECTOR3 & vecExtents ) const
+{
+    for ( ULONG i = 0; i < FRUSTUM_PLANE_COUNT; i++ )
+    {
+        const D3DXPLANE & Plane = m_Planes[i];
+        float fDistance = Plane.a * vecCentre.x + Plane.b * vecCentre.y + Plane.c * vecCentre.z + Plane.d;
+        float fRadius   = D3DXVec3Dot( &m_vecAbsNormal[i], &vecExtents );
+        if ( fDistance < -fRadius ) return false;
+
+    } // Next Plane
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : TestSphere ()
+// Desc : Returns true if the sphere is at least partially inside the frustum.
+//-----------------------------------------------------------------------------
+bool CFrustum::TestSphere( const D3DXVECTOR3 & vecCentre, float fRadius ) const
+{
+    for ( ULONG i = 0; i < FRUSTUM_PLANE_COUNT; i++ )
+    {
+        if ( D3DXPlaneDotCoord( &m_Planes[i], &vecCentre ) < -fRadius ) return false;
+
+    } // Next Plane
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CullBlocks ()
+// Desc : Tests Count boxes, stored in consecutive blocks, against the frustum
+//        writing 1 (visible) or 0 (culled) for each to pVisible.
+// Note : Returns the number of visible boxes. Entries of the final block
+//        beyond Count are tested but not reported.
+//-----------------------------------------------------------------------------
+ULONG CFrustum::CullBlocks( const CULL_BLOCK * pBlocks, ULONG Count, UCHAR * pVisible ) const
+{
+    ULONG Visible = 0;
+
+    for ( ULONG Block = 0; Block * FRUSTUM_BLOCK_SIZE < Count; Block++ )
+    {
+        const CULL_BLOCK & b = pBlocks[ Block ];
+        ULONG Mask = 0;
+
+#if defined(__AVX__)
+        // Test all 8 boxes at once
+        __m256 cx = _mm256_loadu_ps( b.CentreX ), cy = _mm256_loadu_ps( b.CentreY ), cz = _mm256_loadu_ps( b.CentreZ );
+        __m256 ex = _mm256_loadu_ps( b.ExtentX ), ey = _mm256_loadu_ps( b.ExtentY ), ez = _mm256_loadu_ps( b.ExtentZ );
+        __m256 Inside = _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) );
+
+        for ( ULONG i = 0; i < FRUSTUM_PLANE_COUNT; i++ )
+        {
+            const D3DXPLANE & Plane = m_Planes[i];
+            __m256 Distance = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( cx, _mm256_set1_ps( Plane.a ) ), _mm256_mul_ps( cy, _mm256_set1_ps( Plane.b ) ) ),
+                                             _mm256_add_ps( _mm256_mul_ps( cz, _mm256_set1_ps( Plane.c ) ), _mm256_set1_ps( Plane.d ) ) );
+            __m256 Radius   = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( ex, _mm256_set1_ps( m_vecAbsNormal[i].x ) ), _mm256_mul_ps( ey, _mm256_set1_ps( m_vecAbsNormal[i].y ) ) ),
+                                             _mm256_mul_ps( ez, _mm256_set1_ps( m_vecAbsNormal[i].z ) ) );
+
+            // Visible while distance + radius >= 0 for every plane
+            Inside = _mm256_and_ps( Inside, _mm256_cmp_ps( _mm256_add_ps( Distance, Radius ), _mm256_setzero_ps(), _CMP_GE_OQ ) );
+
+        } // Next Plane
+        Mask = (ULONG)_mm256_movemask_ps( Inside );
+#else
+        // Test the block as two groups of 4 boxes
+        for ( ULONG Half = 0; Half < FRUSTUM_BLOCK_SIZE; Half += 4 )
+        {
+            __m128 cx = _mm_loadu_ps( b.CentreX + Half ), cy = _mm_loadu_ps( b.CentreY + Half ), cz = _mm_loadu_ps( b.CentreZ + Half );
+            __m128 ex = _mm_loadu_ps( b.ExtentX + Half ), ey = _mm_loadu_ps( b.ExtentY + Half ), ez = _mm_loadu_ps( b.ExtentZ + Half );
+            __m128 Inside = _mm_cmpeq_ps( _mm_setzero_ps(), _mm_setzero_ps() );
+
+            for ( ULONG i = 0; i < FRUSTUM_PLANE_COUNT; i++ )
+            {
+                const D3DXPLANE & Plane = m_Planes[i];
+                __m128 Distance = _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, _mm_set1_ps( Plane.a ) ), _mm_mul_ps( cy, _mm_set1_ps( Plane.b ) ) ),
+                                              _mm_add_ps( _mm_mul_ps( cz, _mm_set1_ps( Plane.c ) ), _mm_set1_ps( Plane.d ) ) );
+                __m128 Radius   = _mm_add_ps( _mm_add_ps( _mm_mul_ps( ex, _mm_set1_ps( m_vecAbsNormal[i].x ) ), _mm_mul_ps( ey, _mm_set1_ps( m_vecAbsNormal[i].y ) ) ),
+                                              _mm_mul_ps( ez, _mm_set1_ps( m_vecAbsNormal[i].z ) ) );
+
+                // Visible while distance + radius >= 0 for every plane
+                Inside = _mm_and_ps( Inside, _mm_cmpge_ps( _mm_add_ps( Distance, Radius ), _mm_setzero_ps() ) );
+
+            } // Next Plane
+            Mask |= (ULONG)_mm_movemask_ps( Inside ) << Half;
+
+        } // Next Half
+#endif
+
+        // Report the results for this block
+        for ( ULONG i = 0; i < FRUSTUM_BLOCK_SIZE && Block * FRUSTUM_BLOCK_SIZE + i < Count; i++ )
+        {
+            UCHAR bVisible = (UCHAR)((Mask >> i) & 1);
+            pVisible[ Block * FRUSTUM_BLOCK_SIZE + i ] = bVisible;
+            Visible += bVisible;
+
+        } // Next Box
+
+    } // Next Block
+
+    return Visible;
+}
@@ -0,0 +1,86 @@
+//-----------------------------------------------------------------------------
+// File: CFrustum.h
+//
+// Desc: View frustum extraction and batched bounding box culling.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CFRUSTUM_H_
+#define _CFRUSTUM_H_
+
+//-----------------------------------------------------------------------------
+// CFrustum Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG FRUSTUM_PLANE_COUNT     = 6;        // Left, right, bottom, top, near & far
+const ULONG FRUSTUM_BLOCK_SIZE      = 8;        // Boxes stored per CULL_BLOCK
+
+//-----------------------------------------------------------------------------
+// Name : CULL_BLOCK (Struct)
+// Desc : World space bounding boxes for FRUSTUM_BLOCK_SIZE objects, stored
+//        component by component so that they can be tested together.
+//-----------------------------------------------------------------------------
+struct CULL_BLOCK
+{
+    float       CentreX[ FRUSTUM_BLOCK_SIZE ];  // Box centres
+    float       CentreY[ FRUSTUM_BLOCK_SIZE ];
+    float       CentreZ[ FRUSTUM_BLOCK_SIZE ];
+    float       ExtentX[ FRUSTUM_BLOCK_SIZE ];  // Box half sizes
+    float       ExtentY[ FRUSTUM_BLOCK_SIZE ];
+    float       ExtentZ[ FRUSTUM_BLOCK_SIZE ];
+};
+
+//-----------------------------------------------------------------------------
+// Name : CULL_STATS (Struct)
+// Desc : Results of culling a set of objects.
+//-----------------------------------------------------------------------------
+struct CULL_STATS
+{
+    ULONG       Tested;                 // Objects tested
+    ULONG       Visible;                // Objects at least partially inside the frustum
+    ULONG       Culled;                 // Objects entirely outside the frustum
+    float       fCullTime;              // Time taken to cull, in milliseconds
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CFrustum (Class)
+// Desc : Six inward facing planes extracted from a view / projection matrix.
+// Note : CullBlocks tests 8 boxes per step when built with AVX enabled
+//        (/arch:AVX), and 4 per step using SSE otherwise.
+//-----------------------------------------------------------------------------
+class CFrustum
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CFrustum();
+	virtual ~CFrustum();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    void            Extract         ( const D3DXMATRIX & mtxViewProj );
+    bool            TestBox         ( const D3DXVECTOR3 & vecCentre, const D3DXVECTOR3 & vecExtents ) const;
+    bool            TestSphere      ( const D3DXVECTOR3 & vecCentre, float fRadius ) const;
+    ULONG           CullBlocks      ( const CULL_BLOCK * pBlocks, ULONG Count, UCHAR * pVisible ) const;
+
+    const D3DXPLANE & GetPlane      ( ULONG Index ) const { return m_Planes[ Index ]; }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    D3DXPLANE       m_Planes[ FRUSTUM_PLANE_COUNT ];    // Normalised planes (normals point inwards)
+    D3DXVECTOR3     m_vecAbsNormal[ FRUSTUM_PLANE_COUNT ]; // Absolute plane normals, for box radii
+};
+
+#endif // _CFRUSTUM_H_
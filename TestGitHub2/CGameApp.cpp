@@ -10,6 +10,10 @@
 // CGameApp Specific Includes
 //-----------------------------------------------------------------------------
 #include "CGameApp.h"
+#include "CCompiledMesh.h"
+#include "CMeshOptimizer.h"
+#include "CMeshImporter.h"
+#include <process.h>
 
 //-----------------------------------------------------------------------------
 // CGameApp Member Functions
@@ -18,13 +22,61 @@
 // Name : CGameApp () (Constructor)
 // Desc : CGameApp Class Constructor
 //-----------------------------------------------------------------------------
-CGameApp::CGameApp()
+CGameApp::CGameApp() : m_SoftwareBackend( &m_ThreadPool )
 {
 	// Reset / Clear all required values
     m_hWnd          = NULL;
-    m_pD3D          = NULL;
-    m_pD3DDevice    = NULL;
-    m_bLostDevice   = false;
+    m_pBackend      = NULL;
+    m_bHeadless     = false;
+    m_bSoftware     = false;
+    m_nHeadlessFrames = 1000;
+    m_nTransformBench = 0;
+    m_pDecodeBuffer = NULL;
+    m_nDecodeCapacity = 0;
+    m_pObject       = NULL;
+    m_nObjectCount  = 2;
+    m_pVisibleObjects = NULL;
+    m_nDrawCalls    = 0;
+    m_fProjScale    = 1.0f;
+    m_bInstancing   = true;
+    m_bStateCache   = true;
+    m_bOcclusion    = true;
+    m_bOcclusionTemporal = false;
+    m_bThreaded     = false;
+    m_fLockFPS      = 0.0f;
+    m_fTickRate     = DEFAULT_TICK_RATE;
+    m_nMaxTicks     = DEFAULT_MAX_TICKS;
+    m_fSimAccumulator = 0.0;
+    m_fSimAlpha     = 1.0f;
+    m_nSimSteps     = 0;
+    m_nSimDropped   = 0;
+    m_hRenderThread = NULL;
+    m_hResetRequest = NULL;
+    m_hResetDone    = NULL;
+    m_nResetWidth   = 0;
+    m_nResetHeight  = 0;
+    m_nBackBufferWidth  = 0;
+    m_nBackBufferHeight = 0;
+    m_strMeshFile[0]     = _T('\0');
+    m_strSaveMeshFile[0] = _T('\0');
+    m_strImportFile[0]   = _T('\0');
+    m_strBenchFile[0]    = _T('\0');
+    _tcscpy( m_strBenchReport, _T("ImportBenchmark.txt") );
+    _tcscpy( m_strFrameReport, _T("FrameBenchmark.txt") );
+    m_strFrameImage[0]   = _T('\0');
+    m_strProfileFile[0]  = _T('\0');
+    m_strTelemetryName[0] = _T('\0');
+    m_strRecordFile[0]   = _T('\0');
+    m_strReplayFile[0]   = _T('\0');
+    m_nReplayFrame       = 0;
+    m_bReplayPaced       = false;
+    m_nSeed              = 0;
+    m_bFixedSeed         = false;
+    m_nLastAllocations   = 0;
+    _tcscpy( m_strTransformReport, _T("TransformBenchmark.txt") );
+    ZeroMemory( &m_CullStats, sizeof(CULL_STATS) );
+    ZeroMemory( &m_FrameInput, sizeof(FRAME_INPUT) );
+    ZeroMemory( &m_OcclusionTotals, sizeof(OCCLUSION_STATS) );
 
 }
 
@@ -44,22 +96,245 @@ CGameApp::~CGameApp()
 //-----------------------------------------------------------------------------
 bool CGameApp::InitInstance( HANDLE hInstance, LPCTSTR lpCmdLine, int iCmdShow )
 {
-    // Create the primary display device
-    if (!CreateDisplay()) { ShutDown(); return false; }
+    // Retrieve any options specified on the command line
+    ParseCommandLine( lpCmdLine );
+
+    // Profile every thread from the start, if a trace was asked for
+    if ( m_strProfileFile[0] && CProfiler::Create() ) PROFILE_THREAD( "Main" );
+
+    // Replays rebuild the recorded scene, whatever the command line says
+    if ( m_strReplayFile[0] )
+    {
+        if ( !m_ReplayLog.Open( m_strReplayFile ) ) { ShutDown(); return false; }
+
+        const FRAMELOG_HEADER & Header = m_ReplayLog.GetHeader();
+        m_nSeed           = Header.Seed;
+        m_bFixedSeed      = true;
+        m_nObjectCount    = Header.ObjectCount;
+        m_fTickRate       = Header.fTickRate;
+        m_nMaxTicks       = Header.MaxTicks;
+        m_nHeadlessFrames = m_ReplayLog.GetFrameCount();
+
+    } // End if replay
+
+    // Start the worker threads
+    if (!m_ThreadPool.Create()) { ShutDown(); return false; }
+
+    // Benchmark runs are not interactive, so exit once the report is written
+    if ( m_strBenchFile[0] )
+    {
+        CMeshImporter::Benchmark( m_strBenchFile, m_strBenchReport );
+        ShutDown();
+        return false;
+
+    } // End if benchmark
+
+    if ( m_nTransformBench )
+    {
+        CVertexTransform::Benchmark( m_nTransformBench, m_strTransformReport );
+        ShutDown();
+        return false;
+
+    } // End if transform benchmark
+
+    // Create the primary display device, or render without one if headless
+    if ( m_bHeadless )
+    {
+        m_nViewX      = 0;
+        m_nViewY      = 0;
+        m_nViewWidth  = 800;
+        m_nViewHeight = 600;
+        m_NullBackend.SetInstancing( m_bInstancing );
+        m_pBackend    = &m_NullBackend;
+
+        // Rasterize on the CPU if requested
+        if ( m_bSoftware )
+        {
+            if ( !m_SoftwareBackend.Create( m_nViewWidth, m_nViewHeight ) ) { ShutDown(); return false; }
+            m_pBackend = &m_SoftwareBackend;
+
+        } // End if software
+
+    } // End if headless
+    else if (!CreateDisplay()) { ShutDown(); return false; }
+
+    // Filter out redundant state changes before they reach the backend
+    if ( m_bStateCache )
+    {
+        m_StateCache.SetTarget( m_pBackend );
+        m_pBackend = &m_StateCache;
+
+    } // End if state cache
 
     // Build Objects
     if (!BuildObjects()) { ShutDown(); return false; }
 
+    // Prepare the occlusion depth buffer
+    if ( m_bOcclusion )
+    {
+        if ( !m_Occlusion.Create() ) { ShutDown(); return false; }
+        m_Occlusion.SetTemporal( m_bOcclusionTemporal );
+
+    } // End if occlusion
+
+    // Instancing needs shader model 3, so fall back to per object drawing without it
+    m_bInstancing = m_pBackend->SupportsInstancing();
+
     // Set up all required game states
     SetupGameState();
 
     // Setup our rendering environment
     SetupRenderStates();
+    m_nBackBufferWidth  = m_nViewWidth;
+    m_nBackBufferHeight = m_nViewHeight;
+
+    // Frames pass through the snapshot buffer, to the render thread if pipelined
+    if ( !m_Snapshots.Create() ) { ShutDown(); return false; }
+    if ( m_bThreaded && !StartRenderThread() ) { ShutDown(); return false; }
+
+    // Publish each frame's timings for an external reader (not fatal if unavailable)
+    if ( m_strTelemetryName[0] && !m_Telemetry.Create( m_strTelemetryName ) ) m_strTelemetryName[0] = _T('\0');
+    g_bCountAllocations = m_Telemetry.IsOpen();
+    m_nLastAllocations  = g_nAllocations;
+
+    // Start recording the frame inputs, along with all the scene depends upon
+    if ( m_strRecordFile[0] )
+    {
+        FRAMELOG_HEADER Header;
+        ZeroMemory( &Header, sizeof(FRAMELOG_HEADER) );
+        Header.Seed        = m_nSeed;
+        Header.ObjectCount = m_nObjectCount;
+        Header.fTickRate   = m_fTickRate;
+        Header.MaxTicks    = m_nMaxTicks;
+        if ( !m_FrameLog.Create( m_strRecordFile, Header ) ) { ShutDown(); return false; }
+
+    } // End if recording
 
     // Success!
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Name : ParseCommandLine () (Private)
+// Desc : Reads the application options from the command line specified.
+//-----------------------------------------------------------------------------
+void CGameApp::ParseCommandLine( LPCTSTR lpCmdLine )
+{
+    TCHAR strValue[32];
+
+    // Mesh file options
+    GetSwitch( lpCmdLine, _T("/mesh:"), m_strMeshFile, MAX_PATH );
+    GetSwitch( lpCmdLine, _T("/savemesh:"), m_strSaveMeshFile, MAX_PATH );
+
+    // Import options
+    GetSwitch( lpCmdLine, _T("/import:"), m_strImportFile, MAX_PATH );
+    GetSwitch( lpCmdLine, _T("/importbench:"), m_strBenchFile, MAX_PATH );
+    GetSwitch( lpCmdLine, _T("/benchreport:"), m_strBenchReport, MAX_PATH );
+
+    // Vertex transform benchmark options
+    if ( GetSwitch( lpCmdLine, _T("/transformbench:"), strValue, 32 ) ) m_nTransformBench = _tcstoul( strValue, NULL, 10 );
+    GetSwitch( lpCmdLine, _T("/transformreport:"), m_strTransformReport, MAX_PATH );
+
+    // Scene options (the two animated objects are always present)
+    if ( GetSwitch( lpCmdLine, _T("/objects:"), strValue, 32 ) )
+    {
+        m_nObjectCount = _tcstoul( strValue, NULL, 10 );
+        if ( m_nObjectCount < 2 ) m_nObjectCount = 2;
+
+    } // End if object count
+
+    // Rendering options
+    if ( GetSwitch( lpCmdLine, _T("/noinstancing"), strValue, 32 ) ) m_bInstancing = false;
+    if ( GetSwitch( lpCmdLine, _T("/nostatecache"), strValue, 32 ) ) m_bStateCache = false;
+    if ( GetSwitch( lpCmdLine, _T("/noocclusion"), strValue, 32 ) ) m_bOcclusion = false;
+    if ( GetSwitch( lpCmdLine, _T("/occlusiontemporal"), strValue, 32 ) ) m_bOcclusionTemporal = true;
+    if ( GetSwitch( lpCmdLine, _T("/threaded"), strValue, 32 ) ) m_bThreaded = true;
+
+    // Clock the frame timer reads (performance counter unless asked otherwise)
+    if ( GetSwitch( lpCmdLine, _T("/clock:"), strValue, 32 ) )
+    {
+        if ( _tcsicmp( strValue, _T("steady") ) == 0 ) m_Timer.SetClock( TIMERCLOCK_STEADY );
+        else if ( _tcsicmp( strValue, _T("mm") ) == 0 ) m_Timer.SetClock( TIMERCLOCK_MULTIMEDIA );
+
+    } // End if clock
+
+    // Frame time statistics window (also the frames averaged for animation)
+    if ( GetSwitch( lpCmdLine, _T("/timerwindow:"), strValue, 32 ) ) m_Timer.SetSampleWindow( _tcstoul( strValue, NULL, 10 ) );
+
+    // Simulation rate, decoupled from the frame rate unless zero
+    if ( GetSwitch( lpCmdLine, _T("/tickrate:"), strValue, 32 ) ) m_fTickRate = (float)_tcstod( strValue, NULL );
+    if ( GetSwitch( lpCmdLine, _T("/maxticks:"), strValue, 32 ) )
+    {
+        m_nMaxTicks = _tcstoul( strValue, NULL, 10 );
+        if ( m_nMaxTicks < 1 ) m_nMaxTicks = 1;
+
+    } // End if max ticks
+
+    // Frame rate lock, spun out unless sleeping towards each deadline is asked for
+    if ( GetSwitch( lpCmdLine, _T("/lockfps:"), strValue, 32 ) ) m_fLockFPS = (float)_tcstod( strValue, NULL );
+    if ( GetSwitch( lpCmdLine, _T("/pacing:"), strValue, 32 ) )
+        m_Timer.SetPacing( _tcsicmp( strValue, _T("sleep") ) == 0 ? TIMERPACE_SLEEP : TIMERPACE_SPIN );
+
+    // Headless frame benchmark options
+    if ( GetSwitch( lpCmdLine, _T("/headless"), strValue, 32 ) ) m_bHeadless = true;
+    if ( GetSwitch( lpCmdLine, _T("/software"), strValue, 32 ) ) m_bHeadless = m_bSoftware = true;
+    if ( GetSwitch( lpCmdLine, _T("/frames:"), strValue, 32 ) ) m_nHeadlessFrames = _tcstoul( strValue, NULL, 10 );
+    GetSwitch( lpCmdLine, _T("/framereport:"), m_strFrameReport, MAX_PATH );
+    GetSwitch( lpCmdLine, _T("/frameimage:"), m_strFrameImage, MAX_PATH );
+
+    // CPU profile trace, written at shut down
+    GetSwitch( lpCmdLine, _T("/profile:"), m_strProfileFile, MAX_PATH );
+
+    // Frame telemetry, published to a named file mapping under the name given or the default
+    if ( !GetSwitch( lpCmdLine, _T("/telemetry:"), m_strTelemetryName, MAX_PATH ) &&
+          GetSwitch( lpCmdLine, _T("/telemetry"), strValue, 32 ) ) _tcscpy( m_strTelemetryName, TELEMETRY_DEFAULT_NAME );
+
+    // Deterministic runs: a fixed seed, and recording or replaying the frame inputs
+    if ( GetSwitch( lpCmdLine, _T("/seed:"), strValue, 32 ) ) { m_nSeed = _tcstoul( strValue, NULL, 10 ); m_bFixedSeed = true; }
+    GetSwitch( lpCmdLine, _T("/record:"), m_strRecordFile, MAX_PATH );
+    if ( GetSwitch( lpCmdLine, _T("/replay:"), m_strReplayFile, MAX_PATH ) ) m_bHeadless = true;
+    if ( GetSwitch( lpCmdLine, _T("/replaypace:"), strValue, 32 ) ) m_bReplayPaced = ( _tcsicmp( strValue, _T("recorded") ) == 0 );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetSwitch () (Private, Static)
+// Desc : Retrieves the value of a "/name:value" switch from the command line.
+//        Values containing spaces may be enclosed in quotes.
+// Note : Returns false, leaving the value untouched, if the switch is absent.
+//-----------------------------------------------------------------------------
+bool CGameApp::GetSwitch( LPCTSTR lpCmdLine, LPCTSTR strSwitch, LPTSTR strValue, ULONG MaxLength )
+{
+    LPCTSTR pSearch = lpCmdLine;
+    ULONG   SwitchLength = (ULONG)_tcslen( strSwitch ), Length = 0;
+    bool    bQuoted = false;
+
+    // Validate
+    if ( !lpCmdLine || MaxLength == 0 ) return false;
+
+    // Find the switch at the start of an argument
+    for ( ; *pSearch; pSearch++ )
+    {
+        if ( pSearch != lpCmdLine && pSearch[-1] != _T(' ') ) continue;
+        if ( _tcsnicmp( pSearch, strSwitch, SwitchLength ) == 0 ) break;
+
+    } // Next Character
+    if ( !*pSearch ) return false;
+
+    // Copy the value, which ends at a space or the closing quote
+    pSearch += SwitchLength;
+    if ( *pSearch == _T('"') ) { bQuoted = true; pSearch++; }
+    for ( ; *pSearch && Length < MaxLength - 1; pSearch++ )
+    {
+        if ( bQuoted ? (*pSearch == _T('"')) : (*pSearch == _T(' ')) ) break;
+        strValue[ Length++ ] = *pSearch;
+
+    } // Next Character
+    strValue[ Length ] = _T('\0');
+
+    // Success!
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // Name : CreateDisplay ()
 // Desc : Create the display windows, devices etc, ready for rendering.
@@ -104,125 +379,13 @@ bool CGameApp::CreateDisplay()
 	ShowWindow(m_hWnd, SW_SHOW);
 
     // Initialize Direct3D (Simple)
-    if (!InitDirect3D( )) return false;
-
-    // Success!!
-    return true;
-}
-
-//-----------------------------------------------------------------------------
-// Name : InitDirect3D () (Private)
-// Desc : Performs a simple, non-enumerated, initialization of Direct3D
-//-----------------------------------------------------------------------------
-bool CGameApp::InitDirect3D()
-{
-    HRESULT               hRet;
-    D3DPRESENT_PARAMETERS PresentParams;
-    D3DCAPS9              Caps;
-	D3DDISPLAYMODE        CurrentMode;
-	
-    // First of all create our D3D Object
-    m_pD3D = Direct3DCreate9( D3D_SDK_VERSION );
-    if (!m_pD3D) 
-    {
-        MessageBox( m_hWnd, _T("No compatible Direct3D object could be created."), _T("Fatal Error!"), MB_OK | MB_ICONSTOP | MB_APPLMODAL );
-        return false;
-    
-    } // End if failure
-
-    // Fill out a simple set of present parameters
-    ZeroMemory( &PresentParams, sizeof(D3DPRESENT_PARAMETERS) );
-
-    // Select back buffer format etc
-	m_pD3D->GetAdapterDisplayMode( D3DADAPTER_DEFAULT, &CurrentMode);
-	PresentParams.BackBufferFormat = CurrentMode.Format;
-        
-	// Setup remaining flags
-	PresentParams.AutoDepthStencilFormat = FindDepthStencilFormat( D3DADAPTER_DEFAULT, CurrentMode, D3DDEVTYPE_HAL );
-    PresentParams.SwapEffect			 = D3DSWAPEFFECT_DISCARD;
-    PresentParams.PresentationInterval   = D3DPRESENT_INTERVAL_IMMEDIATE;
-	PresentParams.Windowed				 = true;
-	PresentParams.EnableAutoDepthStencil = true;
-    
-	// Set Creation Flags
-	unsigned long ulFlags = D3DCREATE_SOFTWARE_VERTEXPROCESSING;
-
-    // Check if Hardware T&L is available
-    ZeroMemory( &Caps, sizeof(D3DCAPS9) );
-    m_pD3D->GetDeviceCaps( D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, &Caps );
-    if ( Caps.DevCaps & D3DDEVCAPS_HWTRANSFORMANDLIGHT ) ulFlags = D3DCREATE_HARDWARE_VERTEXPROCESSING;
-        
-    // Attempt to create a HAL device
-    if( FAILED( hRet = m_pD3D->CreateDevice( D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, m_hWnd, ulFlags, &PresentParams, &m_pD3DDevice ) ) ) 
-    {
-        MessageBox( m_hWnd, _T("Could not create a valid HAL Direct3D device object.\r\n\r\n")
-                            _T("The system will now attempt to create a device utilising the 'Reference Rasterizer' (D3DDEVTYPE_REF)"),
-                            _T("Fatal Error!"), MB_OK | MB_ICONINFORMATION | MB_APPLMODAL );
-        
-        // Find REF depth buffer format
-        PresentParams.AutoDepthStencilFormat = FindDepthStencilFormat( D3DADAPTER_DEFAULT, CurrentMode, D3DDEVTYPE_REF );
-
-        // Check if Hardware T&L is available
-        ZeroMemory( &Caps, sizeof(D3DCAPS9) );
-        ulFlags = D3DCREATE_SOFTWARE_VERTEXPROCESSING;
-        m_pD3D->GetDeviceCaps( D3DADAPTER_DEFAULT, D3DDEVTYPE_REF, &Caps );
-        if ( Caps.DevCaps & D3DDEVCAPS_HWTRANSFORMANDLIGHT ) ulFlags = D3DCREATE_HARDWARE_VERTEXPROCESSING;
-
-        // Attempt to create a REF device
-        if( FAILED( hRet = m_pD3D->CreateDevice( D3DADAPTER_DEFAULT, D3DDEVTYPE_REF, m_hWnd, ulFlags, &PresentParams, &m_pD3DDevice ) ) ) 
-        {
-            MessageBox( m_hWnd, _T("Could not create a valid REF Direct3D device object.\r\n\r\nThe system will now exit."),
-                                _T("Fatal Error!"), MB_OK | MB_ICONSTOP | MB_APPLMODAL );
-
-            // Failed
-            return false;
-        
-        } // End if Failure (REF)
-
-    } // End if Failure (HAL)
-
-    // Store the present parameters
-    m_D3DPresentParams = PresentParams;
+    if (!m_D3DBackend.Create( m_hWnd, m_bInstancing )) return false;
+    m_pBackend = &m_D3DBackend;
 
     // Success!!
     return true;
 }
 
-//-----------------------------------------------------------------------------
-// Name : FindDepthStencilFormat ()
-// Desc : This function simply determines the best depth format that is
-//        available for the specified mode.
-// Note : No tests for stencil active depth buffers are made.
-//-----------------------------------------------------------------------------
-D3DFORMAT CGameApp::FindDepthStencilFormat( ULONG AdapterOrdinal, D3DDISPLAYMODE Mode, D3DDEVTYPE DevType )
-{
-
-    // Test for 24 bith depth buffer
-    if (SUCCEEDED( m_pD3D->CheckDeviceFormat(AdapterOrdinal, DevType, Mode.Format, D3DUSAGE_DEPTHSTENCIL , D3DRTYPE_SURFACE , D3DFMT_D32 )))
-    {
-        if (SUCCEEDED( m_pD3D->CheckDepthStencilMatch ( AdapterOrdinal, DevType, Mode.Format, Mode.Format, D3DFMT_D32 ))) return D3DFMT_D32;
-    
-    } // End if 32bpp Available
-
-    // Test for 24 bit depth buffer
-    if (SUCCEEDED( m_pD3D->CheckDeviceFormat(AdapterOrdinal, DevType, Mode.Format, D3DUSAGE_DEPTHSTENCIL , D3DRTYPE_SURFACE , D3DFMT_D24X8 )))
-    {
-        if (SUCCEEDED( m_pD3D->CheckDepthStencilMatch ( AdapterOrdinal, DevType, Mode.Format, Mode.Format, D3DFMT_D24X8 ))) return D3DFMT_D24X8;
-    
-    } // End if 24bpp Available
-
-    // Test for 16 bit depth buffer
-    if (SUCCEEDED( m_pD3D->CheckDeviceFormat(AdapterOrdinal, DevType, Mode.Format, D3DUSAGE_DEPTHSTENCIL , D3DRTYPE_SURFACE , D3DFMT_D16 )))
-    {
-        if (SUCCEEDED( m_pD3D->CheckDepthStencilMatch ( AdapterOrdinal, DevType, Mode.Format, Mode.Format, D3DFMT_D16 ))) return D3DFMT_D16;
-    
-    } // End if 16bpp Available
-
-    // No depth buffer supported
-    return D3DFMT_UNKNOWN;
-
-}
-
 //-----------------------------------------------------------------------------
 // Name : SetupGameState ()
 // Desc : Sets up all the initial states required by the game.
@@ -231,6 +394,8 @@ void CGameApp::SetupGameState()
 {
     // Setup Default Matrix Values
     D3DXMatrixIdentity( &m_mtxView );
+    m_mtxPrevView = m_mtxView;
+    SetupProjection();
     
     // Enable rotation
     m_bRotation1 = true;
@@ -247,23 +412,28 @@ void CGameApp::SetupGameState()
 //-----------------------------------------------------------------------------
 void CGameApp::SetupRenderStates()
 {
-    // Set up new perspective projection matrix
-    float fAspect = (float)m_nViewWidth / (float)m_nViewHeight;
-    D3DXMatrixPerspectiveFovLH( &m_mtxProjection, D3DXToRadian( 60.0f ), fAspect, 1.01f, 1000.0f );
-
-    // Setup our D3D Device initial states
-    m_pD3DDevice->SetRenderState( D3DRS_ZENABLE, D3DZB_TRUE );
-    m_pD3DDevice->SetRenderState( D3DRS_DITHERENABLE,  TRUE );
-    m_pD3DDevice->SetRenderState( D3DRS_SHADEMODE, D3DSHADE_GOURAUD );
-    m_pD3DDevice->SetRenderState( D3DRS_CULLMODE, D3DCULL_CCW );
-    m_pD3DDevice->SetRenderState( D3DRS_LIGHTING, FALSE );
+    // Setup our device initial states
+    m_pBackend->SetRenderState( D3DRS_ZENABLE, D3DZB_TRUE );
+    m_pBackend->SetRenderState( D3DRS_DITHERENABLE,  TRUE );
+    m_pBackend->SetRenderState( D3DRS_SHADEMODE, D3DSHADE_GOURAUD );
+    m_pBackend->SetRenderState( D3DRS_CULLMODE, D3DCULL_CCW );
+    m_pBackend->SetRenderState( D3DRS_LIGHTING, FALSE );
 
     // Setup our vertex FVF code
-    m_pD3DDevice->SetFVF( D3DFVF_XYZ | D3DFVF_DIFFUSE );
+    m_pBackend->SetFVF( D3DFVF_XYZ | D3DFVF_DIFFUSE );
 
-    // Setup our matrices
-    m_pD3DDevice->SetTransform( D3DTS_VIEW, &m_mtxView );
-    m_pD3DDevice->SetTransform( D3DTS_PROJECTION, &m_mtxProjection );
+    // Note : The view & projection matrices are set from each snapshot as it is drawn
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetupProjection () (Private)
+// Desc : Builds the projection matrix for the current viewport size.
+//-----------------------------------------------------------------------------
+void CGameApp::SetupProjection()
+{
+    // Set up new perspective projection matrix
+    float fAspect = (float)m_nViewWidth / (float)m_nViewHeight;
+    D3DXMatrixPerspectiveFovLH( &m_mtxProjection, D3DXToRadian( 60.0f ), fAspect, 1.01f, 1000.0f );
 }
 
 //-----------------------------------------------------------------------------
@@ -275,6 +445,9 @@ int CGameApp::BeginGame()
 {
     MSG		msg;
 
+    // Headless runs render a fixed number of frames, then report
+    if ( m_bHeadless ) return RunHeadless();
+
     // Start main loop
 	while (1) 
     {
@@ -284,7 +457,21 @@ int CGameApp::BeginGame()
 			if (msg.message == WM_QUIT) break;
 			TranslateMessage( &msg );
 			DispatchMessage ( &msg );
-		} 
+		}
+        else if ( m_hRenderThread && WaitForSingleObject( m_hResetRequest, 0 ) == WAIT_OBJECT_0 )
+        {
+            // The render thread is parked until we reset the device for it
+            ServiceReset();
+
+        } // End if reset requested
+        else if ( m_hRenderThread && WaitForSingleObject( m_Snapshots.GetWriteEvent(), 0 ) != WAIT_OBJECT_0 )
+        {
+            // The render thread is behind, so sleep until it catches up, asks
+            // for a reset or a message arrives
+            HANDLE Handles[2] = { m_Snapshots.GetWriteEvent(), m_hResetRequest };
+            MsgWaitForMultipleObjects( 2, Handles, FALSE, INFINITE, QS_ALLINPUT );
+
+        } // End if render thread busy
         else 
         {
 			// Advance Game Frame.
@@ -297,17 +484,226 @@ int CGameApp::BeginGame()
     return 0;
 }
 
+//-----------------------------------------------------------------------------
+// Name : RunHeadless () (Private)
+// Desc : Renders the requested number of frames through the null (or
+//        software) backend, then writes the frame timings, scene checksum,
+//        submitted work, simulate / render split and dynamic stream usage to
+//        the report, along with the rasterizer stage timings if any.
+// Note : Every stage of FrameAdvance runs as normal, only the device calls
+//        are replaced, so the report measures the CPU cost of a frame.
+//        There is no window or device, but the timings still come from
+//        QueryPerformanceCounter and the scene from D3DX, so headless runs
+//        (a build server's, say) need Windows all the same.
+//-----------------------------------------------------------------------------
+int CGameApp::RunHeadless()
+{
+    LARGE_INTEGER Start, End, Frequency;
+    FILE        * pFile = NULL;
+    double        fTotal, fFrames;
+
+    // Run every frame back to back
+    m_pBackend->ResetStats();
+    m_Snapshots.ResetStats();
+    ZeroMemory( &m_OcclusionTotals, sizeof(OCCLUSION_STATS) );
+    m_Timer.ResetPacingStats();
+    m_nSimSteps   = 0;
+    m_nSimDropped = 0;
+    QueryPerformanceCounter( &Start );
+    for ( ULONG i = 0; i < m_nHeadlessFrames; i++ ) FrameAdvance();
+    StopRenderThread();
+    QueryPerformanceCounter( &End );
+    QueryPerformanceFrequency( &Frequency );
+
+    fTotal  = (double)(End.QuadPart - Start.QuadPart) * 1000.0 / (double)Frequency.QuadPart;
+    fFrames = (m_nHeadlessFrames > 0) ? (double)m_nHeadlessFrames : 1.0;
+    const RENDER_STATS & Stats = m_pBackend->GetStats();
+
+    // Write the report
+    if (!( pFile = _tfopen( m_strFrameReport, _T("w") ) )) return 1;
+    _ftprintf( pFile, _T("Headless frame benchmark\n") );
+    _ftprintf( pFile, _T("Objects     : %lu\n"), (unsigned long)m_nObjectCount );
+    _ftprintf( pFile, _T("Threads     : %lu\n"), (unsigned long)m_ThreadPool.GetThreadCount() );
+    _ftprintf( pFile, _T("Instancing  : %s\n"), m_bInstancing ? _T("on") : _T("off") );
+    _ftprintf( pFile, _T("Occlusion   : %s\n"), !m_bOcclusion ? _T("off") : m_bOcclusionTemporal ? _T("on (temporal)") : _T("on") );
+    _ftprintf( pFile, _T("Pipeline    : %s\n"), m_bThreaded ? _T("threaded") : _T("serial") );
+    if ( m_fLockFPS > 0.0f )
+        _ftprintf( pFile, _T("Frame lock  : %.1f fps, %s\n"), m_fLockFPS, (m_Timer.GetPacing() == TIMERPACE_SPIN) ? _T("spin") : _T("sleep") );
+    else
+        _ftprintf( pFile, _T("Frame lock  : off\n") );
+    if ( m_fTickRate > 0.0f )
+        _ftprintf( pFile, _T("Simulation  : %.1f Hz fixed step, at most %lu per frame\n"), m_fTickRate, (unsigned long)m_nMaxTicks );
+    else
+        _ftprintf( pFile, _T("Simulation  : variable step\n") );
+    _ftprintf( pFile, _T("Sim steps   : %lu (%.3f per frame), %lu dropped\n"), (unsigned long)m_nSimSteps,
+               m_nSimSteps / fFrames, (unsigned long)m_nSimDropped );
+    if ( m_ReplayLog.IsReplaying() )
+    {
+        const FRAMELOG_HEADER & Header = m_ReplayLog.GetHeader();
+        _ftprintf( pFile, _T("Replay      : %s, %lu frames, %s\n"), m_strReplayFile, (unsigned long)m_ReplayLog.GetFrameCount(),
+                   m_bReplayPaced ? _T("recorded pace") : _T("flat out") );
+        if ( Header.Checksum == 0 )
+            _ftprintf( pFile, _T("Scene       : %08lX (recording incomplete, nothing to compare)\n"), (unsigned long)GetSceneChecksum() );
+        else
+            _ftprintf( pFile, _T("Scene       : %08lX, %s recording (%08lX)\n"), (unsigned long)GetSceneChecksum(),
+                       (GetSceneChecksum() == Header.Checksum) ? _T("matches") : _T("DIFFERS from"), (unsigned long)Header.Checksum );
+
+    } // End if replaying
+    else
+        _ftprintf( pFile, _T("Scene       : %08lX, seed %lu\n"), (unsigned long)GetSceneChecksum(), (unsigned long)m_nSeed );
+    _ftprintf( pFile, _T("Frames      : %lu\n"), (unsigned long)Stats.Frames );
+    _ftprintf( pFile, _T("Total (ms)  : %.2f\n"), fTotal );
+    _ftprintf( pFile, _T("Frame (ms)  : %.4f\n"), fTotal / fFrames );
+    _ftprintf( pFile, _T("Frames/sec  : %.1f\n\n"), (fTotal > 0.0) ? fFrames * 1000.0 / fTotal : 0.0 );
+
+    // Frame pacing over the timer's window
+    FRAME_TIME_STATS FrameStats;
+    m_Timer.GetFrameStats( &FrameStats );
+    _ftprintf( pFile, _T("Frame times (ms), last %lu of %lu frames, %s\n"), (unsigned long)FrameStats.Samples,
+               (unsigned long)m_Timer.GetSampleWindow(), m_Timer.GetClockName() );
+    _ftprintf( pFile, _T("Mean %.3f  Min %.3f  P50 %.3f  P95 %.3f  P99 %.3f  Max %.3f\n\n"), FrameStats.fMean, FrameStats.fMin,
+               FrameStats.fP50, FrameStats.fP95, FrameStats.fP99, FrameStats.fMax );
+
+    // Deadlines kept, and the CPU time the sleeps saved over spinning the whole wait
+    if ( m_fLockFPS > 0.0f )
+    {
+        PACING_STATS Pacing;
+        m_Timer.GetPacingStats( &Pacing );
+        _ftprintf( pFile, _T("Pacing error (ms past deadline), %lu frames, %lu missed\n"), (unsigned long)Pacing.Frames, (unsigned long)Pacing.Missed );
+        _ftprintf( pFile, _T("P50 %.3f  P95 %.3f  P99 %.3f  Max %.3f\n"), Pacing.fErrP50, Pacing.fErrP95, Pacing.fErrP99, Pacing.fErrMax );
+        _ftprintf( pFile, _T("Waited %.1f ms: slept %.1f, spun %.1f (%.1f%% of the wait's CPU time saved), margin %.3f ms\n\n"),
+                   Pacing.fWaitTime, Pacing.fSleepTime, Pacing.fSpinTime,
+                   (Pacing.fWaitTime > 0.0) ? Pacing.fSleepTime * 100.0 / Pacing.fWaitTime : 0.0, Pacing.fMargin );
+
+    } // End if locked
+    _ftprintf( pFile, _T("                     Total    Per Frame\n") );
+    _ftprintf( pFile, _T("Draw calls    %12lu %12.1f\n"), (unsigned long)Stats.DrawCalls, Stats.DrawCalls / fFrames );
+    _ftprintf( pFile, _T("Instances     %12lu %12.1f\n"), (unsigned long)Stats.Instances, Stats.Instances / fFrames );
+    _ftprintf( pFile, _T("Primitives    %12.0f %12.1f\n"), (double)Stats.Primitives, (double)Stats.Primitives / fFrames );
+    _ftprintf( pFile, _T("Bytes         %12.0f %12.1f\n"), (double)Stats.BytesSubmitted, (double)Stats.BytesSubmitted / fFrames );
+    _ftprintf( pFile, _T("State changes %12lu %12.1f\n"), (unsigned long)Stats.StateChanges, Stats.StateChanges / fFrames );
+    _ftprintf( pFile, _T("Transforms    %12lu %12.1f\n"), (unsigned long)Stats.TransformChanges, Stats.TransformChanges / fFrames );
+    if ( !m_bSoftware )
+        _ftprintf( pFile, _T("Redundant     %12lu %12.1f\n"), (unsigned long)m_NullBackend.GetRedundantCount(), m_NullBackend.GetRedundantCount() / fFrames );
+    _ftprintf( pFile, _T("Clears        %12lu %12.1f\n"), (unsigned long)Stats.Clears, Stats.Clears / fFrames );
+
+    // Dynamic stream usage
+    const RING_STATS & Stream = m_pBackend->GetStreamStats();
+    _ftprintf( pFile, _T("\nStream                 Total    Per Frame\n") );
+    _ftprintf( pFile, _T("Allocations   %12lu %12.1f\n"), (unsigned long)Stream.Allocations, Stream.Allocations / fFrames );
+    _ftprintf( pFile, _T("Bytes         %12.0f %12.1f\n"), (double)Stream.BytesAllocated, (double)Stream.BytesAllocated / fFrames );
+    _ftprintf( pFile, _T("Wraps         %12lu %12.3f\n"), (unsigned long)Stream.Wraps, Stream.Wraps / fFrames );
+    _ftprintf( pFile, _T("Wrap stalls   %12lu %12.3f\n"), (unsigned long)Stream.WrapStalls, Stream.WrapStalls / fFrames );
+    _ftprintf( pFile, _T("Failures      %12lu %12.3f\n"), (unsigned long)Stream.Failures, Stream.Failures / fFrames );
+    _ftprintf( pFile, _T("High water    %9lu KB of %lu KB\n"), (unsigned long)(Stream.HighWater / 1024), (unsigned long)(DYNAMIC_STREAM_SIZE / 1024) );
+
+    // Time spent simulating & rendering, and the latency between them
+    const SNAPSHOT_STATS & Pipeline = m_Snapshots.GetStats();
+    double fRendered = (Pipeline.Rendered > 0) ? (double)Pipeline.Rendered : 1.0;
+    _ftprintf( pFile, _T("\nPipeline (ms)          Total    Per Frame\n") );
+    _ftprintf( pFile, _T("Simulate      %12.2f %12.4f\n"), Pipeline.fSimTime, Pipeline.fSimTime / fFrames );
+    _ftprintf( pFile, _T("Render        %12.2f %12.4f\n"), Pipeline.fRenderTime, Pipeline.fRenderTime / fRendered );
+    _ftprintf( pFile, _T("Sim waiting   %12.2f %12.4f\n"), Pipeline.fSimWait, Pipeline.fSimWait / fFrames );
+    _ftprintf( pFile, _T("Render idle   %12.2f %12.4f\n"), Pipeline.fRenderWait, Pipeline.fRenderWait / fRendered );
+    _ftprintf( pFile, _T("Latency avg   %12.4f\n"), Pipeline.fLatency / fRendered );
+    _ftprintf( pFile, _T("Latency max   %12.4f\n"), Pipeline.fMaxLatency );
+    _ftprintf( pFile, _T("Rendered      %12lu\n"), (unsigned long)Pipeline.Rendered );
+
+    // Calls issued & filtered by the state cache
+    if ( m_bStateCache )
+    {
+        const STATE_CACHE_STATS & Cache = m_StateCache.GetTotalCacheStats();
+        _ftprintf( pFile, _T("\nState cache     Issued    Filtered   Issued/Frame\n") );
+        _ftprintf( pFile, _T("Render states %8lu %11lu %14.1f\n"), (unsigned long)Cache.StatesIssued, (unsigned long)Cache.StatesFiltered, Cache.StatesIssued / fFrames );
+        _ftprintf( pFile, _T("Transforms    %8lu %11lu %14.1f\n"), (unsigned long)Cache.TransformsIssued, (unsigned long)Cache.TransformsFiltered, Cache.TransformsIssued / fFrames );
+        _ftprintf( pFile, _T("FVFs          %8lu %11lu %14.1f\n"), (unsigned long)Cache.FVFsIssued, (unsigned long)Cache.FVFsFiltered, Cache.FVFsIssued / fFrames );
+
+    } // End if state cache
+
+    // Objects hidden by occluders, and the cost of finding them
+    if ( m_bOcclusion )
+    {
+        _ftprintf( pFile, _T("\nOcclusion              Total    Per Frame\n") );
+        _ftprintf( pFile, _T("Tested        %12lu %12.1f\n"), (unsigned long)m_OcclusionTotals.Tested, m_OcclusionTotals.Tested / fFrames );
+        _ftprintf( pFile, _T("Occluded      %12lu %12.1f\n"), (unsigned long)m_OcclusionTotals.Occluded, m_OcclusionTotals.Occluded / fFrames );
+        _ftprintf( pFile, _T("Occluders     %12lu %12.1f\n"), (unsigned long)m_OcclusionTotals.Occluders, m_OcclusionTotals.Occluders / fFrames );
+        _ftprintf( pFile, _T("Triangles     %12lu %12.1f\n"), (unsigned long)m_OcclusionTotals.OccluderTriangles, m_OcclusionTotals.OccluderTriangles / fFrames );
+        _ftprintf( pFile, _T("Raster (ms)   %12.2f %12.4f\n"), m_OcclusionTotals.fRasterTime, m_OcclusionTotals.fRasterTime / fFrames );
+        _ftprintf( pFile, _T("Build (ms)    %12.2f %12.4f\n"), m_OcclusionTotals.fBuildTime, m_OcclusionTotals.fBuildTime / fFrames );
+        _ftprintf( pFile, _T("Test (ms)     %12.2f %12.4f\n"), m_OcclusionTotals.fTestTime, m_OcclusionTotals.fTestTime / fFrames );
+
+    } // End if occlusion
+
+    // Software rasterizer stage breakdown
+    if ( m_bSoftware )
+    {
+        const RASTER_TIMINGS & Timings = m_SoftwareBackend.GetTotalTimings();
+        _ftprintf( pFile, _T("\nRasterizer      Total (ms)   Frame (ms)\n") );
+        _ftprintf( pFile, _T("Clear         %12.2f %12.4f\n"), Timings.fClear, Timings.fClear / fFrames );
+        _ftprintf( pFile, _T("Geometry      %12.2f %12.4f\n"), Timings.fGeometry, Timings.fGeometry / fFrames );
+        _ftprintf( pFile, _T("Binning       %12.2f %12.4f\n"), Timings.fBinning, Timings.fBinning / fFrames );
+        _ftprintf( pFile, _T("Raster        %12.2f %12.4f\n"), Timings.fRaster, Timings.fRaster / fFrames );
+        _ftprintf( pFile, _T("Triangles     %12lu %12.1f\n"), (unsigned long)Timings.Triangles, Timings.Triangles / fFrames );
+        _ftprintf( pFile, _T("Binned        %12lu %12.1f\n"), (unsigned long)Timings.Binned, Timings.Binned / fFrames );
+
+        // Keep the final frame if requested
+        if ( m_strFrameImage[0] ) m_SoftwareBackend.SaveImage( m_strFrameImage );
+
+    } // End if software
+
+    // Where the frame time went, by thread (/profile:<file>)
+    if ( CProfiler::IsEnabled() )
+    {
+        _ftprintf( pFile, _T("\n") );
+        CProfiler::WriteZoneTree( pFile );
+
+    } // End if profiling
+    fclose( pFile );
+
+    return 0;
+}
+
 //-----------------------------------------------------------------------------
 // Name : ShutDown ()
 // Desc : Shuts down the game engine, and frees up all resources.
 //-----------------------------------------------------------------------------
 bool CGameApp::ShutDown()
 {
+    // Let the render thread finish with the device
+    StopRenderThread();
+    m_Snapshots.Release();
+    m_Telemetry.Release();
+    g_bCountAllocations = false;
+
+    // Complete the recording with the scene it ended on
+    if ( m_FrameLog.IsRecording() ) m_FrameLog.Close( GetSceneChecksum() );
+    m_ReplayLog.Release();
+
     // Destroy Direct3D Objects
-    if ( m_pD3DDevice ) m_pD3DDevice->Release();
-    if ( m_pD3D       ) m_pD3D->Release();
-    m_pD3D       = NULL;
-    m_pD3DDevice = NULL;
+    m_D3DBackend.Release();
+    m_SoftwareBackend.Release();
+    m_StateCache.SetTarget( NULL );
+    m_Occlusion.Release();
+    m_pBackend = NULL;
+
+    // Stop the worker threads
+    m_ThreadPool.Release();
+
+    // Every thread has stopped recording, so write out the profile
+    if ( CProfiler::IsEnabled() ) CProfiler::WriteTrace( m_strProfileFile );
+    CProfiler::Release();
+
+    // Release the objects
+    m_ObjectTree.Release();
+    if ( m_pObject         ) delete []m_pObject;
+    if ( m_pVisibleObjects ) delete []m_pVisibleObjects;
+    m_pObject         = NULL;
+    m_pVisibleObjects = NULL;
+
+    // Release the compact vertex decode buffer
+    if ( m_pDecodeBuffer ) delete []m_pDecodeBuffer;
+    m_pDecodeBuffer   = NULL;
+    m_nDecodeCapacity = 0;
     
     // Destroy the render window
     if ( m_hWnd ) DestroyWindow( m_hWnd );
@@ -391,21 +787,10 @@ LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM
                 // App is active
                 m_bActive = true;
 
-                // Store new viewport sizes
+                // Store new viewport sizes (the back buffer follows once a frame of this size is drawn)
                 m_nViewWidth  = LOWORD( lParam );
                 m_nViewHeight = HIWORD( lParam );
-        
-                if (m_pD3DDevice) 
-                {
-                    // Store new sizes
-                    m_D3DPresentParams.BackBufferWidth = m_nViewWidth;
-                    m_D3DPresentParams.BackBufferHeight = m_nViewHeight;
-                    
-                    // Reset the device
-                    m_pD3DDevice->Reset( &m_D3DPresentParams );
-                    SetupRenderStates( );
-                
-                } // End if
+                SetupProjection( );
             
             } // End if !Minimized
 
@@ -463,11 +848,90 @@ LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM
 // Desc : Build our demonstration cube mesh, and the objects that instance it
 //-----------------------------------------------------------------------------
 bool CGameApp::BuildObjects()
+{
+    BVH_BOUNDS * pBounds = NULL;
+    ULONG        i, Side;
+    bool         bResult;
+
+    // Seed the random number generator (from the clock, unless the run must be repeatable)
+    if ( !m_bFixedSeed ) m_nSeed = timeGetTime();
+    srand( m_nSeed );
+
+    // Map the mesh from file or import it if requested, otherwise build the cube
+    if ( m_strMeshFile[0] )
+    {
+        if ( !m_MeshFile.Open( m_strMeshFile ) ) return false;
+        if ( !m_MeshFile.Attach( &m_Mesh ) ) return false;
+
+    } // End if load from file
+    else if ( m_strImportFile[0] )
+    {
+        CMeshImporter Importer( &m_ThreadPool );
+        if ( !Importer.Import( m_strImportFile, &m_Mesh ) ) return false;
+        if ( !m_Mesh.Compile() ) return false;
+        if ( !m_Mesh.OptimizeCompiled( OPTIMIZE_ALL ) ) return false;
+
+    } // End if import
+    else if ( !BuildCubeMesh() ) return false;
+
+    // Convert the mesh to a file if requested
+    if ( m_strSaveMeshFile[0] && !CMeshFile::Write( m_strSaveMeshFile, &m_Mesh ) ) return false;
+
+    // Build the detail levels used for distant objects
+    if ( m_Mesh.GetCompiled() && !m_Mesh.GenerateLODs( MESH_MAX_LODS ) ) return false;
+
+    // Allocate the objects, all of which reference this mesh
+    if (!( m_pObject = new CObject[ m_nObjectCount ] )) return false;
+    if (!( m_pVisibleObjects = new ULONG[ m_nObjectCount ] )) return false;
+    for ( i = 0; i < m_nObjectCount; i++ ) m_pObject[ i ].m_pMesh = &m_Mesh;
+
+    // Set the first two objects matrices so that they are offset slightly
+    D3DXMatrixTranslation( &m_pObject[ 0 ].m_mtxWorld, -3.5f,  2.0f, 14.0f );
+    D3DXMatrixTranslation( &m_pObject[ 1 ].m_mtxWorld,  3.5f, -2.0f, 14.0f );
+
+    // Any further objects fill a cube shaped grid behind them
+    for ( Side = 1; Side * Side * Side < m_nObjectCount - 2; ) Side++;
+    for ( i = 2; i < m_nObjectCount; i++ )
+    {
+        ULONG Cell = i - 2;
+        float x = (float)(Cell % Side) - (Side - 1) * 0.5f;
+        float y = (float)((Cell / Side) % Side) - (Side - 1) * 0.5f;
+        float z = (float)(Cell / (Side * Side));
+        D3DXMatrixTranslation( &m_pObject[ i ].m_mtxWorld, x * 8.0f, y * 8.0f, 30.0f + z * 8.0f );
+
+    } // Next Object
+
+    // Build the hierarchy over the world space bounds
+    if (!( pBounds = new BVH_BOUNDS[ m_nObjectCount ] )) return false;
+    for ( i = 0; i < m_nObjectCount; i++ )
+    {
+        m_pObject[ i ].UpdateBounds();
+        pBounds[ i ].vecMin = m_pObject[ i ].m_vecBoundsCentre - m_pObject[ i ].m_vecBoundsExtents;
+        pBounds[ i ].vecMax = m_pObject[ i ].m_vecBoundsCentre + m_pObject[ i ].m_vecBoundsExtents;
+
+    } // Next Object
+    bResult = m_ObjectTree.Build( pBounds, m_nObjectCount );
+    delete []pBounds;
+    
+    // Success?
+    return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildCubeMesh () (Private)
+// Desc : Builds the cube mesh used when no mesh file has been specified.
+//-----------------------------------------------------------------------------
+bool CGameApp::BuildCubeMesh()
 {
     CPolygon * pPoly = NULL;
+    ULONG      Color[8];
+
+    // Pick a colour for each corner of the cube, so that each corner can be
+    // welded into a single vertex when the mesh is compiled.
+    for ( ULONG i = 0; i < 8; i++ ) Color[i] = RANDOM_COLOR;
 
-    // Seed the random number generator
-    srand( timeGetTime() );
+    // Store all of the mesh vertices in a single contiguous pool
+    if ( !m_Mesh.SetStorageMode( MESH_STORAGE_POOLED ) ) return false;
 
     // Add 6 polygons to this mesh.
     if ( m_Mesh.AddPolygon( 6 ) < 0 ) return false;
@@ -476,64 +940,68 @@ bool CGameApp::BuildObjects()
     pPoly = m_Mesh.m_pPolygon[0];
     if ( pPoly->AddVertex( 4 ) < 0 ) return false;
     
-    pPoly->m_pVertex[0] = CVertex( -2,  2, -2, RANDOM_COLOR );
-    pPoly->m_pVertex[1] = CVertex(  2,  2, -2, RANDOM_COLOR );
-    pPoly->m_pVertex[2] = CVertex(  2, -2, -2, RANDOM_COLOR );
-    pPoly->m_pVertex[3] = CVertex( -2, -2, -2, RANDOM_COLOR );
+    pPoly->m_pVertex[0] = CVertex( -2,  2, -2, Color[2] );
+    pPoly->m_pVertex[1] = CVertex(  2,  2, -2, Color[3] );
+    pPoly->m_pVertex[2] = CVertex(  2, -2, -2, Color[1] );
+    pPoly->m_pVertex[3] = CVertex( -2, -2, -2, Color[0] );
     
     // Top Face
     pPoly = m_Mesh.m_pPolygon[1];
     if ( pPoly->AddVertex( 4 ) < 0 ) return false;
     
-    pPoly->m_pVertex[0] = CVertex( -2,  2,  2, RANDOM_COLOR );
-    pPoly->m_pVertex[1] = CVertex(  2,  2,  2, RANDOM_COLOR );
-    pPoly->m_pVertex[2] = CVertex(  2,  2, -2, RANDOM_COLOR );
-    pPoly->m_pVertex[3] = CVertex( -2,  2, -2, RANDOM_COLOR );
+    pPoly->m_pVertex[0] = CVertex( -2,  2,  2, Color[6] );
+    pPoly->m_pVertex[1] = CVertex(  2,  2,  2, Color[7] );
+    pPoly->m_pVertex[2] = CVertex(  2,  2, -2, Color[3] );
+    pPoly->m_pVertex[3] = CVertex( -2,  2, -2, Color[2] );
 
     // Back Face
     pPoly = m_Mesh.m_pPolygon[2];
     if ( pPoly->AddVertex( 4 ) < 0 ) return false;
 
-    pPoly->m_pVertex[0] = CVertex( -2, -2,  2, RANDOM_COLOR );
-    pPoly->m_pVertex[1] = CVertex(  2, -2,  2, RANDOM_COLOR );
-    pPoly->m_pVertex[2] = CVertex(  2,  2,  2, RANDOM_COLOR );
-    pPoly->m_pVertex[3] = CVertex( -2,  2,  2, RANDOM_COLOR );
+    pPoly->m_pVertex[0] = CVertex( -2, -2,  2, Color[4] );
+    pPoly->m_pVertex[1] = CVertex(  2, -2,  2, Color[5] );
+    pPoly->m_pVertex[2] = CVertex(  2,  2,  2, Color[7] );
+    pPoly->m_pVertex[3] = CVertex( -2,  2,  2, Color[6] );
 
     // Bottom Face
     pPoly = m_Mesh.m_pPolygon[3];
     if ( pPoly->AddVertex( 4 ) < 0 ) return false;
 
-    pPoly->m_pVertex[0] = CVertex( -2, -2, -2, RANDOM_COLOR );
-    pPoly->m_pVertex[1] = CVertex(  2, -2, -2, RANDOM_COLOR );
-    pPoly->m_pVertex[2] = CVertex(  2, -2,  2, RANDOM_COLOR );
-    pPoly->m_pVertex[3] = CVertex( -2, -2,  2, RANDOM_COLOR );
+    pPoly->m_pVertex[0] = CVertex( -2, -2, -2, Color[0] );
+    pPoly->m_pVertex[1] = CVertex(  2, -2, -2, Color[1] );
+    pPoly->m_pVertex[2] = CVertex(  2, -2,  2, Color[5] );
+    pPoly->m_pVertex[3] = CVertex( -2, -2,  2, Color[4] );
 
     // Left Face
     pPoly = m_Mesh.m_pPolygon[4];
     if ( pPoly->AddVertex( 4 ) < 0 ) return false;
 
-    pPoly->m_pVertex[0] = CVertex( -2,  2,  2, RANDOM_COLOR );
-    pPoly->m_pVertex[1] = CVertex( -2,  2, -2, RANDOM_COLOR );
-    pPoly->m_pVertex[2] = CVertex( -2, -2, -2, RANDOM_COLOR );
-    pPoly->m_pVertex[3] = CVertex( -2, -2,  2, RANDOM_COLOR );
+    pPoly->m_pVertex[0] = CVertex( -2,  2,  2, Color[6] );
+    pPoly->m_pVertex[1] = CVertex( -2,  2, -2, Color[2] );
+    pPoly->m_pVertex[2] = CVertex( -2, -2, -2, Color[0] );
+    pPoly->m_pVertex[3] = CVertex( -2, -2,  2, Color[4] );
 
     // Right Face
     pPoly = m_Mesh.m_pPolygon[5];
     if ( pPoly->AddVertex( 4 ) < 0 ) return false;
 
-    pPoly->m_pVertex[0] = CVertex(  2,  2, -2, RANDOM_COLOR );
-    pPoly->m_pVertex[1] = CVertex(  2,  2,  2, RANDOM_COLOR ); 
-    pPoly->m_pVertex[2] = CVertex(  2, -2,  2, RANDOM_COLOR );
-    pPoly->m_pVertex[3] = CVertex(  2, -2, -2, RANDOM_COLOR );
+    pPoly->m_pVertex[0] = CVertex(  2,  2, -2, Color[3] );
+    pPoly->m_pVertex[1] = CVertex(  2,  2,  2, Color[7] ); 
+    pPoly->m_pVertex[2] = CVertex(  2, -2,  2, Color[5] );
+    pPoly->m_pVertex[3] = CVertex(  2, -2, -2, Color[1] );
 
-    // Our two objects should reference this mesh
-    m_pObject[ 0 ].m_pMesh = &m_Mesh;
-    m_pObject[ 1 ].m_pMesh = &m_Mesh;
+    // Pack the vertex pool in polygon order now that building is complete
+    if ( !m_Mesh.Compact() ) return false;
+
+    // Compile the mesh into a welded, indexed triangle list
+    if ( !m_Mesh.Compile() ) return false;
+
+    // Reorder the compiled triangles and vertices for the GPU
+    if ( !m_Mesh.OptimizeCompiled( OPTIMIZE_ALL ) ) return false;
+
+    // Quantise the compiled vertices, keeping only the compact copy
+    if ( !m_Mesh.QuantizeCompiled( NULL, true ) ) return false;
 
-    // Set both objects matrices so that they are offset slightly
-    D3DXMatrixTranslation( &m_pObject[ 0 ].m_mtxWorld, -3.5f,  2.0f, 14.0f );
-    D3DXMatrixTranslation( &m_pObject[ 1 ].m_mtxWorld,  3.5f, -2.0f, 14.0f );
-    
     // Success!
     return true;
 }
@@ -541,123 +1009,649 @@ bool CGameApp::BuildObjects()
 //-----------------------------------------------------------------------------
 // Name : FrameAdvance () (Private)
 // Desc : Called to signal that we are now rendering the next frame.
+// Note : When pipelined, the frame is only simulated here and is drawn by
+//        the render thread, while the next frame is simulated.
 //-----------------------------------------------------------------------------
 void CGameApp::FrameAdvance()
 {
-    CMesh      *pMesh = NULL;
+    const SCENE_SNAPSHOT * pDrawn;
+    PROFILE_FRAME();
+    PROFILE_ZONE( "FrameAdvance" );
  
     // Advance the timer
-    m_Timer.Tick( );
+    m_Timer.Tick( GetFrameLock() );
    
     // Skip if app is inactive
     if ( !m_bActive ) return;
 
-    // Recover lost device if required
-    if ( m_bLostDevice )
+    // Gather the time step & input to simulate with, keeping them if recording
+    ReadFrameInput();
+    if ( m_FrameLog.IsRecording() ) m_FrameLog.Write( m_FrameInput );
+
+    // Simulate into the next free snapshot, and pass it on
+    WaitForWrite();
+    SimulateFrame( m_Snapshots.BeginWrite() );
+    m_Snapshots.Publish();
+
+    // Otherwise draw it straight away
+    if ( !m_hRenderThread && (pDrawn = m_Snapshots.Acquire()) )
     {
-        // Can we reset the device yet ?
-        HRESULT hRet = m_pD3DDevice->TestCooperativeLevel();
-        if ( hRet == D3DERR_DEVICENOTRESET )
-        {
-            // Restore the device
-            m_pD3DDevice->Reset( &m_D3DPresentParams );
-            SetupRenderStates( );
-            m_bLostDevice = false;
-        
-        } // End if can reset
-        else
-        {
-            return;
+        RenderFrame( *pDrawn );
+        m_Snapshots.Complete( m_nDrawCalls );
+
+    } // End if serial
+
+    // Publish the frame's timings
+    if ( m_Telemetry.IsOpen() ) RecordTelemetry();
+}
+
+//-----------------------------------------------------------------------------
+// Name : RecordTelemetry () (Private)
+// Desc : Writes the frame just advanced to the telemetry ring.
+// Note : Takes the render figures as handed over by the latest Complete,
+//        so when pipelined they are those of the latest frame drawn.
+//-----------------------------------------------------------------------------
+void CGameApp::RecordTelemetry()
+{
+    SNAPSHOT_STATS     Pipeline;
+    TELEMETRY_RECORD * pRecord      = m_Telemetry.BeginRecord();
+    LONG               nAllocations = g_nAllocations;
+
+    m_Snapshots.CopyStats( &Pipeline );
+
+    pRecord->Frame        = Pipeline.Published;
+    pRecord->fFrameTime   = m_Timer.GetFrameTime() * 1000.0f;
+    pRecord->fSimTime     = Pipeline.fLastSimTime;
+    pRecord->fCullTime    = m_CullStats.fCullTime;
+    pRecord->fRenderTime  = Pipeline.fLastRenderTime;
+    pRecord->fLatency     = Pipeline.fLastLatency;
+    pRecord->DrawCalls    = Pipeline.LastDrawCalls;
+    pRecord->Objects      = m_CullStats.Visible;
+    pRecord->Allocations  = (ULONG)(nAllocations - m_nLastAllocations);
+    m_Telemetry.Publish();
+
+    m_nLastAllocations = nAllocations;
+}
+
+//-----------------------------------------------------------------------------
+// Name : StartRenderThread () (Private)
+// Desc : Starts the thread which draws each snapshot as it is published.
+//-----------------------------------------------------------------------------
+bool CGameApp::StartRenderThread()
+{
+    // Already running?
+    if ( m_hRenderThread ) return true;
+
+    // The render thread hands device resets back to us through these
+    if ( !m_hResetRequest && !(m_hResetRequest = CreateEvent( NULL, TRUE, FALSE, NULL )) ) return false;
+    if ( !m_hResetDone && !(m_hResetDone = CreateEvent( NULL, FALSE, FALSE, NULL )) ) return false;
+
+    m_Snapshots.Reset();
+    if (!( m_hRenderThread = (HANDLE)_beginthreadex( NULL, 0, RenderThread, this, 0, NULL ) )) return false;
 
-        } // End if cannot reset
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : StopRenderThread () (Private)
+// Desc : Closes the snapshot buffer, and waits for the render thread to
+//        draw whatever was already published and exit.
+// Note : Any reset the render thread asks for while finishing up is still
+//        carried out here, or it would never exit.
+//-----------------------------------------------------------------------------
+void CGameApp::StopRenderThread()
+{
+    HANDLE Handles[2];
+
+    // Wait for the render thread to finish, if running
+    if ( m_hRenderThread )
+    {
+        m_Snapshots.Close();
+        Handles[0] = m_hRenderThread;
+        Handles[1] = m_hResetRequest;
+        while ( WaitForMultipleObjects( 2, Handles, FALSE, INFINITE ) == WAIT_OBJECT_0 + 1 ) ServiceReset();
+        CloseHandle( m_hRenderThread );
+        m_hRenderThread = NULL;
+
+    } // End if running
+
+    if ( m_hResetRequest ) CloseHandle( m_hResetRequest );
+    if ( m_hResetDone    ) CloseHandle( m_hResetDone );
+    m_hResetRequest = NULL;
+    m_hResetDone    = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : WaitForWrite () (Private)
+// Desc : Waits until a snapshot is free to simulate into, resetting the
+//        device whenever the render thread asks for it in the meantime.
+// Note : Without this the render thread could be parked on a reset, with
+//        us parked on a snapshot only it can free.
+//-----------------------------------------------------------------------------
+void CGameApp::WaitForWrite()
+{
+    HANDLE Handles[2];
+
+    // Nothing to wait for when serial
+    if ( !m_hRenderThread ) return;
+
+    Handles[0] = m_hResetRequest;
+    Handles[1] = m_Snapshots.GetWriteEvent();
+    while ( WaitForMultipleObjects( 2, Handles, FALSE, INFINITE ) == WAIT_OBJECT_0 ) ServiceReset();
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetBackend () (Private)
+// Desc : Resizes the back buffer if needed, and recovers a lost device.
+// Note : Resets the device, so may only be called on the window's thread
+//        (see RequestReset).
+//-----------------------------------------------------------------------------
+void CGameApp::ResetBackend( ULONG Width, ULONG Height )
+{
+    // Follow the window size
+    if ( Width != m_nBackBufferWidth || Height != m_nBackBufferHeight )
+    {
+        m_pBackend->Resize( Width, Height );
+        m_nBackBufferWidth  = Width;
+        m_nBackBufferHeight = Height;
+        SetupRenderStates( );
+
+    } // End if resized
+
+    // Recover lost device if required
+    if ( m_pBackend->IsLost() )
+    {
+        // Can we restore the device yet ?
+        if ( !m_pBackend->Restore() ) return;
+        SetupRenderStates( );
 
     } // End if Device Lost
+}
+
+//-----------------------------------------------------------------------------
+// Name : RequestReset () (Private)
+// Desc : Called on the render thread to have the main thread reset the
+//        device, and waits until it has.
+// Note : IDirect3DDevice9::Reset must run on the thread which pumps the
+//        window's messages, otherwise it can deadlock (in full screen
+//        especially) waiting on a message that thread is blocked from
+//        handling.
+//-----------------------------------------------------------------------------
+void CGameApp::RequestReset( ULONG Width, ULONG Height )
+{
+    m_nResetWidth  = Width;
+    m_nResetHeight = Height;
+    SetEvent( m_hResetRequest );
+    WaitForSingleObject( m_hResetDone, INFINITE );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ServiceReset () (Private)
+// Desc : Called on the main thread to carry out the reset the render thread
+//        asked for, while it is parked in RequestReset.
+//-----------------------------------------------------------------------------
+void CGameApp::ServiceReset()
+{
+    ResetEvent( m_hResetRequest );
+    ResetBackend( m_nResetWidth, m_nResetHeight );
+    SetEvent( m_hResetDone );
+}
+
+//-----------------------------------------------------------------------------
+// Name : RenderThread () (Private, Static)
+// Desc : Render thread entry point. Draws snapshots until the buffer closes.
+//-----------------------------------------------------------------------------
+unsigned __stdcall CGameApp::RenderThread( void * pParam )
+{
+    CGameApp             * pApp = (CGameApp*)pParam;
+    const SCENE_SNAPSHOT * pSnapshot;
+    PROFILE_THREAD( "Render" );
+
+    while (( pSnapshot = pApp->m_Snapshots.Acquire() ))
+    {
+        pApp->RenderFrame( *pSnapshot );
+        pApp->m_Snapshots.Complete( pApp->m_nDrawCalls );
+
+    } // Next Snapshot
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SimulateFrame () (Private)
+// Desc : Advances the scene to the current time, and captures the view and
+//        every visible object's transform into the snapshot specified,
+//        blended between the latest two simulation steps.
+// Note : Culling uses the latest step, so the few pixels an object moves
+//        between steps may let it appear or vanish up to one step early.
+//-----------------------------------------------------------------------------
+void CGameApp::SimulateFrame( SCENE_SNAPSHOT * pSnapshot )
+{
+    PROFILE_ZONE( "SimulateFrame" );
 
-    // Get / Display the framerate
+    // Run the simulation up to the current time
+    StepSimulation();
+
+    // Remove objects which cannot be seen
+    CullObjects();
+
+    // Build the sorted list of draws for this frame
+    RecordCommands();
+
+    // Get / Display the framerate & culling results (the draw count & latency
+    // are handed over by the render thread when pipelined, so may be a frame behind)
     int nFrameRate = m_Timer.GetFrameRate();
     static int nLastFrameRate = 0;
-    if ( nLastFrameRate != nFrameRate )
+    static ULONG nLastVisible = 0xFFFFFFFF;
+    if ( nLastFrameRate != nFrameRate || nLastVisible != m_CullStats.Visible )
     {
-        static char FPSBuffer[20];
+        static TCHAR FPSBuffer[20], TitleBuffer[160];
+        SNAPSHOT_STATS Pipeline;
+        m_Snapshots.CopyStats( &Pipeline );
         m_Timer.GetFrameRate( FPSBuffer );
+        _stprintf( TitleBuffer, _T("%s - Visible: %lu Culled: %lu (%.3fms) Occluded: %lu Draws: %lu Latency: %.1fms"), FPSBuffer, m_CullStats.Visible,
+                   m_CullStats.Culled, m_CullStats.fCullTime, m_Occlusion.GetStats().Occluded, Pipeline.LastDrawCalls, Pipeline.fLastLatency );
         nLastFrameRate = nFrameRate;
-        SetWindowText( m_hWnd, FPSBuffer );
+        nLastVisible   = m_CullStats.Visible;
+        if ( m_hWnd ) SetWindowText( m_hWnd, TitleBuffer );
 
-    } // End if Frame Rate Altered
+    } // End if Frame Rate or Visibility Altered
 
-    // Poll & Process input devices
-    ProcessInput();
+    // Capture everything the renderer needs, in submission order
+    pSnapshot->ViewWidth     = m_nViewWidth;
+    pSnapshot->ViewHeight    = m_nViewHeight;
+    pSnapshot->mtxProjection = m_mtxProjection;
+    CObject::InterpolateTransform( &pSnapshot->mtxView, m_mtxPrevView, m_mtxView, m_fSimAlpha );
+    if ( !m_Snapshots.ReserveDraws( m_RenderQueue.GetCommandCount() ) ) return;
 
-    // Animate the two objects
-    AnimateObjects();
+    const RENDER_COMMAND * pCommand = m_RenderQueue.GetCommands();
+    for ( ULONG c = 0; c < m_RenderQueue.GetCommandCount(); c++, pCommand++ )
+    {
+        SNAPSHOT_DRAW & Draw = pSnapshot->pDraws[c];
+        m_pObject[ pCommand->Object ].GetRenderTransform( &Draw.mtxWorld, m_fSimAlpha );
+        Draw.Object   = pCommand->Object;
+        Draw.LOD      = pCommand->Param;
+
+    } // Next Command
+    pSnapshot->DrawCount = m_RenderQueue.GetCommandCount();
+}
+
+//-----------------------------------------------------------------------------
+// Name : RenderFrame () (Private)
+// Desc : Draws and presents a snapshot of the scene.
+// Note : Only the object meshes are read from the live scene, as they never
+//        change once built. When pipelined this runs on the render thread,
+//        which then owns the backend, except that device resets are handed
+//        to the main thread (see RequestReset).
+//-----------------------------------------------------------------------------
+void CGameApp::RenderFrame( const SCENE_SNAPSHOT & Snapshot )
+{
+    CMesh      *pMesh = NULL;
+    PROFILE_ZONE( "RenderFrame" );
+
+    // Follow the window size the frame was simulated for, and recover a lost
+    // device (through the main thread when pipelined)
+    if ( Snapshot.ViewWidth != m_nBackBufferWidth || Snapshot.ViewHeight != m_nBackBufferHeight || m_pBackend->IsLost() )
+    {
+        if ( m_hRenderThread )
+            RequestReset( Snapshot.ViewWidth, Snapshot.ViewHeight );
+        else
+            ResetBackend( Snapshot.ViewWidth, Snapshot.ViewHeight );
+
+        // Skip the frame if the device could not be restored yet
+        if ( m_pBackend->IsLost() ) return;
+
+    } // End if reset required
+
+    // Setup our matrices
+    m_pBackend->SetTransform( D3DTS_VIEW, Snapshot.mtxView );
+    m_pBackend->SetTransform( D3DTS_PROJECTION, Snapshot.mtxProjection );
 
     // Clear the frame & depth buffer ready for drawing
-    m_pD3DDevice->Clear( 0, NULL, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0xFFFFFFFF, 1.0f, 0 );
+    m_pBackend->Clear( D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0xFFFFFFFF, 1.0f );
     
     // Begin Scene Rendering
-    m_pD3DDevice->BeginScene();
-
-    // Loop through each object
-    for ( ULONG i = 0; i < 2; i++ )
+    m_pBackend->BeginScene();
+
+    // Submit the commands in sorted order
+    PROFILE_ZONE_NAMED( DrawZone, "Draw" );
+    m_Batcher.Begin();
+    ULONG FirstDrawCall = m_pBackend->GetStats().DrawCalls;
+    const SNAPSHOT_DRAW * pDraw = Snapshot.pDraws;
+    for ( ULONG c = 0; c < Snapshot.DrawCount; c++, pDraw++ )
     {
         // Store mesh for easy access
-        pMesh = m_pObject[i].m_pMesh;
+        pMesh = m_pObject[ pDraw->Object ].m_pMesh;
+
+        // Compiled meshes are queued, and drawn together once every object is known
+        if ( m_bInstancing && pMesh->GetCompiled() )
+        {
+            m_Batcher.Add( pMesh->GetLOD( pDraw->LOD ), &pDraw->mtxWorld );
+            continue;
+
+        } // End if instanced
 
         // Set our object matrix
-        m_pD3DDevice->SetTransform( D3DTS_WORLD, &m_pObject[i].m_mtxWorld );
+        m_pBackend->SetTransform( D3DTS_WORLD, pDraw->mtxWorld );
 
-        // Loop through each polygon
-        for ( ULONG f = 0; f < pMesh->m_nPolygonCount; f++ )
+        if ( pMesh->GetCompiled() )
         {
-            CPolygon * pPolygon = pMesh->m_pPolygon[f];
+            // Draw the detail level selected while recording
+            const CCompiledMesh * pCompiled = pMesh->GetLOD( pDraw->LOD );
+            const CVertex       * pVertices = pCompiled->GetVertices();
+
+            // Compact meshes must be expanded before the fixed function pipeline can use them
+            if ( !pVertices )
+            {
+                if ( pCompiled->GetVertexCount() > m_nDecodeCapacity )
+                {
+                    if ( m_pDecodeBuffer ) delete []m_pDecodeBuffer;
+                    m_nDecodeCapacity = 0;
+                    if (!( m_pDecodeBuffer = new CVertex[ pCompiled->GetVertexCount() ] )) continue;
+                    m_nDecodeCapacity = pCompiled->GetVertexCount();
+
+                } // End if grow buffer
+
+                pCompiled->DecodeVertices( m_pDecodeBuffer );
+                pVertices = m_pDecodeBuffer;
+
+            } // End if compact only
+
+            // Render the entire mesh with a single call
+            m_pBackend->DrawIndexedPrimitiveUP( D3DPT_TRIANGLELIST, pCompiled->GetVertexCount(), pCompiled->GetTriangleCount(),
+                                                pCompiled->GetIndices(), pCompiled->GetIndexFormat(), pVertices, sizeof(CVertex) );
+
+        } // End if compiled
+        else if ( pMesh->GetStorageMode() == MESH_STORAGE_POOLED )
+        {
+            // Walk the polygon table and vertex pool front to back
+            const POLYGON_RANGE * pRange = pMesh->GetPolygonRanges();
+            const CVertex       * pPool  = pMesh->GetVertexPool();
+            ULONG                 StartVertex;
+            CVertex             * pStream;
+
+            // Stream the whole pool with a single copy, so that each polygon is just a range of it
+            if (( pStream = (CVertex*)m_pBackend->LockVertices( pMesh->GetVertexPoolCount(), sizeof(CVertex), &StartVertex ) ))
+            {
+                memcpy( pStream, pPool, pMesh->GetVertexPoolCount() * sizeof(CVertex) );
+                m_pBackend->UnlockVertices();
+
+                for ( ULONG f = 0; f < pMesh->m_nPolygonCount; f++, pRange++ )
+                {
+                    // Render the primitive
+                    m_pBackend->DrawPrimitive( D3DPT_TRIANGLEFAN, StartVertex + pRange->FirstVertex, pRange->VertexCount - 2 );
+
+                } // Next Polygon
+
+            } // End if streamed
+            else
+            {
+                for ( ULONG f = 0; f < pMesh->m_nPolygonCount; f++, pRange++ )
+                {
+                    // Render the primitive
+                    m_pBackend->DrawPrimitiveUP( D3DPT_TRIANGLEFAN, pRange->VertexCount - 2, &pPool[ pRange->FirstVertex ], sizeof(CVertex) );
+
+                } // Next Polygon
+
+            } // End if user memory
+
+        } // End if pooled
+        else
+        {
+            ULONG     f, VertexCount = 0, StartVertex;
+            CVertex * pStream;
+
+            // Gather the polygons into the dynamic stream
+            for ( f = 0; f < pMesh->m_nPolygonCount; f++ ) VertexCount += pMesh->m_pPolygon[f]->m_nVertexCount;
+            if (( pStream = (CVertex*)m_pBackend->LockVertices( VertexCount, sizeof(CVertex), &StartVertex ) ))
+            {
+                for ( f = 0; f < pMesh->m_nPolygonCount; f++ )
+                {
+                    CPolygon * pPolygon = pMesh->m_pPolygon[f];
+                    memcpy( pStream, pPolygon->m_pVertex, pPolygon->m_nVertexCount * sizeof(CVertex) );
+                    pStream += pPolygon->m_nVertexCount;
+
+                } // Next Polygon
+                m_pBackend->UnlockVertices();
+
+            } // End if streamed
+
+            // Loop through each polygon
+            for ( f = 0; f < pMesh->m_nPolygonCount; f++ )
+            {
+                CPolygon * pPolygon = pMesh->m_pPolygon[f];
             
-            // Render the primitive
-            m_pD3DDevice->DrawPrimitiveUP( D3DPT_TRIANGLEFAN, pPolygon->m_nVertexCount - 2, pPolygon->m_pVertex, sizeof(CVertex) );
+                // Render the primitive
+                if ( pStream )
+                {
+                    m_pBackend->DrawPrimitive( D3DPT_TRIANGLEFAN, StartVertex, pPolygon->m_nVertexCount - 2 );
+                    StartVertex += pPolygon->m_nVertexCount;
+
+                } // End if streamed
+                else
+                {
+                    m_pBackend->DrawPrimitiveUP( D3DPT_TRIANGLEFAN, pPolygon->m_nVertexCount - 2, pPolygon->m_pVertex, sizeof(CVertex) );
+
+                } // End if user memory
     
-        } // Next Polygon
+            } // Next Polygon
+
+        } // End if per-polygon storage
     
     } // Next Object
 
+    // Submit each group of instances
+    if ( m_Batcher.GetInstanceCount() > 0 )
+    {
+        D3DXMATRIX          mtxViewProj;
+        IInstanceRenderer * pRenderer;
+        D3DXMatrixMultiply( &mtxViewProj, &Snapshot.mtxView, &Snapshot.mtxProjection );
+        if (( pRenderer = m_pBackend->BeginInstancing( mtxViewProj ) ))
+        {
+            m_Batcher.Flush( pRenderer );
+            m_pBackend->EndInstancing();
+
+        } // End if instancing available
+
+    } // End if instances
+    m_nDrawCalls = m_pBackend->GetStats().DrawCalls - FirstDrawCall;
+    PROFILE_ZONE_END( DrawZone );
+
     // End Scene Rendering
-    m_pD3DDevice->EndScene();
+    m_pBackend->EndScene();
     
-    // Present the buffer
-    if ( FAILED(m_pD3DDevice->Present( NULL, NULL, NULL, NULL )) ) m_bLostDevice = true;
+    // Present the buffer (a failure flags the device as lost)
+    PROFILE_ZONE( "Present" );
+    m_pBackend->Present();
 
 }
 
+//-----------------------------------------------------------------------------
+// Name : ReadFrameInput () (Private)
+// Desc : Fills in the time step & input the frame is simulated with, either
+//        from the timer & input devices, or from the log being replayed.
+// Note : Input is polled once per frame, so every step of a frame sees the
+//        same input, live or replayed.
+//-----------------------------------------------------------------------------
+void CGameApp::ReadFrameInput()
+{
+    // Replaying ?
+    if ( m_ReplayLog.IsReplaying() )
+    {
+        // Past the end, the scene stands still
+        if ( m_nReplayFrame < m_ReplayLog.GetFrameCount() )
+            m_FrameInput = m_ReplayLog.GetFrame( m_nReplayFrame++ );
+        else
+            m_FrameInput.fFrameTime = m_FrameInput.fTimeElapsed = 0.0f;
+
+        m_bRotation1 = ( m_FrameInput.Input & FRAMEINPUT_ROTATION1 ) != 0;
+        m_bRotation2 = ( m_FrameInput.Input & FRAMEINPUT_ROTATION2 ) != 0;
+        return;
+
+    } // End if replaying
+
+    m_FrameInput.fFrameTime   = m_Timer.GetFrameTime();
+    m_FrameInput.fTimeElapsed = m_Timer.GetTimeElapsed();
+    m_FrameInput.Input        = 0;
+    if ( GetKeyState( VK_LEFT  ) & 0xFF00 ) m_FrameInput.Input |= FRAMEINPUT_LEFT;
+    if ( GetKeyState( VK_RIGHT ) & 0xFF00 ) m_FrameInput.Input |= FRAMEINPUT_RIGHT;
+    if ( m_bRotation1 ) m_FrameInput.Input |= FRAMEINPUT_ROTATION1;
+    if ( m_bRotation2 ) m_FrameInput.Input |= FRAMEINPUT_ROTATION2;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFrameLock () (Private)
+// Desc : Returns the frame rate the timer should hold the coming frame to.
+// Note : Replays run flat out, unless asked to keep to the recorded pace.
+//        The timer sets each deadline a frame ahead, so the rate is that of
+//        the frame after the one about to be replayed.
+//-----------------------------------------------------------------------------
+float CGameApp::GetFrameLock() const
+{
+    ULONG Frame;
+    float fFrameTime;
+
+    // Not replaying ?
+    if ( !m_ReplayLog.IsReplaying() ) return m_fLockFPS;
+    if ( !m_bReplayPaced ) return 0.0f;
+
+    Frame = m_nReplayFrame + 1;
+    if ( Frame >= m_ReplayLog.GetFrameCount() ) Frame = m_ReplayLog.GetFrameCount() - 1;
+    fFrameTime = m_ReplayLog.GetFrame( Frame ).fFrameTime;
+    return ( fFrameTime > 0.0f ) ? 1.0f / fFrameTime : 0.0f;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetSceneChecksum () (Private)
+// Desc : Checksums the view & every object's world matrix (FNV-1a), so that
+//        a replay can be checked against the run it was recorded from.
+//-----------------------------------------------------------------------------
+ULONG CGameApp::GetSceneChecksum() const
+{
+    ULONG        Checksum = 2166136261UL;
+    const UCHAR *pBytes;
+    ULONG        i, j;
+
+    pBytes = (const UCHAR*)&m_mtxView;
+    for ( j = 0; j < sizeof(D3DXMATRIX); j++ ) Checksum = (Checksum ^ pBytes[j]) * 16777619UL;
+
+    for ( i = 0; i < m_nObjectCount && m_pObject; i++ )
+    {
+        pBytes = (const UCHAR*)&m_pObject[ i ].m_mtxWorld;
+        for ( j = 0; j < sizeof(D3DXMATRIX); j++ ) Checksum = (Checksum ^ pBytes[j]) * 16777619UL;
+
+    } // Next Object
+
+    return Checksum;
+}
+
+//-----------------------------------------------------------------------------
+// Name : StepSimulation () (Private)
+// Desc : Takes as many fixed simulation steps as the frame time gathered so
+//        far covers, and notes how far past the latest step this frame is,
+//        so that it can be drawn between that step and the one before.
+// Note : No more than m_nMaxTicks steps are taken in a frame, and any time
+//        still owed after that is dropped, so a slow frame slows the
+//        simulation down rather than making the frames after it slower too.
+//        With no tick rate, one step of the smoothed frame time is taken
+//        each frame, as before.
+//-----------------------------------------------------------------------------
+void CGameApp::StepSimulation()
+{
+    float fStep;
+    ULONG Steps = 0, Dropped;
+    PROFILE_ZONE( "StepSimulation" );
+
+    // Variable step ?
+    if ( m_fTickRate <= 0.0f )
+    {
+        SimulateStep( m_FrameInput.fTimeElapsed );
+        m_fSimAlpha = 1.0f;
+        return;
+
+    } // End if variable
+
+    // Step through the time gathered
+    fStep = 1.0f / m_fTickRate;
+    m_fSimAccumulator += m_FrameInput.fFrameTime;
+    while ( m_fSimAccumulator >= fStep && Steps < m_nMaxTicks )
+    {
+        SimulateStep( fStep );
+        m_fSimAccumulator -= fStep;
+        Steps++;
+
+    } // Next Step
+
+    // Drop whatever the clamp left over
+    if ( m_fSimAccumulator >= fStep )
+    {
+        Dropped = (ULONG)(m_fSimAccumulator / fStep);
+        m_fSimAccumulator -= Dropped * (double)fStep;
+        m_nSimDropped     += Dropped;
+
+    } // End if clamped
+
+    m_fSimAlpha = (float)(m_fSimAccumulator / fStep);
+}
+
+//-----------------------------------------------------------------------------
+// Name : SimulateStep () (Private)
+// Desc : Advances the input & animation by the time specified (seconds).
+//-----------------------------------------------------------------------------
+void CGameApp::SimulateStep( float fTimeStep )
+{
+    PROFILE_ZONE( "SimulateStep" );
+
+    // Keep the view this step starts from, to draw from
+    m_mtxPrevView = m_mtxView;
+
+    // Poll & Process input devices
+    ProcessInput( fTimeStep );
+
+    // Animate the two objects
+    AnimateObjects( fTimeStep );
+
+    m_nSimSteps++;
+}
+
 //-----------------------------------------------------------------------------
 // Name : ProcessInput () (Private)
-// Desc : Simply polls the input devices and performs basic input operations
+// Desc : Performs basic input operations, with the input polled for the frame
 //-----------------------------------------------------------------------------
-void CGameApp::ProcessInput( )
+void CGameApp::ProcessInput( float fTimeStep )
 {
+    PROFILE_ZONE( "ProcessInput" );
+
     // Simple strafing
-    if ( GetKeyState( VK_LEFT  ) & 0xFF00 ) m_mtxView._41 += 25.0f * m_Timer.GetTimeElapsed();
-    if ( GetKeyState( VK_RIGHT ) & 0xFF00 ) m_mtxView._41 -= 25.0f * m_Timer.GetTimeElapsed();
-        
-    // Update the device matrix
-    if (m_pD3DDevice) m_pD3DDevice->SetTransform( D3DTS_VIEW, &m_mtxView );
+    if ( m_FrameInput.Input & FRAMEINPUT_LEFT  ) m_mtxView._41 += 25.0f * fTimeStep;
+    if ( m_FrameInput.Input & FRAMEINPUT_RIGHT ) m_mtxView._41 -= 25.0f * fTimeStep;
 
 }
 
 //-----------------------------------------------------------------------------
 // Name : AnimateObjects () (Private)
-// Desc : Animates the objects we currently have loaded.
+// Desc : Animates the objects we currently have loaded, by the time step
+//        specified (seconds).
 //-----------------------------------------------------------------------------
-void CGameApp::AnimateObjects()
+void CGameApp::AnimateObjects( float fTimeStep )
 {
     // Note : Expanded for the purposes of this example only.
     D3DXMATRIX mtxYaw, mtxPitch, mtxRoll, mtxRotate;
     float RotationYaw, RotationPitch, RotationRoll;
+    PROFILE_ZONE( "AnimateObjects" );
+
+    // Keep the transforms this step starts from
+    m_pObject[ 0 ].SaveTransform();
+    m_pObject[ 1 ].SaveTransform();
 
     // Rotate Object 1 by small amount
     if ( m_bRotation1 )
     {
         // Calculate rotation values for object 0
-        RotationYaw   = D3DXToRadian( 75.0f * m_Timer.GetTimeElapsed() );
-        RotationPitch = D3DXToRadian( 50.0f * m_Timer.GetTimeElapsed() );
-        RotationRoll  = D3DXToRadian( 25.0f * m_Timer.GetTimeElapsed() );
+        RotationYaw   = D3DXToRadian( 75.0f * fTimeStep );
+        RotationPitch = D3DXToRadian( 50.0f * fTimeStep );
+        RotationRoll  = D3DXToRadian( 25.0f * fTimeStep );
 
         // Build rotation matrices 
         D3DXMatrixIdentity( &mtxRotate );
@@ -679,9 +1673,9 @@ void CGameApp::AnimateObjects()
     if ( m_bRotation2 )
     {
         // Calculate rotation values for object 1
-        RotationYaw   = D3DXToRadian( -25.0f * m_Timer.GetTimeElapsed() );
-        RotationPitch = D3DXToRadian(  50.0f * m_Timer.GetTimeElapsed() );
-        RotationRoll  = D3DXToRadian( -75.0f * m_Timer.GetTimeElapsed() );
+        RotationYaw   = D3DXToRadian( -25.0f * fTimeStep );
+        RotationPitch = D3DXToRadian(  50.0f * fTimeStep );
+        RotationRoll  = D3DXToRadian( -75.0f * fTimeStep );
 
         // Build rotation matrices 
         D3DXMatrixIdentity( &mtxRotate );
@@ -699,4 +1693,116 @@ void CGameApp::AnimateObjects()
 
     } // End if rotation enabled
 
+    // Keep the world space bounds, and the hierarchy, in step with the matrices
+    for ( ULONG i = 0; i < 2; i++ )
+    {
+        m_pObject[ i ].UpdateBounds();
+        m_ObjectTree.SetBounds( i, m_pObject[ i ].m_vecBoundsCentre - m_pObject[ i ].m_vecBoundsExtents,
+                                   m_pObject[ i ].m_vecBoundsCentre + m_pObject[ i ].m_vecBoundsExtents );
+
+    } // Next Object
+
+}
+
+//-----------------------------------------------------------------------------
+// Name : CullObjects () (Private)
+// Desc : Refits the object hierarchy, and collects the objects whose world
+//        space bounds are at least partially inside the view frustum. Those
+//        hidden behind the largest objects on screen are then removed.
+//-----------------------------------------------------------------------------
+void CGameApp::CullObjects()
+{
+    D3DXMATRIX    mtxViewProj;
+    LARGE_INTEGER Start, End, Frequency;
+    PROFILE_ZONE( "CullObjects" );
+
+    // Extract the frustum for this frame
+    D3DXMatrixMultiply( &mtxViewProj, &m_mtxView, &m_mtxProjection );
+    m_Frustum.Extract( mtxViewProj );
+
+    // Apply this frame's movement, then query the hierarchy
+    QueryPerformanceCounter( &Start );
+    m_ObjectTree.Update();
+    m_CullStats.Visible = m_ObjectTree.QueryFrustum( m_Frustum, m_pVisibleObjects, m_nObjectCount );
+    QueryPerformanceCounter( &End );
+    QueryPerformanceFrequency( &Frequency );
+
+    // Record the results
+    m_CullStats.Tested    = m_nObjectCount;
+    m_CullStats.Culled    = m_nObjectCount - m_CullStats.Visible;
+    m_CullStats.fCullTime = (float)((double)(End.QuadPart - Start.QuadPart) * 1000.0 / (double)Frequency.QuadPart);
+
+    // Remove the objects hidden by others
+    if ( m_bOcclusion )
+    {
+        m_CullStats.Visible = m_Occlusion.Cull( m_pObject, m_pVisibleObjects, m_CullStats.Visible, m_mtxView, m_mtxProjection );
+
+        const OCCLUSION_STATS & Occlusion = m_Occlusion.GetStats();
+        m_OcclusionTotals.Tested            += Occlusion.Tested;
+        m_OcclusionTotals.Occluded          += Occlusion.Occluded;
+        m_OcclusionTotals.Occluders         += Occlusion.Occluders;
+        m_OcclusionTotals.OccluderTriangles += Occlusion.OccluderTriangles;
+        m_OcclusionTotals.fRasterTime       += Occlusion.fRasterTime;
+        m_OcclusionTotals.fBuildTime        += Occlusion.fBuildTime;
+        m_OcclusionTotals.fTestTime         += Occlusion.fTestTime;
+
+    } // End if occlusion
+}
+
+//-----------------------------------------------------------------------------
+// Name : RecordCommands () (Private)
+// Desc : Records a draw command for every visible object, spreading the
+//        objects over every thread in the pool, then sorts the commands.
+//-----------------------------------------------------------------------------
+void CGameApp::RecordCommands()
+{
+    ULONG ContextCount = m_ThreadPool.GetThreadCount();
+    PROFILE_ZONE( "RecordCommands" );
+
+    // Scale converting view space sizes at unit depth into pixels
+    m_fProjScale = m_nViewHeight * 0.5f * m_mtxProjection._22;
+
+    // Small frames are not worth waking the workers for, and the software
+    // rasterizer has the pool to itself once it runs on the render thread
+    if ( m_CullStats.Visible < ContextCount * 256 ) ContextCount = 1;
+    if ( m_hRenderThread && m_bSoftware ) ContextCount = 1;
+    if ( !m_RenderQueue.Begin( ContextCount, m_CullStats.Visible / ContextCount + 1 ) ) return;
+
+    if ( ContextCount > 1 ) m_ThreadPool.Dispatch( RecordTask, this, ContextCount );
+    else RecordTask( this, 0 );
+    m_RenderQueue.Sort();
+}
+
+//-----------------------------------------------------------------------------
+// Name : RecordTask () (Private, Static)
+// Desc : Selects the detail level of, and records a command for, one share of
+//        the visible objects into the context matching the task index.
+// Note : Opaque keys group by mesh, then order front to back. The mesh id is
+//        made from the mesh's id and the detail level drawn, so instances of
+//        the same level always share one, and the order is the same each run.
+//-----------------------------------------------------------------------------
+void CGameApp::RecordTask( void * pContext, ULONG Index )
+{
+    CGameApp  * pApp  = (CGameApp*)pContext;
+    ULONG       Count = pApp->m_RenderQueue.GetContextCount();
+    ULONG       First = (ULONG)((ULONGLONG)pApp->m_CullStats.Visible * Index / Count);
+    ULONG       Last  = (ULONG)((ULONGLONG)pApp->m_CullStats.Visible * (Index + 1) / Count);
+    D3DXVECTOR3 vecCentre;
+
+    for ( ULONG v = First; v < Last; v++ )
+    {
+        ULONG        i       = pApp->m_pVisibleObjects[v];
+        CObject    & Object  = pApp->m_pObject[i];
+        ULONG        Level   = 0;
+
+        // Select the detail level for the object's current screen size
+        if ( Object.m_pMesh->GetCompiled() ) Level = Object.SelectLOD( pApp->m_mtxView, pApp->m_fProjScale );
+
+        // Record it at the view space depth of its bounds
+        D3DXVec3TransformCoord( &vecCentre, &Object.m_vecBoundsCentre, &pApp->m_mtxView );
+        ULONG     Mesh = Object.m_pMesh->GetId() * MESH_MAX_LODS + Level;
+        ULONGLONG Key  = CRenderQueue::MakeKey( RENDERPASS_OPAQUE, 0, Mesh, vecCentre.z );
+        pApp->m_RenderQueue.Record( Index, Key, i, Object.m_nLOD );
+
+    } // Next Object
 }
@@ -15,6 +15,28 @@
 #include "Main.h"
 #include "CTimer.h"
 #include "CObject.h"
+#include "CMeshFile.h"
+#include "CThreadPool.h"
+#include "CFrustum.h"
+#include "COcclusionCuller.h"
+#include "CObjectBVH.h"
+#include "CInstanceBatcher.h"
+#include "CRenderBackend.h"
+#include "CD3DRenderBackend.h"
+#include "CSoftwareRenderBackend.h"
+#include "CStateCacheBackend.h"
+#include "CVertexTransform.h"
+#include "CRenderQueue.h"
+#include "CSnapshotBuffer.h"
+#include "CProfiler.h"
+#include "CTelemetry.h"
+#include "CFrameLog.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const float DEFAULT_TICK_RATE       = 60.0f;    // Simulation steps per second
+const ULONG DEFAULT_MAX_TICKS       = 5;        // Most simulation steps taken in one frame
 
 //-----------------------------------------------------------------------------
 // Main Class Declarations
@@ -45,48 +67,133 @@ private:
 	// Private Functions for This Class
 	//-------------------------------------------------------------------------
     bool        BuildObjects      ( );
+    bool        BuildCubeMesh     ( );
     void        FrameAdvance      ( );
+    void        SimulateFrame     ( SCENE_SNAPSHOT * pSnapshot );
+    void        RecordTelemetry   ( );
+    void        RenderFrame       ( const SCENE_SNAPSHOT & Snapshot );
+    bool        StartRenderThread ( );
+    void        StopRenderThread  ( );
+    void        WaitForWrite      ( );
+    void        ResetBackend      ( ULONG Width, ULONG Height );
+    void        RequestReset      ( ULONG Width, ULONG Height );
+    void        ServiceReset      ( );
     bool        CreateDisplay     ( );
     void        SetupGameState    ( );
     void        SetupRenderStates ( );
-    void        AnimateObjects    ( );
-    void        ProcessInput      ( );
-    bool        InitDirect3D      ( );
-    D3DFORMAT   FindDepthStencilFormat( ULONG AdapterOrdinal, D3DDISPLAYMODE Mode, D3DDEVTYPE DevType );
+    void        SetupProjection   ( );
+    void        ReadFrameInput    ( );
+    float       GetFrameLock      ( ) const;
+    ULONG       GetSceneChecksum  ( ) const;
+    void        StepSimulation    ( );
+    void        SimulateStep      ( float fTimeStep );
+    void        AnimateObjects    ( float fTimeStep );
+    void        CullObjects       ( );
+    void        RecordCommands    ( );
+    void        ProcessInput      ( float fTimeStep );
+    int         RunHeadless       ( );
+    void        ParseCommandLine  ( LPCTSTR lpCmdLine );
     
     //-------------------------------------------------------------------------
 	// Private Static Functions For This Class
 	//-------------------------------------------------------------------------
     static LRESULT CALLBACK StaticWndProc(HWND hWnd, UINT Message, WPARAM wParam, LPARAM lParam);
+    static bool GetSwitch         ( LPCTSTR lpCmdLine, LPCTSTR strSwitch, LPTSTR strValue, ULONG MaxLength );
+    static void RecordTask        ( void * pContext, ULONG Index );
+    static unsigned __stdcall RenderThread( void * pParam );
 
     //-------------------------------------------------------------------------
 	// Private Variables For This Class
 	//-------------------------------------------------------------------------
     D3DXMATRIX              m_mtxView;          // View Matrix
+    D3DXMATRIX              m_mtxPrevView;      // View matrix before the latest simulation step
     D3DXMATRIX              m_mtxProjection;    // Projection matrix
 
+    CThreadPool             m_ThreadPool;       // Worker threads used for importing
+    CMeshFile               m_MeshFile;         // Mapped mesh file (if loading from file)
     CMesh                   m_Mesh;             // Mesh to be rendered
-    CObject                 m_pObject[2];       // Objects storing mesh instances
+    CObject                *m_pObject;          // Objects storing mesh instances
+    ULONG                   m_nObjectCount;     // Number of objects (/objects:<count>)
+    CObjectBVH              m_ObjectTree;       // Hierarchy over the object bounds
+    ULONG                  *m_pVisibleObjects;  // Objects which survived the most recent cull
+    CFrustum                m_Frustum;          // View frustum for the current frame
+    CULL_STATS              m_CullStats;        // Culling results for the current frame
+    COcclusionCuller        m_Occlusion;        // Removes objects hidden behind others (disable with /noocclusion)
+    OCCLUSION_STATS         m_OcclusionTotals;  // Occlusion results summed since the last reset
+    CRenderQueue            m_RenderQueue;      // Sorted draw commands for the current frame
+    float                   m_fProjScale;       // Pixels per view space unit at unit depth
+    CInstanceBatcher        m_Batcher;          // Groups visible objects by mesh
+    ULONG                   m_nDrawCalls;       // Draw calls issued for the previous frame
+    CSnapshotBuffer         m_Snapshots;        // Simulated frames waiting to be, or being, drawn
+    HANDLE                  m_hRenderThread;    // Draws the snapshots when pipelined (/threaded)
+    HANDLE                  m_hResetRequest;    // Set while the render thread waits for a device reset
+    HANDLE                  m_hResetDone;       // Releases the render thread once the device is reset
+    ULONG                   m_nResetWidth;      // Back buffer size the render thread asked to reset to
+    ULONG                   m_nResetHeight;
+
+    IRenderBackend         *m_pBackend;         // Backend all rendering is submitted to
+    CD3DRenderBackend       m_D3DBackend;       // Direct3D 9 device
+    CNullRenderBackend      m_NullBackend;      // Counts submitted work only (/headless)
+    CSoftwareRenderBackend  m_SoftwareBackend;  // Rasterizes on the CPU (/software)
+    CStateCacheBackend      m_StateCache;       // Filters redundant state changes (disable with /nostatecache)
+    ULONG                   m_nHeadlessFrames;  // Frames rendered by a headless run (/frames:<count>)
+    ULONG                   m_nTransformBench;  // Vertices to benchmark the transform with (/transformbench:<count>)
     
+    CVertex                *m_pDecodeBuffer;    // Scratch vertices for decoding compact meshes
+    ULONG                   m_nDecodeCapacity;  // Number of vertices m_pDecodeBuffer can hold
+
     CTimer                  m_Timer;            // Game timer
+    float                   m_fLockFPS;         // Frame rate to lock to, or 0 for none (/lockfps:<fps>)
+    float                   m_fTickRate;        // Simulation steps per second, or 0 for one per frame (/tickrate:<hz>)
+    ULONG                   m_nMaxTicks;        // Most steps simulated in one frame (/maxticks:<count>)
+    double                  m_fSimAccumulator;  // Frame time not yet simulated (seconds)
+    float                   m_fSimAlpha;        // How far past the latest step frames are drawn (fraction of a step)
+    ULONG                   m_nSimSteps;        // Steps simulated since the last reset
+    ULONG                   m_nSimDropped;      // Steps skipped because a frame owed more than m_nMaxTicks
+
+    FRAME_INPUT             m_FrameInput;       // Time step & input the current frame is simulated with
+    CFrameLog               m_FrameLog;         // Frame inputs being recorded (/record:<file>)
+    CFrameLog               m_ReplayLog;        // Frame inputs being replayed (/replay:<file>)
+    ULONG                   m_nReplayFrame;     // Next frame of m_ReplayLog to simulate
+    bool                    m_bReplayPaced;     // Replay at the recorded frame times, rather than flat out (/replaypace:recorded)
+    ULONG                   m_nSeed;            // Random number seed the objects are built with (/seed:<n>)
+    bool                    m_bFixedSeed;       // Was the seed specified, rather than taken from the clock ?
+
+    CTelemetry              m_Telemetry;        // Shared memory ring each frame is recorded to (/telemetry[:<name>])
+    LONG                    m_nLastAllocations; // Allocation count when the previous frame was recorded
     
     HWND                    m_hWnd;             // Main window HWND
-    
-    bool                    m_bLostDevice;      // Is the 3d device currently lost ?
+
+    TCHAR                   m_strMeshFile[MAX_PATH];     // Mesh file to load (/mesh:<file>)
+    TCHAR                   m_strSaveMeshFile[MAX_PATH]; // Mesh file to write (/savemesh:<file>)
+    TCHAR                   m_strImportFile[MAX_PATH];   // OBJ / PLY file to import (/import:<file>)
+    TCHAR                   m_strBenchFile[MAX_PATH];    // OBJ / PLY file to benchmark (/importbench:<file>)
+    TCHAR                   m_strBenchReport[MAX_PATH];  // Benchmark report file (/benchreport:<file>)
+    TCHAR                   m_strFrameReport[MAX_PATH];  // Headless frame report file (/framereport:<file>)
+    TCHAR                   m_strFrameImage[MAX_PATH];   // Final software frame image (/frameimage:<file>)
+    TCHAR                   m_strProfileFile[MAX_PATH];  // Chrome trace of the CPU profile (/profile:<file>)
+    TCHAR                   m_strTelemetryName[MAX_PATH];// Shared memory the frame telemetry is published to
+    TCHAR                   m_strRecordFile[MAX_PATH];   // Frame log to record to (/record:<file>)
+    TCHAR                   m_strReplayFile[MAX_PATH];   // Frame log to replay, headless (/replay:<file>)
+    TCHAR                   m_strTransformReport[MAX_PATH]; // Transform benchmark report (/transformreport:<file>)
+
+    bool                    m_bHeadless;        // Render to the null backend without a window (/headless)
+    bool                    m_bSoftware;        // Headless, but rasterize each frame on the CPU (/software)
     bool                    m_bActive;          // Is the application active ?
     bool                    m_bRotation1;       // Object 1 rotation enabled / disabled 
     bool                    m_bRotation2;       // Object 2 rotation enabled / disabled 
+    bool                    m_bInstancing;      // Compiled meshes are drawn instanced (disable with /noinstancing)
+    bool                    m_bStateCache;      // Is m_StateCache placed in front of the backend ?
+    bool                    m_bOcclusion;       // Are objects tested against m_Occlusion ?
+    bool                    m_bOcclusionTemporal; // Reuse the previous frame's occluders (/occlusiontemporal)
+    bool                    m_bThreaded;        // Simulate & render on separate threads (/threaded)
 
     ULONG                   m_nViewX;           // X Position of render viewport
     ULONG                   m_nViewY;           // Y Position of render viewport
     ULONG                   m_nViewWidth;       // Width of render viewport
     ULONG                   m_nViewHeight;      // Height of render viewport
-
-
-    LPDIRECT3D9             m_pD3D;             // Direct3D Object
-    LPDIRECT3DDEVICE9       m_pD3DDevice;       // Direct3D Device Object
-    D3DPRESENT_PARAMETERS   m_D3DPresentParams; // Direct3D Present Parameters
-
+    ULONG                   m_nBackBufferWidth; // Size the backend was last resized to (render side)
+    ULONG                   m_nBackBufferHeight;
 
 };
 
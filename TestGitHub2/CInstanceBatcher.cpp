@@ -0,0 +1,208 @@
+//-----------------------------------------------------------------------------
+// File: CInstanceBatcher.cpp
+//
+// Desc: Groups object instances by the compiled mesh they draw, packing their
+//       world matrices so that each group can be submitted with a single
+//       instanced draw.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CInstanceBatcher Specific Includes
+//-----------------------------------------------------------------------------
+#include "CInstanceBatcher.h"
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------
+// Name : CInstanceBatcher () (Constructor)
+// Desc : CInstanceBatcher Class Constructor
+//-----------------------------------------------------------------------------
+CInstanceBatcher::CInstanceBatcher()
+{
+	// Reset / Clear all required values
+    m_pEntries          = NULL;
+    m_nEntryCount       = 0;
+    m_nEntryCapacity    = 0;
+    m_pGroups           = NULL;
+    m_nGroupCount       = 0;
+    m_nGroupCapacity    = 0;
+    m_pInstances        = NULL;
+    m_nInstanceCapacity = 0;
+    m_nLastGroup        = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CInstanceBatcher () (Destructor)
+// Desc : CInstanceBatcher Class Destructor
+//-----------------------------------------------------------------------------
+CInstanceBatcher::~CInstanceBatcher()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Begin ()
+// Desc : Discards the instances of the previous frame. Storage is retained.
+//-----------------------------------------------------------------------------
+void CInstanceBatcher::Begin( )
+{
+    m_nEntryCount = 0;
+    m_nGroupCount = 0;
+    m_nLastGroup  = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Add ()
+// Desc : Queues a single instance of the specified mesh.
+//-----------------------------------------------------------------------------
+bool CInstanceBatcher::Add( const CCompiledMesh * pMesh, const D3DXMATRIX * pWorld )
+{
+    ULONG Group;
+
+    // Validate
+    if ( !pMesh || !pWorld ) return false;
+
+    // Find this mesh's group, trying the previous one first
+    if ( m_nLastGroup < m_nGroupCount && m_pGroups[ m_nLastGroup ].pMesh == pMesh )
+    {
+        Group = m_nLastGroup;
+
+    } // End if same as last
+    else
+    {
+        for ( Group = 0; Group < m_nGroupCount; Group++ ) if ( m_pGroups[ Group ].pMesh == pMesh ) break;
+        if ( Group == m_nGroupCount )
+        {
+            // Start a new group
+            if ( !Reserve( (void**)&m_pGroups, &m_nGroupCapacity, m_nGroupCount + 1, sizeof(GROUP) ) ) return false;
+            m_pGroups[ Group ].pMesh = pMesh;
+            m_pGroups[ Group ].Count = 0;
+            m_pGroups[ Group ].First = 0;
+            m_nGroupCount++;
+
+        } // End if new mesh
+
+        m_nLastGroup = Group;
+
+    } // End if search
+
+    // Store the instance
+    if ( !Reserve( (void**)&m_pEntries, &m_nEntryCapacity, m_nEntryCount + 1, sizeof(ENTRY) ) ) return false;
+    m_pEntries[ m_nEntryCount ].pWorld = pWorld;
+    m_pEntries[ m_nEntryCount ].Group  = Group;
+    m_nEntryCount++;
+    m_pGroups[ Group ].Count++;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Flush ()
+// Desc : Packs the queued instances by group, and passes each group to the
+//        renderer. Returns the number of groups successfully submitted.
+// Note : The queue is left intact, so the same frame may be flushed to more
+//        than one renderer.
+//-----------------------------------------------------------------------------
+ULONG CInstanceBatcher::Flush( IInstanceRenderer * pRenderer )
+{
+    ULONG i, Submitted = 0, First = 0;
+
+    // Validate
+    if ( !pRenderer || m_nEntryCount == 0 ) return 0;
+    if ( !Reserve( (void**)&m_pInstances, &m_nInstanceCapacity, m_nEntryCount, sizeof(INSTANCE_DATA) ) ) return 0;
+
+    // Find where each group starts within the packed array
+    for ( i = 0; i < m_nGroupCount; i++ )
+    {
+        m_pGroups[i].First = First;
+        First += m_pGroups[i].Count;
+
+    } // Next Group
+
+    // Scatter the matrix columns into place (First becomes each group's end)
+    for ( i = 0; i < m_nEntryCount; i++ )
+    {
+        const D3DXMATRIX & mtxWorld = *m_pEntries[i].pWorld;
+        INSTANCE_DATA    & Instance = m_pInstances[ m_pGroups[ m_pEntries[i].Group ].First++ ];
+
+        for ( ULONG c = 0; c < 3; c++ )
+        {
+            Instance.Column[c][0] = mtxWorld.m[0][c];
+            Instance.Column[c][1] = mtxWorld.m[1][c];
+            Instance.Column[c][2] = mtxWorld.m[2][c];
+            Instance.Column[c][3] = mtxWorld.m[3][c];
+
+        } // Next Column
+
+    } // Next Entry
+
+    // Submit each group
+    for ( i = 0; i < m_nGroupCount; i++ )
+    {
+        const GROUP & Group = m_pGroups[i];
+        if ( pRenderer->DrawInstances( Group.pMesh, &m_pInstances[ Group.First - Group.Count ], Group.Count ) ) Submitted++;
+
+    } // Next Group
+
+    return Submitted;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Frees all storage.
+//-----------------------------------------------------------------------------
+void CInstanceBatcher::Release( )
+{
+    if ( m_pEntries   ) free( m_pEntries );
+    if ( m_pGroups    ) free( m_pGroups );
+    if ( m_pInstances ) free( m_pInstances );
+
+    m_pEntries          = NULL;
+    m_nEntryCount       = 0;
+    m_nEntryCapacity    = 0;
+    m_pGroups           = NULL;
+    m_nGroupCount       = 0;
+    m_nGroupCapacity    = 0;
+    m_pInstances        = NULL;
+    m_nInstanceCapacity = 0;
+    m_nLastGroup        = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Reserve () (Private)
+// Desc : Grows one of our arrays so that it can hold at least Count entries.
+//-----------------------------------------------------------------------------
+bool CInstanceBatcher::Reserve( void ** ppData, ULONG * pCapacity, ULONG Count, ULONG Stride )
+{
+    ULONG  NewCapacity;
+    void * pNewData;
+
+    // Already large enough?
+    if ( Count <= *pCapacity ) return true;
+
+    // Grow by half again, to keep reallocation rare
+    NewCapacity = (*pCapacity < 64) ? 64 : *pCapacity + *pCapacity / 2;
+    if ( NewCapacity < Count ) NewCapacity = Count;
+    if (!( pNewData = realloc( *ppData, NewCapacity * Stride ) )) return false;
+
+    *ppData    = pNewData;
+    *pCapacity = NewCapacity;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawInstances ()
+// Desc : Records a single draw call covering every instance.
+//-----------------------------------------------------------------------------
+bool CInstanceDrawCounter::DrawInstances( const CCompiledMesh * pMesh, const INSTANCE_DATA * pInstances, ULONG Count )
+{
+    // Validate
+    if ( !pMesh || !pInstances || Count == 0 ) return false;
+
+    m_nDrawCount++;
+    m_nInstanceCount += Count;
+    m_nTriangleCount += pMesh->GetTriangleCount() * Count;
+    return true;
+}
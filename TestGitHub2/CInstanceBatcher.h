@@ -0,0 +1,141 @@
+//-----------------------------------------------------------------------------
+// File: CInstanceBatcher.h
+//
+// Desc: Groups object instances by the compiled mesh they draw, packing their
+//       world matrices so that each group can be submitted with a single
+//       instanced draw.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CINSTANCEBATCHER_H_
+#define _CINSTANCEBATCHER_H_
+
+//-----------------------------------------------------------------------------
+// CInstanceBatcher Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CCompiledMesh.h"
+
+//-----------------------------------------------------------------------------
+// Name : INSTANCE_DATA (Struct)
+// Desc : Per instance vertex stream entry. Holds the first three columns of
+//        the world matrix, so that each world space component is the dot
+//        product of (x, y, z, 1) with one column.
+//-----------------------------------------------------------------------------
+struct INSTANCE_DATA
+{
+    float           Column[3][4];           // World matrix columns 1 - 3
+};
+
+//-----------------------------------------------------------------------------
+// Name : IInstanceRenderer (Interface)
+// Desc : Receives each group of instances produced by CInstanceBatcher.
+//-----------------------------------------------------------------------------
+class IInstanceRenderer
+{
+public:
+    virtual        ~IInstanceRenderer() {}
+    virtual bool    DrawInstances   ( const CCompiledMesh * pMesh, const INSTANCE_DATA * pInstances, ULONG Count ) = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CInstanceBatcher (Class)
+// Desc : Collects (mesh, world matrix) pairs for a frame, and on Flush hands
+//        each distinct mesh to a renderer once along with every instance of
+//        it, in the order the meshes were first added.
+// Note : Matrices are referenced rather than copied until Flush, so they
+//        must remain valid until then.
+//-----------------------------------------------------------------------------
+class CInstanceBatcher
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CInstanceBatcher();
+	virtual ~CInstanceBatcher();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    void            Begin           ( );
+    bool            Add             ( const CCompiledMesh * pMesh, const D3DXMATRIX * pWorld );
+    ULONG           Flush           ( IInstanceRenderer * pRenderer );
+    void            Release         ( );
+
+    ULONG           GetInstanceCount( ) const { return m_nEntryCount; }
+    ULONG           GetGroupCount   ( ) const { return m_nGroupCount; }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Structures for This Class
+	//-------------------------------------------------------------------------
+    struct ENTRY
+    {
+        const D3DXMATRIX  * pWorld;         // Instance world matrix
+        ULONG               Group;          // Index of the mesh group
+    };
+
+    struct GROUP
+    {
+        const CCompiledMesh * pMesh;        // Mesh drawn by every instance
+        ULONG               Count;          // Number of instances
+        ULONG               First;          // First packed instance (during Flush)
+    };
+
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Reserve         ( void ** ppData, ULONG * pCapacity, ULONG Count, ULONG Stride );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    ENTRY          *m_pEntries;         // Instances added this frame
+    ULONG           m_nEntryCount;
+    ULONG           m_nEntryCapacity;
+    GROUP          *m_pGroups;          // Distinct meshes added this frame
+    ULONG           m_nGroupCount;
+    ULONG           m_nGroupCapacity;
+    INSTANCE_DATA  *m_pInstances;       // Instance data packed in group order
+    ULONG           m_nInstanceCapacity;
+    ULONG           m_nLastGroup;       // Group of the previous Add (usually repeats)
+};
+
+//-----------------------------------------------------------------------------
+// Name : CInstanceDrawCounter (Class)
+// Desc : Renderer that draws nothing, but counts what it would have drawn.
+//        Allows the batching path to be exercised without a device.
+//-----------------------------------------------------------------------------
+class CInstanceDrawCounter : public IInstanceRenderer
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CInstanceDrawCounter() { Reset(); }
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    virtual bool    DrawInstances   ( const CCompiledMesh * pMesh, const INSTANCE_DATA * pInstances, ULONG Count );
+    void            Reset           ( ) { m_nDrawCount = 0; m_nInstanceCount = 0; m_nTriangleCount = 0; }
+
+    ULONG           GetDrawCount    ( ) const { return m_nDrawCount; }
+    ULONG           GetInstanceCount( ) const { return m_nInstanceCount; }
+    ULONG           GetTriangleCount( ) const { return m_nTriangleCount; }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    ULONG           m_nDrawCount;       // Draw calls submitted
+    ULONG           m_nInstanceCount;   // Instances drawn by those calls
+    ULONG           m_nTriangleCount;   // Triangles drawn by those calls
+};
+
+#endif // _CINSTANCEBATCHER_H_
@@ -0,0 +1,203 @@
+//-----------------------------------------------------------------------------
+// File: CMemoryArena.cpp
+//
+// Desc: Simple chunked linear allocator. Memory is handed out sequentially
+//       from large chunks and is only ever released all at once, which makes
+//       it ideal for data with a shared lifetime such as mesh components.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CMemoryArena Specific Includes
+//-----------------------------------------------------------------------------
+#include "CMemoryArena.h"
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------
+// Name : CMemoryArena () (Constructor)
+// Desc : CMemoryArena Class Constructor
+//-----------------------------------------------------------------------------
+CMemoryArena::CMemoryArena( ULONG ChunkSize )
+{
+	// Reset / Clear all required values
+    m_pChunk            = NULL;
+    m_pLastBlock        = NULL;
+    m_nChunkSize        = ChunkSize;
+    m_nChunkCount       = 0;
+    m_nBytesReserved    = 0;
+    m_nBytesUsed        = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CMemoryArena () (Destructor)
+// Desc : CMemoryArena Class Destructor
+//-----------------------------------------------------------------------------
+CMemoryArena::~CMemoryArena()
+{
+    // Free all chunks
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetChunkSize ()
+// Desc : Sets the size of the next chunk to be allocated. Chunks continue to
+//        double in size from this point up to ARENA_MAX_CHUNK_SIZE.
+//-----------------------------------------------------------------------------
+void CMemoryArena::SetChunkSize( ULONG ChunkSize )
+{
+    m_nChunkSize = ChunkSize;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Alloc ()
+// Desc : Allocates a block of memory from the arena.
+// Note : Returns NULL on failure. Memory is uninitialised.
+//-----------------------------------------------------------------------------
+void * CMemoryArena::Alloc( ULONG Size, ULONG Alignment )
+{
+    ARENA_CHUNK * pChunk = NULL;
+    ULONG_PTR     Address, Padding;
+
+    // Zero sized requests still return a unique block
+    if ( Size == 0 ) Size = 1;
+
+    // Attempt to fit the block in the current chunk
+    if ( m_pChunk )
+    {
+        Address = (ULONG_PTR)((UCHAR*)(m_pChunk + 1) + m_pChunk->Used);
+        Padding = ((Address + Alignment - 1) & ~(ULONG_PTR)(Alignment - 1)) - Address;
+        if ( m_pChunk->Used + Padding + Size <= m_pChunk->Size )
+        {
+            m_pChunk->Used += (ULONG)(Padding + Size);
+            m_nBytesUsed   += Size;
+            m_pLastBlock    = (UCHAR*)(Address + Padding);
+            return m_pLastBlock;
+
+        } // End if fits
+
+    } // End if has chunk
+
+    // Large blocks get a dedicated chunk so that the current one isn't wasted
+    if ( m_pChunk && Size + Alignment > m_nChunkSize / 2 )
+    {
+        if (!( pChunk = NewChunk( Size + Alignment ) )) return NULL;
+
+        // Link it in behind the current chunk
+        pChunk->pNext   = m_pChunk->pNext;
+        m_pChunk->pNext = pChunk;
+
+    } // End if dedicated
+    else
+    {
+        if (!( pChunk = NewChunk( Size + Alignment ) )) return NULL;
+
+        // Becomes the current chunk
+        pChunk->pNext = m_pChunk;
+        m_pChunk      = pChunk;
+        m_pLastBlock  = NULL;
+
+    } // End if new current chunk
+
+    // Carve the block from the start of the chunk
+    Address = (ULONG_PTR)(pChunk + 1);
+    Padding = ((Address + Alignment - 1) & ~(ULONG_PTR)(Alignment - 1)) - Address;
+    pChunk->Used  = (ULONG)(Padding + Size);
+    m_nBytesUsed += Size;
+
+    // Only blocks in the current chunk may later be grown in place
+    if ( pChunk == m_pChunk ) m_pLastBlock = (UCHAR*)(Address + Padding);
+    return (UCHAR*)(Address + Padding);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Grow ()
+// Desc : Resizes a block previously returned by Alloc. If the block was the
+//        most recent allocation in the current chunk it is extended in place,
+//        otherwise a new block is allocated and the old contents copied.
+// Note : The abandoned block is not reclaimed until the arena is released,
+//        but no longer counts as used.
+//-----------------------------------------------------------------------------
+void * CMemoryArena::Grow( void * pBlock, ULONG OldSize, ULONG NewSize, ULONG Alignment )
+{
+    void * pNewBlock = NULL;
+
+    // No existing block, or shrinking?
+    if ( !pBlock ) return Alloc( NewSize, Alignment );
+    if ( NewSize <= OldSize ) return pBlock;
+
+    // Can we grow in place?
+    if ( m_pChunk && (UCHAR*)pBlock == m_pLastBlock )
+    {
+        ULONG Offset = (ULONG)((UCHAR*)pBlock - (UCHAR*)(m_pChunk + 1));
+        if ( Offset + NewSize <= m_pChunk->Size )
+        {
+            m_pChunk->Used = Offset + NewSize;
+            m_nBytesUsed  += NewSize - OldSize;
+            return pBlock;
+
+        } // End if fits
+
+    } // End if top of chunk
+
+    // Allocate a new block and copy the old data over
+    if (!( pNewBlock = Alloc( NewSize, Alignment ) )) return NULL;
+    memcpy( pNewBlock, pBlock, OldSize );
+    m_nBytesUsed -= OldSize;
+
+    // Success!
+    return pNewBlock;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Frees every chunk owned by the arena, invalidating all allocations.
+//-----------------------------------------------------------------------------
+void CMemoryArena::Release( )
+{
+    // Walk the chunk list
+    while ( m_pChunk )
+    {
+        ARENA_CHUNK * pNext = m_pChunk->pNext;
+        free( m_pChunk );
+        m_pChunk = pNext;
+
+    } // Next Chunk
+
+    // Clear variables
+    m_pLastBlock        = NULL;
+    m_nChunkCount       = 0;
+    m_nBytesReserved    = 0;
+    m_nBytesUsed        = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : NewChunk () (Private)
+// Desc : Allocates a new chunk from the heap large enough for MinSize bytes.
+//-----------------------------------------------------------------------------
+CMemoryArena::ARENA_CHUNK * CMemoryArena::NewChunk( ULONG MinSize )
+{
+    ARENA_CHUNK * pChunk = NULL;
+    ULONG         Size   = ( MinSize > m_nChunkSize ) ? MinSize : m_nChunkSize;
+
+    // Allocate chunk and header together
+    if (!( pChunk = (ARENA_CHUNK*)malloc( sizeof(ARENA_CHUNK) + Size ) )) return NULL;
+    pChunk->pNext = NULL;
+    pChunk->Size  = Size;
+    pChunk->Used  = 0;
+
+    // Subsequent chunks double in size so large data needs only a few chunks
+    if ( Size == m_nChunkSize && m_nChunkSize < ARENA_MAX_CHUNK_SIZE )
+    {
+        m_nChunkSize *= 2;
+        if ( m_nChunkSize > ARENA_MAX_CHUNK_SIZE ) m_nChunkSize = ARENA_MAX_CHUNK_SIZE;
+    
+    } // End if grow
+
+    // Update statistics
+    m_nChunkCount++;
+    m_nBytesReserved += (ULONG)sizeof(ARENA_CHUNK) + Size;
+
+    // Success!
+    return pChunk;
+}
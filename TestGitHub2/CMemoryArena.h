@@ -0,0 +1,86 @@
+//-----------------------------------------------------------------------------
+// File: CMemoryArena.h
+//
+// Desc: Simple chunked linear allocator. Memory is handed out sequentially
+//       from large chunks and is only ever released all at once, which makes
+//       it ideal for data with a shared lifetime such as mesh components.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CMEMORYARENA_H_
+#define _CMEMORYARENA_H_
+
+//-----------------------------------------------------------------------------
+// CMemoryArena Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG ARENA_DEFAULT_CHUNK_SIZE = 4096;    // Size of the first arena chunk
+const ULONG ARENA_MAX_CHUNK_SIZE     = 1048576; // Chunks double in size up to this
+const ULONG ARENA_DEFAULT_ALIGNMENT  = 8;       // Default allocation alignment
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CMemoryArena (Class)
+// Desc : Chunked linear allocator. Individual allocations are never freed,
+//        instead the entire arena is released in one go.
+//-----------------------------------------------------------------------------
+class CMemoryArena
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+             CMemoryArena( ULONG ChunkSize = ARENA_DEFAULT_CHUNK_SIZE );
+	virtual ~CMemoryArena();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    void      * Alloc           ( ULONG Size, ULONG Alignment = ARENA_DEFAULT_ALIGNMENT );
+    void      * Grow            ( void * pBlock, ULONG OldSize, ULONG NewSize, ULONG Alignment = ARENA_DEFAULT_ALIGNMENT );
+    void        Release         ( );
+    void        SetChunkSize    ( ULONG ChunkSize );
+
+    ULONG       GetBytesReserved( ) const { return m_nBytesReserved; }
+    ULONG       GetBytesUsed    ( ) const { return m_nBytesUsed; }
+    ULONG       GetChunkCount   ( ) const { return m_nChunkCount; }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Structures for This Class
+	//-------------------------------------------------------------------------
+    struct ARENA_CHUNK
+    {
+        ARENA_CHUNK   * pNext;          // Previously filled chunk
+        ULONG           Size;           // Usable bytes following this header
+        ULONG           Used;           // Bytes consumed so far
+    };
+
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    ARENA_CHUNK   * NewChunk        ( ULONG MinSize );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    ARENA_CHUNK   * m_pChunk;           // Chunk currently being filled
+    UCHAR         * m_pLastBlock;       // Most recent allocation (for in place growth)
+    ULONG           m_nChunkSize;       // Size of newly allocated chunks
+    ULONG           m_nChunkCount;      // Number of chunks allocated
+    ULONG           m_nBytesReserved;   // Total bytes requested from the heap
+    ULONG           m_nBytesUsed;       // Total bytes handed out to callers
+
+    // Arenas own raw memory, copying is not supported.
+    CMemoryArena( const CMemoryArena & );
+    CMemoryArena & operator=( const CMemoryArena & );
+};
+
+#endif // _CMEMORYARENA_H_
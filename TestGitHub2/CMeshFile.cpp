@@ -0,0 +1,376 @@
+//-----------------------------------------------------------------------------
+// File: CMeshFile.cpp
+//
+// Desc: Versioned binary mesh file format. Files are memory mapped and used
+//       in place, so meshes are attached to the mapped data without any
+//       parsing or per-vertex copies.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CMeshFile Specific Includes
+//-----------------------------------------------------------------------------
+#include "CMeshFile.h"
+#include "CCompiledMesh.h"
+
+//-----------------------------------------------------------------------------
+// Local Structures & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : AlignUp ()
+    // Desc : Rounds the file offset specified up to the block alignment.
+    //-------------------------------------------------------------------------
+    ULONGLONG AlignUp( ULONGLONG Offset )
+    {
+        return (Offset + MESHFILE_ALIGNMENT - 1) & ~(ULONGLONG)(MESHFILE_ALIGNMENT - 1);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CheckBlock ()
+    // Desc : Determines whether a block of Count elements of the size given,
+    //        found at the offset specified, lies entirely within the file.
+    //-------------------------------------------------------------------------
+    bool CheckBlock( ULONG Offset, ULONG Count, ULONG Stride, ULONG FileSize )
+    {
+        if ( Offset % MESHFILE_ALIGNMENT != 0 || Offset < sizeof(MESH_FILE_HEADER) ) return false;
+        return (ULONGLONG)Offset + (ULONGLONG)Count * Stride <= FileSize;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : HeaderChecksum ()
+    // Desc : Calculates the checksum of the header specified.
+    //-------------------------------------------------------------------------
+    ULONG HeaderChecksum( const MESH_FILE_HEADER * pHeader )
+    {
+        MESH_FILE_HEADER Header = *pHeader;
+        Header.HeaderChecksum = 0;
+        ULONGLONG Sum = CMeshFile::Checksum( &Header, sizeof(MESH_FILE_HEADER) );
+        return (ULONG)(Sum ^ (Sum >> 32));
+    }
+
+}; // End Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CMeshFile () (Constructor)
+// Desc : CMeshFile Class Constructor
+//-----------------------------------------------------------------------------
+CMeshFile::CMeshFile()
+{
+	// Reset / Clear all required values
+    m_hFile     = INVALID_HANDLE_VALUE;
+    m_hMapping  = NULL;
+    m_pView     = NULL;
+    m_nSize     = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CMeshFile () (Destructor)
+// Desc : CMeshFile Class Destructor
+//-----------------------------------------------------------------------------
+CMeshFile::~CMeshFile()
+{
+    Close();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Open ()
+// Desc : Maps the specified mesh file into memory and validates it. The
+//        header and block extents are always checked, further checks are
+//        controlled by the MESHFILE_VERIFY flags.
+//-----------------------------------------------------------------------------
+bool CMeshFile::Open( LPCTSTR strFileName, ULONG VerifyFlags )
+{
+    LARGE_INTEGER FileSize;
+
+    // Close any file already open
+    Close();
+
+    // Open the file and retrieve its size
+    m_hFile = CreateFile( strFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if ( m_hFile == INVALID_HANDLE_VALUE ) return false;
+    if ( !GetFileSizeEx( m_hFile, &FileSize ) ) { Close(); return false; }
+
+    // Files are limited to 4GB, and must at least hold a header
+    if ( FileSize.QuadPart < (LONGLONG)sizeof(MESH_FILE_HEADER) || FileSize.QuadPart > 0xFFFFFFFF ) { Close(); return false; }
+    m_nSize = (ULONG)FileSize.QuadPart;
+
+    // Map the entire file copy-on-write
+    if (!( m_hMapping = CreateFileMapping( m_hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL ) )) { Close(); return false; }
+    if (!( m_pView = (UCHAR*)MapViewOfFile( m_hMapping, FILE_MAP_COPY, 0, 0, 0 ) )) { Close(); return false; }
+
+    // Validate the contents
+    if ( !Validate( m_pView, m_nSize, VerifyFlags ) ) { Close(); return false; }
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Close ()
+// Desc : Unmaps and closes the mesh file.
+//-----------------------------------------------------------------------------
+void CMeshFile::Close( )
+{
+    if ( m_pView    ) UnmapViewOfFile( m_pView );
+    if ( m_hMapping ) CloseHandle( m_hMapping );
+    if ( m_hFile != INVALID_HANDLE_VALUE ) CloseHandle( m_hFile );
+
+    // Clear variables
+    m_hFile     = INVALID_HANDLE_VALUE;
+    m_hMapping  = NULL;
+    m_pView     = NULL;
+    m_nSize     = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Attach ()
+// Desc : Attaches the mesh specified directly to the mapped data, including
+//        its compiled form if the file has one.
+//-----------------------------------------------------------------------------
+bool CMeshFile::Attach( CMesh * pMesh ) const
+{
+    const MESH_FILE_HEADER * pHeader = GetHeader();
+
+    // Validate
+    if ( !pHeader || !pMesh ) return false;
+
+    // Attach the pool and polygon table
+    if ( !pMesh->Attach( (CVertex*)(m_pView + pHeader->VertexOffset), pHeader->VertexCount,
+                         (POLYGON_RANGE*)(m_pView + pHeader->PolygonOffset), pHeader->PolygonCount ) ) return false;
+
+    // Attach the compiled triangle list
+    if ( pHeader->Flags & MESHFILE_HAS_COMPILED )
+    {
+        D3DFORMAT Format = (pHeader->Flags & MESHFILE_INDEX32) ? D3DFMT_INDEX32 : D3DFMT_INDEX16;
+        if ( !pMesh->AttachCompiled( (CVertex*)(m_pView + pHeader->CompiledVertexOffset), pHeader->CompiledVertexCount,
+                                     m_pView + pHeader->IndexOffset, pHeader->IndexCount, Format ) ) return false;
+
+    } // End if compiled
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Write () (Static)
+// Desc : Writes the mesh specified, plus its compiled form if it has one, to
+//        a new mesh file.
+// Note : The file is built in place through a writable mapping, so no
+//        intermediate copy of the mesh is made.
+//-----------------------------------------------------------------------------
+bool CMeshFile::Write( LPCTSTR strFileName, const CMesh * pMesh )
+{
+    const CCompiledMesh * pCompiled = NULL;
+    MESH_FILE_HEADER      Header;
+    HANDLE                hFile    = INVALID_HANDLE_VALUE, hMapping = NULL;
+    UCHAR               * pView    = NULL;
+    ULONGLONG             Offset   = 0;
+    ULONG                 i, IndexStride = 0;
+    bool                  bResult  = false;
+
+    // Validate
+    if ( !pMesh ) return false;
+
+    // Fill out the header counts
+    ZeroMemory( &Header, sizeof(MESH_FILE_HEADER) );
+    Header.Magic        = MESHFILE_MAGIC;
+    Header.Version      = MESHFILE_VERSION;
+    Header.HeaderSize   = sizeof(MESH_FILE_HEADER);
+    Header.VertexSize   = sizeof(CVertex);
+    Header.PolygonCount = pMesh->m_nPolygonCount;
+    for ( i = 0; i < pMesh->m_nPolygonCount; i++ )
+    {
+        ULONG nCount = 0;
+        pMesh->GetPolygonVertices( i, &nCount );
+        Header.VertexCount += nCount;
+
+    } // Next Polygon
+
+    // Include the compiled form if it has usable vertices
+    pCompiled = pMesh->GetCompiled();
+    if ( pCompiled && pCompiled->GetIndexCount() > 0 && (pCompiled->GetVertices() || pCompiled->IsQuantized()) )
+    {
+        Header.Flags              |= MESHFILE_HAS_COMPILED;
+        if ( pCompiled->GetIndexFormat() == D3DFMT_INDEX32 ) Header.Flags |= MESHFILE_INDEX32;
+        Header.CompiledVertexCount = pCompiled->GetVertexCount();
+        Header.IndexCount          = pCompiled->GetIndexCount();
+        IndexStride                = pCompiled->GetIndexStride();
+
+    } // End if compiled
+
+    // Lay out the blocks
+    Offset = AlignUp( sizeof(MESH_FILE_HEADER) );
+    Header.VertexOffset  = (ULONG)Offset; Offset = AlignUp( Offset + (ULONGLONG)Header.VertexCount * sizeof(CVertex) );
+    Header.PolygonOffset = (ULONG)Offset; Offset = AlignUp( Offset + (ULONGLONG)Header.PolygonCount * sizeof(POLYGON_RANGE) );
+    if ( Header.Flags & MESHFILE_HAS_COMPILED )
+    {
+        Header.CompiledVertexOffset = (ULONG)Offset; Offset = AlignUp( Offset + (ULONGLONG)Header.CompiledVertexCount * sizeof(CVertex) );
+        Header.IndexOffset          = (ULONG)Offset; Offset = AlignUp( Offset + (ULONGLONG)Header.IndexCount * IndexStride );
+
+    } // End if compiled
+
+    // Files are limited to 4GB
+    if ( Offset > 0xFFFFFFFF ) return false;
+    Header.FileSize = (ULONG)Offset;
+
+    // Create the file at its final size and map it (new space is zero filled)
+    hFile = CreateFile( strFileName, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+    if ( hFile == INVALID_HANDLE_VALUE ) return false;
+    if (!( hMapping = CreateFileMapping( hFile, NULL, PAGE_READWRITE, 0, Header.FileSize, NULL ) )) goto Cleanup;
+    if (!( pView = (UCHAR*)MapViewOfFile( hMapping, FILE_MAP_WRITE, 0, 0, 0 ) )) goto Cleanup;
+
+    // Write the vertex block & polygon table in polygon order
+    {
+        CVertex       * pVertex = (CVertex*)(pView + Header.VertexOffset);
+        POLYGON_RANGE * pRange  = (POLYGON_RANGE*)(pView + Header.PolygonOffset);
+        ULONG           nFirst  = 0;
+
+        for ( i = 0; i < pMesh->m_nPolygonCount; i++ )
+        {
+            ULONG     nCount    = 0;
+            CVertex * pVertices = pMesh->GetPolygonVertices( i, &nCount );
+            if ( nCount > 0 ) memcpy( &pVertex[ nFirst ], pVertices, nCount * sizeof(CVertex) );
+            pRange[i].FirstVertex = nFirst;
+            pRange[i].VertexCount = nCount;
+            nFirst += nCount;
+
+        } // Next Polygon
+
+    } // End vertex block
+
+    // Write the compiled vertices (decoding compact meshes) and indices
+    if ( Header.Flags & MESHFILE_HAS_COMPILED )
+    {
+        CVertex * pVertex = (CVertex*)(pView + Header.CompiledVertexOffset);
+        if ( pCompiled->GetVertices() )
+            memcpy( pVertex, pCompiled->GetVertices(), Header.CompiledVertexCount * sizeof(CVertex) );
+        else
+            pCompiled->DecodeVertices( pVertex );
+
+        memcpy( pView + Header.IndexOffset, pCompiled->GetIndices(), Header.IndexCount * IndexStride );
+
+    } // End if compiled
+
+    // Checksum the data, then the header, and store it
+    Header.DataChecksum   = Checksum( pView + sizeof(MESH_FILE_HEADER), Header.FileSize - sizeof(MESH_FILE_HEADER) );
+    Header.HeaderChecksum = HeaderChecksum( &Header );
+    memcpy( pView, &Header, sizeof(MESH_FILE_HEADER) );
+
+    // Success!
+    bResult = true;
+
+Cleanup:
+    if ( pView    ) UnmapViewOfFile( pView );
+    if ( hMapping ) CloseHandle( hMapping );
+    CloseHandle( hFile );
+
+    // Don't leave partially written files behind
+    if ( !bResult ) DeleteFile( strFileName );
+    return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Validate () (Static)
+// Desc : Validates the mesh file image specified. The header and the extent
+//        of each block are always validated, the remaining checks are
+//        performed only when requested through the VerifyFlags.
+//-----------------------------------------------------------------------------
+bool CMeshFile::Validate( const void * pData, ULONG Size, ULONG VerifyFlags )
+{
+    const MESH_FILE_HEADER * pHeader = (const MESH_FILE_HEADER*)pData;
+    const UCHAR            * pBytes  = (const UCHAR*)pData;
+    ULONG                    i, IndexStride;
+
+    // Validate the header
+    if ( !pData || Size < sizeof(MESH_FILE_HEADER) ) return false;
+    if ( pHeader->Magic != MESHFILE_MAGIC || pHeader->Version != MESHFILE_VERSION ) return false;
+    if ( pHeader->HeaderSize != sizeof(MESH_FILE_HEADER) || pHeader->VertexSize != sizeof(CVertex) ) return false;
+    if ( pHeader->FileSize != Size ) return false;
+    if ( pHeader->Flags & ~(MESHFILE_HAS_COMPILED | MESHFILE_INDEX32) ) return false;
+    if ( pHeader->HeaderChecksum != HeaderChecksum( pHeader ) ) return false;
+
+    // Validate the block extents
+    if ( !CheckBlock( pHeader->VertexOffset,  pHeader->VertexCount,  sizeof(CVertex), Size ) ) return false;
+    if ( !CheckBlock( pHeader->PolygonOffset, pHeader->PolygonCount, sizeof(POLYGON_RANGE), Size ) ) return false;
+    IndexStride = (pHeader->Flags & MESHFILE_INDEX32) ? 4 : 2;
+    if ( pHeader->Flags & MESHFILE_HAS_COMPILED )
+    {
+        if ( pHeader->IndexCount == 0 || pHeader->IndexCount % 3 != 0 ) return false;
+        if ( !CheckBlock( pHeader->CompiledVertexOffset, pHeader->CompiledVertexCount, sizeof(CVertex), Size ) ) return false;
+        if ( !CheckBlock( pHeader->IndexOffset, pHeader->IndexCount, IndexStride, Size ) ) return false;
+
+    } // End if compiled
+    else if ( pHeader->CompiledVertexCount != 0 || pHeader->IndexCount != 0 ) return false;
+
+    // Validate polygon runs and indices
+    if ( VerifyFlags & MESHFILE_VERIFY_BOUNDS )
+    {
+        const POLYGON_RANGE * pRange = (const POLYGON_RANGE*)(pBytes + pHeader->PolygonOffset);
+        for ( i = 0; i < pHeader->PolygonCount; i++ )
+        {
+            // Polygons address at most 65535 vertices (see CPolygon)
+            if ( pRange[i].VertexCount > 0xFFFF ) return false;
+            if ( (ULONGLONG)pRange[i].FirstVertex + pRange[i].VertexCount > pHeader->VertexCount ) return false;
+
+        } // Next Polygon
+
+        if ( pHeader->Flags & MESHFILE_HAS_COMPILED )
+        {
+            const void * pIndices = pBytes + pHeader->IndexOffset;
+            for ( i = 0; i < pHeader->IndexCount; i++ )
+            {
+                ULONG Index = (IndexStride == 4) ? ((const ULONG*)pIndices)[i] : ((const USHORT*)pIndices)[i];
+                if ( Index >= pHeader->CompiledVertexCount ) return false;
+
+            } // Next Index
+
+        } // End if compiled
+
+    } // End if verify bounds
+
+    // Validate the data checksum
+    if ( VerifyFlags & MESHFILE_VERIFY_CHECKSUM )
+    {
+        if ( Checksum( pBytes + sizeof(MESH_FILE_HEADER), Size - sizeof(MESH_FILE_HEADER) ) != pHeader->DataChecksum ) return false;
+
+    } // End if verify checksum
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Checksum () (Static)
+// Desc : Fletcher style checksum over 32 bit words, cheap enough to run over
+//        very large files at memory bandwidth.
+// Note : Any trailing bytes are treated as a zero padded final word.
+//-----------------------------------------------------------------------------
+ULONGLONG CMeshFile::Checksum( const void * pData, ULONG Size )
+{
+    const UCHAR * pBytes = (const UCHAR*)pData;
+    ULONG         a = 1, b = 0, Word;
+
+    // Sum whole words
+    for ( ULONG i = 0; i < Size / 4; i++, pBytes += 4 )
+    {
+        memcpy( &Word, pBytes, 4 );
+        a += Word;
+        b += a;
+
+    } // Next Word
+
+    // Sum any remaining bytes
+    if ( Size & 3 )
+    {
+        Word = 0;
+        memcpy( &Word, pBytes, Size & 3 );
+        a += Word;
+        b += a;
+
+    } // End if remainder
+
+    return ((ULONGLONG)b << 32) | a;
+}
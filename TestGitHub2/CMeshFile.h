@@ -0,0 +1,115 @@
+//-----------------------------------------------------------------------------
+// File: CMeshFile.h
+//
+// Desc: Versioned binary mesh file format. Files are memory mapped and used
+//       in place, so meshes are attached to the mapped data without any
+//       parsing or per-vertex copies.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CMESHFILE_H_
+#define _CMESHFILE_H_
+
+//-----------------------------------------------------------------------------
+// CMeshFile Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CObject.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG  MESHFILE_MAGIC         = 0x4853454D;   // 'MESH'
+const USHORT MESHFILE_VERSION       = 1;            // Current file format version
+const ULONG  MESHFILE_ALIGNMENT     = 16;           // Alignment of every data block
+
+// Header flags
+const ULONG  MESHFILE_HAS_COMPILED  = 0x00000001;   // Compiled vertex & index blocks present
+const ULONG  MESHFILE_INDEX32       = 0x00000002;   // Index block uses 32 bit indices
+
+// Open flags
+const ULONG  MESHFILE_VERIFY_BOUNDS   = 0x00000001; // Check polygon runs and indices lie within range
+const ULONG  MESHFILE_VERIFY_CHECKSUM = 0x00000002; // Check the checksum of every data block
+const ULONG  MESHFILE_VERIFY_ALL      = 0x00000003;
+
+//-----------------------------------------------------------------------------
+// Name : MESH_FILE_HEADER (Struct)
+// Desc : Header found at the start of every mesh file. Each block offset is
+//        relative to the start of the file and aligned to MESHFILE_ALIGNMENT.
+//        Blocks are stored in the order listed, each padded with zeros.
+// Note : The header checksum is calculated with HeaderChecksum set to zero,
+//        and the data checksum covers everything that follows the header.
+//-----------------------------------------------------------------------------
+struct MESH_FILE_HEADER
+{
+    ULONG       Magic;                  // MESHFILE_MAGIC
+    USHORT      Version;                // MESHFILE_VERSION
+    USHORT      HeaderSize;             // sizeof(MESH_FILE_HEADER)
+    ULONG       Flags;                  // MESHFILE_HAS_COMPILED etc.
+    ULONG       VertexSize;             // sizeof(CVertex)
+    ULONG       VertexCount;            // Number of vertices in the vertex block
+    ULONG       PolygonCount;           // Number of POLYGON_RANGE entries in the polygon block
+    ULONG       CompiledVertexCount;    // Number of vertices in the compiled vertex block
+    ULONG       IndexCount;             // Number of triangle list indices in the index block
+    ULONG       VertexOffset;           // Offset of the vertex block
+    ULONG       PolygonOffset;          // Offset of the polygon block
+    ULONG       CompiledVertexOffset;   // Offset of the compiled vertex block (0 if none)
+    ULONG       IndexOffset;            // Offset of the index block (0 if none)
+    ULONG       FileSize;               // Total size of the file in bytes
+    ULONG       HeaderChecksum;         // Checksum of this header
+    ULONGLONG   DataChecksum;           // Checksum of all data blocks
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CMeshFile (Class)
+// Desc : Maps a mesh file into memory, validates it and attaches meshes to
+//        its contents. Also provides the writer used to produce mesh files.
+// Note : The view is mapped copy-on-write, so attached meshes may safely be
+//        written to without altering the file. Any mesh attached to a file
+//        must be released, modified or re-attached before the file is closed.
+//-----------------------------------------------------------------------------
+class CMeshFile
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CMeshFile();
+	virtual ~CMeshFile();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool        Open            ( LPCTSTR strFileName, ULONG VerifyFlags = MESHFILE_VERIFY_BOUNDS );
+    void        Close           ( );
+    bool        Attach          ( CMesh * pMesh ) const;
+
+    const MESH_FILE_HEADER * GetHeader( ) const { return (const MESH_FILE_HEADER*)m_pView; }
+    bool                     IsOpen   ( ) const { return m_pView != NULL; }
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static bool         Write       ( LPCTSTR strFileName, const CMesh * pMesh );
+    static bool         Validate    ( const void * pData, ULONG Size, ULONG VerifyFlags );
+    static ULONGLONG    Checksum    ( const void * pData, ULONG Size );
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    HANDLE      m_hFile;                // Handle to the open mesh file
+    HANDLE      m_hMapping;             // File mapping object
+    UCHAR      *m_pView;                // Mapped view of the entire file
+    ULONG       m_nSize;                // Size of the mapped view
+
+    // Mapped files are not copyable.
+    CMeshFile( const CMeshFile & );
+    CMeshFile & operator=( const CMeshFile & );
+};
+
+#endif // _CMESHFILE_H_
@@ -0,0 +1,1200 @@
+//-----------------------------------------------------------------------------
+// File: CMeshImporter.cpp
+//
+// Desc: Parallel importer for Wavefront OBJ and ASCII / binary PLY files.
+//       Files are memory mapped, split into chunks which are parsed on every
+//       available thread, and the results merged into a pooled CMesh.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CMeshImporter Specific Includes
+//-----------------------------------------------------------------------------
+#include "CMeshImporter.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Local Structures & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const ULONG PLY_MAX_ELEMENTS    = 16;       // Largest number of PLY elements supported
+    const ULONG PLY_MAX_PROPERTIES  = 32;       // Largest number of properties per element
+    const ULONG PLY_MAX_NAME        = 32;       // Longest element / property name
+    const ULONG PLY_MAX_LINE        = 256;      // Longest header line
+
+    // Powers of ten which are exactly representable as doubles
+    const double Pow10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    enum PLY_TYPE
+    {
+        PLY_INT8 = 0, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_TYPE_COUNT
+    };
+
+    const ULONG PlyTypeSize[ PLY_TYPE_COUNT ] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+    enum PLY_ROLE
+    {
+        PLY_ROLE_NONE = 0, PLY_ROLE_X, PLY_ROLE_Y, PLY_ROLE_Z, PLY_ROLE_RED, PLY_ROLE_GREEN, PLY_ROLE_BLUE, PLY_ROLE_INDICES
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : GROW_ARRAY (Struct)
+    // Desc : Minimal growable array of plain data, used for per chunk output.
+    //-------------------------------------------------------------------------
+    template <class T> struct GROW_ARRAY
+    {
+        T     * pData;
+        ULONG   Count;
+        ULONG   Capacity;
+
+        GROW_ARRAY( )  { pData = NULL; Count = 0; Capacity = 0; }
+        ~GROW_ARRAY( ) { if ( pData ) free( pData ); }
+
+        bool Push( const T & Value )
+        {
+            if ( Count == Capacity )
+            {
+                ULONG NewCapacity = (Capacity < 256) ? 256 : Capacity + Capacity / 2;
+                T   * pNewData    = (T*)realloc( pData, NewCapacity * sizeof(T) );
+                if ( !pNewData ) return false;
+                pData    = pNewData;
+                Capacity = NewCapacity;
+
+            } // End if full
+
+            pData[ Count++ ] = Value;
+            return true;
+        }
+
+    private:
+        GROW_ARRAY( const GROW_ARRAY & );
+        GROW_ARRAY & operator=( const GROW_ARRAY & );
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : IMPORT_FACE (Struct)
+    // Desc : Face parsed from a chunk. VertexBase records the number of
+    //        vertices the chunk had read when the face was parsed, so that
+    //        relative OBJ indices can be resolved once chunks are merged.
+    //-------------------------------------------------------------------------
+    struct IMPORT_FACE
+    {
+        ULONG       FirstIndex;             // First entry in the chunk index array
+        ULONG       IndexCount;             // Number of indices
+        ULONG       VertexBase;             // Chunk vertex count when parsed
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : IMPORT_CHUNK (Struct)
+    // Desc : A range of the file parsed as a single task, and its output.
+    //-------------------------------------------------------------------------
+    struct IMPORT_CHUNK
+    {
+        const char *            pStart;     // First byte of the chunk
+        const char *            pEnd;       // One past the last byte of the chunk
+        ULONG                   FirstRow;   // First line (ASCII PLY) or element row (binary PLY)
+        ULONG                   RowCount;   // Number of lines / rows in this chunk
+        GROW_ARRAY<CVertex>     Vertices;   // Vertices read (OBJ only)
+        GROW_ARRAY<IMPORT_FACE> Faces;      // Faces read
+        GROW_ARRAY<LONG>        Indices;    // Face indices, as stored in the file
+        ULONG                   VertexBase; // Offset of our vertices in the merged array
+        ULONG                   FaceBase;   // Offset of our faces in the merged list
+        bool                    bError;     // Chunk could not be parsed
+
+        IMPORT_CHUNK( ) { pStart = pEnd = NULL; FirstRow = RowCount = VertexBase = FaceBase = 0; bError = false; }
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : PLY_PROPERTY / PLY_ELEMENT / PLY_HEADER (Structs)
+    // Desc : Parsed PLY header.
+    //-------------------------------------------------------------------------
+    struct PLY_PROPERTY
+    {
+        char        Name[ PLY_MAX_NAME ];
+        PLY_TYPE    Type;                   // Value type (list entries for lists)
+        PLY_TYPE    CountType;              // Type of the list count (lists only)
+        bool        bList;                  // Is this a list property ?
+        PLY_ROLE    Role;                   // What we use this property for
+        float       Scale;                  // Scale applied to colour values
+    };
+
+    struct PLY_ELEMENT
+    {
+        char            Name[ PLY_MAX_NAME ];
+        ULONG           Count;                  // Number of rows
+        PLY_PROPERTY    Properties[ PLY_MAX_PROPERTIES ];
+        ULONG           PropertyCount;
+        ULONG           Stride;                 // Row size in bytes (binary, 0 if variable)
+    };
+
+    struct PLY_HEADER
+    {
+        bool            bBinary;                // Binary body ?
+        bool            bSwap;                  // Binary body is big endian ?
+        PLY_ELEMENT     Elements[ PLY_MAX_ELEMENTS ];
+        ULONG           ElementCount;
+        LONG            VertexElement;          // Index of the "vertex" element
+        LONG            FaceElement;            // Index of the "face" element
+        ULONG           DataOffset;             // Offset of the body within the file
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : IMPORT_CONTEXT (Struct)
+    // Desc : State shared between the import tasks.
+    //-------------------------------------------------------------------------
+    struct IMPORT_CONTEXT
+    {
+        const char     * pFile;                 // Mapped file
+        ULONG            FileSize;              // Size of the mapped file
+        IMPORT_FORMAT    Format;                // Format being imported
+        IMPORT_CHUNK   * pChunks;               // Face producing chunks
+        ULONG            ChunkCount;
+        IMPORT_CHUNK   * pVertexChunks;         // Vertex element chunks (binary PLY)
+        ULONG            VertexChunkCount;
+        CVertex        * pVertices;             // Merged vertex array
+        ULONG            VertexCount;
+        CMesh          * pMesh;                 // Mesh being populated
+        ULONG            FirstPolygon;          // First polygon we added to the mesh
+        PLY_HEADER     * pPly;                  // PLY header (PLY only)
+        ULONG            ElementFirstLine[ PLY_MAX_ELEMENTS ]; // First body line of each element (ASCII PLY)
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : IsSpace () / SkipSpace () / SkipToken ()
+    // Desc : Whitespace helpers. Lines are split at '\n' so '\r' is treated as
+    //        ordinary whitespace.
+    //-------------------------------------------------------------------------
+    inline bool IsSpace( char c ) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    inline const char * SkipSpace( const char * p, const char * pEnd )
+    {
+        while ( p < pEnd && IsSpace( *p ) ) p++;
+        return p;
+    }
+
+    inline const char * SkipToken( const char * p, const char * pEnd )
+    {
+        p = SkipSpace( p, pEnd );
+        while ( p < pEnd && !IsSpace( *p ) ) p++;
+        return p;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ParseFloat ()
+    // Desc : Fast float parser. Up to 19 significant digits are accumulated
+    //        as an integer and scaled by an exact power of ten, which avoids
+    //        the locale handling and per digit floating point work of atof.
+    // Note : Returns false, leaving p untouched, if no number is present.
+    //-------------------------------------------------------------------------
+    bool ParseFloat( const char *& p, const char * pEnd, float * pValue )
+    {
+        const char * q = SkipSpace( p, pEnd );
+        ULONGLONG    Mantissa = 0;
+        LONG         Exponent = 0, Digits = 0;
+        bool         bNegative = false;
+        double       Value;
+
+        // Sign
+        if ( q < pEnd && (*q == '-' || *q == '+') ) { bNegative = (*q == '-'); q++; }
+
+        // Integer part (digits beyond what we can hold just scale the result)
+        for ( ; q < pEnd && (ULONG)(*q - '0') < 10; q++, Digits++ )
+        {
+            if ( Mantissa < 1000000000000000000ULL ) Mantissa = Mantissa * 10 + (*q - '0'); else Exponent++;
+
+        } // Next Digit
+
+        // Fractional part
+        if ( q < pEnd && *q == '.' )
+        {
+            for ( q++; q < pEnd && (ULONG)(*q - '0') < 10; q++, Digits++ )
+            {
+                if ( Mantissa < 1000000000000000000ULL ) { Mantissa = Mantissa * 10 + (*q - '0'); Exponent--; }
+
+            } // Next Digit
+
+        } // End if fraction
+        if ( Digits == 0 ) return false;
+
+        // Exponent
+        if ( q < pEnd && (*q == 'e' || *q == 'E') )
+        {
+            const char * r = q + 1;
+            bool         bNegExp = false;
+            LONG         Exp = 0, ExpDigits = 0;
+
+            if ( r < pEnd && (*r == '-' || *r == '+') ) { bNegExp = (*r == '-'); r++; }
+            for ( ; r < pEnd && (ULONG)(*r - '0') < 10; r++, ExpDigits++ ) if ( Exp < 10000 ) Exp = Exp * 10 + (*r - '0');
+            if ( ExpDigits > 0 ) { Exponent += bNegExp ? -Exp : Exp; q = r; }
+
+        } // End if exponent
+
+        // Scale
+        Value = (double)Mantissa;
+        if ( Mantissa != 0 && Exponent != 0 )
+        {
+            if ( Exponent < 0 )
+                Value = (Exponent >= -22) ? Value / Pow10[ -Exponent ] : Value * pow( 10.0, (double)Exponent );
+            else
+                Value = (Exponent <= 22) ? Value * Pow10[ Exponent ] : Value * pow( 10.0, (double)Exponent );
+
+        } // End if scale
+
+        *pValue = (float)(bNegative ? -Value : Value);
+        p = q;
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ParseLong ()
+    // Desc : Parses a signed integer, returning false if none is present.
+    //-------------------------------------------------------------------------
+    bool ParseLong( const char *& p, const char * pEnd, LONG * pValue )
+    {
+        const char * q = SkipSpace( p, pEnd );
+        ULONGLONG    Value = 0;
+        bool         bNegative = false;
+        ULONG        Digits = 0;
+
+        if ( q < pEnd && (*q == '-' || *q == '+') ) { bNegative = (*q == '-'); q++; }
+        for ( ; q < pEnd && (ULONG)(*q - '0') < 10; q++, Digits++ ) if ( Value <= 0x7FFFFFFF ) Value = Value * 10 + (*q - '0');
+        if ( Digits == 0 || Value > 0x7FFFFFFF ) return false;
+
+        *pValue = bNegative ? -(LONG)Value : (LONG)Value;
+        p = q;
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : PackColor ()
+    // Desc : Builds an opaque diffuse colour from 0-255 channel values.
+    //-------------------------------------------------------------------------
+    ULONG PackColor( float r, float g, float b )
+    {
+        float c[3] = { r, g, b };
+        ULONG Color = 0xFF000000;
+        for ( ULONG i = 0; i < 3; i++ )
+        {
+            float v = c[i];
+            if ( !(v > 0.0f) ) v = 0.0f; else if ( v > 255.0f ) v = 255.0f;
+            Color |= (ULONG)(v + 0.5f) << (16 - i * 8);
+
+        } // Next Channel
+        return Color;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : RunTasks ()
+    // Desc : Runs a task over the thread pool, or the calling thread alone.
+    //-------------------------------------------------------------------------
+    void RunTasks( CThreadPool * pPool, THREAD_TASK pTask, void * pContext, ULONG Count )
+    {
+        if ( pPool ) { pPool->Dispatch( pTask, pContext, Count ); return; }
+        for ( ULONG i = 0; i < Count; i++ ) pTask( pContext, i );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : SplitText ()
+    // Desc : Splits a range of text into chunks of roughly IMPORT_CHUNK_SIZE
+    //        bytes, each ending immediately after a newline.
+    //-------------------------------------------------------------------------
+    IMPORT_CHUNK * SplitText( const char * pStart, const char * pEnd, ULONG * pChunkCount )
+    {
+        IMPORT_CHUNK * pChunks = NULL;
+        ULONG          Count   = (ULONG)((pEnd - pStart) / IMPORT_CHUNK_SIZE) + 1;
+        const char   * p       = pStart;
+
+        if (!( pChunks = new IMPORT_CHUNK[ Count ] )) return NULL;
+        for ( ULONG i = 0; i < Count; i++ )
+        {
+            const char * pSplit = pEnd;
+
+            // Move the split point forward to the end of the line it lands in
+            if ( i + 1 < Count && (ULONG)(pEnd - p) > IMPORT_CHUNK_SIZE )
+            {
+                pSplit = (const char*)memchr( p + IMPORT_CHUNK_SIZE, '\n', pEnd - (p + IMPORT_CHUNK_SIZE) );
+                pSplit = pSplit ? pSplit + 1 : pEnd;
+
+            } // End if not last
+
+            pChunks[i].pStart = p;
+            pChunks[i].pEnd   = pSplit;
+            p = pSplit;
+
+        } // Next Chunk
+
+        *pChunkCount = Count;
+        return pChunks;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ObjParseTask ()
+    // Desc : Parses the "v" and "f" lines of a single OBJ chunk.
+    //-------------------------------------------------------------------------
+    void ObjParseTask( void * pContext, ULONG Index )
+    {
+        IMPORT_CHUNK & Chunk = ((IMPORT_CONTEXT*)pContext)->pChunks[ Index ];
+        const char   * p     = Chunk.pStart;
+
+        while ( p < Chunk.pEnd )
+        {
+            const char * pLineEnd = (const char*)memchr( p, '\n', Chunk.pEnd - p );
+            if ( !pLineEnd ) pLineEnd = Chunk.pEnd;
+            p = SkipSpace( p, pLineEnd );
+
+            if ( pLineEnd - p >= 2 && p[0] == 'v' && IsSpace( p[1] ) )
+            {
+                CVertex Vertex;
+                float   r, g, b;
+
+                // Position, followed by an optional 0-1 colour
+                p++;
+                if ( !ParseFloat( p, pLineEnd, &Vertex.x ) || !ParseFloat( p, pLineEnd, &Vertex.y ) ||
+                     !ParseFloat( p, pLineEnd, &Vertex.z ) ) { Chunk.bError = true; return; }
+                if ( ParseFloat( p, pLineEnd, &r ) && ParseFloat( p, pLineEnd, &g ) && ParseFloat( p, pLineEnd, &b ) )
+                    Vertex.Diffuse = PackColor( r * 255.0f, g * 255.0f, b * 255.0f );
+
+                if ( !Chunk.Vertices.Push( Vertex ) ) { Chunk.bError = true; return; }
+
+            } // End if vertex
+            else if ( pLineEnd - p >= 2 && p[0] == 'f' && IsSpace( p[1] ) )
+            {
+                IMPORT_FACE Face;
+                Face.FirstIndex = Chunk.Indices.Count;
+                Face.VertexBase = Chunk.Vertices.Count;
+
+                // Read the position index of each "v/vt/vn" token
+                for ( p++; ; )
+                {
+                    LONG Value;
+                    p = SkipSpace( p, pLineEnd );
+                    if ( p >= pLineEnd ) break;
+                    if ( !ParseLong( p, pLineEnd, &Value ) || !Chunk.Indices.Push( Value ) ) { Chunk.bError = true; return; }
+                    while ( p < pLineEnd && !IsSpace( *p ) ) p++;
+
+                } // Next Token
+
+                // Keep only polygons that a CPolygon can represent
+                Face.IndexCount = Chunk.Indices.Count - Face.FirstIndex;
+                if ( Face.IndexCount < 3 || Face.IndexCount > 0xFFFF )
+                    Chunk.Indices.Count = Face.FirstIndex;
+                else if ( !Chunk.Faces.Push( Face ) ) { Chunk.bError = true; return; }
+
+            } // End if face
+
+            p = pLineEnd + 1;
+
+        } // Next Line
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ParsePlyType ()
+    // Desc : Converts a PLY type name into a PLY_TYPE.
+    //-------------------------------------------------------------------------
+    bool ParsePlyType( const char * strName, PLY_TYPE * pType )
+    {
+        static const char * Names[] = { "char", "uchar", "short", "ushort", "int", "uint", "float", "double",
+                                        "int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64" };
+        for ( ULONG i = 0; i < 16; i++ )
+        {
+            if ( strcmp( strName, Names[i] ) == 0 ) { *pType = (PLY_TYPE)(i % PLY_TYPE_COUNT); return true; }
+
+        } // Next Type
+        return false;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : GetWord ()
+    // Desc : Copies the next whitespace delimited word of a header line.
+    //-------------------------------------------------------------------------
+    const char * GetWord( const char * p, char * strWord, ULONG MaxLength )
+    {
+        ULONG Length = 0;
+        while ( *p && IsSpace( *p ) ) p++;
+        while ( *p && !IsSpace( *p ) ) { if ( Length < MaxLength - 1 ) strWord[ Length++ ] = *p; p++; }
+        strWord[ Length ] = '\0';
+        return p;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ParsePlyHeader ()
+    // Desc : Parses the header of a PLY file and locates the vertex and face
+    //        elements along with the properties we import.
+    // Note : Element counts the body is too small to hold are rejected here,
+    //        before anything is allocated to match them.
+    //-------------------------------------------------------------------------
+    bool ParsePlyHeader( const char * pFile, ULONG FileSize, PLY_HEADER * pHeader )
+    {
+        const char * p = pFile, * pEnd = pFile + FileSize;
+        char         strLine[ PLY_MAX_LINE ], strWord[ PLY_MAX_LINE ];
+        bool         bFormat = false;
+        ULONGLONG    MinBodySize = 0;
+
+        ZeroMemory( pHeader, sizeof(PLY_HEADER) );
+        pHeader->VertexElement = -1;
+        pHeader->FaceElement   = -1;
+
+        for ( ULONG Line = 0; ; Line++ )
+        {
+            const char * pLineEnd = (const char*)memchr( p, '\n', pEnd - p );
+            const char * q;
+            if ( !pLineEnd ) return false;
+
+            // Copy the line so it can be tokenised safely
+            ULONG Length = (ULONG)(pLineEnd - p);
+            if ( Length >= PLY_MAX_LINE ) return false;
+            memcpy( strLine, p, Length );
+            strLine[ Length ] = '\0';
+            p = pLineEnd + 1;
+
+            // Process the keyword
+            q = GetWord( strLine, strWord, PLY_MAX_LINE );
+            if ( Line == 0 ) { if ( strcmp( strWord, "ply" ) != 0 ) return false; continue; }
+
+            if ( strcmp( strWord, "format" ) == 0 )
+            {
+                GetWord( q, strWord, PLY_MAX_LINE );
+                if ( strcmp( strWord, "ascii" ) == 0 ) bFormat = true;
+                else if ( strcmp( strWord, "binary_little_endian" ) == 0 ) { bFormat = true; pHeader->bBinary = true; }
+                else if ( strcmp( strWord, "binary_big_endian" ) == 0 ) { bFormat = true; pHeader->bBinary = true; pHeader->bSwap = true; }
+                else return false;
+
+            } // End if format
+            else if ( strcmp( strWord, "element" ) == 0 )
+            {
+                if ( pHeader->ElementCount == PLY_MAX_ELEMENTS ) return false;
+                PLY_ELEMENT & Element = pHeader->Elements[ pHeader->ElementCount++ ];
+
+                q = GetWord( q, Element.Name, PLY_MAX_NAME );
+                GetWord( q, strWord, PLY_MAX_LINE );
+                Element.Count = strtoul( strWord, NULL, 10 );
+
+            } // End if element
+            else if ( strcmp( strWord, "property" ) == 0 )
+            {
+                if ( pHeader->ElementCount == 0 ) return false;
+                PLY_ELEMENT & Element = pHeader->Elements[ pHeader->ElementCount - 1 ];
+                if ( Element.PropertyCount == PLY_MAX_PROPERTIES ) return false;
+                PLY_PROPERTY & Property = Element.Properties[ Element.PropertyCount++ ];
+
+                q = GetWord( q, strWord, PLY_MAX_LINE );
+                if ( strcmp( strWord, "list" ) == 0 )
+                {
+                    Property.bList = true;
+                    q = GetWord( q, strWord, PLY_MAX_LINE );
+                    if ( !ParsePlyType( strWord, &Property.CountType ) ) return false;
+                    q = GetWord( q, strWord, PLY_MAX_LINE );
+
+                } // End if list
+                if ( !ParsePlyType( strWord, &Property.Type ) ) return false;
+                GetWord( q, Property.Name, PLY_MAX_NAME );
+
+            } // End if property
+            else if ( strcmp( strWord, "end_header" ) == 0 )
+            {
+                pHeader->DataOffset = (ULONG)(p - pFile);
+                break;
+
+            } // End if end of header
+
+        } // Next Line
+
+        // Locate the elements & properties we import
+        for ( ULONG e = 0; e < pHeader->ElementCount; e++ )
+        {
+            PLY_ELEMENT & Element = pHeader->Elements[e];
+            bool          bVertex = strcmp( Element.Name, "vertex" ) == 0;
+            bool          bFace   = strcmp( Element.Name, "face" ) == 0;
+
+            if ( bVertex ) pHeader->VertexElement = e;
+            if ( bFace   ) pHeader->FaceElement   = e;
+
+            // Calculate the binary row size (and the smallest any row can be),
+            // and assign property roles
+            ULONG MinRowSize = 0;
+            Element.Stride = 0;
+            for ( ULONG i = 0; i < Element.PropertyCount; i++ )
+            {
+                PLY_PROPERTY & Property = Element.Properties[i];
+                const char   * strName  = Property.Name;
+
+                if ( Property.bList ) Element.Stride = 0xFFFFFFFF;
+                if ( Element.Stride != 0xFFFFFFFF ) Element.Stride += PlyTypeSize[ Property.Type ];
+
+                // ASCII values take at least a digit and a separator, empty lists just their count
+                if ( !pHeader->bBinary ) MinRowSize += 2;
+                else MinRowSize += PlyTypeSize[ Property.bList ? Property.CountType : Property.Type ];
+
+                // Colour channels are stored as 0-255, 0-65535 or 0-1
+                Property.Scale = 1.0f;
+                if ( Property.Type == PLY_FLOAT32 || Property.Type == PLY_FLOAT64 ) Property.Scale = 255.0f;
+                if ( Property.Type == PLY_UINT16 ) Property.Scale = 1.0f / 257.0f;
+
+                Property.Role = PLY_ROLE_NONE;
+                if ( bVertex && !Property.bList )
+                {
+                    if      ( strcmp( strName, "x" ) == 0 ) Property.Role = PLY_ROLE_X;
+                    else if ( strcmp( strName, "y" ) == 0 ) Property.Role = PLY_ROLE_Y;
+                    else if ( strcmp( strName, "z" ) == 0 ) Property.Role = PLY_ROLE_Z;
+                    else if ( strcmp( strName, "red"   ) == 0 ) Property.Role = PLY_ROLE_RED;
+                    else if ( strcmp( strName, "green" ) == 0 ) Property.Role = PLY_ROLE_GREEN;
+                    else if ( strcmp( strName, "blue"  ) == 0 ) Property.Role = PLY_ROLE_BLUE;
+
+                } // End if vertex
+                else if ( bFace && Property.bList )
+                {
+                    if ( strcmp( strName, "vertex_indices" ) == 0 || strcmp( strName, "vertex_index" ) == 0 ) Property.Role = PLY_ROLE_INDICES;
+
+                } // End if face
+
+            } // Next Property
+            if ( Element.Stride == 0xFFFFFFFF ) Element.Stride = 0;
+
+            // Every row takes up some of the body
+            MinBodySize += (ULONGLONG)Element.Count * (MinRowSize > 0 ? MinRowSize : 1);
+
+        } // Next Element
+
+        // The final ASCII line need not end in a new line
+        if ( MinBodySize > (ULONGLONG)(FileSize - pHeader->DataOffset) + (pHeader->bBinary ? 0 : 1) ) return false;
+
+        // We need a format, vertices and faces
+        return bFormat && pHeader->VertexElement >= 0 && pHeader->FaceElement >= 0;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ReadValue ()
+    // Desc : Reads a single binary PLY value.
+    //-------------------------------------------------------------------------
+    double ReadValue( const UCHAR * p, PLY_TYPE Type, bool bSwap )
+    {
+        UCHAR Buffer[8];
+        ULONG Size = PlyTypeSize[ Type ];
+        for ( ULONG i = 0; i < Size; i++ ) Buffer[i] = bSwap ? p[ Size - 1 - i ] : p[i];
+
+        switch ( Type )
+        {
+            case PLY_INT8:    return (double)*(signed char*)Buffer;
+            case PLY_UINT8:   return (double)Buffer[0];
+            case PLY_INT16:   { SHORT  v; memcpy( &v, Buffer, 2 ); return (double)v; }
+            case PLY_UINT16:  { USHORT v; memcpy( &v, Buffer, 2 ); return (double)v; }
+            case PLY_INT32:   { LONG   v; memcpy( &v, Buffer, 4 ); return (double)v; }
+            case PLY_UINT32:  { ULONG  v; memcpy( &v, Buffer, 4 ); return (double)v; }
+            case PLY_FLOAT32: { float  v; memcpy( &v, Buffer, 4 ); return (double)v; }
+            default:          { double v; memcpy( &v, Buffer, 8 ); return v; }
+
+        } // End Switch
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : SplitBinaryElement ()
+    // Desc : Determines the extent of a binary PLY element, optionally
+    //        dividing it into chunks of IMPORT_CHUNK_ROWS rows. Elements with
+    //        list properties have to be walked row by row to do so.
+    //-------------------------------------------------------------------------
+    bool SplitBinaryElement( const PLY_HEADER & Header, const PLY_ELEMENT & Element, const char * pStart, const char * pEnd,
+                             IMPORT_CHUNK ** ppChunks, ULONG * pChunkCount, const char ** ppElementEnd )
+    {
+        IMPORT_CHUNK * pChunks = NULL;
+        ULONG          Count   = (Element.Count + IMPORT_CHUNK_ROWS - 1) / IMPORT_CHUNK_ROWS;
+        const char   * p       = pStart;
+
+        if ( ppChunks && Count > 0 && !(pChunks = new IMPORT_CHUNK[ Count ]) ) return false;
+
+        for ( ULONG Row = 0; Row < Element.Count; Row++ )
+        {
+            // Record the start of each chunk
+            if ( pChunks && Row % IMPORT_CHUNK_ROWS == 0 )
+            {
+                IMPORT_CHUNK & Chunk = pChunks[ Row / IMPORT_CHUNK_ROWS ];
+                Chunk.pStart   = p;
+                Chunk.FirstRow = Row;
+                Chunk.RowCount = ( Element.Count - Row < IMPORT_CHUNK_ROWS ) ? Element.Count - Row : IMPORT_CHUNK_ROWS;
+
+            } // End if chunk start
+
+            // Fixed size rows can skip straight to the next chunk
+            if ( Element.Stride )
+            {
+                ULONG Rows = IMPORT_CHUNK_ROWS - Row % IMPORT_CHUNK_ROWS;
+                if ( Rows > Element.Count - Row ) Rows = Element.Count - Row;
+                if ( (ULONGLONG)Rows * Element.Stride > (ULONGLONG)(pEnd - p) ) { delete []pChunks; return false; }
+                p   += Rows * Element.Stride;
+                Row += Rows - 1;
+
+            } // End if fixed size
+            else
+            {
+                for ( ULONG i = 0; i < Element.PropertyCount; i++ )
+                {
+                    const PLY_PROPERTY & Property = Element.Properties[i];
+                    ULONGLONG            Size     = PlyTypeSize[ Property.Type ];
+
+                    if ( Property.bList )
+                    {
+                        if ( (ULONG)(pEnd - p) < PlyTypeSize[ Property.CountType ] ) { delete []pChunks; return false; }
+                        double Entries = ReadValue( (const UCHAR*)p, Property.CountType, Header.bSwap );
+                        if ( Entries < 0 ) { delete []pChunks; return false; }
+                        p    += PlyTypeSize[ Property.CountType ];
+                        Size *= (ULONGLONG)Entries;
+
+                    } // End if list
+
+                    if ( Size > (ULONGLONG)(pEnd - p) ) { delete []pChunks; return false; }
+                    p += (ULONG)Size;
+
+                } // Next Property
+
+            } // End if variable size
+
+            // Record the end of each chunk
+            if ( pChunks && (Row + 1) % IMPORT_CHUNK_ROWS == 0 ) pChunks[ Row / IMPORT_CHUNK_ROWS ].pEnd = p;
+
+        } // Next Row
+
+        // Close the final chunk
+        if ( pChunks && Count > 0 ) pChunks[ Count - 1 ].pEnd = p;
+
+        if ( ppChunks    ) *ppChunks    = pChunks;
+        if ( pChunkCount ) *pChunkCount = pChunks ? Count : 0;
+        *ppElementEnd = p;
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : PlyBinaryTask ()
+    // Desc : Parses a chunk of binary PLY vertex or face rows. The task index
+    //        covers the vertex chunks first, followed by the face chunks.
+    //-------------------------------------------------------------------------
+    void PlyBinaryTask( void * pContext, ULONG Index )
+    {
+        IMPORT_CONTEXT   * pCtx    = (IMPORT_CONTEXT*)pContext;
+        const PLY_HEADER & Header  = *pCtx->pPly;
+        bool               bVertex = Index < pCtx->VertexChunkCount;
+        IMPORT_CHUNK     & Chunk   = bVertex ? pCtx->pVertexChunks[ Index ] : pCtx->pChunks[ Index - pCtx->VertexChunkCount ];
+        const PLY_ELEMENT& Element = Header.Elements[ bVertex ? Header.VertexElement : Header.FaceElement ];
+        const UCHAR      * p       = (const UCHAR*)Chunk.pStart;
+
+        for ( ULONG Row = 0; Row < Chunk.RowCount; Row++ )
+        {
+            CVertex     Vertex;
+            float       Color[3] = { 0, 0, 0 };
+            bool        bColor = false;
+            IMPORT_FACE Face;
+
+            Face.FirstIndex = Chunk.Indices.Count;
+            Face.IndexCount = 0;
+            Face.VertexBase = 0;
+
+            for ( ULONG i = 0; i < Element.PropertyCount; i++ )
+            {
+                const PLY_PROPERTY & Property = Element.Properties[i];
+                ULONG                Size     = PlyTypeSize[ Property.Type ];
+
+                if ( Property.bList )
+                {
+                    ULONG Entries = (ULONG)ReadValue( p, Property.CountType, Header.bSwap );
+                    p += PlyTypeSize[ Property.CountType ];
+
+                    // Read the face indices
+                    if ( Property.Role == PLY_ROLE_INDICES )
+                    {
+                        for ( ULONG j = 0; j < Entries; j++, p += Size )
+                        {
+                            if ( !Chunk.Indices.Push( (LONG)ReadValue( p, Property.Type, Header.bSwap ) ) ) { Chunk.bError = true; return; }
+
+                        } // Next Entry
+                        Face.IndexCount = Entries;
+
+                    } // End if indices
+                    else p += Entries * Size;
+
+                    continue;
+
+                } // End if list
+
+                // Scalar property
+                switch ( Property.Role )
+                {
+                    case PLY_ROLE_X:     Vertex.x = (float)ReadValue( p, Property.Type, Header.bSwap ); break;
+                    case PLY_ROLE_Y:     Vertex.y = (float)ReadValue( p, Property.Type, Header.bSwap ); break;
+                    case PLY_ROLE_Z:     Vertex.z = (float)ReadValue( p, Property.Type, Header.bSwap ); break;
+                    case PLY_ROLE_RED:   Color[0] = (float)ReadValue( p, Property.Type, Header.bSwap ) * Property.Scale; bColor = true; break;
+                    case PLY_ROLE_GREEN: Color[1] = (float)ReadValue( p, Property.Type, Header.bSwap ) * Property.Scale; bColor = true; break;
+                    case PLY_ROLE_BLUE:  Color[2] = (float)ReadValue( p, Property.Type, Header.bSwap ) * Property.Scale; bColor = true; break;
+                    default: break;
+
+                } // End Switch
+                p += Size;
+
+            } // Next Property
+
+            // Store the row
+            if ( bVertex )
+            {
+                if ( bColor ) Vertex.Diffuse = PackColor( Color[0], Color[1], Color[2] );
+                pCtx->pVertices[ Chunk.FirstRow + Row ] = Vertex;
+
+            } // End if vertex
+            else if ( Face.IndexCount < 3 || Face.IndexCount > 0xFFFF )
+                Chunk.Indices.Count = Face.FirstIndex;
+            else if ( !Chunk.Faces.Push( Face ) ) { Chunk.bError = true; return; }
+
+        } // Next Row
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : PlyCountLinesTask ()
+    // Desc : Counts the lines in an ASCII PLY chunk.
+    //-------------------------------------------------------------------------
+    void PlyCountLinesTask( void * pContext, ULONG Index )
+    {
+        IMPORT_CHUNK & Chunk = ((IMPORT_CONTEXT*)pContext)->pChunks[ Index ];
+        const char   * p     = Chunk.pStart;
+
+        Chunk.RowCount = 0;
+        while ( p < Chunk.pEnd )
+        {
+            const char * pLineEnd = (const char*)memchr( p, '\n', Chunk.pEnd - p );
+            Chunk.RowCount++;
+            if ( !pLineEnd ) break;
+            p = pLineEnd + 1;
+
+        } // Next Line
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : PlyAsciiTask ()
+    // Desc : Parses the lines of an ASCII PLY chunk. Each line is one row of
+    //        an element, identified from its line number.
+    //-------------------------------------------------------------------------
+    void PlyAsciiTask( void * pContext, ULONG Index )
+    {
+        IMPORT_CONTEXT   * pCtx   = (IMPORT_CONTEXT*)pContext;
+        const PLY_HEADER & Header = *pCtx->pPly;
+        IMPORT_CHUNK     & Chunk  = pCtx->pChunks[ Index ];
+        const char       * p      = Chunk.pStart;
+        ULONG              Line   = Chunk.FirstRow, e = 0;
+
+        for ( ; p < Chunk.pEnd; Line++ )
+        {
+            const char * pLineEnd = (const char*)memchr( p, '\n', Chunk.pEnd - p );
+            if ( !pLineEnd ) pLineEnd = Chunk.pEnd;
+
+            // Find the element this line belongs to
+            while ( e < Header.ElementCount && Line >= pCtx->ElementFirstLine[e] + Header.Elements[e].Count ) e++;
+            if ( e >= Header.ElementCount ) break;
+
+            if ( e == (ULONG)Header.VertexElement || e == (ULONG)Header.FaceElement )
+            {
+                const PLY_ELEMENT & Element = Header.Elements[e];
+                CVertex             Vertex;
+                float               Value, Color[3] = { 0, 0, 0 };
+                bool                bColor = false;
+                IMPORT_FACE         Face;
+
+                Face.FirstIndex = Chunk.Indices.Count;
+                Face.IndexCount = 0;
+                Face.VertexBase = 0;
+
+                for ( ULONG i = 0; i < Element.PropertyCount; i++ )
+                {
+                    const PLY_PROPERTY & Property = Element.Properties[i];
+
+                    if ( Property.bList )
+                    {
+                        LONG Entries;
+                        if ( !ParseLong( p, pLineEnd, &Entries ) || Entries < 0 ) { Chunk.bError = true; return; }
+
+                        for ( LONG j = 0; j < Entries; j++ )
+                        {
+                            if ( Property.Role != PLY_ROLE_INDICES ) { p = SkipToken( p, pLineEnd ); continue; }
+
+                            LONG VertexIndex;
+                            if ( !ParseLong( p, pLineEnd, &VertexIndex ) || !Chunk.Indices.Push( VertexIndex ) ) { Chunk.bError = true; return; }
+
+                        } // Next Entry
+                        if ( Property.Role == PLY_ROLE_INDICES ) Face.IndexCount = (ULONG)Entries;
+                        continue;
+
+                    } // End if list
+
+                    // Scalar property
+                    if ( Property.Role == PLY_ROLE_NONE ) { p = SkipToken( p, pLineEnd ); continue; }
+                    if ( !ParseFloat( p, pLineEnd, &Value ) ) { Chunk.bError = true; return; }
+                    switch ( Property.Role )
+                    {
+                        case PLY_ROLE_X:     Vertex.x = Value; break;
+                        case PLY_ROLE_Y:     Vertex.y = Value; break;
+                        case PLY_ROLE_Z:     Vertex.z = Value; break;
+                        case PLY_ROLE_RED:   Color[0] = Value * Property.Scale; bColor = true; break;
+                        case PLY_ROLE_GREEN: Color[1] = Value * Property.Scale; bColor = true; break;
+                        case PLY_ROLE_BLUE:  Color[2] = Value * Property.Scale; bColor = true; break;
+                        default: break;
+
+                    } // End Switch
+
+                } // Next Property
+
+                // Store the row
+                if ( e == (ULONG)Header.VertexElement )
+                {
+                    if ( bColor ) Vertex.Diffuse = PackColor( Color[0], Color[1], Color[2] );
+                    pCtx->pVertices[ Line - pCtx->ElementFirstLine[e] ] = Vertex;
+
+                } // End if vertex
+                else if ( Face.IndexCount < 3 || Face.IndexCount > 0xFFFF )
+                    Chunk.Indices.Count = Face.FirstIndex;
+                else if ( !Chunk.Faces.Push( Face ) ) { Chunk.bError = true; return; }
+
+            } // End if imported element
+
+            p = pLineEnd + 1;
+
+        } // Next Line
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : GatherTask ()
+    // Desc : Copies the vertices of an OBJ chunk into the merged array.
+    //-------------------------------------------------------------------------
+    void GatherTask( void * pContext, ULONG Index )
+    {
+        IMPORT_CONTEXT * pCtx  = (IMPORT_CONTEXT*)pContext;
+        IMPORT_CHUNK   & Chunk = pCtx->pChunks[ Index ];
+        if ( Chunk.Vertices.Count ) memcpy( &pCtx->pVertices[ Chunk.VertexBase ], Chunk.Vertices.pData, Chunk.Vertices.Count * sizeof(CVertex) );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ResolveTask ()
+    // Desc : Converts the face indices of a chunk into zero based offsets in
+    //        the merged vertex array, validating each one.
+    //-------------------------------------------------------------------------
+    void ResolveTask( void * pContext, ULONG Index )
+    {
+        IMPORT_CONTEXT * pCtx  = (IMPORT_CONTEXT*)pContext;
+        IMPORT_CHUNK   & Chunk = pCtx->pChunks[ Index ];
+        bool             bObj  = (pCtx->Format == IMPORT_FORMAT_OBJ);
+
+        for ( ULONG f = 0; f < Chunk.Faces.Count; f++ )
+        {
+            const IMPORT_FACE & Face = Chunk.Faces.pData[f];
+            for ( ULONG i = 0; i < Face.IndexCount; i++ )
+            {
+                LONG    & Value    = Chunk.Indices.pData[ Face.FirstIndex + i ];
+                LONGLONG  Resolved = Value;
+
+                // OBJ indices are one based, or relative to the last vertex read
+                if ( bObj )
+                {
+                    if ( Value == 0 ) { Chunk.bError = true; return; }
+                    Resolved = ( Value > 0 ) ? Value - 1 : (LONGLONG)Chunk.VertexBase + Face.VertexBase + Value;
+
+                } // End if OBJ
+
+                if ( Resolved < 0 || Resolved >= (LONGLONG)pCtx->VertexCount ) { Chunk.bError = true; return; }
+                Value = (LONG)Resolved;
+
+            } // Next Index
+
+        } // Next Face
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : FillTask ()
+    // Desc : Copies the vertices of each face in a chunk into its polygon.
+    //-------------------------------------------------------------------------
+    void FillTask( void * pContext, ULONG Index )
+    {
+        IMPORT_CONTEXT * pCtx  = (IMPORT_CONTEXT*)pContext;
+        IMPORT_CHUNK   & Chunk = pCtx->pChunks[ Index ];
+
+        for ( ULONG f = 0; f < Chunk.Faces.Count; f++ )
+        {
+            const IMPORT_FACE & Face     = Chunk.Faces.pData[f];
+            const LONG        * pIndices = &Chunk.Indices.pData[ Face.FirstIndex ];
+            CVertex           * pVertex  = pCtx->pMesh->GetPolygonVertices( pCtx->FirstPolygon + Chunk.FaceBase + f, NULL );
+
+            for ( ULONG i = 0; i < Face.IndexCount; i++ ) pVertex[i] = pCtx->pVertices[ pIndices[i] ];
+
+        } // Next Face
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : GetSeconds ()
+    // Desc : Retrieves the performance counter, in seconds.
+    //-------------------------------------------------------------------------
+    double GetSeconds( )
+    {
+        LARGE_INTEGER Counter, Frequency;
+        QueryPerformanceFrequency( &Frequency );
+        QueryPerformanceCounter( &Counter );
+        return (double)Counter.QuadPart / (double)Frequency.QuadPart;
+    }
+
+}; // End Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CMeshImporter () (Constructor)
+// Desc : CMeshImporter Class Constructor
+//-----------------------------------------------------------------------------
+CMeshImporter::CMeshImporter( CThreadPool * pThreadPool )
+{
+	// Reset / Clear all required values
+    m_pThreadPool = pThreadPool;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CMeshImporter () (Destructor)
+// Desc : CMeshImporter Class Destructor
+//-----------------------------------------------------------------------------
+CMeshImporter::~CMeshImporter()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFormat () (Static)
+// Desc : Determines the format of a file from its extension.
+//-----------------------------------------------------------------------------
+IMPORT_FORMAT CMeshImporter::GetFormat( LPCTSTR strFileName )
+{
+    LPCTSTR strExtension = _tcsrchr( strFileName, _T('.') );
+    if ( !strExtension ) return IMPORT_FORMAT_UNKNOWN;
+    if ( _tcsicmp( strExtension, _T(".obj") ) == 0 ) return IMPORT_FORMAT_OBJ;
+    if ( _tcsicmp( strExtension, _T(".ply") ) == 0 ) return IMPORT_FORMAT_PLY;
+    return IMPORT_FORMAT_UNKNOWN;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Import ()
+// Desc : Imports the file specified, appending its polygons to the mesh.
+//        On failure the mesh keeps only the polygons it had before.
+// Note : The file is mapped rather than read, so no copy of the text is
+//        ever made. Each chunk's output is merged once all have completed.
+//-----------------------------------------------------------------------------
+bool CMeshImporter::Import( LPCTSTR strFileName, CMesh * pMesh, IMPORT_STATS * pStats )
+{
+    IMPORT_CONTEXT  Context;
+    PLY_HEADER      Header;
+    HANDLE          hFile = INVALID_HANDLE_VALUE, hMapping = NULL;
+    LARGE_INTEGER   FileSize;
+    ULONG           i, FaceCount = 0, IndexCount = 0, FirstPolygon = 0;
+    double          StartTime = GetSeconds(), ParseTime = 0.0;
+    bool            bResult = false, bAdded = false;
+
+    // Validate
+    ZeroMemory( &Context, sizeof(IMPORT_CONTEXT) );
+    Context.Format = GetFormat( strFileName );
+    if ( !pMesh || Context.Format == IMPORT_FORMAT_UNKNOWN ) return false;
+    Context.pMesh = pMesh;
+
+    // Map the file (limited to 4GB)
+    hFile = CreateFile( strFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    if ( hFile == INVALID_HANDLE_VALUE ) return false;
+    if ( !GetFileSizeEx( hFile, &FileSize ) || FileSize.QuadPart == 0 || FileSize.QuadPart > 0xFFFFFFFF ) goto Cleanup;
+    Context.FileSize = (ULONG)FileSize.QuadPart;
+    if (!( hMapping = CreateFileMapping( hFile, NULL, PAGE_READONLY, 0, 0, NULL ) )) goto Cleanup;
+    if (!( Context.pFile = (const char*)MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 ) )) goto Cleanup;
+
+    // Split the file into chunks and parse them
+    if ( Context.Format == IMPORT_FORMAT_OBJ )
+    {
+        if (!( Context.pChunks = SplitText( Context.pFile, Context.pFile + Context.FileSize, &Context.ChunkCount ) )) goto Cleanup;
+        RunTasks( m_pThreadPool, ObjParseTask, &Context, Context.ChunkCount );
+
+        // Merge the vertex arrays
+        for ( i = 0; i < Context.ChunkCount; i++ )
+        {
+            Context.pChunks[i].VertexBase = Context.VertexCount;
+            Context.VertexCount          += Context.pChunks[i].Vertices.Count;
+
+        } // Next Chunk
+        if ( Context.VertexCount == 0 || !(Context.pVertices = new CVertex[ Context.VertexCount ]) ) goto Cleanup;
+        RunTasks( m_pThreadPool, GatherTask, &Context, Context.ChunkCount );
+
+    } // End if OBJ
+    else
+    {
+        const char * pBody    = NULL;
+        const char * pFileEnd = Context.pFile + Context.FileSize;
+
+        // Read the header and allocate the vertex array
+        if ( !ParsePlyHeader( Context.pFile, Context.FileSize, &Header ) ) goto Cleanup;
+        Context.pPly        = &Header;
+        Context.VertexCount = Header.Elements[ Header.VertexElement ].Count;
+        if ( Context.VertexCount == 0 || !(Context.pVertices = new CVertex[ Context.VertexCount ]) ) goto Cleanup;
+        pBody = Context.pFile + Header.DataOffset;
+
+        if ( Header.bBinary )
+        {
+            // Locate each element, splitting up the vertices and faces
+            for ( ULONG e = 0; e < Header.ElementCount; e++ )
+            {
+                IMPORT_CHUNK ** ppChunks = NULL;
+                ULONG         * pCount   = NULL;
+                if ( e == (ULONG)Header.VertexElement ) { ppChunks = &Context.pVertexChunks; pCount = &Context.VertexChunkCount; }
+                if ( e == (ULONG)Header.FaceElement   ) { ppChunks = &Context.pChunks;       pCount = &Context.ChunkCount; }
+                if ( !SplitBinaryElement( Header, Header.Elements[e], pBody, pFileEnd, ppChunks, pCount, &pBody ) ) goto Cleanup;
+
+            } // Next Element
+
+            // Parse the vertex and face chunks together
+            RunTasks( m_pThreadPool, PlyBinaryTask, &Context, Context.VertexChunkCount + Context.ChunkCount );
+
+        } // End if binary
+        else
+        {
+            ULONG LineCount = 0;
+
+            // Split the body into chunks and find the first line of each
+            if (!( Context.pChunks = SplitText( pBody, pFileEnd, &Context.ChunkCount ) )) goto Cleanup;
+            RunTasks( m_pThreadPool, PlyCountLinesTask, &Context, Context.ChunkCount );
+            for ( i = 0; i < Context.ChunkCount; i++ )
+            {
+                Context.pChunks[i].FirstRow = LineCount;
+                LineCount += Context.pChunks[i].RowCount;
+
+            } // Next Chunk
+
+            // Find the first line of each element, and ensure the body is complete
+            for ( i = 0; i < Header.ElementCount; i++ )
+            {
+                Context.ElementFirstLine[i] = ( i == 0 ) ? 0 : Context.ElementFirstLine[i - 1] + Header.Elements[i - 1].Count;
+
+            } // Next Element
+            if ( Context.ElementFirstLine[ Header.ElementCount - 1 ] + Header.Elements[ Header.ElementCount - 1 ].Count > LineCount ) goto Cleanup;
+
+            RunTasks( m_pThreadPool, PlyAsciiTask, &Context, Context.ChunkCount );
+
+        } // End if ASCII
+
+    } // End if PLY
+
+    // Check for parse errors and total up the faces
+    for ( i = 0; i < Context.VertexChunkCount; i++ ) if ( Context.pVertexChunks[i].bError ) goto Cleanup;
+    for ( i = 0; i < Context.ChunkCount; i++ )
+    {
+        IMPORT_CHUNK & Chunk = Context.pChunks[i];
+        if ( Chunk.bError ) goto Cleanup;
+        Chunk.FaceBase = FaceCount;
+        FaceCount     += Chunk.Faces.Count;
+        IndexCount    += Chunk.Indices.Count;
+
+    } // Next Chunk
+    if ( FaceCount == 0 ) goto Cleanup;
+    ParseTime = GetSeconds() - StartTime;
+
+    // Resolve & validate the face indices
+    RunTasks( m_pThreadPool, ResolveTask, &Context, Context.ChunkCount );
+    for ( i = 0; i < Context.ChunkCount; i++ ) if ( Context.pChunks[i].bError ) goto Cleanup;
+
+    // Add the polygons to the mesh, claiming their runs in the vertex pool
+    if ( !pMesh->SetStorageMode( MESH_STORAGE_POOLED ) || !pMesh->ReserveVertices( IndexCount ) ) goto Cleanup;
+    FirstPolygon = pMesh->m_nPolygonCount;
+    bAdded       = true;
+    if ( pMesh->AddPolygon( FaceCount ) < 0 ) goto Cleanup;
+    Context.FirstPolygon = FirstPolygon;
+    for ( i = 0; i < Context.ChunkCount; i++ )
+    {
+        const IMPORT_CHUNK & Chunk = Context.pChunks[i];
+        for ( ULONG f = 0; f < Chunk.Faces.Count; f++ )
+        {
+            if ( pMesh->m_pPolygon[ Context.FirstPolygon + Chunk.FaceBase + f ]->AddVertex( (USHORT)Chunk.Faces.pData[f].IndexCount ) < 0 ) goto Cleanup;
+
+        } // Next Face
+
+    } // Next Chunk
+
+    // Fill in the polygon vertices
+    RunTasks( m_pThreadPool, FillTask, &Context, Context.ChunkCount );
+
+    // Fill out the statistics
+    if ( pStats )
+    {
+        pStats->Format       = Context.Format;
+        pStats->FileBytes    = Context.FileSize;
+        pStats->VertexCount  = Context.VertexCount;
+        pStats->PolygonCount = FaceCount;
+        pStats->ChunkCount   = Context.ChunkCount + Context.VertexChunkCount;
+        pStats->ThreadCount  = m_pThreadPool ? m_pThreadPool->GetThreadCount() : 1;
+        pStats->ParseSeconds = (float)ParseTime;
+        pStats->TotalSeconds = (float)(GetSeconds() - StartTime);
+        pStats->MBPerSecond  = (pStats->TotalSeconds > 0.0f) ? (float)(Context.FileSize / 1048576.0 / pStats->TotalSeconds) : 0.0f;
+
+    } // End if stats
+
+    // Success!
+    bResult = true;
+
+Cleanup:
+    // Leave the mesh as we found it if the polygons were not all built
+    if ( !bResult && bAdded ) pMesh->RemovePolygons( FirstPolygon );
+
+    if ( Context.pChunks       ) delete []Context.pChunks;
+    if ( Context.pVertexChunks ) delete []Context.pVertexChunks;
+    if ( Context.pVertices     ) delete []Context.pVertices;
+    if ( Context.pFile ) UnmapViewOfFile( Context.pFile );
+    if ( hMapping      ) CloseHandle( hMapping );
+    CloseHandle( hFile );
+    return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Benchmark () (Static)
+// Desc : Imports the file specified using a single thread and then using a
+//        thread per processor, and writes the best throughput of each to the
+//        report file specified.
+//-----------------------------------------------------------------------------
+bool CMeshImporter::Benchmark( LPCTSTR strFileName, LPCTSTR strReportFile, ULONG Iterations )
+{
+    CThreadPool  ThreadPool;
+    IMPORT_STATS Best[2];
+    FILE       * pFile = NULL;
+
+    // Start a thread per processor
+    if ( !ThreadPool.Create() ) return false;
+    if ( Iterations == 0 ) Iterations = 1;
+
+    // Single threaded baseline, then the full pool
+    for ( ULONG Pass = 0; Pass < 2; Pass++ )
+    {
+        CMeshImporter Importer( Pass == 0 ? NULL : &ThreadPool );
+        ZeroMemory( &Best[ Pass ], sizeof(IMPORT_STATS) );
+
+        for ( ULONG i = 0; i < Iterations; i++ )
+        {
+            CMesh        Mesh;
+            IMPORT_STATS Stats;
+            if ( !Importer.Import( strFileName, &Mesh, &Stats ) ) return false;
+            if ( i == 0 || Stats.TotalSeconds < Best[ Pass ].TotalSeconds ) Best[ Pass ] = Stats;
+
+        } // Next Iteration
+
+    } // Next Pass
+
+    // Write the report
+    if (!( pFile = _tfopen( strReportFile, _T("w") ) )) return false;
+    _ftprintf( pFile, _T("Import benchmark: %s\n"), strFileName );
+    _ftprintf( pFile, _T("File size   : %.2f MB\n"), Best[0].FileBytes / 1048576.0 );
+    _ftprintf( pFile, _T("Vertices    : %lu\n"), (unsigned long)Best[0].VertexCount );
+    _ftprintf( pFile, _T("Polygons    : %lu\n"), (unsigned long)Best[0].PolygonCount );
+    _ftprintf( pFile, _T("Chunks      : %lu\n"), (unsigned long)Best[0].ChunkCount );
+    _ftprintf( pFile, _T("Iterations  : %lu (best of)\n\n"), (unsigned long)Iterations );
+    _ftprintf( pFile, _T("Threads   Parse (ms)   Total (ms)       MB/s   Speedup\n") );
+    for ( ULONG Pass = 0; Pass < 2; Pass++ )
+    {
+        _ftprintf( pFile, _T("%7lu   %10.2f   %10.2f   %8.1f   %6.2fx\n"), (unsigned long)Best[ Pass ].ThreadCount,
+                   Best[ Pass ].ParseSeconds * 1000.0f, Best[ Pass ].TotalSeconds * 1000.0f, Best[ Pass ].MBPerSecond,
+                   (Best[ Pass ].TotalSeconds > 0.0f) ? Best[0].TotalSeconds / Best[ Pass ].TotalSeconds : 0.0f );
+
+    } // Next Pass
+    fclose( pFile );
+
+    // Success!
+    return true;
+}
@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+// File: CMeshImporter.h
+//
+// Desc: Parallel importer for Wavefront OBJ and ASCII / binary PLY files.
+//       Files are memory mapped, split into chunks which are parsed on every
+//       available thread, and the results merged into a pooled CMesh.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CMESHIMPORTER_H_
+#define _CMESHIMPORTER_H_
+
+//-----------------------------------------------------------------------------
+// CMeshImporter Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CObject.h"
+#include "CThreadPool.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG IMPORT_CHUNK_SIZE       = 1048576;  // Target size of each text chunk in bytes
+const ULONG IMPORT_CHUNK_ROWS       = 65536;    // Rows per chunk for binary PLY elements
+
+enum IMPORT_FORMAT
+{
+    IMPORT_FORMAT_UNKNOWN   = 0,
+    IMPORT_FORMAT_OBJ       = 1,        // Wavefront OBJ
+    IMPORT_FORMAT_PLY       = 2         // Stanford PLY (ASCII or binary)
+};
+
+//-----------------------------------------------------------------------------
+// Name : IMPORT_STATS (Struct)
+// Desc : Statistics describing a single import.
+//-----------------------------------------------------------------------------
+struct IMPORT_STATS
+{
+    IMPORT_FORMAT   Format;             // Format of the file imported
+    ULONG           FileBytes;          // Size of the file in bytes
+    ULONG           VertexCount;        // Unique vertices read from the file
+    ULONG           PolygonCount;       // Polygons added to the mesh
+    ULONG           ChunkCount;         // Number of chunks the file was split into
+    ULONG           ThreadCount;        // Number of threads used
+    float           ParseSeconds;       // Time spent parsing chunks
+    float           TotalSeconds;       // Time spent in total, including merging
+    float           MBPerSecond;        // Overall throughput
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CMeshImporter (Class)
+// Desc : Imports OBJ and PLY files into a CMesh. Imported polygons are
+//        appended to the mesh, which is switched to pooled storage.
+// Note : OBJ files may carry per vertex colours as "v x y z r g b". Only
+//        positions and colours are imported, and polygons with fewer than 3
+//        or more than 65535 vertices are skipped.
+//-----------------------------------------------------------------------------
+class CMeshImporter
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CMeshImporter( CThreadPool * pThreadPool = NULL );
+	virtual ~CMeshImporter();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Import          ( LPCTSTR strFileName, CMesh * pMesh, IMPORT_STATS * pStats = NULL );
+    void            SetThreadPool   ( CThreadPool * pThreadPool ) { m_pThreadPool = pThreadPool; }
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static IMPORT_FORMAT GetFormat  ( LPCTSTR strFileName );
+    static bool     Benchmark       ( LPCTSTR strFileName, LPCTSTR strReportFile, ULONG Iterations = 3 );
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    CThreadPool    *m_pThreadPool;      // Pool used for parsing (NULL = calling thread only)
+
+};
+
+#endif // _CMESHIMPORTER_H_
@@ -0,0 +1,472 @@
+//-----------------------------------------------------------------------------
+// File: CMeshOptimizer.cpp
+//
+// Desc: Reorders the triangles and vertices of compiled meshes for better
+//       post-transform vertex cache reuse, vertex fetch locality and reduced
+//       overdraw.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CMeshOptimizer Specific Includes
+//-----------------------------------------------------------------------------
+#include "CMeshOptimizer.h"
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------
+// Local Constants, Structures & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    // Tom Forsyth's "Linear-Speed Vertex Cache Optimisation" scoring values
+    const LONG  FORSYTH_CACHE_SIZE      = 32;       // Modelled LRU cache size
+    const float FORSYTH_CACHE_DECAY     = 1.5f;     // Cache position score falloff
+    const float FORSYTH_LAST_TRI_SCORE  = 0.75f;    // Score for the last triangle's vertices
+    const float FORSYTH_VALENCE_SCALE   = 2.0f;     // Valence boost scale
+    const float FORSYTH_VALENCE_POWER   = 0.5f;     // Valence boost falloff
+
+    //-------------------------------------------------------------------------
+    // Name : FORSYTH_VERTEX (Struct)
+    // Desc : Per vertex working data for the cache optimiser.
+    //-------------------------------------------------------------------------
+    struct FORSYTH_VERTEX
+    {
+        float   Score;              // Current vertex score
+        LONG    CachePosition;      // Position in the modelled cache (-1 = not cached)
+        ULONG   FirstTriangle;      // Offset of this vertex's triangle list
+        ULONG   ActiveCount;        // Number of triangles not yet emitted
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : CLUSTER (Struct)
+    // Desc : Run of triangles sorted as a unit by the overdraw optimiser.
+    //-------------------------------------------------------------------------
+    struct CLUSTER
+    {
+        ULONG   FirstTriangle;      // First triangle in the cluster
+        ULONG   TriangleCount;      // Number of triangles in the cluster
+        float   SortKey;            // Larger keys are drawn first
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : ScoreVertex ()
+    // Desc : Computes the Forsyth score for the specified vertex.
+    //-------------------------------------------------------------------------
+    float ScoreVertex( const FORSYTH_VERTEX & v )
+    {
+        float Score = 0.0f;
+
+        // No triangles left to use this vertex?
+        if ( v.ActiveCount == 0 ) return -1.0f;
+
+        if ( v.CachePosition >= 0 )
+        {
+            // Vertices of the last triangle get a fixed score so that we don't
+            // favour strip like orders which cost more in a real FIFO cache
+            if ( v.CachePosition < 3 )
+                Score = FORSYTH_LAST_TRI_SCORE;
+            else
+                Score = powf( 1.0f - (float)(v.CachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY );
+
+        } // End if cached
+
+        // Boost vertices with few remaining triangles to finish them off
+        Score += FORSYTH_VALENCE_SCALE * powf( (float)v.ActiveCount, -FORSYTH_VALENCE_POWER );
+        return Score;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CompareClusters ()
+    // Desc : qsort callback ordering clusters by descending sort key.
+    //-------------------------------------------------------------------------
+    int CompareClusters( const void * a, const void * b )
+    {
+        const CLUSTER * pA = (const CLUSTER*)a, * pB = (const CLUSTER*)b;
+        if ( pA->SortKey > pB->SortKey ) return -1;
+        if ( pA->SortKey < pB->SortKey ) return  1;
+        return ( pA->FirstTriangle < pB->FirstTriangle ) ? -1 : 1;
+    }
+
+}; // End Namespace
+
+//-----------------------------------------------------------------------------
+// Name : Optimize () (Static)
+// Desc : Runs the requested optimisations over the compiled mesh, in the
+//        order cache -> overdraw -> fetch, and optionally reports ACMR / ATVR
+//        before and after.
+//-----------------------------------------------------------------------------
+bool CMeshOptimizer::Optimize( CCompiledMesh * pMesh, ULONG Flags, OPTIMIZE_REPORT * pReport, ULONG CacheSize, ULONG ClusterSize )
+{
+    ULONG   *pIndices = NULL;
+    bool    *pClusterStart = NULL;
+    CVertex *pNewVertices = NULL;
+    ULONG    i, IndexCount, VertexCount, TriangleCount, ClusterCount = 0;
+    bool     bResult = false;
+
+    // Validate
+    if ( !pMesh || pMesh->GetIndexCount() == 0 || !pMesh->GetVertices() ) return false;
+    IndexCount    = pMesh->GetIndexCount();
+    VertexCount   = pMesh->GetVertexCount();
+    TriangleCount = IndexCount / 3;
+
+    // Work in 32 bit indices regardless of the stored format
+    if (!( pIndices = new ULONG[ IndexCount ] )) goto Cleanup;
+    if (!( pClusterStart = new bool[ TriangleCount ] )) goto Cleanup;
+    for ( i = 0; i < IndexCount; i++ ) pIndices[i] = pMesh->GetIndex( i );
+
+    // Without cache optimisation, every triangle may start a cluster
+    for ( i = 0; i < TriangleCount; i++ ) pClusterStart[i] = true;
+
+    // Record initial statistics
+    if ( pReport ) AnalyzeCache( pIndices, IndexCount, VertexCount, CacheSize, &pReport->Before );
+
+    // Reorder triangles for vertex cache reuse
+    if ( Flags & OPTIMIZE_VERTEXCACHE )
+    {
+        if ( !OptimizeCache( pIndices, IndexCount, VertexCount, pClusterStart ) ) goto Cleanup;
+
+    } // End if cache
+
+    // Reorder clusters of triangles to reduce overdraw
+    if ( Flags & OPTIMIZE_OVERDRAW )
+    {
+        if ( !OptimizeOverdraw( pIndices, IndexCount, pMesh->GetVertices(), pClusterStart, ClusterSize, &ClusterCount ) ) goto Cleanup;
+
+    } // End if overdraw
+
+    // Reorder vertices into first use order
+    if ( Flags & OPTIMIZE_VERTEXFETCH )
+    {
+        if (!( pNewVertices = new CVertex[ VertexCount ] )) goto Cleanup;
+        if ( !OptimizeFetch( pIndices, IndexCount, pMesh->GetVertices(), VertexCount, pNewVertices, &VertexCount ) ) goto Cleanup;
+
+    } // End if fetch
+
+    // Store the results back into the mesh
+    if ( !pMesh->SetData( pNewVertices, VertexCount, pIndices, IndexCount, pMesh->GetIndexFormat() == D3DFMT_INDEX32 ) ) goto Cleanup;
+
+    // Record final statistics
+    if ( pReport )
+    {
+        AnalyzeCache( pIndices, IndexCount, VertexCount, CacheSize, &pReport->After );
+        pReport->ClusterCount = ClusterCount;
+
+    } // End if report
+
+    // Success!
+    bResult = true;
+
+Cleanup:
+    if ( pIndices      ) delete []pIndices;
+    if ( pClusterStart ) delete []pClusterStart;
+    if ( pNewVertices  ) delete []pNewVertices;
+    return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AnalyzeCache () (Static)
+// Desc : Simulates a FIFO post-transform vertex cache of the specified size
+//        and reports the resulting ACMR and ATVR.
+//-----------------------------------------------------------------------------
+void CMeshOptimizer::AnalyzeCache( const ULONG * pIndices, ULONG IndexCount, ULONG VertexCount, ULONG CacheSize, VERTEX_CACHE_STATS * pStats )
+{
+    ULONG *pStamp = NULL, i, Misses = 0, Referenced = 0;
+
+    // Clear stats
+    ZeroMemory( pStats, sizeof(VERTEX_CACHE_STATS) );
+    if ( IndexCount == 0 || VertexCount == 0 ) return;
+    if (!( pStamp = new ULONG[ VertexCount ] )) return;
+
+    // A vertex is resident if fewer than CacheSize misses have occurred since
+    // it was inserted. Stamps are offset by CacheSize so that 0 means 'never'.
+    for ( i = 0; i < VertexCount; i++ ) pStamp[i] = 0;
+    for ( i = 0; i < IndexCount; i++ )
+    {
+        ULONG v = pIndices[i];
+        if ( pStamp[v] == 0 ) Referenced++;
+        if ( pStamp[v] == 0 || (Misses + CacheSize) - pStamp[v] >= CacheSize )
+        {
+            pStamp[v] = Misses + CacheSize;
+            Misses++;
+
+        } // End if miss
+
+    } // Next Index
+
+    // Fill out statistics
+    pStats->CacheMisses = Misses;
+    pStats->ACMR        = (float)Misses / (float)(IndexCount / 3);
+    pStats->ATVR        = (Referenced > 0) ? (float)Misses / (float)Referenced : 0.0f;
+
+    delete []pStamp;
+}
+
+//-----------------------------------------------------------------------------
+// Name : OptimizeCache () (Private, Static)
+// Desc : Reorders triangles for post-transform cache reuse using Forsyth's
+//        linear-speed algorithm. Triangles at which the greedy walk had to
+//        restart away from the cache are flagged in pClusterStart; these are
+//        natural boundaries for the overdraw pass to reorder around.
+//-----------------------------------------------------------------------------
+bool CMeshOptimizer::OptimizeCache( ULONG * pIndices, ULONG IndexCount, ULONG VertexCount, bool * pClusterStart )
+{
+    FORSYTH_VERTEX *pVertex = NULL;
+    ULONG          *pVertexTris = NULL, *pOutput = NULL;
+    bool           *pEmitted = NULL;
+    LONG            Cache[ FORSYTH_CACHE_SIZE + 3 ], NewCache[ FORSYTH_CACHE_SIZE + 3 ];
+    LONG            CacheCount = 0, BestTriangle = -1;
+    ULONG           i, j, k, TriangleCount = IndexCount / 3, Cursor = 0, Output = 0;
+    bool            bResult = false;
+
+    // Allocate working memory
+    pVertex     = new FORSYTH_VERTEX[ VertexCount ];
+    pVertexTris = new ULONG[ IndexCount ];
+    pOutput     = new ULONG[ IndexCount ];
+    pEmitted    = new bool[ TriangleCount ];
+    if ( !pVertex || !pVertexTris || !pOutput || !pEmitted ) goto Cleanup;
+
+    // Build the vertex -> triangle adjacency
+    for ( i = 0; i < VertexCount; i++ ) { pVertex[i].ActiveCount = 0; pVertex[i].CachePosition = -1; }
+    for ( i = 0; i < IndexCount; i++ ) pVertex[ pIndices[i] ].ActiveCount++;
+    for ( j = 0, i = 0; i < VertexCount; i++ ) { pVertex[i].FirstTriangle = j; j += pVertex[i].ActiveCount; pVertex[i].ActiveCount = 0; }
+    for ( i = 0; i < IndexCount; i++ )
+    {
+        FORSYTH_VERTEX & v = pVertex[ pIndices[i] ];
+        pVertexTris[ v.FirstTriangle + v.ActiveCount++ ] = i / 3;
+
+    } // Next Index
+
+    // Initial scores
+    for ( i = 0; i < VertexCount; i++ ) pVertex[i].Score = ScoreVertex( pVertex[i] );
+    for ( i = 0; i < TriangleCount; i++ ) pEmitted[i] = false;
+
+    // Emit every triangle
+    for ( Output = 0; Output < TriangleCount; Output++ )
+    {
+        // Nothing in the cache to continue from? Restart at the next unused triangle.
+        pClusterStart[ Output ] = ( BestTriangle < 0 );
+        if ( BestTriangle < 0 )
+        {
+            while ( pEmitted[ Cursor ] ) Cursor++;
+            BestTriangle = (LONG)Cursor;
+
+        } // End if restart
+
+        // Emit the triangle
+        const ULONG * pTri = &pIndices[ BestTriangle * 3 ];
+        pOutput[ Output * 3 + 0 ] = pTri[0];
+        pOutput[ Output * 3 + 1 ] = pTri[1];
+        pOutput[ Output * 3 + 2 ] = pTri[2];
+        pEmitted[ BestTriangle ] = true;
+
+        // Remove it from each vertex's active triangle list
+        for ( k = 0; k < 3; k++ )
+        {
+            FORSYTH_VERTEX & v = pVertex[ pTri[k] ];
+            ULONG * pList = &pVertexTris[ v.FirstTriangle ];
+            for ( j = 0; j < v.ActiveCount; j++ )
+            {
+                if ( pList[j] != (ULONG)BestTriangle ) continue;
+                pList[j] = pList[ v.ActiveCount - 1 ];
+                pList[ v.ActiveCount - 1 ] = BestTriangle;
+                break;
+
+            } // Next Triangle
+            v.ActiveCount--;
+
+        } // Next Vertex
+
+        // Push the triangle's vertices to the front of the modelled LRU cache
+        LONG NewCount = 0;
+        for ( k = 0; k < 3; k++ ) NewCache[ NewCount++ ] = (LONG)pTri[k];
+        for ( LONG c = 0; c < CacheCount; c++ )
+        {
+            LONG v = Cache[c];
+            if ( v == (LONG)pTri[0] || v == (LONG)pTri[1] || v == (LONG)pTri[2] ) continue;
+            NewCache[ NewCount++ ] = v;
+
+        } // Next Cache Entry
+
+        // Vertices pushed out of the cache lose their cache score
+        for ( LONG c = FORSYTH_CACHE_SIZE; c < NewCount; c++ )
+        {
+            pVertex[ NewCache[c] ].CachePosition = -1;
+            pVertex[ NewCache[c] ].Score = ScoreVertex( pVertex[ NewCache[c] ] );
+
+        } // Next Evicted Vertex
+        if ( NewCount > FORSYTH_CACHE_SIZE ) NewCount = FORSYTH_CACHE_SIZE;
+
+        // Update scores of cached vertices
+        for ( LONG c = 0; c < NewCount; c++ )
+        {
+            Cache[c] = NewCache[c];
+            pVertex[ Cache[c] ].CachePosition = c;
+            pVertex[ Cache[c] ].Score = ScoreVertex( pVertex[ Cache[c] ] );
+
+        } // Next Cache Entry
+        CacheCount = NewCount;
+
+        // Rescore the triangles touched by the cache, selecting the best
+        float BestScore = -1.0f;
+        BestTriangle = -1;
+        for ( LONG c = 0; c < CacheCount; c++ )
+        {
+            const FORSYTH_VERTEX & v = pVertex[ Cache[c] ];
+            for ( j = 0; j < v.ActiveCount; j++ )
+            {
+                ULONG t = pVertexTris[ v.FirstTriangle + j ];
+                float Score = pVertex[ pIndices[t*3] ].Score + pVertex[ pIndices[t*3+1] ].Score + pVertex[ pIndices[t*3+2] ].Score;
+                if ( Score > BestScore ) { BestScore = Score; BestTriangle = (LONG)t; }
+
+            } // Next Triangle
+
+        } // Next Cache Entry
+
+    } // Next Output Triangle
+
+    // Store the new order
+    memcpy( pIndices, pOutput, IndexCount * sizeof(ULONG) );
+    bResult = true;
+
+Cleanup:
+    if ( pVertex     ) delete []pVertex;
+    if ( pVertexTris ) delete []pVertexTris;
+    if ( pOutput     ) delete []pOutput;
+    if ( pEmitted    ) delete []pEmitted;
+    return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : OptimizeOverdraw () (Private, Static)
+// Desc : Splits the triangle list into clusters at the boundaries flagged by
+//        the cache pass (so cache efficiency is largely preserved) and sorts
+//        the clusters so that outward facing clusters far from the mesh
+//        centre, which are most likely to occlude the rest, are drawn first.
+//        This is the view independent ordering of Sander et al. (Tipsify).
+//-----------------------------------------------------------------------------
+bool CMeshOptimizer::OptimizeOverdraw( ULONG * pIndices, ULONG IndexCount, const CVertex * pVertices, bool * pClusterStart, ULONG ClusterSize, ULONG * pClusterCount )
+{
+    CLUSTER     *pCluster = NULL;
+    ULONG       *pOutput  = NULL;
+    ULONG        i, t, TriangleCount = IndexCount / 3, ClusterCount = 0;
+    D3DXVECTOR3  MeshCentre( 0.0f, 0.0f, 0.0f );
+    float        MeshArea = 0.0f;
+    bool         bResult  = false;
+
+    // Allocate working memory
+    pCluster = new CLUSTER[ TriangleCount ];
+    pOutput  = new ULONG[ IndexCount ];
+    if ( !pCluster || !pOutput ) goto Cleanup;
+
+    // Build clusters, never smaller than ClusterSize triangles
+    for ( t = 0; t < TriangleCount; t++ )
+    {
+        bool bStart = ( t == 0 ) || ( pClusterStart[t] && pCluster[ ClusterCount - 1 ].TriangleCount >= ClusterSize );
+        if ( bStart )
+        {
+            pCluster[ ClusterCount ].FirstTriangle = t;
+            pCluster[ ClusterCount ].TriangleCount = 0;
+            ClusterCount++;
+
+        } // End if new cluster
+        pCluster[ ClusterCount - 1 ].TriangleCount++;
+
+    } // Next Triangle
+
+    // Compute the area weighted centre of the whole mesh
+    for ( t = 0; t < TriangleCount; t++ )
+    {
+        D3DXVECTOR3 p0( pVertices[ pIndices[t*3  ] ].x, pVertices[ pIndices[t*3  ] ].y, pVertices[ pIndices[t*3  ] ].z );
+        D3DXVECTOR3 p1( pVertices[ pIndices[t*3+1] ].x, pVertices[ pIndices[t*3+1] ].y, pVertices[ pIndices[t*3+1] ].z );
+        D3DXVECTOR3 p2( pVertices[ pIndices[t*3+2] ].x, pVertices[ pIndices[t*3+2] ].y, pVertices[ pIndices[t*3+2] ].z );
+        D3DXVECTOR3 vecEdge1 = p1 - p0, vecEdge2 = p2 - p0, vecNormal;
+        D3DXVec3Cross( &vecNormal, &vecEdge1, &vecEdge2 );
+        float Area = D3DXVec3Length( &vecNormal ) * 0.5f;
+        MeshCentre += (p0 + p1 + p2) * (Area / 3.0f);
+        MeshArea   += Area;
+
+    } // Next Triangle
+    if ( MeshArea > 0.0f ) MeshCentre /= MeshArea;
+
+    // Compute each cluster's sort key
+    for ( i = 0; i < ClusterCount; i++ )
+    {
+        D3DXVECTOR3 Centre( 0.0f, 0.0f, 0.0f ), Normal( 0.0f, 0.0f, 0.0f );
+        float       Area = 0.0f;
+
+        for ( t = pCluster[i].FirstTriangle; t < pCluster[i].FirstTriangle + pCluster[i].TriangleCount; t++ )
+        {
+            D3DXVECTOR3 p0( pVertices[ pIndices[t*3  ] ].x, pVertices[ pIndices[t*3  ] ].y, pVertices[ pIndices[t*3  ] ].z );
+            D3DXVECTOR3 p1( pVertices[ pIndices[t*3+1] ].x, pVertices[ pIndices[t*3+1] ].y, pVertices[ pIndices[t*3+1] ].z );
+            D3DXVECTOR3 p2( pVertices[ pIndices[t*3+2] ].x, pVertices[ pIndices[t*3+2] ].y, pVertices[ pIndices[t*3+2] ].z );
+            D3DXVECTOR3 vecEdge1 = p1 - p0, vecEdge2 = p2 - p0, vecNormal;
+            D3DXVec3Cross( &vecNormal, &vecEdge1, &vecEdge2 );
+            float TriArea = D3DXVec3Length( &vecNormal ) * 0.5f;
+            Centre += (p0 + p1 + p2) * (TriArea / 3.0f);
+            Normal += vecNormal;
+            Area   += TriArea;
+
+        } // Next Triangle
+
+        // Degenerate clusters simply keep their position
+        if ( Area > 0.0f ) Centre /= Area;
+        D3DXVec3Normalize( &Normal, &Normal );
+        D3DXVECTOR3 vecOffset = Centre - MeshCentre;
+        pCluster[i].SortKey = D3DXVec3Dot( &vecOffset, &Normal );
+
+    } // Next Cluster
+
+    // Sort the clusters and rebuild the index list
+    qsort( pCluster, ClusterCount, sizeof(CLUSTER), CompareClusters );
+    for ( t = 0, i = 0; i < ClusterCount; i++ )
+    {
+        memcpy( &pOutput[ t * 3 ], &pIndices[ pCluster[i].FirstTriangle * 3 ], pCluster[i].TriangleCount * 3 * sizeof(ULONG) );
+        t += pCluster[i].TriangleCount;
+
+    } // Next Cluster
+    memcpy( pIndices, pOutput, IndexCount * sizeof(ULONG) );
+
+    // Success!
+    if ( pClusterCount ) *pClusterCount = ClusterCount;
+    bResult = true;
+
+Cleanup:
+    if ( pCluster ) delete []pCluster;
+    if ( pOutput  ) delete []pOutput;
+    return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : OptimizeFetch () (Private, Static)
+// Desc : Reorders vertices into the order in which they are first referenced
+//        by the index list, so that vertex fetches walk memory forwards.
+//        Unreferenced vertices are discarded.
+//-----------------------------------------------------------------------------
+bool CMeshOptimizer::OptimizeFetch( ULONG * pIndices, ULONG IndexCount, const CVertex * pVertices, ULONG VertexCount, CVertex * pNewVertices, ULONG * pNewVertexCount )
+{
+    ULONG *pRemap = NULL, i, NewCount = 0;
+
+    // Allocate remap table
+    if (!( pRemap = new ULONG[ VertexCount ] )) return false;
+    memset( pRemap, 0xFF, VertexCount * sizeof(ULONG) );
+
+    // Assign new indices in first use order
+    for ( i = 0; i < IndexCount; i++ )
+    {
+        ULONG v = pIndices[i];
+        if ( pRemap[v] == 0xFFFFFFFF )
+        {
+            pRemap[v] = NewCount;
+            pNewVertices[ NewCount++ ] = pVertices[v];
+
+        } // End if first use
+        pIndices[i] = pRemap[v];
+
+    } // Next Index
+
+    // Success!
+    *pNewVertexCount = NewCount;
+    delete []pRemap;
+    return true;
+}
@@ -0,0 +1,79 @@
+//-----------------------------------------------------------------------------
+// File: CMeshOptimizer.h
+//
+// Desc: Reorders the triangles and vertices of compiled meshes for better
+//       post-transform vertex cache reuse, vertex fetch locality and reduced
+//       overdraw.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CMESHOPTIMIZER_H_
+#define _CMESHOPTIMIZER_H_
+
+//-----------------------------------------------------------------------------
+// CMeshOptimizer Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CCompiledMesh.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG OPTIMIZE_VERTEXCACHE    = 0x1;      // Reorder triangles for cache reuse
+const ULONG OPTIMIZE_OVERDRAW       = 0x2;      // Reorder triangle clusters to reduce overdraw
+const ULONG OPTIMIZE_VERTEXFETCH    = 0x4;      // Reorder vertices into first use order
+const ULONG OPTIMIZE_ALL            = 0x7;
+
+const ULONG OPTIMIZE_DEFAULT_CACHE_SIZE     = 16;   // FIFO size used for ACMR / ATVR analysis
+const ULONG OPTIMIZE_DEFAULT_CLUSTER_SIZE   = 64;   // Minimum triangles per overdraw cluster
+
+//-----------------------------------------------------------------------------
+// Name : VERTEX_CACHE_STATS (Struct)
+// Desc : Results of simulating a FIFO post-transform vertex cache.
+//-----------------------------------------------------------------------------
+struct VERTEX_CACHE_STATS
+{
+    ULONG       CacheMisses;        // Number of vertices transformed
+    float       ACMR;               // Average cache miss ratio (misses per triangle)
+    float       ATVR;               // Average transform to vertex ratio (misses per vertex)
+};
+
+//-----------------------------------------------------------------------------
+// Name : OPTIMIZE_REPORT (Struct)
+// Desc : Before and after statistics reported by CMeshOptimizer::Optimize.
+//-----------------------------------------------------------------------------
+struct OPTIMIZE_REPORT
+{
+    VERTEX_CACHE_STATS  Before;     // Statistics for the original ordering
+    VERTEX_CACHE_STATS  After;      // Statistics for the optimised ordering
+    ULONG               ClusterCount;   // Number of clusters used for overdraw ordering
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CMeshOptimizer (Class)
+// Desc : Collection of mesh ordering optimisations for compiled meshes.
+//-----------------------------------------------------------------------------
+class CMeshOptimizer
+{
+public:
+	//-------------------------------------------------------------------------
+	// Public Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static bool     Optimize        ( CCompiledMesh * pMesh, ULONG Flags = OPTIMIZE_ALL, OPTIMIZE_REPORT * pReport = NULL,
+                                      ULONG CacheSize = OPTIMIZE_DEFAULT_CACHE_SIZE, ULONG ClusterSize = OPTIMIZE_DEFAULT_CLUSTER_SIZE );
+    static void     AnalyzeCache    ( const ULONG * pIndices, ULONG IndexCount, ULONG VertexCount, ULONG CacheSize, VERTEX_CACHE_STATS * pStats );
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static bool     OptimizeCache   ( ULONG * pIndices, ULONG IndexCount, ULONG VertexCount, bool * pClusterStart );
+    static bool     OptimizeOverdraw( ULONG * pIndices, ULONG IndexCount, const CVertex * pVertices, bool * pClusterStart, ULONG ClusterSize, ULONG * pClusterCount );
+    static bool     OptimizeFetch   ( ULONG * pIndices, ULONG IndexCount, const CVertex * pVertices, ULONG VertexCount, CVertex * pNewVertices, ULONG * pNewVertexCount );
+};
+
+#endif // _CMESHOPTIMIZER_H_
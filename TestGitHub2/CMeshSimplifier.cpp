@@ -0,0 +1,355 @@
+//-----------------------------------------------------------------------------
+// File: CMeshSimplifier.cpp
+//
+// Desc: Quadric error metric edge collapse simplification of compiled meshes,
+//       used to build the level of detail chain for a CMesh.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CMeshSimplifier Specific Includes
+//-----------------------------------------------------------------------------
+#include "CMeshSimplifier.h"
+#include <stdlib.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Local Structures & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : QUADRIC (Struct)
+    // Desc : Symmetric 4x4 matrix summing the squared distance to a set of
+    //        weighted planes, along with the total weight of those planes.
+    //-------------------------------------------------------------------------
+    struct QUADRIC
+    {
+        double  a2, ab, ac, ad;
+        double      b2, bc, bd;
+        double          c2, cd;
+        double              d2;
+        double  Weight;
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : COLLAPSE (Struct)
+    // Desc : Candidate edge collapse, merging vertex From onto vertex To.
+    //-------------------------------------------------------------------------
+    struct COLLAPSE
+    {
+        ULONG   From;               // Vertex removed
+        ULONG   To;                 // Vertex kept
+        float   Cost;               // Mean squared distance introduced
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : AddPlane ()
+    // Desc : Accumulates the plane ax + by + cz + d = 0 into a quadric.
+    //-------------------------------------------------------------------------
+    void AddPlane( QUADRIC & Q, double a, double b, double c, double d, double Weight )
+    {
+        Q.a2 += a * a * Weight; Q.ab += a * b * Weight; Q.ac += a * c * Weight; Q.ad += a * d * Weight;
+        Q.b2 += b * b * Weight; Q.bc += b * c * Weight; Q.bd += b * d * Weight;
+        Q.c2 += c * c * Weight; Q.cd += c * d * Weight;
+        Q.d2 += d * d * Weight;
+        Q.Weight += Weight;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : AddQuadric ()
+    // Desc : Accumulates one quadric into another.
+    //-------------------------------------------------------------------------
+    void AddQuadric( QUADRIC & Q, const QUADRIC & R )
+    {
+        Q.a2 += R.a2; Q.ab += R.ab; Q.ac += R.ac; Q.ad += R.ad;
+        Q.b2 += R.b2; Q.bc += R.bc; Q.bd += R.bd;
+        Q.c2 += R.c2; Q.cd += R.cd;
+        Q.d2 += R.d2;
+        Q.Weight += R.Weight;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : QuadricError ()
+    // Desc : Evaluates the mean squared distance from a point to the planes
+    //        summed into the two quadrics specified.
+    //-------------------------------------------------------------------------
+    double QuadricError( const QUADRIC & Q, const QUADRIC & R, const CVertex & v )
+    {
+        double x = v.x, y = v.y, z = v.z, Weight = Q.Weight + R.Weight;
+        double Error = (Q.a2 + R.a2) * x * x + (Q.b2 + R.b2) * y * y + (Q.c2 + R.c2) * z * z + (Q.d2 + R.d2) +
+                       2.0 * ( (Q.ab + R.ab) * x * y + (Q.ac + R.ac) * x * z + (Q.bc + R.bc) * y * z +
+                               (Q.ad + R.ad) * x + (Q.bd + R.bd) * y + (Q.cd + R.cd) * z );
+        return fabs( Error ) / ( Weight > 0.0 ? Weight : 1.0 );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CompareCollapse ()
+    // Desc : qsort callback ordering collapses by increasing cost.
+    //-------------------------------------------------------------------------
+    int CompareCollapse( const void * pA, const void * pB )
+    {
+        float a = ((const COLLAPSE*)pA)->Cost, b = ((const COLLAPSE*)pB)->Cost;
+        return (a < b) ? -1 : (a > b) ? 1 : 0;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : TriangleNormal ()
+    // Desc : Unnormalised normal of the triangle a, b, c.
+    //-------------------------------------------------------------------------
+    D3DXVECTOR3 TriangleNormal( const CVertex & a, const CVertex & b, const CVertex & c )
+    {
+        D3DXVECTOR3 e1( b.x - a.x, b.y - a.y, b.z - a.z ), e2( c.x - a.x, c.y - a.y, c.z - a.z );
+        return D3DXVECTOR3( e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : BuildAdjacency ()
+    // Desc : Builds the list of triangles using each vertex.
+    //-------------------------------------------------------------------------
+    void BuildAdjacency( const ULONG * pIndices, ULONG IndexCount, ULONG VertexCount, ULONG * pOffsets, ULONG * pTriangles )
+    {
+        ULONG i;
+
+        // Count the triangles using each vertex and convert to offsets
+        ZeroMemory( pOffsets, (VertexCount + 1) * sizeof(ULONG) );
+        for ( i = 0; i < IndexCount; i++ ) pOffsets[ pIndices[i] + 1 ]++;
+        for ( i = 0; i < VertexCount; i++ ) pOffsets[ i + 1 ] += pOffsets[i];
+
+        // Fill in the lists, then step the offsets back to the list starts
+        for ( i = 0; i < IndexCount; i++ ) pTriangles[ pOffsets[ pIndices[i] ]++ ] = i / 3;
+        for ( i = VertexCount; i > 0; i-- ) pOffsets[i] = pOffsets[i - 1];
+        pOffsets[0] = 0;
+    }
+
+}; // End Namespace
+
+//-----------------------------------------------------------------------------
+// Name : Simplify () (Static)
+// Desc : Builds a simplified copy of the source mesh with no more than the
+//        specified number of triangles, unless doing so would introduce an
+//        error greater than fMaxError (in object space units).
+// Note : Collapses are made in passes, each of which sorts every edge by cost
+//        and greedily collapses those whose neighbourhood is untouched so far
+//        in the pass. pResultError receives the largest error introduced.
+//-----------------------------------------------------------------------------
+bool CMeshSimplifier::Simplify( const CCompiledMesh * pSource, CCompiledMesh * pDest, ULONG TargetTriangles, float fMaxError, float * pResultError )
+{
+    CVertex     *pDecoded = NULL, *pNewVertices = NULL;
+    ULONG       *pIndices = NULL, *pOffsets = NULL, *pTriangles = NULL, *pStamp = NULL, *pNewIndex = NULL;
+    QUADRIC     *pQuadrics = NULL;
+    COLLAPSE    *pCollapses = NULL;
+    bool        *pLocked = NULL, bResult = false;
+    const CVertex * pVertices = NULL;
+    ULONG        i, j, k, Pass, IndexCount, VertexCount, NewVertexCount = 0, Stamp = 0;
+    double       MaxCost = (double)fMaxError * fMaxError, ResultCost = 0.0;
+
+    // Validate
+    if ( !pSource || !pDest || pSource == pDest || pSource->GetIndexCount() == 0 ) return false;
+    IndexCount  = pSource->GetIndexCount();
+    VertexCount = pSource->GetVertexCount();
+
+    // Compact meshes have to be expanded first
+    pVertices = pSource->GetVertices();
+    if ( !pVertices )
+    {
+        if (!( pDecoded = new CVertex[ VertexCount ] )) goto Cleanup;
+        if ( !pSource->DecodeVertices( pDecoded ) ) goto Cleanup;
+        pVertices = pDecoded;
+
+    } // End if compact
+
+    // Allocate working data
+    if (!( pIndices   = new ULONG[ IndexCount ] )) goto Cleanup;
+    if (!( pTriangles = new ULONG[ IndexCount ] )) goto Cleanup;
+    if (!( pOffsets   = new ULONG[ VertexCount + 1 ] )) goto Cleanup;
+    if (!( pStamp     = new ULONG[ VertexCount ] )) goto Cleanup;
+    if (!( pNewIndex  = new ULONG[ VertexCount ] )) goto Cleanup;
+    if (!( pQuadrics  = new QUADRIC[ VertexCount ] )) goto Cleanup;
+    if (!( pCollapses = new COLLAPSE[ IndexCount ] )) goto Cleanup;
+    if (!( pLocked    = new bool[ VertexCount ] )) goto Cleanup;
+    for ( i = 0; i < IndexCount; i++ ) pIndices[i] = pSource->GetIndex( i );
+    ZeroMemory( pQuadrics, VertexCount * sizeof(QUADRIC) );
+    ZeroMemory( pStamp, VertexCount * sizeof(ULONG) );
+
+    // Accumulate the area weighted plane of every triangle into its vertices
+    for ( i = 0; i < IndexCount; i += 3 )
+    {
+        const CVertex & a = pVertices[ pIndices[i] ];
+        D3DXVECTOR3     Normal = TriangleNormal( a, pVertices[ pIndices[i + 1] ], pVertices[ pIndices[i + 2] ] );
+        double          Length = sqrt( (double)Normal.x * Normal.x + (double)Normal.y * Normal.y + (double)Normal.z * Normal.z );
+        if ( Length <= 0.0 ) continue;
+
+        double nx = Normal.x / Length, ny = Normal.y / Length, nz = Normal.z / Length;
+        double d  = -(nx * a.x + ny * a.y + nz * a.z);
+        for ( k = 0; k < 3; k++ ) AddPlane( pQuadrics[ pIndices[i + k] ], nx, ny, nz, d, Length * 0.5 );
+
+    } // Next Triangle
+
+    // Hold open edges in place with a plane through the edge, perpendicular to its triangle
+    BuildAdjacency( pIndices, IndexCount, VertexCount, pOffsets, pTriangles );
+    for ( i = 0; i < IndexCount; i++ )
+    {
+        ULONG a = pIndices[i], b = pIndices[ (i % 3 == 2) ? i - 2 : i + 1 ];
+        bool  bOpen = true;
+
+        // The edge is shared if a triangle of b has the opposing edge b -> a
+        for ( j = pOffsets[b]; j < pOffsets[b + 1] && bOpen; j++ )
+        {
+            const ULONG * t = &pIndices[ pTriangles[j] * 3 ];
+            if ( (t[0] == b && t[1] == a) || (t[1] == b && t[2] == a) || (t[2] == b && t[0] == a) ) bOpen = false;
+
+        } // Next Triangle
+        if ( !bOpen ) continue;
+
+        // Build the boundary plane
+        ULONG         Base   = i - i % 3;
+        D3DXVECTOR3   Normal = TriangleNormal( pVertices[ pIndices[Base] ], pVertices[ pIndices[Base + 1] ], pVertices[ pIndices[Base + 2] ] );
+        const CVertex &va = pVertices[a], &vb = pVertices[b];
+        double ex = vb.x - va.x, ey = vb.y - va.y, ez = vb.z - va.z;
+        double px = ey * Normal.z - ez * Normal.y, py = ez * Normal.x - ex * Normal.z, pz = ex * Normal.y - ey * Normal.x;
+        double Length = sqrt( px * px + py * py + pz * pz );
+        if ( Length <= 0.0 ) continue;
+
+        px /= Length; py /= Length; pz /= Length;
+        double d = -(px * va.x + py * va.y + pz * va.z), Weight = (ex * ex + ey * ey + ez * ez) * SIMPLIFY_BOUNDARY_WEIGHT;
+        AddPlane( pQuadrics[a], px, py, pz, d, Weight );
+        AddPlane( pQuadrics[b], px, py, pz, d, Weight );
+
+    } // Next Edge
+
+    // Collapse edges in passes until we reach the target
+    for ( Pass = 0; Pass < SIMPLIFY_MAX_PASSES && IndexCount / 3 > TargetTriangles; Pass++ )
+    {
+        ULONG CollapseCount = 0, Removed = 0, Required = IndexCount / 3 - TargetTriangles, Collapsed = 0;
+
+        // Cost every edge, in the cheaper of its two directions (shared edges
+        // are listed twice, but the second is rejected once the first is applied)
+        BuildAdjacency( pIndices, IndexCount, VertexCount, pOffsets, pTriangles );
+        for ( i = 0; i < IndexCount; i++ )
+        {
+            ULONG  a = pIndices[i], b = pIndices[ (i % 3 == 2) ? i - 2 : i + 1 ];
+            double CostA = QuadricError( pQuadrics[a], pQuadrics[b], pVertices[b] );
+            double CostB = QuadricError( pQuadrics[a], pQuadrics[b], pVertices[a] );
+
+            COLLAPSE & Collapse = pCollapses[ CollapseCount++ ];
+            Collapse.From = (CostA <= CostB) ? a : b;
+            Collapse.To   = (CostA <= CostB) ? b : a;
+            Collapse.Cost = (float)((CostA <= CostB) ? CostA : CostB);
+
+        } // Next Edge
+        qsort( pCollapses, CollapseCount, sizeof(COLLAPSE), CompareCollapse );
+        ZeroMemory( pLocked, VertexCount * sizeof(bool) );
+
+        // Apply the cheapest collapses whose neighbourhood is untouched
+        for ( i = 0; i < CollapseCount && Removed < Required; i++ )
+        {
+            const COLLAPSE & Collapse = pCollapses[i];
+            ULONG From = Collapse.From, To = Collapse.To, Shared = 0, Common = 0;
+            bool  bValid = true;
+
+            if ( Collapse.Cost > MaxCost ) break;
+            if ( pLocked[From] || pLocked[To] ) continue;
+
+            // Count the triangles on the edge, marking the neighbours of From
+            Stamp++;
+            for ( j = pOffsets[From]; j < pOffsets[From + 1]; j++ )
+            {
+                const ULONG * t = &pIndices[ pTriangles[j] * 3 ];
+                if ( t[0] == To || t[1] == To || t[2] == To ) Shared++;
+                for ( k = 0; k < 3; k++ ) pStamp[ t[k] ] = Stamp;
+
+            } // Next Triangle
+
+            // The only neighbours From and To may share are those opposite the edge,
+            // otherwise the collapse would pinch the surface
+            for ( j = pOffsets[To]; j < pOffsets[To + 1]; j++ )
+            {
+                const ULONG * t = &pIndices[ pTriangles[j] * 3 ];
+                for ( k = 0; k < 3; k++ )
+                {
+                    if ( t[k] == From || t[k] == To || pStamp[ t[k] ] != Stamp ) continue;
+                    pStamp[ t[k] ] = Stamp - 1;
+                    Common++;
+
+                } // Next Vertex
+
+            } // Next Triangle
+            if ( Shared == 0 || Common != Shared ) continue;
+
+            // Reject collapses that would flip a triangle
+            for ( j = pOffsets[From]; j < pOffsets[From + 1] && bValid; j++ )
+            {
+                const ULONG * t = &pIndices[ pTriangles[j] * 3 ];
+                if ( t[0] == To || t[1] == To || t[2] == To ) continue;
+
+                D3DXVECTOR3 Before = TriangleNormal( pVertices[t[0]], pVertices[t[1]], pVertices[t[2]] );
+                D3DXVECTOR3 After  = TriangleNormal( pVertices[ t[0] == From ? To : t[0] ], pVertices[ t[1] == From ? To : t[1] ],
+                                                     pVertices[ t[2] == From ? To : t[2] ] );
+                if ( D3DXVec3Dot( &Before, &After ) <= 0.0f ) bValid = false;
+
+            } // Next Triangle
+            if ( !bValid ) continue;
+
+            // Collapse the edge, locking the neighbourhood for the rest of this pass
+            for ( j = pOffsets[From]; j < pOffsets[From + 1]; j++ )
+            {
+                ULONG * t = &pIndices[ pTriangles[j] * 3 ];
+                for ( k = 0; k < 3; k++ ) { pLocked[ t[k] ] = true; if ( t[k] == From ) t[k] = To; }
+
+            } // Next Triangle
+            AddQuadric( pQuadrics[To], pQuadrics[From] );
+            if ( Collapse.Cost > ResultCost ) ResultCost = Collapse.Cost;
+            Removed += Shared;
+            Collapsed++;
+
+        } // Next Collapse
+
+        // Remove the triangles which have collapsed
+        for ( i = 0, j = 0; i < IndexCount; i += 3 )
+        {
+            ULONG a = pIndices[i], b = pIndices[i + 1], c = pIndices[i + 2];
+            if ( a == b || b == c || c == a ) continue;
+            pIndices[j++] = a; pIndices[j++] = b; pIndices[j++] = c;
+
+        } // Next Triangle
+        IndexCount = j;
+
+        // Stop once nothing more can be collapsed within the error bound
+        if ( Collapsed == 0 ) break;
+
+    } // Next Pass
+    if ( IndexCount == 0 ) goto Cleanup;
+
+    // Gather the vertices still in use
+    for ( i = 0; i < VertexCount; i++ ) pNewIndex[i] = 0xFFFFFFFF;
+    if (!( pNewVertices = new CVertex[ VertexCount ] )) goto Cleanup;
+    for ( i = 0; i < IndexCount; i++ )
+    {
+        ULONG v = pIndices[i];
+        if ( pNewIndex[v] == 0xFFFFFFFF ) { pNewIndex[v] = NewVertexCount; pNewVertices[ NewVertexCount++ ] = pVertices[v]; }
+        pIndices[i] = pNewIndex[v];
+
+    } // Next Index
+
+    // Store the result
+    if ( !pDest->SetData( pNewVertices, NewVertexCount, pIndices, IndexCount ) ) goto Cleanup;
+    if ( pResultError ) *pResultError = (float)sqrt( ResultCost );
+
+    // Success!
+    bResult = true;
+
+Cleanup:
+    if ( pDecoded     ) delete []pDecoded;
+    if ( pNewVertices ) delete []pNewVertices;
+    if ( pIndices     ) delete []pIndices;
+    if ( pOffsets     ) delete []pOffsets;
+    if ( pTriangles   ) delete []pTriangles;
+    if ( pStamp       ) delete []pStamp;
+    if ( pNewIndex    ) delete []pNewIndex;
+    if ( pQuadrics    ) delete []pQuadrics;
+    if ( pCollapses   ) delete []pCollapses;
+    if ( pLocked      ) delete []pLocked;
+    return bResult;
+}
@@ -0,0 +1,49 @@
+//-----------------------------------------------------------------------------
+// File: CMeshSimplifier.h
+//
+// Desc: Quadric error metric edge collapse simplification of compiled meshes,
+//       used to build the level of detail chain for a CMesh.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CMESHSIMPLIFIER_H_
+#define _CMESHSIMPLIFIER_H_
+
+//-----------------------------------------------------------------------------
+// CMeshSimplifier Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CCompiledMesh.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const float SIMPLIFY_BOUNDARY_WEIGHT    = 10.0f;    // Weight of planes which hold open edges in place
+const ULONG SIMPLIFY_MAX_PASSES         = 64;       // Largest number of collapse passes per simplification
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CMeshSimplifier (Class)
+// Desc : Reduces the triangle count of compiled meshes by repeatedly
+//        collapsing the edge whose removal least disturbs the surface, as
+//        measured by the accumulated plane quadrics of its end points
+//        (Garland & Heckbert, "Surface Simplification Using Quadric Error
+//        Metrics").
+// Note : Vertices are only ever collapsed onto one another, never moved, so
+//        colours are preserved. Welded vertices that differ only in colour
+//        form open edges, which are held in place by boundary planes.
+//-----------------------------------------------------------------------------
+class CMeshSimplifier
+{
+public:
+	//-------------------------------------------------------------------------
+	// Public Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static bool     Simplify        ( const CCompiledMesh * pSource, CCompiledMesh * pDest, ULONG TargetTriangles,
+                                      float fMaxError, float * pResultError = NULL );
+};
+
+#endif // _CMESHSIMPLIFIER_H_
@@ -10,6 +10,15 @@
 // CObject Specific Includes
 //-----------------------------------------------------------------------------
 #include "CObject.h"
+#include "CCompiledMesh.h"
+#include "CMeshOptimizer.h"
+#include "CMeshSimplifier.h"
+#include <new>
+
+//-----------------------------------------------------------------------------
+// Static Member Definitions
+//-----------------------------------------------------------------------------
+volatile LONG   CMesh::m_nNextId    = 0;
 
 //-----------------------------------------------------------------------------
 // Name : CObject () (Constructor)
@@ -19,7 +28,11 @@ CObject::CObject()
 {
 	// Reset / Clear all required values
     m_pMesh = NULL;
+    m_nLOD  = 0;
+    m_bInterpolate = false;
     D3DXMatrixIdentity( &m_mtxWorld );
+    D3DXMatrixIdentity( &m_mtxPrevWorld );
+    UpdateBounds();
 }
 
 //-----------------------------------------------------------------------------
@@ -30,9 +43,143 @@ CObject::CObject( CMesh * pMesh )
 {
 	// Reset / Clear all required values
     D3DXMatrixIdentity( &m_mtxWorld );
+    D3DXMatrixIdentity( &m_mtxPrevWorld );
+    m_bInterpolate = false;
 
     // Set Mesh
     m_pMesh = pMesh;
+    m_nLOD  = 0;
+    UpdateBounds();
+}
+
+//-----------------------------------------------------------------------------
+// Name : UpdateBounds ()
+// Desc : Derives our world space bounding box and sphere from the bounds of
+//        our mesh and the current world matrix.
+// Note : Must be called whenever the world matrix changes.
+//-----------------------------------------------------------------------------
+void CObject::UpdateBounds( )
+{
+    D3DXVECTOR3 vecCentre( 0.0f, 0.0f, 0.0f ), vecExtents( 0.0f, 0.0f, 0.0f );
+    float       fScale = 0.0f, fRadius = 0.0f;
+
+    // Local space bounds
+    if ( m_pMesh )
+    {
+        vecCentre  = (m_pMesh->GetBoundsMin() + m_pMesh->GetBoundsMax()) * 0.5f;
+        vecExtents = (m_pMesh->GetBoundsMax() - m_pMesh->GetBoundsMin()) * 0.5f;
+        fRadius    = m_pMesh->GetBoundsRadius();
+
+    } // End if mesh
+
+    // Transform the box centre, and enclose the rotated box (Arvo)
+    D3DXVec3TransformCoord( &m_vecBoundsCentre, &vecCentre, &m_mtxWorld );
+    for ( ULONG i = 0; i < 3; i++ )
+    {
+        float fAxis = m_mtxWorld.m[i][0] * m_mtxWorld.m[i][0] + m_mtxWorld.m[i][1] * m_mtxWorld.m[i][1] + m_mtxWorld.m[i][2] * m_mtxWorld.m[i][2];
+        if ( fAxis > fScale ) fScale = fAxis;
+
+    } // Next Axis
+    m_vecBoundsExtents.x = fabsf( m_mtxWorld._11 ) * vecExtents.x + fabsf( m_mtxWorld._21 ) * vecExtents.y + fabsf( m_mtxWorld._31 ) * vecExtents.z;
+    m_vecBoundsExtents.y = fabsf( m_mtxWorld._12 ) * vecExtents.x + fabsf( m_mtxWorld._22 ) * vecExtents.y + fabsf( m_mtxWorld._32 ) * vecExtents.z;
+    m_vecBoundsExtents.z = fabsf( m_mtxWorld._13 ) * vecExtents.x + fabsf( m_mtxWorld._23 ) * vecExtents.y + fabsf( m_mtxWorld._33 ) * vecExtents.z;
+
+    // The sphere scales by the largest axis scale
+    m_fBoundsRadius = fRadius * sqrtf( fScale );
+}
+
+//-----------------------------------------------------------------------------
+// Name : SaveTransform ()
+// Desc : Remembers the world matrix before a simulation step moves us, so
+//        that frames drawn between steps can be blended from it.
+// Note : Objects which are never moved need not call this, and are drawn
+//        with their world matrix as it stands.
+//-----------------------------------------------------------------------------
+void CObject::SaveTransform( )
+{
+    m_mtxPrevWorld = m_mtxWorld;
+    m_bInterpolate = true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetRenderTransform ()
+// Desc : Retrieves the world matrix to draw with, fAlpha of the way from the
+//        previous simulation step to the latest.
+//-----------------------------------------------------------------------------
+void CObject::GetRenderTransform( D3DXMATRIX * pOut, float fAlpha ) const
+{
+    if ( m_bInterpolate ) InterpolateTransform( pOut, m_mtxPrevWorld, m_mtxWorld, fAlpha );
+    else *pOut = m_mtxWorld;
+}
+
+//-----------------------------------------------------------------------------
+// Name : InterpolateTransform () (Static)
+// Desc : Blends between two transforms, spherically for the rotation and
+//        linearly for the scale & translation.
+// Note : Returns mtxTo unchanged for an alpha of 1 or more, or when the two
+//        are identical, so that anything not moving is drawn exactly.
+//-----------------------------------------------------------------------------
+void CObject::InterpolateTransform( D3DXMATRIX * pOut, const D3DXMATRIX & mtxFrom, const D3DXMATRIX & mtxTo, float fAlpha )
+{
+    D3DXVECTOR3    vecScaleFrom, vecScaleTo, vecScale, vecPosFrom, vecPosTo, vecPos;
+    D3DXQUATERNION qFrom, qTo, qRotation;
+
+    // Nothing to blend ?
+    if ( fAlpha >= 1.0f || memcmp( &mtxFrom, &mtxTo, sizeof(D3DXMATRIX) ) == 0 ) { *pOut = mtxTo; return; }
+    if ( fAlpha <= 0.0f ) { *pOut = mtxFrom; return; }
+
+    // Split both into scale, rotation & translation (fails if either is degenerate)
+    if ( FAILED( D3DXMatrixDecompose( &vecScaleFrom, &qFrom, &vecPosFrom, &mtxFrom ) ) ||
+         FAILED( D3DXMatrixDecompose( &vecScaleTo, &qTo, &vecPosTo, &mtxTo ) ) ) { *pOut = mtxTo; return; }
+
+    // Blend each, and rebuild the matrix
+    D3DXQuaternionSlerp( &qRotation, &qFrom, &qTo, fAlpha );
+    D3DXVec3Lerp( &vecScale, &vecScaleFrom, &vecScaleTo, fAlpha );
+    D3DXVec3Lerp( &vecPos, &vecPosFrom, &vecPosTo, fAlpha );
+    D3DXMatrixRotationQuaternion( pOut, &qRotation );
+
+    pOut->_11 *= vecScale.x; pOut->_12 *= vecScale.x; pOut->_13 *= vecScale.x;
+    pOut->_21 *= vecScale.y; pOut->_22 *= vecScale.y; pOut->_23 *= vecScale.y;
+    pOut->_31 *= vecScale.z; pOut->_32 *= vecScale.z; pOut->_33 *= vecScale.z;
+    pOut->_41  = vecPos.x;   pOut->_42  = vecPos.y;   pOut->_43  = vecPos.z;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SelectLOD ()
+// Desc : Selects the coarsest detail level of our mesh whose simplification
+//        error, projected to the screen at the nearest point of the mesh
+//        bounding sphere, is no more than fPixelError pixels.
+// Note : fProjScale converts view space size at unit depth into pixels, i.e.
+//        half the viewport height multiplied by the projection matrix _22.
+//        Relies on the world space bounds maintained by UpdateBounds.
+//-----------------------------------------------------------------------------
+ULONG CObject::SelectLOD( const D3DXMATRIX & mtxView, float fProjScale, float fPixelError )
+{
+    D3DXVECTOR3 vecCentre;
+    float       fScale, fDepth;
+
+    // Full detail unless we have a choice
+    m_nLOD = 0;
+    if ( !m_pMesh || m_pMesh->GetLODCount() <= 1 ) return m_nLOD;
+
+    // World space scale of our mesh, from our bounding sphere
+    fScale = (m_pMesh->GetBoundsRadius() > 0.0f) ? m_fBoundsRadius / m_pMesh->GetBoundsRadius() : 1.0f;
+
+    // Find the view space depth of the nearest point of the bounding sphere
+    D3DXVec3TransformCoord( &vecCentre, &m_vecBoundsCentre, &mtxView );
+    fDepth = vecCentre.z - m_fBoundsRadius;
+
+    // Spheres which reach the eye plane are always drawn in full detail
+    if ( fDepth <= 0.0f ) return m_nLOD;
+
+    // Select the coarsest acceptable level
+    for ( ULONG i = m_pMesh->GetLODCount() - 1; i > 0; i-- )
+    {
+        if ( m_pMesh->GetLODError( i ) * fScale * fProjScale / fDepth <= fPixelError ) { m_nLOD = i; break; }
+
+    } // Next Level
+
+    return m_nLOD;
 }
 
 //-----------------------------------------------------------------------------
@@ -42,8 +189,23 @@ CObject::CObject( CMesh * pMesh )
 CMesh::CMesh()
 {
 	// Reset / Clear all required values
+    m_nId           = (ULONG)InterlockedIncrement( &m_nNextId ) - 1;
     m_nPolygonCount = 0;
+    m_nPolygonCapacity = 0;
     m_pPolygon      = NULL;
+    m_Storage       = MESH_STORAGE_POLYGON;
+    m_pVertexPool   = NULL;
+    m_nPoolCount    = 0;
+    m_nPoolCapacity = 0;
+    m_nPoolSlack    = 0;
+    m_pPolyRange    = NULL;
+    m_pCompiled     = NULL;
+    m_bBorrowed     = false;
+    m_nLODCount     = 0;
+    m_fBoundsRadius = 0.0f;
+    m_vecBoundsMin  = m_vecBoundsMax = m_vecBoundsCentre = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+    ZeroMemory( m_pLOD, sizeof(m_pLOD) );
+    ZeroMemory( m_fLODError, sizeof(m_fLODError) );
 
 }
 
@@ -54,8 +216,23 @@ CMesh::CMesh()
 CMesh::CMesh( ULONG Count )
 {
 	// Reset / Clear all required values
+    m_nId           = (ULONG)InterlockedIncrement( &m_nNextId ) - 1;
     m_nPolygonCount = 0;
+    m_nPolygonCapacity = 0;
     m_pPolygon      = NULL;
+    m_Storage       = MESH_STORAGE_POLYGON;
+    m_pVertexPool   = NULL;
+    m_nPoolCount    = 0;
+    m_nPoolCapacity = 0;
+    m_nPoolSlack    = 0;
+    m_pPolyRange    = NULL;
+    m_pCompiled     = NULL;
+    m_bBorrowed     = false;
+    m_nLODCount     = 0;
+    m_fBoundsRadius = 0.0f;
+    m_vecBoundsMin  = m_vecBoundsMax = m_vecBoundsCentre = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+    ZeroMemory( m_pLOD, sizeof(m_pLOD) );
+    ZeroMemory( m_fLODError, sizeof(m_fLODError) );
 
     // Add Polygons
     AddPolygon( Count );
@@ -68,23 +245,35 @@ CMesh::CMesh( ULONG Count )
 CMesh::~CMesh()
 {
 	// Release our mesh components
-    if ( m_pPolygon ) 
-    {
-        // Delete all individual polygons in the array.
-        for ( ULONG i = 0; i < m_nPolygonCount; i++ )
-        {
-            if ( m_pPolygon[i] ) delete m_pPolygon[i];
-        
-        } // Next Polygon
+    Clear();
+}
 
-        // Free up the array itself
-        delete []m_pPolygon;
-    
-    } // End if
+//-----------------------------------------------------------------------------
+// Name : Clear() (Private)
+// Desc : Releases all mesh data, leaving an empty mesh in the current mode.
+//-----------------------------------------------------------------------------
+void CMesh::Clear( )
+{
+	// Polygons live in the arena and own none of their own memory, so there
+    // is no need to visit them individually.
+    m_Arena.Release();
+
+    // Release the polygon array, the vertex pool & table (unless borrowed) and compiled data
+    if ( m_pPolygon ) delete []m_pPolygon;
+    if ( m_pVertexPool && !m_bBorrowed ) delete []m_pVertexPool;
+    if ( m_pPolyRange  && !m_bBorrowed ) delete []m_pPolyRange;
+    ReleaseCompiled();
 
     // Clear variables
     m_pPolygon      = NULL;
     m_nPolygonCount = 0;
+    m_nPolygonCapacity = 0;
+    m_pVertexPool   = NULL;
+    m_pPolyRange    = NULL;
+    m_nPoolCount    = 0;
+    m_nPoolCapacity = 0;
+    m_nPoolSlack    = 0;
+    m_bBorrowed     = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -94,34 +283,42 @@ CMesh::~CMesh()
 //-----------------------------------------------------------------------------
 long CMesh::AddPolygon( ULONG Count )
 {
+    UCHAR     * pPolyBlock  = NULL;
 
-    CPolygon ** pPolyBuffer = NULL;
+    // Attached meshes must take their own copy first
+    if ( !Unborrow() ) return -1;
     
-    // Allocate new resized array
-    if (!( pPolyBuffer = new CPolygon*[ m_nPolygonCount + Count ] )) return -1;
+    // Make room in the pointer array (and table)
+    if ( !ReservePolygons( m_nPolygonCount + Count ) ) return -1;
 
     // Clear out slack pointers
-    ZeroMemory( &pPolyBuffer[ m_nPolygonCount ], Count * sizeof( CPolygon* ) );
+    ZeroMemory( &m_pPolygon[ m_nPolygonCount ], Count * sizeof( CPolygon* ) );
 
-    // Existing Data?
-    if ( m_pPolygon )
+    // Pooled meshes also maintain the compact polygon table
+    if ( m_Storage == MESH_STORAGE_POOLED )
     {
-        // Copy old data into new buffer
-        memcpy( pPolyBuffer, m_pPolygon, m_nPolygonCount * sizeof( CPolygon* ) );
+        // Empty ranges start at the current end of the pool
+        for ( UINT i = 0; i < Count; i++ )
+        {
+            m_pPolyRange[ m_nPolygonCount + i ].FirstVertex = m_nPoolCount;
+            m_pPolyRange[ m_nPolygonCount + i ].VertexCount = 0;
+        
+        } // Next Range
 
-        // Release old buffer
-        delete []m_pPolygon;
+    } // End if pooled
 
-    } // End if
-    
-    // Store pointer for new buffer
-    m_pPolygon = pPolyBuffer;
+    // Allocate the new polygon headers as one contiguous block
+    if (!( pPolyBlock = (UCHAR*)m_Arena.Alloc( Count * sizeof(CPolygon) ) )) return -1;
 
-    // Allocate new polygon pointers
+    // Construct new polygons
     for ( UINT i = 0; i < Count; i++ )
     {
-        // Allocate new poly
-        if (!( m_pPolygon[ m_nPolygonCount ] = new CPolygon() )) return -1;
+        // Construct new poly in place
+        m_pPolygon[ m_nPolygonCount ] = new ( pPolyBlock + i * sizeof(CPolygon) ) CPolygon();
+
+        // Record ownership so that vertex growth can be routed to us
+        m_pPolygon[ m_nPolygonCount ]->m_pMesh  = this;
+        m_pPolygon[ m_nPolygonCount ]->m_nIndex = m_nPolygonCount;
 
         // Increase overall poly count
         m_nPolygonCount++;
@@ -132,6 +329,732 @@ long CMesh::AddPolygon( ULONG Count )
     return m_nPolygonCount - Count;
 }
 
+//-----------------------------------------------------------------------------
+// Name : ReservePolygons() (Private)
+// Desc : Ensures the polygon pointer array (and the polygon table, when
+//        pooled) can hold at least the number of entries specified.
+// Note : These arrays are resized as the mesh grows, so they are kept on the
+//        heap rather than in the arena, where each resize would otherwise
+//        leave the old copy behind.
+//-----------------------------------------------------------------------------
+bool CMesh::ReservePolygons( ULONG Count )
+{
+    CPolygon     ** pPolyBuffer  = NULL;
+    POLYGON_RANGE * pRangeBuffer = NULL;
+    ULONG           NewCapacity  = m_nPolygonCapacity;
+
+    // Already large enough?
+    if ( Count <= m_nPolygonCapacity ) return true;
+
+    // Grow by half again until we fit
+    if ( NewCapacity < 16 ) NewCapacity = 16;
+    while ( NewCapacity < Count ) NewCapacity += NewCapacity / 2;
+
+    // Allocate new arrays
+    if (!( pPolyBuffer = new CPolygon*[ NewCapacity ] )) return false;
+    if ( m_Storage == MESH_STORAGE_POOLED && !(pRangeBuffer = new POLYGON_RANGE[ NewCapacity ]) ) { delete []pPolyBuffer; return false; }
+
+    // Copy old data over and release the old arrays
+    if ( m_pPolygon )
+    {
+        memcpy( pPolyBuffer, m_pPolygon, m_nPolygonCount * sizeof(CPolygon*) );
+        delete []m_pPolygon;
+
+    } // End if pointers
+    if ( m_pPolyRange && pRangeBuffer )
+    {
+        memcpy( pRangeBuffer, m_pPolyRange, m_nPolygonCount * sizeof(POLYGON_RANGE) );
+        delete []m_pPolyRange;
+
+    } // End if table
+
+    // Store new arrays
+    m_pPolygon         = pPolyBuffer;
+    if ( pRangeBuffer ) m_pPolyRange = pRangeBuffer;
+    m_nPolygonCapacity = NewCapacity;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RemovePolygons()
+// Desc : Removes the polygons from FirstPolygon onwards, i.e. undoes the most
+//        recent calls to AddPolygon.
+// Note : Their headers stay in the arena until the mesh is cleared. Pool
+//        runs at the end of the pool are given back, any others become
+//        slack (see Compact).
+//-----------------------------------------------------------------------------
+void CMesh::RemovePolygons( ULONG FirstPolygon )
+{
+    // Anything to remove?
+    if ( FirstPolygon >= m_nPolygonCount ) return;
+
+    if ( m_Storage == MESH_STORAGE_POOLED && !m_bBorrowed )
+    {
+        ULONG LowVertex = m_nPoolCount, nVertexCount = 0;
+
+        // Find the span of the runs being removed
+        for ( ULONG i = FirstPolygon; i < m_nPolygonCount; i++ )
+        {
+            const POLYGON_RANGE & Range = m_pPolyRange[i];
+            if ( Range.VertexCount == 0 ) continue;
+            if ( Range.FirstVertex < LowVertex ) LowVertex = Range.FirstVertex;
+            nVertexCount += Range.VertexCount;
+
+        } // Next Polygon
+
+        // Runs never overlap, so if they fill the span they end the pool
+        if ( LowVertex + nVertexCount == m_nPoolCount )
+            m_nPoolCount = LowVertex;
+        else
+            m_nPoolSlack += nVertexCount;
+
+    } // End if pooled
+
+    m_nPolygonCount = FirstPolygon;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReserveVertices()
+// Desc : Ensures the vertex pool has room for the specified number of further
+//        vertices, so that bulk loads do not repeatedly grow the pool.
+// Note : Has no effect on meshes using per polygon storage.
+//-----------------------------------------------------------------------------
+bool CMesh::ReserveVertices( ULONG Count )
+{
+    // Attached meshes must take their own copy first
+    if ( !Unborrow() ) return false;
+
+    // Only the pool can be reserved in advance
+    if ( m_Storage != MESH_STORAGE_POOLED ) return true;
+    return ReservePool( m_nPoolCount + Count );
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetStorageMode()
+// Desc : Switches this mesh between per-polygon vertex arrays and a single
+//        flat vertex pool. Any existing vertex data is migrated.
+//-----------------------------------------------------------------------------
+bool CMesh::SetStorageMode( MESH_STORAGE Mode )
+{
+    ULONG i, nVertexCount = 0;
+
+    // Nothing to do?
+    if ( Mode == m_Storage ) return true;
+
+    // Attached meshes must take their own copy first
+    if ( !Unborrow() ) return false;
+
+    if ( Mode == MESH_STORAGE_POOLED )
+    {
+        CVertex       * pPool  = NULL;
+        POLYGON_RANGE * pRange = NULL;
+
+        // Count up the total number of vertices we need to store
+        for ( i = 0; i < m_nPolygonCount; i++ ) nVertexCount += m_pPolygon[i]->m_nVertexCount;
+
+        // Allocate the pool and polygon table
+        if ( nVertexCount > 0 && !(pPool = new CVertex[ nVertexCount ]) ) return false;
+        if ( m_nPolygonCapacity > 0 && !(pRange = new POLYGON_RANGE[ m_nPolygonCapacity ]) ) { delete []pPool; return false; }
+
+        // Gather each polygons vertices, in order, into the pool
+        for ( nVertexCount = 0, i = 0; i < m_nPolygonCount; i++ )
+        {
+            CPolygon * pPolygon = m_pPolygon[i];
+            pRange[i].FirstVertex = nVertexCount;
+            pRange[i].VertexCount = pPolygon->m_nVertexCount;
+
+            // Old arrays remain in the arena until the mesh is released
+            if ( pPolygon->m_pVertex ) memcpy( &pPool[ nVertexCount ], pPolygon->m_pVertex, pPolygon->m_nVertexCount * sizeof(CVertex) );
+            pPolygon->m_pVertex = NULL;
+
+            nVertexCount += pPolygon->m_nVertexCount;
+
+        } // Next Polygon
+
+        // Store the new pool
+        m_pVertexPool   = pPool;
+        m_pPolyRange    = pRange;
+        m_nPoolCount    = nVertexCount;
+        m_nPoolCapacity = nVertexCount;
+        m_nPoolSlack    = 0;
+        m_Storage       = MESH_STORAGE_POOLED;
+
+        // Point each polygon at its run in the pool
+        BindPolygons();
+
+    } // End if to pooled
+    else
+    {
+        // Give each polygon its own copy of its vertex data
+        for ( i = 0; i < m_nPolygonCount; i++ )
+        {
+            CPolygon * pPolygon = m_pPolygon[i];
+            CVertex  * pVertex  = NULL;
+
+            if ( pPolygon->m_nVertexCount > 0 )
+            {
+                if (!( pVertex = (CVertex*)m_Arena.Alloc( pPolygon->m_nVertexCount * sizeof(CVertex) ) )) return false;
+                memcpy( pVertex, &m_pVertexPool[ m_pPolyRange[i].FirstVertex ], pPolygon->m_nVertexCount * sizeof(CVertex) );
+            
+            } // End if has vertices
+
+            pPolygon->m_pVertex = pVertex;
+
+        } // Next Polygon
+
+        // Release the pool and table
+        if ( m_pVertexPool ) delete []m_pVertexPool;
+        if ( m_pPolyRange  ) delete []m_pPolyRange;
+        m_pVertexPool   = NULL;
+        m_pPolyRange    = NULL;
+        m_nPoolCount    = 0;
+        m_nPoolCapacity = 0;
+        m_nPoolSlack    = 0;
+        m_Storage       = MESH_STORAGE_POLYGON;
+
+    } // End if to polygon
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Compact()
+// Desc : Removes any slack from the vertex pool and ensures that polygon
+//        vertex runs are stored in polygon order, so that walking the
+//        polygon table touches the pool strictly front to back.
+// Note : Should be called once a pooled mesh has been fully built.
+//-----------------------------------------------------------------------------
+bool CMesh::Compact( )
+{
+    CVertex * pPool = NULL;
+    ULONG     i, nVertexCount = 0;
+    bool      bOrdered = true;
+
+    // Only applies to pooled meshes
+    if ( m_Storage != MESH_STORAGE_POOLED ) return true;
+
+    // Are the runs already packed in polygon order?
+    for ( i = 0; i < m_nPolygonCount; i++ )
+    {
+        if ( m_pPolyRange[i].VertexCount > 0 && m_pPolyRange[i].FirstVertex != nVertexCount ) { bOrdered = false; break; }
+        nVertexCount += m_pPolyRange[i].VertexCount;
+    
+    } // Next Polygon
+
+    // Nothing to do if ordered and free of slack
+    if ( bOrdered && m_nPoolSlack == 0 && m_nPoolCapacity == m_nPoolCount ) return true;
+
+    // Attached meshes must take their own copy first
+    if ( !Unborrow() ) return false;
+
+    // Count total live vertices
+    for ( nVertexCount = 0, i = 0; i < m_nPolygonCount; i++ ) nVertexCount += m_pPolyRange[i].VertexCount;
+
+    // Allocate exact sized pool
+    if ( nVertexCount > 0 && !(pPool = new CVertex[ nVertexCount ]) ) return false;
+
+    // Copy each run over in polygon order
+    for ( nVertexCount = 0, i = 0; i < m_nPolygonCount; i++ )
+    {
+        POLYGON_RANGE & Range = m_pPolyRange[i];
+        if ( Range.VertexCount > 0 ) memcpy( &pPool[ nVertexCount ], &m_pVertexPool[ Range.FirstVertex ], Range.VertexCount * sizeof(CVertex) );
+        Range.FirstVertex = nVertexCount;
+        nVertexCount     += Range.VertexCount;
+
+    } // Next Polygon
+
+    // Swap in the new pool
+    if ( m_pVertexPool ) delete []m_pVertexPool;
+    m_pVertexPool   = pPool;
+    m_nPoolCount    = nVertexCount;
+    m_nPoolCapacity = nVertexCount;
+    m_nPoolSlack    = 0;
+
+    // Repoint polygons
+    BindPolygons();
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPolygonVertices()
+// Desc : Retrieves the vertex array for the specified polygon regardless of
+//        the storage mode currently in use.
+//-----------------------------------------------------------------------------
+CVertex * CMesh::GetPolygonVertices( ULONG Polygon, ULONG * pVertexCount ) const
+{
+    // Pooled meshes resolve through the polygon table
+    if ( m_Storage == MESH_STORAGE_POOLED )
+    {
+        if ( pVertexCount ) *pVertexCount = m_pPolyRange[ Polygon ].VertexCount;
+        return &m_pVertexPool[ m_pPolyRange[ Polygon ].FirstVertex ];
+    
+    } // End if pooled
+
+    // Otherwise use the polygon directly
+    if ( pVertexCount ) *pVertexCount = m_pPolygon[ Polygon ]->m_nVertexCount;
+    return m_pPolygon[ Polygon ]->m_pVertex;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Compile()
+// Desc : Builds the indexed triangle list form of this mesh, welding shared
+//        vertices, so that the whole mesh can be drawn with a single call.
+// Note : Must be called again if the polygon data is subsequently altered.
+//-----------------------------------------------------------------------------
+bool CMesh::Compile( float fWeldEpsilon, bool bForce32Bit )
+{
+    // Any existing detail levels are now out of date
+    ReleaseLODs();
+
+    // Allocate the compiled mesh if required
+    if ( !m_pCompiled && !(m_pCompiled = new CCompiledMesh) ) return false;
+
+    // Compile it
+    if ( !m_pCompiled->Compile( this, fWeldEpsilon, bForce32Bit ) )
+    {
+        ReleaseCompiled();
+        return false;
+    
+    } // End if failed
+
+    // Calculate the bounds of the compiled data
+    return CalculateBounds();
+}
+
+//-----------------------------------------------------------------------------
+// Name : OptimizeCompiled()
+// Desc : Runs the mesh optimiser over the compiled form of this mesh. See
+//        CMeshOptimizer::Optimize for the available flags.
+//-----------------------------------------------------------------------------
+bool CMesh::OptimizeCompiled( ULONG Flags, OPTIMIZE_REPORT * pReport )
+{
+    // Must have been compiled first
+    if ( !m_pCompiled ) return false;
+    return CMeshOptimizer::Optimize( m_pCompiled, Flags, pReport );
+}
+
+//-----------------------------------------------------------------------------
+// Name : QuantizeCompiled()
+// Desc : Builds the compact vertex copy of the compiled form of this mesh.
+// Note : Must follow OptimizeCompiled, which requires the float vertices.
+//-----------------------------------------------------------------------------
+bool CMesh::QuantizeCompiled( QUANTIZE_REPORT * pReport, bool bDiscardSource )
+{
+    // Must have been compiled first
+    if ( !m_pCompiled ) return false;
+    return m_pCompiled->Quantize( pReport, bDiscardSource );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReleaseCompiled()
+// Desc : Discards the compiled form of this mesh.
+//-----------------------------------------------------------------------------
+void CMesh::ReleaseCompiled( )
+{
+    // Detail levels are derived from the compiled mesh
+    ReleaseLODs();
+
+    if ( m_pCompiled ) delete m_pCompiled;
+    m_pCompiled = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GenerateLODs()
+// Desc : Builds a chain of up to LevelCount detail levels (including the
+//        compiled mesh itself as level 0), each with roughly fReduction times
+//        the triangles of the level before.
+// Note : Every level is simplified from level 0, so that its recorded error
+//        is measured against the original surface. Level n may introduce an
+//        error of up to fMaxError * 2^(n-1) times the bounding radius. The
+//        chain stops early once a level can no longer be reduced usefully.
+//-----------------------------------------------------------------------------
+bool CMesh::GenerateLODs( ULONG LevelCount, float fReduction, float fMaxError )
+{
+    ULONG           i, Previous;
+
+    // Must have been compiled first
+    if ( !m_pCompiled || m_pCompiled->GetIndexCount() == 0 ) return false;
+    if ( fReduction <= 0.0f || fReduction >= 1.0f ) return false;
+    if ( LevelCount > MESH_MAX_LODS ) LevelCount = MESH_MAX_LODS;
+    ReleaseLODs();
+
+    // Build each level in turn
+    for ( Previous = m_pCompiled->GetTriangleCount(), i = 1; i < LevelCount; i++ )
+    {
+        CCompiledMesh * pLOD   = NULL;
+        ULONG           Target = (ULONG)(Previous * fReduction);
+        float           fError = 0.0f, fBound = fMaxError * m_fBoundsRadius * (float)(1 << (i - 1));
+        if ( Target == 0 ) break;
+
+        // Simplify the full detail mesh
+        if (!( pLOD = new CCompiledMesh )) return false;
+        if ( !CMeshSimplifier::Simplify( m_pCompiled, pLOD, Target, fBound, &fError ) ) { delete pLOD; return false; }
+
+        // Stop if we did not get at least half way to the target
+        if ( pLOD->GetTriangleCount() > (Previous + Target) / 2 ) { delete pLOD; break; }
+
+        // Match the format of the full detail mesh
+        if ( !CMeshOptimizer::Optimize( pLOD, OPTIMIZE_ALL ) ) { delete pLOD; return false; }
+        if ( m_pCompiled->IsQuantized() && !pLOD->Quantize( NULL, m_pCompiled->GetVertices() == NULL ) ) { delete pLOD; return false; }
+
+        // Store the level, keeping errors increasing so selection can stop at the first fit
+        m_pLOD[ m_nLODCount ]      = pLOD;
+        m_fLODError[ m_nLODCount ] = fError;
+        if ( m_nLODCount > 0 && m_fLODError[ m_nLODCount - 1 ] > fError ) m_fLODError[ m_nLODCount ] = m_fLODError[ m_nLODCount - 1 ];
+        m_nLODCount++;
+        Previous = pLOD->GetTriangleCount();
+
+    } // Next Level
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReleaseLODs()
+// Desc : Discards the simplified detail levels of this mesh.
+//-----------------------------------------------------------------------------
+void CMesh::ReleaseLODs( )
+{
+    for ( ULONG i = 0; i < m_nLODCount; i++ ) delete m_pLOD[i];
+    ZeroMemory( m_pLOD, sizeof(m_pLOD) );
+    ZeroMemory( m_fLODError, sizeof(m_fLODError) );
+    m_nLODCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CalculateBounds()
+// Desc : Calculates the local space bounding box of this mesh, and a bounding
+//        sphere about the centre of that box. The compiled form is used when
+//        available, otherwise the polygon data.
+//-----------------------------------------------------------------------------
+bool CMesh::CalculateBounds( )
+{
+    CVertex       * pDecoded  = NULL;
+    const CVertex * pVertices = NULL;
+    ULONG           i, j, Count = 0, RunCount = 1;
+    bool            bEmpty = true;
+
+    // Reset the bounds
+    m_vecBoundsMin = m_vecBoundsMax = m_vecBoundsCentre = D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
+    m_fBoundsRadius = 0.0f;
+
+    // Compact compiled meshes must be expanded first
+    if ( m_pCompiled && m_pCompiled->GetVertexCount() > 0 && !m_pCompiled->GetVertices() )
+    {
+        if (!( pDecoded = new CVertex[ m_pCompiled->GetVertexCount() ] )) return false;
+        m_pCompiled->DecodeVertices( pDecoded );
+
+    } // End if compact
+
+    // Two passes over every vertex run; the box, then the sphere radius
+    if ( !m_pCompiled ) RunCount = m_nPolygonCount;
+    for ( ULONG Pass = 0; Pass < 2; Pass++ )
+    {
+        for ( i = 0; i < RunCount; i++ )
+        {
+            // Select the next run of vertices
+            if ( m_pCompiled )
+            {
+                pVertices = pDecoded ? pDecoded : m_pCompiled->GetVertices();
+                Count     = m_pCompiled->GetVertexCount();
+
+            } // End if compiled
+            else pVertices = GetPolygonVertices( i, &Count );
+
+            for ( j = 0; j < Count; j++ )
+            {
+                D3DXVECTOR3 vecPos( pVertices[j].x, pVertices[j].y, pVertices[j].z );
+                if ( Pass == 0 )
+                {
+                    if ( bEmpty ) { m_vecBoundsMin = m_vecBoundsMax = vecPos; bEmpty = false; }
+                    D3DXVec3Minimize( &m_vecBoundsMin, &m_vecBoundsMin, &vecPos );
+                    D3DXVec3Maximize( &m_vecBoundsMax, &m_vecBoundsMax, &vecPos );
+
+                } // End if box
+                else
+                {
+                    D3DXVECTOR3 vecOffset = vecPos - m_vecBoundsCentre;
+                    float       fDistance = D3DXVec3Length( &vecOffset );
+                    if ( fDistance > m_fBoundsRadius ) m_fBoundsRadius = fDistance;
+
+                } // End if sphere
+
+            } // Next Vertex
+
+        } // Next Run
+
+        // The sphere is centred on the box
+        m_vecBoundsCentre = (m_vecBoundsMin + m_vecBoundsMax) * 0.5f;
+
+    } // Next Pass
+
+    // Success!
+    if ( pDecoded ) delete []pDecoded;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetLOD()
+// Desc : Retrieves the specified detail level, where level 0 is the compiled
+//        mesh itself. Levels beyond the end of the chain return the coarsest.
+//-----------------------------------------------------------------------------
+const CCompiledMesh * CMesh::GetLOD( ULONG Level ) const
+{
+    if ( Level == 0 || m_nLODCount == 0 ) return m_pCompiled;
+    return m_pLOD[ (Level < m_nLODCount ? Level : m_nLODCount) - 1 ];
+}
+
+//-----------------------------------------------------------------------------
+// Name : Attach()
+// Desc : Releases the current contents of this mesh and attaches it, without
+//        copying, to the pooled vertex data and polygon table specified.
+// Note : The data must remain valid until the mesh is released, modified or
+//        re-attached, and is trusted to be valid (see CMeshFile::Open).
+//-----------------------------------------------------------------------------
+bool CMesh::Attach( CVertex * pVertices, ULONG VertexCount, POLYGON_RANGE * pRanges, ULONG PolygonCount )
+{
+    // Validate
+    if ( (VertexCount > 0 && !pVertices) || (PolygonCount > 0 && !pRanges) ) return false;
+
+    // Release our existing data
+    Clear();
+
+    // Reference the external data directly
+    m_Storage       = MESH_STORAGE_POOLED;
+    m_pVertexPool   = pVertices;
+    m_nPoolCount    = VertexCount;
+    m_nPoolCapacity = VertexCount;
+    m_pPolyRange    = pRanges;
+    m_nPolygonCount = PolygonCount;
+    m_bBorrowed     = true;
+
+    // Calculate the bounds of the attached data
+    return CalculateBounds();
+}
+
+//-----------------------------------------------------------------------------
+// Name : AttachCompiled()
+// Desc : Attaches the compiled form of this mesh, without copying, to the
+//        triangle list data specified. See CCompiledMesh::Attach.
+//-----------------------------------------------------------------------------
+bool CMesh::AttachCompiled( CVertex * pVertices, ULONG VertexCount, void * pIndices, ULONG IndexCount, D3DFORMAT IndexFormat )
+{
+    // Allocate the compiled mesh if required
+    ReleaseLODs();
+    if ( !m_pCompiled && !(m_pCompiled = new CCompiledMesh) ) return false;
+    if ( !m_pCompiled->Attach( pVertices, VertexCount, pIndices, IndexCount, IndexFormat ) ) return false;
+    return CalculateBounds();
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBytesReserved()
+// Desc : Returns the number of bytes of heap memory held by this mesh.
+//-----------------------------------------------------------------------------
+ULONG CMesh::GetBytesReserved( ) const
+{
+    if ( m_bBorrowed ) return m_Arena.GetBytesReserved();
+    return m_Arena.GetBytesReserved() + m_nPoolCapacity * sizeof(CVertex) +
+           m_nPolygonCapacity * (sizeof(CPolygon*) + (m_pPolyRange ? sizeof(POLYGON_RANGE) : 0));
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBytesUsed()
+// Desc : Returns the number of bytes actually handed out to mesh components.
+// Note : Excludes arena blocks abandoned by growth and pool slack.
+//-----------------------------------------------------------------------------
+ULONG CMesh::GetBytesUsed( ) const
+{
+    if ( m_bBorrowed ) return m_Arena.GetBytesUsed();
+    return m_Arena.GetBytesUsed() + (m_nPoolCount - m_nPoolSlack) * sizeof(CVertex) +
+           m_nPolygonCount * (sizeof(CPolygon*) + (m_pPolyRange ? sizeof(POLYGON_RANGE) : 0));
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddArenaVertices() (Private)
+// Desc : Grows the vertex array of the specified polygon within the arena.
+// Note : Growth happens in place if no other allocation has been made since
+//        the array was last resized, as is the case for typical builders.
+//-----------------------------------------------------------------------------
+long CMesh::AddArenaVertices( ULONG Polygon, USHORT Count )
+{
+    CPolygon * pPolygon      = m_pPolygon[ Polygon ];
+    CVertex  * pVertexBuffer = NULL;
+    USHORT     OldCount      = pPolygon->m_nVertexCount;
+
+    // Resize the array
+    if (!( pVertexBuffer = (CVertex*)m_Arena.Grow( pPolygon->m_pVertex, OldCount * sizeof(CVertex), 
+                                                   (OldCount + Count) * sizeof(CVertex) ) )) return -1;
+
+    // Construct the new vertices
+    for ( USHORT i = 0; i < Count; i++ ) new ( &pVertexBuffer[ OldCount + i ] ) CVertex();
+
+    // Store pointer for new buffer
+    pPolygon->m_pVertex       = pVertexBuffer;
+    pPolygon->m_nVertexCount += Count;
+
+    // Return first vertex
+    return OldCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddPoolVertices() (Private)
+// Desc : Grows the vertex run for the specified polygon within the pool.
+// Note : If the polygon is not the last run in the pool, its run is moved
+//        to the end and the space it vacated becomes slack (see Compact).
+//-----------------------------------------------------------------------------
+long CMesh::AddPoolVertices( ULONG Polygon, USHORT Count )
+{
+    POLYGON_RANGE * pRange   = &m_pPolyRange[ Polygon ];
+    bool            bAtEnd   = false;
+    ULONG           Required = Count;
+
+    // Empty runs can simply be restarted at the end of the pool
+    if ( pRange->VertexCount == 0 ) pRange->FirstVertex = m_nPoolCount;
+    bAtEnd = ( pRange->FirstVertex + pRange->VertexCount == m_nPoolCount );
+    if ( !bAtEnd ) Required += pRange->VertexCount;
+
+    // Make sure we have enough room (may move the pool)
+    if ( !ReservePool( m_nPoolCount + Required ) ) return -1;
+
+    // Relocate this run to the end of the pool if required
+    if ( !bAtEnd )
+    {
+        memcpy( &m_pVertexPool[ m_nPoolCount ], &m_pVertexPool[ pRange->FirstVertex ], pRange->VertexCount * sizeof(CVertex) );
+        m_nPoolSlack      += pRange->VertexCount;
+        pRange->FirstVertex = m_nPoolCount;
+        m_nPoolCount      += pRange->VertexCount;
+
+    } // End if relocate
+
+    // Reset the newly claimed vertices
+    for ( USHORT i = 0; i < Count; i++ ) m_pVertexPool[ m_nPoolCount + i ] = CVertex();
+    m_nPoolCount        += Count;
+    pRange->VertexCount += Count;
+
+    // Update the polygon itself
+    CPolygon * pPolygon = m_pPolygon[ Polygon ];
+    pPolygon->m_pVertex      = &m_pVertexPool[ pRange->FirstVertex ];
+    pPolygon->m_nVertexCount = (USHORT)pRange->VertexCount;
+
+    // Return first vertex
+    return pRange->VertexCount - Count;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReservePool() (Private)
+// Desc : Ensures the vertex pool can hold at least the number of entries
+//        specified, growing geometrically to amortise the cost of the copy.
+//-----------------------------------------------------------------------------
+bool CMesh::ReservePool( ULONG Count )
+{
+    CVertex * pPool       = NULL;
+    ULONG     NewCapacity = m_nPoolCapacity;
+
+    // Already large enough?
+    if ( Count <= m_nPoolCapacity ) return true;
+
+    // Grow by half again until we fit
+    if ( NewCapacity < 64 ) NewCapacity = 64;
+    while ( NewCapacity < Count ) NewCapacity += NewCapacity / 2;
+
+    // Allocate new pool
+    if (!( pPool = new CVertex[ NewCapacity ] )) return false;
+
+    // Existing Data?
+    if ( m_pVertexPool )
+    {
+        // Copy old data into new buffer
+        memcpy( pPool, m_pVertexPool, m_nPoolCount * sizeof(CVertex) );
+
+        // Release old buffer
+        delete []m_pVertexPool;
+
+    } // End if
+
+    // Store new pool and repoint polygons
+    m_pVertexPool   = pPool;
+    m_nPoolCapacity = NewCapacity;
+    BindPolygons();
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BindPolygons() (Private)
+// Desc : Points each polygon's vertex array at its run within the pool.
+//-----------------------------------------------------------------------------
+void CMesh::BindPolygons( )
+{
+    for ( ULONG i = 0; i < m_nPolygonCount; i++ )
+    {
+        CPolygon * pPolygon = m_pPolygon[i];
+        if ( !pPolygon ) continue;
+        pPolygon->m_pVertex      = (m_pPolyRange[i].VertexCount > 0) ? &m_pVertexPool[ m_pPolyRange[i].FirstVertex ] : NULL;
+        pPolygon->m_nVertexCount = (USHORT)m_pPolyRange[i].VertexCount;
+
+    } // Next Polygon
+}
+
+//-----------------------------------------------------------------------------
+// Name : Unborrow() (Private)
+// Desc : Replaces attached pool data with mesh owned copies, and builds the
+//        polygon headers which attached meshes do without.
+//-----------------------------------------------------------------------------
+bool CMesh::Unborrow( )
+{
+    CVertex        * pPool       = NULL;
+    POLYGON_RANGE  * pRange      = NULL;
+    CPolygon      ** pPolyBuffer = NULL;
+    UCHAR          * pPolyBlock  = NULL;
+
+    // Already own our data?
+    if ( !m_bBorrowed ) return true;
+
+    // Allocate the pool, table and polygon headers
+    if ( m_nPoolCount > 0 && !(pPool = new CVertex[ m_nPoolCount ]) ) return false;
+    if ( m_nPolygonCount > 0 )
+    {
+        if (!( pRange      = new POLYGON_RANGE[ m_nPolygonCount ] )) { delete []pPool; return false; }
+        if (!( pPolyBuffer = new CPolygon*[ m_nPolygonCount ] )) { delete []pPool; delete []pRange; return false; }
+        if (!( pPolyBlock  = (UCHAR*)m_Arena.Alloc( m_nPolygonCount * sizeof(CPolygon) ) )) { delete []pPool; delete []pRange; delete []pPolyBuffer; return false; }
+
+    } // End if any polygons
+
+    // Copy the attached data
+    if ( pPool  ) memcpy( pPool, m_pVertexPool, m_nPoolCount * sizeof(CVertex) );
+    if ( pRange ) memcpy( pRange, m_pPolyRange, m_nPolygonCount * sizeof(POLYGON_RANGE) );
+
+    // Construct the polygon headers
+    for ( ULONG i = 0; i < m_nPolygonCount; i++ )
+    {
+        pPolyBuffer[i] = new ( pPolyBlock + i * sizeof(CPolygon) ) CPolygon();
+        pPolyBuffer[i]->m_pMesh  = this;
+        pPolyBuffer[i]->m_nIndex = i;
+
+    } // Next Polygon
+
+    // Store our own copies
+    m_pVertexPool   = pPool;
+    m_nPoolCapacity = m_nPoolCount;
+    m_pPolyRange    = pRange;
+    m_pPolygon      = pPolyBuffer;
+    m_nPolygonCapacity = m_nPolygonCount;
+    m_bBorrowed     = false;
+
+    // Point each polygon at its run in the pool
+    BindPolygons();
+
+    // Success!
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // Name : CPolygon () (Constructor)
 // Desc : CPolygon Class Constructor
@@ -141,6 +1064,8 @@ CPolygon::CPolygon()
 	// Reset / Clear all required values
     m_nVertexCount  = 0;
     m_pVertex       = NULL;
+    m_pMesh         = NULL;
+    m_nIndex        = 0;
 
 }
 
@@ -153,6 +1078,8 @@ CPolygon::CPolygon( USHORT Count )
 	// Reset / Clear all required values
     m_nVertexCount  = 0;
     m_pVertex       = NULL;
+    m_pMesh         = NULL;
+    m_nIndex        = 0;
 
     // Add vertices
     AddVertex( Count );
@@ -164,8 +1091,8 @@ CPolygon::CPolygon( USHORT Count )
 //-----------------------------------------------------------------------------
 CPolygon::~CPolygon()
 {
-	// Release our vertices
-    if ( m_pVertex ) delete []m_pVertex;
+	// Release our vertices (mesh owned polygons are backed by the mesh)
+    if ( m_pVertex && !m_pMesh ) delete []m_pVertex;
     
     // Clear variables
     m_pVertex       = NULL;
@@ -180,6 +1107,14 @@ CPolygon::~CPolygon()
 long CPolygon::AddVertex( USHORT Count )
 {
     CVertex * pVertexBuffer = NULL;
+
+    // Mesh owned polygons store their vertices in the mesh pool or arena
+    if ( m_pMesh )
+    {
+        if ( m_pMesh->GetStorageMode() == MESH_STORAGE_POOLED ) return m_pMesh->AddPoolVertices( m_nIndex, Count );
+        return m_pMesh->AddArenaVertices( m_nIndex, Count );
+    
+    } // End if owned by mesh
     
     // Allocate new resized array
     if (!( pVertexBuffer = new CVertex[ m_nVertexCount + Count ] )) return -1;
@@ -13,6 +13,40 @@
 // CObject Specific Includes
 //-----------------------------------------------------------------------------
 #include "Main.h"
+#include "CMemoryArena.h"
+
+//-----------------------------------------------------------------------------
+// Forward Declarations
+//-----------------------------------------------------------------------------
+class CMesh;
+class CCompiledMesh;
+struct OPTIMIZE_REPORT;
+struct QUANTIZE_REPORT;
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+enum MESH_STORAGE
+{
+    MESH_STORAGE_POLYGON    = 0,        // Each polygon owns its own vertex array
+    MESH_STORAGE_POOLED     = 1         // All vertices live in one mesh owned pool
+};
+
+const ULONG MESH_MAX_LODS           = 8;        // Largest number of detail levels per mesh (inc. level 0)
+const float MESH_LOD_REDUCTION      = 0.5f;     // Default triangle ratio between detail levels
+const float MESH_LOD_MAX_ERROR      = 0.02f;    // Default level 1 error bound (fraction of bounding radius)
+const float MESH_LOD_PIXEL_ERROR    = 1.0f;     // Default screen space error allowed when selecting
+
+//-----------------------------------------------------------------------------
+// Name : POLYGON_RANGE (Struct)
+// Desc : Compact polygon table entry used by pooled meshes. Describes the
+//        run of vertices in the mesh vertex pool used by a single polygon.
+//-----------------------------------------------------------------------------
+struct POLYGON_RANGE
+{
+    ULONG       FirstVertex;            // Offset of the first vertex in the pool
+    ULONG       VertexCount;            // Number of vertices in this polygon
+};
 
 //-----------------------------------------------------------------------------
 // Main Class Declarations
@@ -67,12 +101,26 @@ public:
 	//-------------------------------------------------------------------------
     USHORT      m_nVertexCount;         // Number of vertices stored.
     CVertex    *m_pVertex;              // Simple vertex array
+    CMesh      *m_pMesh;                // Mesh that owns this polygon (if any)
+    ULONG       m_nIndex;               // Index of this polygon within its mesh
 
 };
 
 //-----------------------------------------------------------------------------
 // Name : CMesh (Class)
 // Desc : Basic mesh class used to store individual mesh data.
+// Note : Polygons and per-polygon vertex arrays are allocated from a mesh
+//        owned arena and are released together when the mesh is destroyed.
+//        The polygon pointer array & table, which are resized as the mesh
+//        grows, are kept on the heap.
+//        Meshes may also be attached to externally owned pool data (such as a
+//        mapped mesh file). Attached meshes have no CPolygon headers (m_pPolygon
+//        is NULL), so use GetPolygonVertices or the polygon table to read them.
+//        Any modification first takes a private copy of the attached data.
+//        Bounds are calculated by Compile and Attach; call CalculateBounds
+//        after altering the polygons of a mesh which is not recompiled.
+//        Each mesh is numbered in the order created, giving it an id which,
+//        unlike its address, is the same from one run to the next.
 //-----------------------------------------------------------------------------
 class CMesh
 {
@@ -88,6 +136,38 @@ public:
 	// Public Functions for This Class
 	//-------------------------------------------------------------------------
     long        AddPolygon( ULONG Count = 1 );
+    void        RemovePolygons( ULONG FirstPolygon );
+    bool        SetStorageMode( MESH_STORAGE Mode );
+    bool        ReserveVertices( ULONG Count );
+    bool        Compact( );
+    CVertex   * GetPolygonVertices( ULONG Polygon, ULONG * pVertexCount ) const;
+    bool        Compile( float fWeldEpsilon = 0.0f, bool bForce32Bit = false );
+    bool        OptimizeCompiled( ULONG Flags, OPTIMIZE_REPORT * pReport = NULL );
+    bool        QuantizeCompiled( QUANTIZE_REPORT * pReport = NULL, bool bDiscardSource = false );
+    void        ReleaseCompiled( );
+    bool        GenerateLODs( ULONG LevelCount, float fReduction = MESH_LOD_REDUCTION, float fMaxError = MESH_LOD_MAX_ERROR );
+    void        ReleaseLODs( );
+    bool        CalculateBounds( );
+    bool        Attach( CVertex * pVertices, ULONG VertexCount, POLYGON_RANGE * pRanges, ULONG PolygonCount );
+    bool        AttachCompiled( CVertex * pVertices, ULONG VertexCount, void * pIndices, ULONG IndexCount, D3DFORMAT IndexFormat );
+
+    ULONG                   GetBytesReserved  ( ) const;
+    ULONG                   GetBytesUsed      ( ) const;
+
+    ULONG                   GetId             ( ) const { return m_nId; }
+    MESH_STORAGE            GetStorageMode    ( ) const { return m_Storage; }
+    const CVertex         * GetVertexPool     ( ) const { return m_pVertexPool; }
+    ULONG                   GetVertexPoolCount( ) const { return m_nPoolCount; }
+    const POLYGON_RANGE   * GetPolygonRanges  ( ) const { return m_pPolyRange; }
+    const CCompiledMesh   * GetCompiled       ( ) const { return m_pCompiled; }
+    bool                    IsBorrowed        ( ) const { return m_bBorrowed; }
+    ULONG                   GetLODCount       ( ) const { return m_pCompiled ? m_nLODCount + 1 : 0; }
+    const CCompiledMesh   * GetLOD            ( ULONG Level ) const;
+    float                   GetLODError       ( ULONG Level ) const { return (Level > 0 && Level <= m_nLODCount) ? m_fLODError[ Level - 1 ] : 0.0f; }
+    const D3DXVECTOR3     & GetBoundsMin      ( ) const { return m_vecBoundsMin; }
+    const D3DXVECTOR3     & GetBoundsMax      ( ) const { return m_vecBoundsMax; }
+    const D3DXVECTOR3     & GetBoundsCentre   ( ) const { return m_vecBoundsCentre; }
+    float                   GetBoundsRadius   ( ) const { return m_fBoundsRadius; }
 
     //-------------------------------------------------------------------------
 	// Public Variables for This Class
@@ -95,6 +175,46 @@ public:
     ULONG       m_nPolygonCount;        // Number of polygons stored
     CPolygon  **m_pPolygon;             // Simply polygon array.
 
+private:
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    long        AddArenaVertices  ( ULONG Polygon, USHORT Count );
+    long        AddPoolVertices   ( ULONG Polygon, USHORT Count );
+    bool        ReservePool       ( ULONG Count );
+    bool        ReservePolygons   ( ULONG Count );
+    void        BindPolygons      ( );
+    bool        Unborrow          ( );
+    void        Clear             ( );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    ULONG           m_nId;              // Creation order number (see GetId)
+    CMemoryArena    m_Arena;            // Backs polygon headers & vertex blocks
+    ULONG           m_nPolygonCapacity; // Entries allocated in m_pPolygon (and m_pPolyRange)
+    MESH_STORAGE    m_Storage;          // Where polygon vertex data is stored
+    CVertex        *m_pVertexPool;      // Flat vertex pool (pooled storage only)
+    ULONG           m_nPoolCount;       // Number of pool entries in use (inc. slack)
+    ULONG           m_nPoolCapacity;    // Number of pool entries allocated
+    ULONG           m_nPoolSlack;       // Pool entries orphaned by relocation
+    POLYGON_RANGE  *m_pPolyRange;       // Polygon table (pooled storage only)
+    CCompiledMesh  *m_pCompiled;        // Indexed triangle list form (if compiled)
+    CCompiledMesh  *m_pLOD[ MESH_MAX_LODS - 1 ]; // Simplified forms of m_pCompiled (levels 1 and up)
+    float           m_fLODError[ MESH_MAX_LODS - 1 ]; // Object space error of each simplified level
+    ULONG           m_nLODCount;        // Number of simplified levels
+    D3DXVECTOR3     m_vecBoundsMin;     // Local space bounding box
+    D3DXVECTOR3     m_vecBoundsMax;
+    D3DXVECTOR3     m_vecBoundsCentre;  // Local space bounding sphere (about the box centre)
+    float           m_fBoundsRadius;
+    bool            m_bBorrowed;        // Pool & polygon table are externally owned (see Attach)
+
+    // Number given to the next mesh created
+    static volatile LONG m_nNextId;
+
+    // CPolygon routes vertex growth through us when it is owned by a mesh
+    friend class CPolygon;
+
 };
 
 //-----------------------------------------------------------------------------
@@ -110,11 +230,27 @@ public:
      CObject( CMesh * pMesh );
 	 CObject();
 
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    void        UpdateBounds( );
+    ULONG       SelectLOD( const D3DXMATRIX & mtxView, float fProjScale, float fPixelError = MESH_LOD_PIXEL_ERROR );
+    void        SaveTransform( );
+    void        GetRenderTransform( D3DXMATRIX * pOut, float fAlpha ) const;
+
+    static void InterpolateTransform( D3DXMATRIX * pOut, const D3DXMATRIX & mtxFrom, const D3DXMATRIX & mtxTo, float fAlpha );
+
 	//-------------------------------------------------------------------------
 	// Public Variables for This Class
 	//-------------------------------------------------------------------------
     D3DXMATRIX  m_mtxWorld;             // Objects world matrix
+    D3DXMATRIX  m_mtxPrevWorld;         // World matrix before the latest simulation step (see SaveTransform)
+    bool        m_bInterpolate;         // Is m_mtxPrevWorld blended towards m_mtxWorld when drawn ?
     CMesh      *m_pMesh;                // Mesh we are instancing
+    ULONG       m_nLOD;                 // Detail level selected for drawing (see SelectLOD)
+    D3DXVECTOR3 m_vecBoundsCentre;      // World space bounding box centre (see UpdateBounds)
+    D3DXVECTOR3 m_vecBoundsExtents;     // World space bounding box half size
+    float       m_fBoundsRadius;        // World space bounding sphere radius (about the centre)
 
 };
 
@@ -0,0 +1,868 @@
+//-----------------------------------------------------------------------------
+// File: CObjectBVH.cpp
+//
+// Desc: Bounding volume hierarchy over object instances, used for frustum,
+//       sphere and ray queries against large numbers of objects.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CObjectBVH Specific Includes
+//-----------------------------------------------------------------------------
+#include "CObjectBVH.h"
+#include <process.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Module Local Constants, Structures & Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    const ULONG BVH_NO_PARENT = 0xFFFFFFFF;
+
+    // Node range still to be split during a build
+    struct BUILD_ENTRY
+    {
+        ULONG   Node;
+        ULONG   First;
+        ULONG   Count;
+        ULONG   Depth;
+    };
+
+    // Node waiting to be visited during a query
+    struct QUERY_ENTRY
+    {
+        ULONG   Node;
+        ULONG   PlaneMask;                  // Frustum planes the node may still cross
+        float   fDistance;                  // Ray entry distance
+    };
+
+    // Bounds accumulated into a single centroid bin
+    struct BUILD_BIN
+    {
+        D3DXVECTOR3 vecMin;
+        D3DXVECTOR3 vecMax;
+        ULONG       Count;
+    };
+
+    //-------------------------------------------------------------------------
+    // Name : ResetBox ()
+    // Desc : Sets a box to the empty (inverted) state ready for growing.
+    //-------------------------------------------------------------------------
+    inline void ResetBox( D3DXVECTOR3 & vecMin, D3DXVECTOR3 & vecMax )
+    {
+        vecMin = D3DXVECTOR3(  FLT_MAX,  FLT_MAX,  FLT_MAX );
+        vecMax = D3DXVECTOR3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : GrowBox ()
+    // Desc : Expands a box to contain a second box.
+    //-------------------------------------------------------------------------
+    inline void GrowBox( D3DXVECTOR3 & vecMin, D3DXVECTOR3 & vecMax, const D3DXVECTOR3 & vecAddMin, const D3DXVECTOR3 & vecAddMax )
+    {
+        if ( vecAddMin.x < vecMin.x ) vecMin.x = vecAddMin.x;
+        if ( vecAddMin.y < vecMin.y ) vecMin.y = vecAddMin.y;
+        if ( vecAddMin.z < vecMin.z ) vecMin.z = vecAddMin.z;
+        if ( vecAddMax.x > vecMax.x ) vecMax.x = vecAddMax.x;
+        if ( vecAddMax.y > vecMax.y ) vecMax.y = vecAddMax.y;
+        if ( vecAddMax.z > vecMax.z ) vecMax.z = vecAddMax.z;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : BoxArea ()
+    // Desc : Surface area of a box, or zero for an empty box.
+    //-------------------------------------------------------------------------
+    inline float BoxArea( const D3DXVECTOR3 & vecMin, const D3DXVECTOR3 & vecMax )
+    {
+        float x = vecMax.x - vecMin.x, y = vecMax.y - vecMin.y, z = vecMax.z - vecMin.z;
+        if ( x < 0.0f || y < 0.0f || z < 0.0f ) return 0.0f;
+        return 2.0f * (x * y + y * z + z * x);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : Centroid ()
+    // Desc : Returns a single component of an object box centre.
+    //-------------------------------------------------------------------------
+    inline float Centroid( const BVH_BOUNDS & Bounds, ULONG Axis )
+    {
+        return ((&Bounds.vecMin.x)[ Axis ] + (&Bounds.vecMax.x)[ Axis ]) * 0.5f;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : ClassifyBox ()
+    // Desc : Tests a box against the frustum planes selected by PlaneMask,
+    //        removing from the mask every plane the box is entirely inside.
+    // Note : Returns false if the box is entirely outside any plane.
+    //-------------------------------------------------------------------------
+    inline bool ClassifyBox( const CFrustum & Frustum, const D3DXVECTOR3 & vecMin, const D3DXVECTOR3 & vecMax, ULONG & PlaneMask )
+    {
+        D3DXVECTOR3 vecCentre  = (vecMin + vecMax) * 0.5f;
+        D3DXVECTOR3 vecExtents = (vecMax - vecMin) * 0.5f;
+
+        for ( ULONG i = 0; i < FRUSTUM_PLANE_COUNT; i++ )
+        {
+            if ( !(PlaneMask & (1 << i)) ) continue;
+
+            const D3DXPLANE & Plane = Frustum.GetPlane( i );
+            float fDistance = Plane.a * vecCentre.x + Plane.b * vecCentre.y + Plane.c * vecCentre.z + Plane.d;
+            float fRadius   = fabsf( Plane.a ) * vecExtents.x + fabsf( Plane.b ) * vecExtents.y + fabsf( Plane.c ) * vecExtents.z;
+            if ( fDistance < -fRadius ) return false;
+            if ( fDistance >= fRadius ) PlaneMask &= ~(1 << i);
+
+        } // Next Plane
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : SphereTouchesBox ()
+    // Desc : Returns true if the sphere overlaps the box.
+    //-------------------------------------------------------------------------
+    inline bool SphereTouchesBox( const D3DXVECTOR3 & vecCentre, float fRadiusSq, const D3DXVECTOR3 & vecMin, const D3DXVECTOR3 & vecMax )
+    {
+        float fDistanceSq = 0.0f;
+
+        for ( ULONG i = 0; i < 3; i++ )
+        {
+            float c = (&vecCentre.x)[i], d = 0.0f;
+            if ( c < (&vecMin.x)[i] ) d = (&vecMin.x)[i] - c;
+            else if ( c > (&vecMax.x)[i] ) d = c - (&vecMax.x)[i];
+            fDistanceSq += d * d;
+
+        } // Next Axis
+
+        return fDistanceSq <= fRadiusSq;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : RayHitsBox ()
+    // Desc : Slab test of a ray against a box, returning the entry distance.
+    //-------------------------------------------------------------------------
+    inline bool RayHitsBox( const D3DXVECTOR3 & vecOrigin, const D3DXVECTOR3 & vecInvDir, const D3DXVECTOR3 & vecMin,
+                            const D3DXVECTOR3 & vecMax, float fMaxDistance, float & fDistance )
+    {
+        float fNear = 0.0f, fFar = fMaxDistance;
+
+        for ( ULONG i = 0; i < 3; i++ )
+        {
+            float t0 = ((&vecMin.x)[i] - (&vecOrigin.x)[i]) * (&vecInvDir.x)[i];
+            float t1 = ((&vecMax.x)[i] - (&vecOrigin.x)[i]) * (&vecInvDir.x)[i];
+            if ( t0 > t1 ) { float t = t0; t0 = t1; t1 = t; }
+            if ( t0 > fNear ) fNear = t0;
+            if ( t1 < fFar  ) fFar  = t1;
+            if ( fNear > fFar ) return false;
+
+        } // Next Axis
+
+        fDistance = fNear;
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : CompareNodeDescending ()
+    // Desc : qsort callback ordering node indices from last to first.
+    //-------------------------------------------------------------------------
+    int CompareNodeDescending( const void * pA, const void * pB )
+    {
+        ULONG a = *(const ULONG*)pA, b = *(const ULONG*)pB;
+        return (a < b) ? 1 : ((a > b) ? -1 : 0);
+    }
+
+}; // End Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CObjectBVH () (Constructor)
+// Desc : CObjectBVH Class Constructor
+//-----------------------------------------------------------------------------
+CObjectBVH::CObjectBVH()
+{
+	// Reset / Clear all required values
+    m_nObjectCount      = 0;
+    m_pBounds           = NULL;
+    m_pIndices          = NULL;
+    m_pObjectLeaf       = NULL;
+    m_pNodes            = NULL;
+    m_pParents          = NULL;
+    m_nNodeCount        = 0;
+    m_pNodeDirty        = NULL;
+    m_pDirtyNodes       = NULL;
+    m_nDirtyCount       = 0;
+    m_fCost             = 0.0;
+    m_fBuildCost        = 0.0;
+    m_hRebuildThread    = NULL;
+    m_pRebuildBounds    = NULL;
+    m_pRebuildNodes     = NULL;
+    m_pRebuildIndices   = NULL;
+    m_nRebuildNodeCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CObjectBVH () (Destructor)
+// Desc : CObjectBVH Class Destructor
+//-----------------------------------------------------------------------------
+CObjectBVH::~CObjectBVH()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Build ()
+// Desc : Builds the hierarchy over Count object boxes. Object indices
+//        returned by the queries are indices into this array.
+//-----------------------------------------------------------------------------
+bool CObjectBVH::Build( const BVH_BOUNDS * pBounds, ULONG Count )
+{
+    ULONG MaxNodes = Count * 2;
+
+    // Release any previous hierarchy
+    Release();
+    if ( !pBounds || Count == 0 ) return true;
+
+    // Allocate the live and rebuild arrays together
+    if (!( m_pBounds         = new BVH_BOUNDS[ Count ] )) goto BuildError;
+    if (!( m_pIndices        = new ULONG[ Count ] )) goto BuildError;
+    if (!( m_pObjectLeaf     = new ULONG[ Count ] )) goto BuildError;
+    if (!( m_pNodes          = new BVH_NODE[ MaxNodes ] )) goto BuildError;
+    if (!( m_pParents        = new ULONG[ MaxNodes ] )) goto BuildError;
+    if (!( m_pNodeDirty      = new UCHAR[ MaxNodes ] )) goto BuildError;
+    if (!( m_pDirtyNodes     = new ULONG[ MaxNodes ] )) goto BuildError;
+    if (!( m_pRebuildBounds  = new BVH_BOUNDS[ Count ] )) goto BuildError;
+    if (!( m_pRebuildNodes   = new BVH_NODE[ MaxNodes ] )) goto BuildError;
+    if (!( m_pRebuildIndices = new ULONG[ Count ] )) goto BuildError;
+    m_nObjectCount = Count;
+
+    // Build the initial tree in place
+    memcpy( m_pBounds, pBounds, Count * sizeof(BVH_BOUNDS) );
+    m_nNodeCount = BuildNodes( m_pBounds, Count, m_pNodes, m_pIndices );
+    LinkNodes();
+
+    // Success!
+    return true;
+
+BuildError:
+    Release();
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Waits for any background rebuild, and releases the hierarchy.
+//-----------------------------------------------------------------------------
+void CObjectBVH::Release( )
+{
+    // The rebuild thread reads the snapshot arrays, so it must finish first
+    if ( m_hRebuildThread )
+    {
+        WaitForSingleObject( m_hRebuildThread, INFINITE );
+        CloseHandle( m_hRebuildThread );
+        m_hRebuildThread = NULL;
+
+    } // End if rebuilding
+
+    // Release memory
+    if ( m_pBounds         ) delete []m_pBounds;
+    if ( m_pIndices        ) delete []m_pIndices;
+    if ( m_pObjectLeaf     ) delete []m_pObjectLeaf;
+    if ( m_pNodes          ) delete []m_pNodes;
+    if ( m_pParents        ) delete []m_pParents;
+    if ( m_pNodeDirty      ) delete []m_pNodeDirty;
+    if ( m_pDirtyNodes     ) delete []m_pDirtyNodes;
+    if ( m_pRebuildBounds  ) delete []m_pRebuildBounds;
+    if ( m_pRebuildNodes   ) delete []m_pRebuildNodes;
+    if ( m_pRebuildIndices ) delete []m_pRebuildIndices;
+
+    // Clear variables
+    m_nObjectCount      = 0;
+    m_pBounds           = NULL;
+    m_pIndices          = NULL;
+    m_pObjectLeaf       = NULL;
+    m_pNodes            = NULL;
+    m_pParents          = NULL;
+    m_nNodeCount        = 0;
+    m_pNodeDirty        = NULL;
+    m_pDirtyNodes       = NULL;
+    m_nDirtyCount       = 0;
+    m_fCost             = 0.0;
+    m_fBuildCost        = 0.0;
+    m_pRebuildBounds    = NULL;
+    m_pRebuildNodes     = NULL;
+    m_pRebuildIndices   = NULL;
+    m_nRebuildNodeCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetBounds ()
+// Desc : Records the new box of a moved object. The tree itself is refitted
+//        by the next call to Update.
+//-----------------------------------------------------------------------------
+void CObjectBVH::SetBounds( ULONG Object, const D3DXVECTOR3 & vecMin, const D3DXVECTOR3 & vecMax )
+{
+    // Validate
+    if ( Object >= m_nObjectCount ) return;
+
+    // Store the box, and queue its leaf
+    m_pBounds[ Object ].vecMin = vecMin;
+    m_pBounds[ Object ].vecMax = vecMax;
+
+    ULONG Leaf = m_pObjectLeaf[ Object ];
+    if ( !m_pNodeDirty[ Leaf ] )
+    {
+        m_pNodeDirty[ Leaf ] = 1;
+        m_pDirtyNodes[ m_nDirtyCount++ ] = Leaf;
+
+    } // End if newly dirty
+}
+
+//-----------------------------------------------------------------------------
+// Name : Update ()
+// Desc : Swaps in any completed background rebuild, refits every node above
+//        a moved object, and starts a rebuild if the tree has degraded.
+//-----------------------------------------------------------------------------
+void CObjectBVH::Update( bool bAllowRebuild )
+{
+    ULONG i;
+
+    // Collect a finished rebuild (this refits everything itself)
+    if ( m_hRebuildThread ) FinishRebuild( false );
+
+    if ( m_nDirtyCount > 0 )
+    {
+        // Queue the ancestors of every dirty leaf (the list grows as we go)
+        for ( i = 0; i < m_nDirtyCount; i++ )
+        {
+            ULONG Parent = m_pParents[ m_pDirtyNodes[i] ];
+            if ( Parent == BVH_NO_PARENT || m_pNodeDirty[ Parent ] ) continue;
+            m_pNodeDirty[ Parent ] = 1;
+            m_pDirtyNodes[ m_nDirtyCount++ ] = Parent;
+
+        } // Next Dirty Node
+
+        // Children always follow their parents, so refit from the back
+        qsort( m_pDirtyNodes, m_nDirtyCount, sizeof(ULONG), CompareNodeDescending );
+
+        for ( i = 0; i < m_nDirtyCount; i++ )
+        {
+            ULONG      Node  = m_pDirtyNodes[i];
+            BVH_NODE & Entry = m_pNodes[ Node ];
+            double     fOldCost = NodeCost( Node );
+
+            ResetBox( Entry.vecMin, Entry.vecMax );
+            if ( Entry.Count > 0 )
+            {
+                for ( ULONG j = 0; j < Entry.Count; j++ )
+                {
+                    const BVH_BOUNDS & Bounds = m_pBounds[ m_pIndices[ Entry.Child + j ] ];
+                    GrowBox( Entry.vecMin, Entry.vecMax, Bounds.vecMin, Bounds.vecMax );
+
+                } // Next Object
+
+            } // End if leaf
+            else
+            {
+                GrowBox( Entry.vecMin, Entry.vecMax, m_pNodes[ Entry.Child ].vecMin, m_pNodes[ Entry.Child ].vecMax );
+                GrowBox( Entry.vecMin, Entry.vecMax, m_pNodes[ Entry.Child + 1 ].vecMin, m_pNodes[ Entry.Child + 1 ].vecMax );
+
+            } // End if interior
+
+            m_fCost += NodeCost( Node ) - fOldCost;
+            m_pNodeDirty[ Node ] = 0;
+
+        } // Next Dirty Node
+        m_nDirtyCount = 0;
+
+    } // End if anything moved
+
+    // Replace the tree once refitting has made it too expensive to traverse
+    if ( bAllowRebuild && !m_hRebuildThread && GetCostRatio() > BVH_REBUILD_RATIO ) StartRebuild();
+}
+
+//-----------------------------------------------------------------------------
+// Name : QueryFrustum ()
+// Desc : Writes the index of every object whose box is at least partially
+//        inside the frustum to pResults, returning the number written.
+// Note : Subtrees entirely inside a plane stop testing against it, so the
+//        contents of subtrees entirely inside the frustum are not tested.
+//-----------------------------------------------------------------------------
+ULONG CObjectBVH::QueryFrustum( const CFrustum & Frustum, ULONG * pResults, ULONG MaxResults ) const
+{
+    QUERY_ENTRY Stack[ BVH_MAX_DEPTH + 2 ];
+    ULONG       StackSize = 0, Found = 0;
+
+    // Validate
+    if ( m_nNodeCount == 0 || !pResults ) return 0;
+
+    Stack[ StackSize ].Node      = 0;
+    Stack[ StackSize++ ].PlaneMask = (1 << FRUSTUM_PLANE_COUNT) - 1;
+
+    while ( StackSize > 0 )
+    {
+        QUERY_ENTRY     Entry = Stack[ --StackSize ];
+        const BVH_NODE & Node = m_pNodes[ Entry.Node ];
+
+        // Discard the node if it is outside
+        if ( Entry.PlaneMask && !ClassifyBox( Frustum, Node.vecMin, Node.vecMax, Entry.PlaneMask ) ) continue;
+
+        if ( Node.Count > 0 )
+        {
+            for ( ULONG i = 0; i < Node.Count; i++ )
+            {
+                ULONG Object = m_pIndices[ Node.Child + i ];
+                ULONG PlaneMask = Entry.PlaneMask;
+                if ( PlaneMask && !ClassifyBox( Frustum, m_pBounds[ Object ].vecMin, m_pBounds[ Object ].vecMax, PlaneMask ) ) continue;
+                if ( Found == MaxResults ) return Found;
+                pResults[ Found++ ] = Object;
+
+            } // Next Object
+
+        } // End if leaf
+        else
+        {
+            Stack[ StackSize ].Node        = Node.Child + 1;
+            Stack[ StackSize++ ].PlaneMask = Entry.PlaneMask;
+            Stack[ StackSize ].Node        = Node.Child;
+            Stack[ StackSize++ ].PlaneMask = Entry.PlaneMask;
+
+        } // End if interior
+
+    } // Next Node
+
+    return Found;
+}
+
+//-----------------------------------------------------------------------------
+// Name : QuerySphere ()
+// Desc : Writes the index of every object whose box overlaps the sphere to
+//        pResults, returning the number written.
+//-----------------------------------------------------------------------------
+ULONG CObjectBVH::QuerySphere( const D3DXVECTOR3 & vecCentre, float fRadius, ULONG * pResults, ULONG MaxResults ) const
+{
+    ULONG Stack[ BVH_MAX_DEPTH + 2 ];
+    ULONG StackSize = 0, Found = 0;
+    float fRadiusSq = fRadius * fRadius;
+
+    // Validate
+    if ( m_nNodeCount == 0 || !pResults || fRadius < 0.0f ) return 0;
+
+    Stack[ StackSize++ ] = 0;
+    while ( StackSize > 0 )
+    {
+        const BVH_NODE & Node = m_pNodes[ Stack[ --StackSize ] ];
+        if ( !SphereTouchesBox( vecCentre, fRadiusSq, Node.vecMin, Node.vecMax ) ) continue;
+
+        if ( Node.Count > 0 )
+        {
+            for ( ULONG i = 0; i < Node.Count; i++ )
+            {
+                ULONG Object = m_pIndices[ Node.Child + i ];
+                if ( !SphereTouchesBox( vecCentre, fRadiusSq, m_pBounds[ Object ].vecMin, m_pBounds[ Object ].vecMax ) ) continue;
+                if ( Found == MaxResults ) return Found;
+                pResults[ Found++ ] = Object;
+
+            } // Next Object
+
+        } // End if leaf
+        else
+        {
+            Stack[ StackSize++ ] = Node.Child + 1;
+            Stack[ StackSize++ ] = Node.Child;
+
+        } // End if interior
+
+    } // Next Node
+
+    return Found;
+}
+
+//-----------------------------------------------------------------------------
+// Name : QueryRay ()
+// Desc : Finds the nearest object box hit by the ray within fMaxDistance.
+// Note : vecDir need not be normalised; distances are measured in multiples
+//        of its length. A ray starting inside a box hits it at distance 0.
+//-----------------------------------------------------------------------------
+bool CObjectBVH::QueryRay( const D3DXVECTOR3 & vecOrigin, const D3DXVECTOR3 & vecDir, float fMaxDistance,
+                           ULONG * pObject, float * pDistance ) const
+{
+    QUERY_ENTRY Stack[ BVH_MAX_DEPTH + 2 ];
+    ULONG       StackSize = 0, BestObject = 0;
+    float       fBest = fMaxDistance, fDistance;
+    bool        bHit = false;
+    D3DXVECTOR3 vecInvDir;
+
+    // Validate
+    if ( m_nNodeCount == 0 ) return false;
+
+    // Axis parallel rays use a huge reciprocal in place of infinity
+    for ( ULONG i = 0; i < 3; i++ )
+    {
+        float d = (&vecDir.x)[i];
+        (&vecInvDir.x)[i] = (fabsf( d ) > 1e-20f) ? 1.0f / d : ((d < 0.0f) ? -1e30f : 1e30f);
+
+    } // Next Axis
+
+    if ( !RayHitsBox( vecOrigin, vecInvDir, m_pNodes[0].vecMin, m_pNodes[0].vecMax, fBest, fDistance ) ) return false;
+    Stack[ StackSize ].Node        = 0;
+    Stack[ StackSize++ ].fDistance = fDistance;
+
+    while ( StackSize > 0 )
+    {
+        QUERY_ENTRY      Entry = Stack[ --StackSize ];
+        const BVH_NODE & Node  = m_pNodes[ Entry.Node ];
+
+        // Skip nodes beyond the nearest hit found since they were queued
+        if ( Entry.fDistance > fBest ) continue;
+
+        if ( Node.Count > 0 )
+        {
+            for ( ULONG i = 0; i < Node.Count; i++ )
+            {
+                ULONG Object = m_pIndices[ Node.Child + i ];
+                if ( !RayHitsBox( vecOrigin, vecInvDir, m_pBounds[ Object ].vecMin, m_pBounds[ Object ].vecMax, fBest, fDistance ) ) continue;
+                if ( bHit && fDistance >= fBest ) continue;
+                fBest = fDistance; BestObject = Object; bHit = true;
+
+            } // Next Object
+
+        } // End if leaf
+        else
+        {
+            float fNear, fFar;
+            bool  bNear = RayHitsBox( vecOrigin, vecInvDir, m_pNodes[ Node.Child ].vecMin, m_pNodes[ Node.Child ].vecMax, fBest, fNear );
+            bool  bFar  = RayHitsBox( vecOrigin, vecInvDir, m_pNodes[ Node.Child + 1 ].vecMin, m_pNodes[ Node.Child + 1 ].vecMax, fBest, fFar );
+            ULONG Near  = Node.Child, Far = Node.Child + 1;
+
+            // Visit the closer child first
+            if ( bNear && bFar && fFar < fNear )
+            {
+                float t = fNear; fNear = fFar; fFar = t;
+                Near = Node.Child + 1; Far = Node.Child;
+
+            } // End if swap
+            else if ( !bNear && bFar )
+            {
+                fNear = fFar; Near = Far; bNear = true; bFar = false;
+
+            } // End if only far
+
+            if ( bFar )
+            {
+                Stack[ StackSize ].Node        = Far;
+                Stack[ StackSize++ ].fDistance = fFar;
+
+            } // End if far
+            if ( bNear )
+            {
+                Stack[ StackSize ].Node        = Near;
+                Stack[ StackSize++ ].fDistance = fNear;
+
+            } // End if near
+
+        } // End if interior
+
+    } // Next Node
+
+    // Return the nearest hit
+    if ( bHit )
+    {
+        if ( pObject   ) *pObject   = BestObject;
+        if ( pDistance ) *pDistance = fBest;
+
+    } // End if hit
+    return bHit;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetCostRatio ()
+// Desc : Returns the SAH cost of the tree in its current, refitted state
+//        relative to its cost when it was last built.
+//-----------------------------------------------------------------------------
+float CObjectBVH::GetCostRatio( ) const
+{
+    // Validate
+    if ( m_nNodeCount == 0 || m_fBuildCost <= 0.0 ) return 1.0f;
+
+    double fRootArea = BoxArea( m_pNodes[0].vecMin, m_pNodes[0].vecMax );
+    if ( fRootArea <= 0.0 ) return 1.0f;
+
+    return (float)((m_fCost / fRootArea) / m_fBuildCost);
+}
+
+//-----------------------------------------------------------------------------
+// Name : StartRebuild () (Private)
+// Desc : Snapshots the current object boxes and starts building a new tree
+//        from them on a background thread.
+//-----------------------------------------------------------------------------
+bool CObjectBVH::StartRebuild( )
+{
+    // Validate
+    if ( m_hRebuildThread || m_nObjectCount == 0 ) return false;
+
+    // The live boxes keep changing while the thread runs, so take a copy
+    memcpy( m_pRebuildBounds, m_pBounds, m_nObjectCount * sizeof(BVH_BOUNDS) );
+    m_nRebuildNodeCount = 0;
+
+    m_hRebuildThread = (HANDLE)_beginthreadex( NULL, 0, RebuildThread, this, 0, NULL );
+    return m_hRebuildThread != NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : FinishRebuild () (Private)
+// Desc : Swaps in the tree built by the background thread if it is complete
+//        (or once it completes, if bWait is set).
+// Note : Objects may have moved since the snapshot was taken, so the new
+//        tree is refitted to the current boxes before use.
+//-----------------------------------------------------------------------------
+void CObjectBVH::FinishRebuild( bool bWait )
+{
+    // Validate
+    if ( !m_hRebuildThread ) return;
+    if ( WaitForSingleObject( m_hRebuildThread, bWait ? INFINITE : 0 ) != WAIT_OBJECT_0 ) return;
+    CloseHandle( m_hRebuildThread );
+    m_hRebuildThread = NULL;
+
+    // Exchange the trees
+    BVH_NODE * pNodes   = m_pNodes;   m_pNodes   = m_pRebuildNodes;   m_pRebuildNodes   = pNodes;
+    ULONG    * pIndices = m_pIndices; m_pIndices = m_pRebuildIndices; m_pRebuildIndices = pIndices;
+    m_nNodeCount = m_nRebuildNodeCount;
+
+    // Bring the new tree up to date
+    LinkNodes();
+}
+
+//-----------------------------------------------------------------------------
+// Name : LinkNodes () (Private)
+// Desc : Rebuilds the parent and object leaf links of a freshly built tree,
+//        refits it to the current boxes, and records its cost.
+//-----------------------------------------------------------------------------
+void CObjectBVH::LinkNodes( )
+{
+    ULONG i;
+
+    // Clear any refits queued against the previous tree
+    ZeroMemory( m_pNodeDirty, m_nObjectCount * 2 * sizeof(UCHAR) );
+    m_nDirtyCount = 0;
+
+    // Store links
+    m_pParents[0] = BVH_NO_PARENT;
+    for ( i = 0; i < m_nNodeCount; i++ )
+    {
+        const BVH_NODE & Node = m_pNodes[i];
+        if ( Node.Count > 0 )
+        {
+            for ( ULONG j = 0; j < Node.Count; j++ ) m_pObjectLeaf[ m_pIndices[ Node.Child + j ] ] = i;
+
+        } // End if leaf
+        else
+        {
+            m_pParents[ Node.Child ]     = i;
+            m_pParents[ Node.Child + 1 ] = i;
+
+        } // End if interior
+
+    } // Next Node
+
+    // Refit, and use the result as the baseline cost of this tree
+    RefitAll();
+    double fRootArea = BoxArea( m_pNodes[0].vecMin, m_pNodes[0].vecMax );
+    m_fBuildCost = (fRootArea > 0.0) ? m_fCost / fRootArea : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RefitAll () (Private)
+// Desc : Recalculates the box of every node, and the total cost of the tree.
+//-----------------------------------------------------------------------------
+void CObjectBVH::RefitAll( )
+{
+    m_fCost = 0.0;
+
+    for ( ULONG i = m_nNodeCount; i-- > 0; )
+    {
+        BVH_NODE & Node = m_pNodes[i];
+
+        ResetBox( Node.vecMin, Node.vecMax );
+        if ( Node.Count > 0 )
+        {
+            for ( ULONG j = 0; j < Node.Count; j++ )
+            {
+                const BVH_BOUNDS & Bounds = m_pBounds[ m_pIndices[ Node.Child + j ] ];
+                GrowBox( Node.vecMin, Node.vecMax, Bounds.vecMin, Bounds.vecMax );
+
+            } // Next Object
+
+        } // End if leaf
+        else
+        {
+            GrowBox( Node.vecMin, Node.vecMax, m_pNodes[ Node.Child ].vecMin, m_pNodes[ Node.Child ].vecMax );
+            GrowBox( Node.vecMin, Node.vecMax, m_pNodes[ Node.Child + 1 ].vecMin, m_pNodes[ Node.Child + 1 ].vecMax );
+
+        } // End if interior
+
+        m_fCost += NodeCost( i );
+
+    } // Next Node
+}
+
+//-----------------------------------------------------------------------------
+// Name : NodeCost () (Private)
+// Desc : Contribution of a single node to the (unnormalised) SAH cost.
+//-----------------------------------------------------------------------------
+double CObjectBVH::NodeCost( ULONG Node ) const
+{
+    const BVH_NODE & Entry = m_pNodes[ Node ];
+    double fArea = BoxArea( Entry.vecMin, Entry.vecMax );
+    return (Entry.Count > 0) ? fArea * Entry.Count * BVH_INTERSECT_COST : fArea * BVH_TRAVERSAL_COST;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildNodes () (Private, Static)
+// Desc : Builds a tree over the boxes using the binned surface area
+//        heuristic, returning the number of nodes written to pNodes (which
+//        must have room for Count * 2 nodes).
+// Note : Ranges whose centres all coincide are split down the middle, and
+//        ranges at BVH_MAX_DEPTH become leaves regardless of their size.
+//-----------------------------------------------------------------------------
+ULONG CObjectBVH::BuildNodes( const BVH_BOUNDS * pBounds, ULONG Count, BVH_NODE * pNodes, ULONG * pIndices )
+{
+    BUILD_ENTRY Stack[ BVH_MAX_DEPTH + 2 ];
+    BUILD_BIN   Bins[ BVH_BIN_COUNT ];
+    float       fRightArea[ BVH_BIN_COUNT ];
+    ULONG       RightCount[ BVH_BIN_COUNT ];
+    ULONG       StackSize = 0, NodeCount = 1, i;
+
+    // Every object starts in the root
+    for ( i = 0; i < Count; i++ ) pIndices[i] = i;
+    Stack[ StackSize ].Node    = 0;
+    Stack[ StackSize ].First   = 0;
+    Stack[ StackSize ].Count   = Count;
+    Stack[ StackSize++ ].Depth = 0;
+
+    while ( StackSize > 0 )
+    {
+        BUILD_ENTRY Entry = Stack[ --StackSize ];
+        BVH_NODE  & Node  = pNodes[ Entry.Node ];
+        D3DXVECTOR3 vecCentreMin, vecCentreMax;
+
+        // Calculate the node box, and the box of the object centres
+        ResetBox( Node.vecMin, Node.vecMax );
+        ResetBox( vecCentreMin, vecCentreMax );
+        for ( i = 0; i < Entry.Count; i++ )
+        {
+            const BVH_BOUNDS & Bounds = pBounds[ pIndices[ Entry.First + i ] ];
+            D3DXVECTOR3 vecCentre = (Bounds.vecMin + Bounds.vecMax) * 0.5f;
+            GrowBox( Node.vecMin, Node.vecMax, Bounds.vecMin, Bounds.vecMax );
+            GrowBox( vecCentreMin, vecCentreMax, vecCentre, vecCentre );
+
+        } // Next Object
+
+        // Small ranges become leaves
+        if ( Entry.Count <= BVH_LEAF_SIZE || Entry.Depth >= BVH_MAX_DEPTH )
+        {
+            Node.Child = Entry.First;
+            Node.Count = Entry.Count;
+            continue;
+
+        } // End if leaf
+
+        // Find the cheapest bin boundary over all three axes
+        ULONG BestAxis = 3, BestSplit = 0;
+        float fBestCost = FLT_MAX;
+        for ( ULONG Axis = 0; Axis < 3; Axis++ )
+        {
+            float fMin = (&vecCentreMin.x)[ Axis ], fExtent = (&vecCentreMax.x)[ Axis ] - fMin;
+            if ( fExtent <= 1e-6f ) continue;
+            float fScale = BVH_BIN_COUNT / fExtent;
+
+            // Bin the object boxes by centre
+            for ( ULONG b = 0; b < BVH_BIN_COUNT; b++ ) { ResetBox( Bins[b].vecMin, Bins[b].vecMax ); Bins[b].Count = 0; }
+            for ( i = 0; i < Entry.Count; i++ )
+            {
+                const BVH_BOUNDS & Bounds = pBounds[ pIndices[ Entry.First + i ] ];
+                ULONG Bin = (ULONG)((Centroid( Bounds, Axis ) - fMin) * fScale);
+                if ( Bin >= BVH_BIN_COUNT ) Bin = BVH_BIN_COUNT - 1;
+                GrowBox( Bins[ Bin ].vecMin, Bins[ Bin ].vecMax, Bounds.vecMin, Bounds.vecMax );
+                Bins[ Bin ].Count++;
+
+            } // Next Object
+
+            // Sweep from the right, then from the left evaluating each boundary
+            D3DXVECTOR3 vecMin, vecMax;
+            ULONG       Total = 0;
+            ResetBox( vecMin, vecMax );
+            for ( ULONG b = BVH_BIN_COUNT - 1; b > 0; b-- )
+            {
+                GrowBox( vecMin, vecMax, Bins[b].vecMin, Bins[b].vecMax );
+                Total += Bins[b].Count;
+                fRightArea[ b - 1 ] = BoxArea( vecMin, vecMax );
+                RightCount[ b - 1 ] = Total;
+
+            } // Next Bin
+
+            ResetBox( vecMin, vecMax );
+            Total = 0;
+            for ( ULONG b = 0; b < BVH_BIN_COUNT - 1; b++ )
+            {
+                GrowBox( vecMin, vecMax, Bins[b].vecMin, Bins[b].vecMax );
+                Total += Bins[b].Count;
+                if ( Total == 0 || RightCount[b] == 0 ) continue;
+
+                float fCost = BoxArea( vecMin, vecMax ) * Total + fRightArea[b] * RightCount[b];
+                if ( fCost < fBestCost ) { fBestCost = fCost; BestAxis = Axis; BestSplit = b; }
+
+            } // Next Boundary
+
+        } // Next Axis
+
+        // Partition the object indices about the chosen boundary
+        ULONG LeftCount = Entry.Count / 2;
+        if ( BestAxis < 3 )
+        {
+            float fMin   = (&vecCentreMin.x)[ BestAxis ];
+            float fScale = BVH_BIN_COUNT / ((&vecCentreMax.x)[ BestAxis ] - fMin);
+            ULONG Left = Entry.First, Right = Entry.First + Entry.Count;
+
+            while ( Left < Right )
+            {
+                ULONG Bin = (ULONG)((Centroid( pBounds[ pIndices[ Left ] ], BestAxis ) - fMin) * fScale);
+                if ( Bin >= BVH_BIN_COUNT ) Bin = BVH_BIN_COUNT - 1;
+                if ( Bin <= BestSplit ) { Left++; continue; }
+
+                ULONG Swap = pIndices[ Left ]; pIndices[ Left ] = pIndices[ --Right ]; pIndices[ Right ] = Swap;
+
+            } // Next Object
+            LeftCount = Left - Entry.First;
+
+        } // End if split found
+
+        // Allocate both children together, and queue them for splitting
+        Node.Child = NodeCount;
+        Node.Count = 0;
+        NodeCount += 2;
+
+        Stack[ StackSize ].Node    = Node.Child + 1;
+        Stack[ StackSize ].First   = Entry.First + LeftCount;
+        Stack[ StackSize ].Count   = Entry.Count - LeftCount;
+        Stack[ StackSize++ ].Depth = Entry.Depth + 1;
+        Stack[ StackSize ].Node    = Node.Child;
+        Stack[ StackSize ].First   = Entry.First;
+        Stack[ StackSize ].Count   = LeftCount;
+        Stack[ StackSize++ ].Depth = Entry.Depth + 1;
+
+    } // Next Node
+
+    return NodeCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RebuildThread () (Private, Static)
+// Desc : Background rebuild thread entry point.
+//-----------------------------------------------------------------------------
+unsigned __stdcall CObjectBVH::RebuildThread( void * pParam )
+{
+    CObjectBVH * pTree = (CObjectBVH*)pParam;
+    pTree->m_nRebuildNodeCount = BuildNodes( pTree->m_pRebuildBounds, pTree->m_nObjectCount,
+                                             pTree->m_pRebuildNodes, pTree->m_pRebuildIndices );
+    return 0;
+}
@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+// File: CObjectBVH.h
+//
+// Desc: Bounding volume hierarchy over object instances, used for frustum,
+//       sphere and ray queries against large numbers of objects.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _COBJECTBVH_H_
+#define _COBJECTBVH_H_
+
+//-----------------------------------------------------------------------------
+// CObjectBVH Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CFrustum.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG BVH_LEAF_SIZE           = 4;        // Largest number of objects stored in a leaf
+const ULONG BVH_BIN_COUNT           = 16;       // Centroid bins tested per axis when splitting
+const ULONG BVH_MAX_DEPTH           = 64;       // Nodes below this depth always become leaves
+const float BVH_TRAVERSAL_COST      = 1.0f;     // SAH cost of visiting an interior node
+const float BVH_INTERSECT_COST      = 1.0f;     // SAH cost of testing a single object
+const float BVH_REBUILD_RATIO       = 1.5f;     // Cost growth (vs. build) at which to rebuild
+
+//-----------------------------------------------------------------------------
+// Name : BVH_BOUNDS (Struct)
+// Desc : World space axis aligned box of a single object.
+//-----------------------------------------------------------------------------
+struct BVH_BOUNDS
+{
+    D3DXVECTOR3     vecMin;                 // Box minimum
+    D3DXVECTOR3     vecMax;                 // Box maximum
+};
+
+//-----------------------------------------------------------------------------
+// Name : BVH_NODE (Struct)
+// Desc : Single node of the flattened hierarchy. Interior nodes (Count == 0)
+//        store their two children at Child and Child + 1, leaves store Count
+//        entries of the object index list starting at Child.
+//-----------------------------------------------------------------------------
+struct BVH_NODE
+{
+    D3DXVECTOR3     vecMin;                 // Node box minimum
+    ULONG           Child;                  // First child node, or first object index
+    D3DXVECTOR3     vecMax;                 // Node box maximum
+    ULONG           Count;                  // Number of objects (leaves only)
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CObjectBVH (Class)
+// Desc : Binned SAH bounding volume hierarchy over a fixed number of object
+//        boxes. Moved objects are refitted incrementally, and once refitting
+//        has degraded the tree far enough a replacement is built on a
+//        background thread and swapped in by a later call to Update.
+// Note : Nodes are stored depth first, so every child follows its parent in
+//        the node array, which is what allows refits to run in a single
+//        reverse pass over the modified nodes.
+//-----------------------------------------------------------------------------
+class CObjectBVH
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CObjectBVH();
+	virtual ~CObjectBVH();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Build           ( const BVH_BOUNDS * pBounds, ULONG Count );
+    void            Release         ( );
+    void            SetBounds       ( ULONG Object, const D3DXVECTOR3 & vecMin, const D3DXVECTOR3 & vecMax );
+    void            Update          ( bool bAllowRebuild = true );
+
+    ULONG           QueryFrustum    ( const CFrustum & Frustum, ULONG * pResults, ULONG MaxResults ) const;
+    ULONG           QuerySphere     ( const D3DXVECTOR3 & vecCentre, float fRadius, ULONG * pResults, ULONG MaxResults ) const;
+    bool            QueryRay        ( const D3DXVECTOR3 & vecOrigin, const D3DXVECTOR3 & vecDir, float fMaxDistance,
+                                      ULONG * pObject, float * pDistance ) const;
+
+    ULONG           GetObjectCount  ( ) const { return m_nObjectCount; }
+    ULONG           GetNodeCount    ( ) const { return m_nNodeCount; }
+    float           GetCostRatio    ( ) const;
+    bool            IsRebuilding    ( ) const { return m_hRebuildThread != NULL; }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            StartRebuild    ( );
+    void            FinishRebuild   ( bool bWait );
+    void            RefitAll        ( );
+    void            LinkNodes       ( );
+    double          NodeCost        ( ULONG Node ) const;
+
+    //-------------------------------------------------------------------------
+	// Private Static Functions For This Class
+	//-------------------------------------------------------------------------
+    static ULONG    BuildNodes      ( const BVH_BOUNDS * pBounds, ULONG Count, BVH_NODE * pNodes, ULONG * pIndices );
+    static unsigned __stdcall RebuildThread( void * pParam );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    ULONG           m_nObjectCount;     // Number of objects in the hierarchy
+    BVH_BOUNDS     *m_pBounds;          // Current box of every object
+    ULONG          *m_pIndices;         // Object indices, referenced by leaf nodes
+    ULONG          *m_pObjectLeaf;      // Leaf node containing each object
+
+    BVH_NODE       *m_pNodes;           // Flattened node array (root at 0)
+    ULONG          *m_pParents;         // Parent of every node
+    ULONG           m_nNodeCount;       // Number of nodes in use
+
+    UCHAR          *m_pNodeDirty;       // Nodes waiting to be refitted
+    ULONG          *m_pDirtyNodes;      // List of nodes waiting to be refitted
+    ULONG           m_nDirtyCount;      // Number of entries in m_pDirtyNodes
+
+    double          m_fCost;            // Current (unnormalised) SAH cost of the tree
+    double          m_fBuildCost;       // SAH cost, relative to root area, when built
+
+    HANDLE          m_hRebuildThread;   // Background rebuild thread (if running)
+    BVH_BOUNDS     *m_pRebuildBounds;   // Snapshot of the boxes being rebuilt
+    BVH_NODE       *m_pRebuildNodes;    // Nodes of the tree being rebuilt
+    ULONG          *m_pRebuildIndices;  // Object indices of the tree being rebuilt
+    ULONG           m_nRebuildNodeCount;// Nodes built by the background thread
+};
+
+#endif // _COBJECTBVH_H_
@@ -0,0 +1,631 @@
+//-----------------------------------------------------------------------------
+// File: COcclusionCuller.cpp
+//
+// Desc: Software occlusion culling against a low resolution depth buffer,
+//       using a min / max depth hierarchy to test object bounds.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// COcclusionCuller Specific Includes
+//-----------------------------------------------------------------------------
+#include "COcclusionCuller.h"
+#include "CCompiledMesh.h"
+#include "CVertexTransform.h"
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <emmintrin.h>
+
+//-----------------------------------------------------------------------------
+// Local Module Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name : Min () / Max ()
+    // Desc : Smallest / largest of two values.
+    //-------------------------------------------------------------------------
+    inline float Min( float a, float b ) { return a < b ? a : b; }
+    inline float Max( float a, float b ) { return a > b ? a : b; }
+    inline LONG  Min( LONG a, LONG b )   { return a < b ? a : b; }
+    inline LONG  Max( LONG a, LONG b )   { return a > b ? a : b; }
+
+    //-------------------------------------------------------------------------
+    // Name : Min3 () / Max3 ()
+    // Desc : Smallest / largest of three values.
+    //-------------------------------------------------------------------------
+    inline float Min3( float a, float b, float c ) { return Min( Min( a, b ), c ); }
+    inline float Max3( float a, float b, float c ) { return Max( Max( a, b ), c ); }
+
+    //-------------------------------------------------------------------------
+    // Name : Reserve ()
+    // Desc : Grows an array so that it can hold at least Count entries.
+    //-------------------------------------------------------------------------
+    bool Reserve( void ** ppData, ULONG * pCapacity, ULONG Count, ULONG Stride )
+    {
+        ULONG  NewCapacity;
+        void * pNewData;
+
+        // Already large enough?
+        if ( Count <= *pCapacity ) return true;
+
+        // Grow by half again, to keep reallocation rare
+        NewCapacity = (*pCapacity < 64) ? 64 : *pCapacity + *pCapacity / 2;
+        if ( NewCapacity < Count ) NewCapacity = Count;
+        if (!( pNewData = realloc( *ppData, NewCapacity * Stride ) )) return false;
+
+        *ppData    = pNewData;
+        *pCapacity = NewCapacity;
+        return true;
+    }
+
+}; // End Namespace
+
+//-----------------------------------------------------------------------------
+// Name : COcclusionCuller () (Constructor)
+// Desc : COcclusionCuller Class Constructor
+//-----------------------------------------------------------------------------
+COcclusionCuller::COcclusionCuller()
+{
+    LARGE_INTEGER Frequency;
+
+	// Reset / Clear all required values
+    m_nWidth           = 0;
+    m_nHeight          = 0;
+    m_pDepth           = NULL;
+    m_pPrevDepth       = NULL;
+    m_pLevels          = NULL;
+    m_nLevelCount      = 0;
+    m_pClip            = NULL;
+    m_pOutCodes        = NULL;
+    m_nClipCapacity    = 0;
+    m_pDecoded         = NULL;
+    m_nDecodedCapacity = 0;
+    m_pDecodedMesh     = NULL;
+    m_bFrameBuilt      = false;
+    m_bTemporal        = false;
+    m_bMergePrev       = false;
+    ZeroMemory( m_pMinZ, sizeof(m_pMinZ) );
+    ZeroMemory( m_pMaxZ, sizeof(m_pMaxZ) );
+    ZeroMemory( &m_Stats, sizeof(OCCLUSION_STATS) );
+    D3DXMatrixIdentity( &m_mtxViewProj );
+    D3DXMatrixIdentity( &m_mtxPrevViewProj );
+
+    QueryPerformanceFrequency( &Frequency );
+    m_fTimerScale = 1000.0 / (double)Frequency.QuadPart;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~COcclusionCuller () (Destructor)
+// Desc : COcclusionCuller Class Destructor
+//-----------------------------------------------------------------------------
+COcclusionCuller::~COcclusionCuller()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Allocates the depth buffers and every level of the hierarchy. The
+//        width is rounded up to a multiple of 4 pixels.
+//-----------------------------------------------------------------------------
+bool COcclusionCuller::Create( ULONG Width, ULONG Height )
+{
+    ULONG Total, i, w, h;
+
+    // Validate
+    if ( Width == 0 || Height == 0 ) return false;
+
+    Release();
+    Width = (Width + 3) & ~3;
+
+    // Each level halves the one before, until a single block remains
+    w = Width; h = Height; Total = 0;
+    for ( i = 0; i < OCCLUSION_MAX_LEVELS; i++ )
+    {
+        m_nLevelWidth[i]  = w;
+        m_nLevelHeight[i] = h;
+        Total += (i == 0) ? w * h : w * h * 2;
+        m_nLevelCount = i + 1;
+        if ( w == 1 && h == 1 ) break;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+
+    } // Next Level
+
+    if (!( m_pDepth     = (float*)malloc( Width * Height * sizeof(float) ) )) goto CreateError;
+    if (!( m_pPrevDepth = (float*)malloc( Width * Height * sizeof(float) ) )) goto CreateError;
+    if (!( m_pLevels    = (float*)malloc( Total * sizeof(float) ) )) goto CreateError;
+
+    // The first level is the depth buffer itself, so its nearest & farthest match
+    m_pMinZ[0] = m_pMaxZ[0] = m_pLevels;
+    for ( i = 1, Total = Width * Height; i < m_nLevelCount; i++ )
+    {
+        m_pMinZ[i] = m_pLevels + Total;
+        m_pMaxZ[i] = m_pMinZ[i] + m_nLevelWidth[i] * m_nLevelHeight[i];
+        Total += m_nLevelWidth[i] * m_nLevelHeight[i] * 2;
+
+    } // Next Level
+
+    m_nWidth  = Width;
+    m_nHeight = Height;
+
+    // Success!
+    return true;
+
+CreateError:
+    // Clean up
+    Release();
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Frees the depth buffers and all working storage.
+//-----------------------------------------------------------------------------
+void COcclusionCuller::Release( )
+{
+    if ( m_pDepth     ) free( m_pDepth );
+    if ( m_pPrevDepth ) free( m_pPrevDepth );
+    if ( m_pLevels    ) free( m_pLevels );
+    if ( m_pClip      ) free( m_pClip );
+    if ( m_pOutCodes  ) free( m_pOutCodes );
+    if ( m_pDecoded   ) free( m_pDecoded );
+
+    m_nWidth           = 0;
+    m_nHeight          = 0;
+    m_pDepth           = NULL;
+    m_pPrevDepth       = NULL;
+    m_pLevels          = NULL;
+    m_nLevelCount      = 0;
+    m_pClip            = NULL;
+    m_pOutCodes        = NULL;
+    m_nClipCapacity    = 0;
+    m_pDecoded         = NULL;
+    m_nDecodedCapacity = 0;
+    m_pDecodedMesh     = NULL;
+    m_bFrameBuilt      = false;
+    ZeroMemory( m_pMinZ, sizeof(m_pMinZ) );
+    ZeroMemory( m_pMaxZ, sizeof(m_pMaxZ) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetElapsed () (Private)
+// Desc : Returns the milliseconds since *pStart, and restarts the
+//        measurement so that consecutive stages can be chained.
+//-----------------------------------------------------------------------------
+float COcclusionCuller::GetElapsed( LARGE_INTEGER * pStart ) const
+{
+    LARGE_INTEGER Now;
+    float         fElapsed;
+
+    QueryPerformanceCounter( &Now );
+    fElapsed = (float)((double)(Now.QuadPart - pStart->QuadPart) * m_fTimerScale);
+    *pStart  = Now;
+    return fElapsed;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Cull ()
+// Desc : Runs the complete pass over the objects which survived frustum
+//        culling, removing those which are hidden from the visible list.
+//        Returns the number of objects left in the list.
+// Note : The objects with the largest projected bounding spheres are chosen
+//        as the occluders, at full detail.
+//-----------------------------------------------------------------------------
+ULONG COcclusionCuller::Cull( const CObject * pObjects, ULONG * pVisible, ULONG VisibleCount,
+                              const D3DXMATRIX & mtxView, const D3DXMATRIX & mtxProjection )
+{
+    ULONG         Occluders[ OCCLUSION_MAX_OCCLUDERS ];
+    float         Sizes[ OCCLUSION_MAX_OCCLUDERS ];
+    ULONG         OccluderCount = 0, i, j, Kept;
+    float         fScale = m_nHeight * 0.5f * mtxProjection._22;
+    D3DXMATRIX    mtxViewProj;
+    LARGE_INTEGER Start;
+
+    // Validate
+    if ( !m_pLevels ) return VisibleCount;
+
+    QueryPerformanceCounter( &Start );
+    D3DXMatrixMultiply( &mtxViewProj, &mtxView, &mtxProjection );
+    BeginFrame( mtxViewProj );
+
+    // Keep the largest objects on screen, in descending order of size
+    for ( i = 0; i < VisibleCount; i++ )
+    {
+        const CObject & Object = pObjects[ pVisible[i] ];
+        const D3DXVECTOR3 & c  = Object.m_vecBoundsCentre;
+        float fDepth, fSize;
+
+        if ( !Object.m_pMesh->GetCompiled() ) continue;
+
+        // Objects reaching the near plane would only have triangles skipped
+        fDepth = c.x * mtxView._13 + c.y * mtxView._23 + c.z * mtxView._33 + mtxView._43;
+        if ( fDepth - Object.m_fBoundsRadius <= 0.0f ) continue;
+
+        fSize = Object.m_fBoundsRadius / fDepth * fScale;
+        if ( fSize < OCCLUSION_MIN_OCCLUDER ) continue;
+        if ( OccluderCount == OCCLUSION_MAX_OCCLUDERS && fSize <= Sizes[ OccluderCount - 1 ] ) continue;
+
+        // Insert in order, dropping the smallest if full
+        if ( OccluderCount < OCCLUSION_MAX_OCCLUDERS ) OccluderCount++;
+        for ( j = OccluderCount - 1; j > 0 && Sizes[ j - 1 ] < fSize; j-- )
+        {
+            Sizes[j]     = Sizes[ j - 1 ];
+            Occluders[j] = Occluders[ j - 1 ];
+
+        } // Next Slot
+        Sizes[j]     = fSize;
+        Occluders[j] = pVisible[i];
+
+    } // Next Object
+
+    // Render them
+    for ( i = 0; i < OccluderCount; i++ )
+    {
+        const CObject & Object = pObjects[ Occluders[i] ];
+        RenderOccluder( Object.m_pMesh->GetCompiled(), Object.m_mtxWorld );
+
+    } // Next Occluder
+    m_Stats.Occluders   = OccluderCount;
+    m_Stats.fRasterTime = GetElapsed( &Start );
+
+    BuildHierarchy();
+    m_Stats.fBuildTime = GetElapsed( &Start );
+
+    // Test every object, compacting the list as we go
+    for ( i = 0, Kept = 0; i < VisibleCount; i++ )
+    {
+        const CObject & Object = pObjects[ pVisible[i] ];
+        if ( IsVisible( Object.m_vecBoundsCentre, Object.m_vecBoundsExtents ) ) pVisible[ Kept++ ] = pVisible[i];
+
+    } // Next Object
+    m_Stats.Tested    = VisibleCount;
+    m_Stats.Occluded  = VisibleCount - Kept;
+    m_Stats.fTestTime = GetElapsed( &Start );
+
+    return Kept;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BeginFrame ()
+// Desc : Clears the depth buffer ready for this frame's occluders, keeping
+//        the last frame's for temporal reuse.
+//-----------------------------------------------------------------------------
+void COcclusionCuller::BeginFrame( const D3DXMATRIX & mtxViewProj )
+{
+    float * pSwap;
+    ULONG   i;
+
+    // Validate
+    if ( !m_pDepth ) return;
+
+    // The frame just completed becomes the previous one
+    pSwap = m_pPrevDepth; m_pPrevDepth = m_pDepth; m_pDepth = pSwap;
+    m_mtxPrevViewProj = m_mtxViewProj;
+    m_mtxViewProj     = mtxViewProj;
+
+    // It can only be reused from the same viewpoint, as it is not reprojected
+    m_bMergePrev  = m_bTemporal && m_bFrameBuilt && memcmp( &m_mtxPrevViewProj, &mtxViewProj, sizeof(D3DXMATRIX) ) == 0;
+    m_bFrameBuilt = false;
+
+    // The mesh may have changed since the last frame
+    m_pDecodedMesh = NULL;
+
+    for ( i = 0; i < m_nWidth * m_nHeight; i++ ) m_pDepth[i] = 1.0f;
+    ZeroMemory( &m_Stats, sizeof(OCCLUSION_STATS) );
+    m_Stats.bTemporal = m_bMergePrev;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RenderOccluder ()
+// Desc : Rasterizes the front facing triangles of a mesh into the depth
+//        buffer.
+//-----------------------------------------------------------------------------
+void COcclusionCuller::RenderOccluder( const CCompiledMesh * pMesh, const D3DXMATRIX & mtxWorld )
+{
+    const CVertex * pVertices;
+    const void    * pIndices;
+    D3DXMATRIX      mtxTransform;
+    ULONG           VertexCount, i, Index[3];
+    bool            b32Bit;
+
+    // Validate
+    if ( !m_pDepth || !pMesh ) return;
+    if ( (VertexCount = pMesh->GetVertexCount()) == 0 || !(pIndices = pMesh->GetIndices()) ) return;
+
+    // Compact meshes are expanded once per frame
+    if (!( pVertices = pMesh->GetVertices() ))
+    {
+        if ( m_pDecodedMesh != pMesh )
+        {
+            if ( !Reserve( (void**)&m_pDecoded, &m_nDecodedCapacity, VertexCount, sizeof(CVertex) ) ) return;
+            if ( !pMesh->DecodeVertices( m_pDecoded ) ) return;
+            m_pDecodedMesh = pMesh;
+
+        } // End if decode
+        pVertices = m_pDecoded;
+
+    } // End if compact only
+
+    // Transform into clip space
+    if ( VertexCount > m_nClipCapacity )
+    {
+        ULONG Capacity = m_nClipCapacity;
+        if ( !Reserve( (void**)&m_pClip, &Capacity, VertexCount, sizeof(D3DXVECTOR4) ) ) return;
+        if ( !Reserve( (void**)&m_pOutCodes, &m_nClipCapacity, VertexCount, sizeof(UCHAR) ) ) return;
+
+    } // End if grow
+    D3DXMatrixMultiply( &mtxTransform, &mtxWorld, &m_mtxViewProj );
+    CVertexTransform::Transform( m_pClip, m_pOutCodes, pVertices, VertexCount, mtxTransform );
+
+    // Rasterize each triangle entirely in front of the near plane
+    b32Bit = (pMesh->GetIndexFormat() == D3DFMT_INDEX32);
+    for ( i = 0; i < pMesh->GetTriangleCount(); i++ )
+    {
+        for ( ULONG k = 0; k < 3; k++ )
+        {
+            Index[k] = b32Bit ? ((const ULONG*)pIndices)[ i * 3 + k ] : ((const USHORT*)pIndices)[ i * 3 + k ];
+
+        } // Next Index
+        if ( Index[0] >= VertexCount || Index[1] >= VertexCount || Index[2] >= VertexCount ) continue;
+
+        UCHAR Codes0 = m_pOutCodes[ Index[0] ], Codes1 = m_pOutCodes[ Index[1] ], Codes2 = m_pOutCodes[ Index[2] ];
+        if ( Codes0 & Codes1 & Codes2 ) continue;
+        if ( (Codes0 | Codes1 | Codes2) & CLIP_NEAR ) continue;
+
+        RasterTriangle( m_pClip[ Index[0] ], m_pClip[ Index[1] ], m_pClip[ Index[2] ] );
+
+    } // Next Triangle
+}
+
+//-----------------------------------------------------------------------------
+// Name : RasterTriangle () (Private)
+// Desc : Projects a triangle and writes its depth to each pixel it covers
+//        entirely, 4 pixels at a time.
+// Note : Counter-clockwise triangles are culled, matching D3DCULL_CCW. The
+//        depth written is the farthest the triangle reaches within the
+//        pixel, so that the buffer never claims more than the occluder hides
+//        at any resolution.
+//-----------------------------------------------------------------------------
+void COcclusionCuller::RasterTriangle( const D3DXVECTOR4 & v0, const D3DXVECTOR4 & v1, const D3DXVECTOR4 & v2 )
+{
+    const D3DXVECTOR4 * pSource[3] = { &v0, &v1, &v2 };
+    float  x[3], y[3], z[3], fArea, A[3], B[3], C[3];
+    float  fHalfWidth = m_nWidth * 0.5f, fHalfHeight = m_nHeight * 0.5f;
+    float  fMinZ, fMaxZ, fDZdX, fDZdY, fBias;
+    LONG   MinX, MinY, MaxX, MaxY, px, py;
+    ULONG  i;
+
+    // Project each vertex
+    for ( i = 0; i < 3; i++ )
+    {
+        const D3DXVECTOR4 & v = *pSource[i];
+        float fInvW = 1.0f / v.w;
+        x[i] = (v.x * fInvW + 1.0f) * fHalfWidth;
+        y[i] = (1.0f - v.y * fInvW) * fHalfHeight;
+        z[i] = v.z * fInvW;
+
+    } // Next Vertex
+
+    // Screen space y points down, so clockwise triangles have a positive area
+    fArea = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if ( fArea <= 0.0f ) return;
+
+    // Pixel centres (at +0.5) inside the bounds, clamped to the buffer
+    MinX = (LONG)ceilf( Min3( x[0], x[1], x[2] ) - 0.5f );
+    MinY = (LONG)ceilf( Min3( y[0], y[1], y[2] ) - 0.5f );
+    MaxX = (LONG)floorf( Max3( x[0], x[1], x[2] ) - 0.5f );
+    MaxY = (LONG)floorf( Max3( y[0], y[1], y[2] ) - 0.5f );
+    if ( MinX < 0 ) MinX = 0;
+    if ( MinY < 0 ) MinY = 0;
+    if ( MaxX > (LONG)m_nWidth  - 1 ) MaxX = (LONG)m_nWidth  - 1;
+    if ( MaxY > (LONG)m_nHeight - 1 ) MaxY = (LONG)m_nHeight - 1;
+    if ( MinX > MaxX || MinY > MaxY ) return;
+
+    // Edge i runs from vertex i to the next, with the inside where E >= 0. Each
+    // is moved inwards by half a pixel, so only whole pixels pass at their centre
+    for ( i = 0; i < 3; i++ )
+    {
+        ULONG n = (i + 1) % 3;
+        A[i] = y[i] - y[n];
+        B[i] = x[n] - x[i];
+        C[i] = -(A[i] * x[i] + B[i] * y[i]) - (fabsf( A[i] ) + fabsf( B[i] )) * 0.5f;
+
+    } // Next Edge
+
+    // Depth plane, relative to the first vertex, raised to the farthest corner of each pixel
+    fDZdX = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / fArea;
+    fDZdY = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / fArea;
+    fBias = (fabsf( fDZdX ) + fabsf( fDZdY )) * 0.5f;
+    fMinZ = Min3( z[0], z[1], z[2] );
+    fMaxZ = Max3( z[0], z[1], z[2] );
+
+    // Step 4 pixels at a time from an aligned start, the edges reject the extra lanes
+    MinX &= ~3;
+    __m128 Lanes  = _mm_set_ps( 3.5f, 2.5f, 1.5f, 0.5f );
+    __m128 Zero   = _mm_setzero_ps();
+    __m128 ZClampMin = _mm_set1_ps( fMinZ ), ZClampMax = _mm_set1_ps( fMaxZ );
+    __m128 StepE0 = _mm_set1_ps( A[0] * 4.0f ), StepE1 = _mm_set1_ps( A[1] * 4.0f ), StepE2 = _mm_set1_ps( A[2] * 4.0f );
+    __m128 StepZ  = _mm_set1_ps( fDZdX * 4.0f );
+
+    for ( py = MinY; py <= MaxY; py++ )
+    {
+        float  fY  = (float)py + 0.5f;
+        __m128 X   = _mm_add_ps( _mm_set1_ps( (float)MinX ), Lanes );
+        __m128 E0  = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( A[0] ), X ), _mm_set1_ps( B[0] * fY + C[0] ) );
+        __m128 E1  = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( A[1] ), X ), _mm_set1_ps( B[1] * fY + C[1] ) );
+        __m128 E2  = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( A[2] ), X ), _mm_set1_ps( B[2] * fY + C[2] ) );
+        __m128 Z   = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( fDZdX ), _mm_sub_ps( X, _mm_set1_ps( x[0] ) ) ),
+                                 _mm_set1_ps( z[0] + fDZdY * (fY - y[0]) + fBias ) );
+        float * pRow = m_pDepth + py * m_nWidth;
+
+        for ( px = MinX; px <= MaxX; px += 4 )
+        {
+            __m128 Mask = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( E0, Zero ), _mm_cmpge_ps( E1, Zero ) ), _mm_cmpge_ps( E2, Zero ) );
+            if ( _mm_movemask_ps( Mask ) )
+            {
+                __m128 Old   = _mm_loadu_ps( pRow + px );
+                __m128 Depth = _mm_min_ps( _mm_max_ps( Z, ZClampMin ), ZClampMax );
+                Depth = _mm_min_ps( Depth, Old );
+                _mm_storeu_ps( pRow + px, _mm_or_ps( _mm_and_ps( Mask, Depth ), _mm_andnot_ps( Mask, Old ) ) );
+
+            } // End if any covered
+
+            E0 = _mm_add_ps( E0, StepE0 );
+            E1 = _mm_add_ps( E1, StepE1 );
+            E2 = _mm_add_ps( E2, StepE2 );
+            Z  = _mm_add_ps( Z, StepZ );
+
+        } // Next Block
+
+    } // Next Row
+
+    m_Stats.OccluderTriangles++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildHierarchy ()
+// Desc : Reduces the depth buffer into blocks, keeping the nearest and
+//        farthest depth of the four blocks beneath each one.
+//-----------------------------------------------------------------------------
+void COcclusionCuller::BuildHierarchy( )
+{
+    ULONG i, Level, x, y;
+
+    // Validate
+    if ( !m_pLevels ) return;
+
+    // The first level is this frame's depth, merged with the last if reusing it
+    if ( m_bMergePrev )
+    {
+        for ( i = 0; i < m_nWidth * m_nHeight; i++ ) m_pMaxZ[0][i] = Min( m_pDepth[i], m_pPrevDepth[i] );
+
+    } // End if temporal
+    else memcpy( m_pMaxZ[0], m_pDepth, m_nWidth * m_nHeight * sizeof(float) );
+
+    for ( Level = 1; Level < m_nLevelCount; Level++ )
+    {
+        ULONG         SrcWidth  = m_nLevelWidth[ Level - 1 ], SrcHeight = m_nLevelHeight[ Level - 1 ];
+        const float * pSrcMin   = m_pMinZ[ Level - 1 ];
+        const float * pSrcMax   = m_pMaxZ[ Level - 1 ];
+        float       * pMin      = m_pMinZ[ Level ];
+        float       * pMax      = m_pMaxZ[ Level ];
+
+        for ( y = 0; y < m_nLevelHeight[ Level ]; y++ )
+        {
+            ULONG y0 = y * 2, y1 = (y * 2 + 1 < SrcHeight) ? y * 2 + 1 : y * 2;
+            for ( x = 0; x < m_nLevelWidth[ Level ]; x++ )
+            {
+                ULONG x0 = x * 2, x1 = (x * 2 + 1 < SrcWidth) ? x * 2 + 1 : x * 2;
+                float fMin = Min( Min( pSrcMin[ y0 * SrcWidth + x0 ], pSrcMin[ y0 * SrcWidth + x1 ] ),
+                                  Min( pSrcMin[ y1 * SrcWidth + x0 ], pSrcMin[ y1 * SrcWidth + x1 ] ) );
+                float fMax = Max( Max( pSrcMax[ y0 * SrcWidth + x0 ], pSrcMax[ y0 * SrcWidth + x1 ] ),
+                                  Max( pSrcMax[ y1 * SrcWidth + x0 ], pSrcMax[ y1 * SrcWidth + x1 ] ) );
+                *pMin++ = fMin;
+                *pMax++ = fMax;
+
+            } // Next Block
+
+        } // Next Row
+
+    } // Next Level
+
+    m_bFrameBuilt = true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsVisible ()
+// Desc : Tests a world space box against the hierarchy, returning false
+//        only if it is certainly hidden.
+//-----------------------------------------------------------------------------
+bool COcclusionCuller::IsVisible( const D3DXVECTOR3 & vecCentre, const D3DXVECTOR3 & vecExtents ) const
+{
+    const D3DXMATRIX & m = m_mtxViewProj;
+    float fMinX = FLT_MAX, fMinY = FLT_MAX, fMaxX = -FLT_MAX, fMaxY = -FLT_MAX, fMinZ = FLT_MAX;
+    LONG  x0, y0, x1, y1;
+    ULONG i, Level;
+
+    // Validate
+    if ( !m_bFrameBuilt ) return true;
+
+    // Project every corner of the box
+    for ( i = 0; i < 8; i++ )
+    {
+        float cx = vecCentre.x + ((i & 1) ? vecExtents.x : -vecExtents.x);
+        float cy = vecCentre.y + ((i & 2) ? vecExtents.y : -vecExtents.y);
+        float cz = vecCentre.z + ((i & 4) ? vecExtents.z : -vecExtents.z);
+        float w  = cx * m._14 + cy * m._24 + cz * m._34 + m._44;
+        float z  = cx * m._13 + cy * m._23 + cz * m._33 + m._43;
+
+        // Boxes reaching the near plane are always drawn
+        if ( w <= 1e-6f || z < 0.0f ) return true;
+
+        float fInvW = 1.0f / w;
+        float x = (cx * m._11 + cy * m._21 + cz * m._31 + m._41) * fInvW;
+        float y = (cx * m._12 + cy * m._22 + cz * m._32 + m._42) * fInvW;
+        fMinX = Min( fMinX, x ); fMaxX = Max( fMaxX, x );
+        fMinY = Min( fMinY, y ); fMaxY = Max( fMaxY, y );
+        fMinZ = Min( fMinZ, z * fInvW );
+
+    } // Next Corner
+
+    // Every pixel the box overlaps, clamped to the buffer
+    x0 = (LONG)floorf( (fMinX + 1.0f) * m_nWidth * 0.5f );
+    x1 = (LONG)floorf( (fMaxX + 1.0f) * m_nWidth * 0.5f );
+    y0 = (LONG)floorf( (1.0f - fMaxY) * m_nHeight * 0.5f );
+    y1 = (LONG)floorf( (1.0f - fMinY) * m_nHeight * 0.5f );
+    if ( x0 < 0 ) x0 = 0;
+    if ( y0 < 0 ) y0 = 0;
+    if ( x1 > (LONG)m_nWidth  - 1 ) x1 = (LONG)m_nWidth  - 1;
+    if ( y1 > (LONG)m_nHeight - 1 ) y1 = (LONG)m_nHeight - 1;
+    if ( x0 > x1 || y0 > y1 ) return true;
+
+    // Start from the level where the box covers at most 2 x 2 blocks
+    for ( Level = 0; Level + 1 < m_nLevelCount; Level++ )
+    {
+        if ( (x1 >> Level) - (x0 >> Level) <= 1 && (y1 >> Level) - (y0 >> Level) <= 1 ) break;
+
+    } // Next Level
+
+    return TestRect( Level, x0, y0, x1, y1, fMinZ - OCCLUSION_DEPTH_BIAS );
+}
+
+//-----------------------------------------------------------------------------
+// Name : TestRect () (Private)
+// Desc : Returns true if any part of the rectangle (in pixels) may be nearer
+//        than the occluders, descending only into blocks which can't decide.
+// Note : A block whose nearest depth is behind the box can't contain anything
+//        that hides it, so the box is visible without looking further.
+//-----------------------------------------------------------------------------
+bool COcclusionCuller::TestRect( ULONG Level, LONG x0, LONG y0, LONG x1, LONG y1, float fDepth ) const
+{
+    const float * pMin = m_pMinZ[ Level ];
+    const float * pMax = m_pMaxZ[ Level ];
+    ULONG         Width = m_nLevelWidth[ Level ];
+    LONG          bx, by;
+
+    for ( by = y0 >> Level; by <= (y1 >> Level); by++ )
+    {
+        for ( bx = x0 >> Level; bx <= (x1 >> Level); bx++ )
+        {
+            ULONG i = by * Width + bx;
+
+            // Hidden throughout this block
+            if ( pMax[i] < fDepth ) continue;
+            if ( Level == 0 || fDepth <= pMin[i] ) return true;
+
+            // Look at the part of the rectangle inside this block more closely
+            LONG cx0 = Max( x0, bx << Level ), cx1 = Min( x1, ((bx + 1) << Level) - 1 );
+            LONG cy0 = Max( y0, by << Level ), cy1 = Min( y1, ((by + 1) << Level) - 1 );
+            if ( TestRect( Level - 1, cx0, cy0, cx1, cy1, fDepth ) ) return true;
+
+        } // Next Block
+
+    } // Next Row
+
+    // Hidden everywhere
+    return false;
+}
@@ -0,0 +1,130 @@
+//-----------------------------------------------------------------------------
+// File: COcclusionCuller.h
+//
+// Desc: Software occlusion culling against a low resolution depth buffer,
+//       using a min / max depth hierarchy to test object bounds.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _COCCLUSIONCULLER_H_
+#define _COCCLUSIONCULLER_H_
+
+//-----------------------------------------------------------------------------
+// COcclusionCuller Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CObject.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG OCCLUSION_WIDTH         = 256;      // Depth buffer width (multiple of 4)
+const ULONG OCCLUSION_HEIGHT        = 128;      // Depth buffer height
+const ULONG OCCLUSION_MAX_LEVELS    = 10;       // Levels in the depth hierarchy, including the buffer itself
+const ULONG OCCLUSION_MAX_OCCLUDERS = 32;       // Objects rendered into the buffer each frame
+const float OCCLUSION_MIN_OCCLUDER  = 8.0f;     // Smallest occluder, as a projected radius in buffer pixels
+const float OCCLUSION_DEPTH_BIAS    = 1e-5f;    // Moves tested boxes towards the viewer, so no object hides itself
+
+//-----------------------------------------------------------------------------
+// Name : OCCLUSION_STATS (Struct)
+// Desc : Results, and cost in milliseconds, of the most recent occlusion pass.
+//-----------------------------------------------------------------------------
+struct OCCLUSION_STATS
+{
+    ULONG       Tested;                 // Objects tested against the hierarchy
+    ULONG       Occluded;               // Objects found to be hidden
+    ULONG       Occluders;              // Objects rendered into the depth buffer
+    ULONG       OccluderTriangles;      // Triangles rasterized for the occluders
+    bool        bTemporal;              // Was the previous frame's depth reused ?
+    float       fRasterTime;            // Selecting & rasterizing the occluders
+    float       fBuildTime;             // Building the hierarchy
+    float       fTestTime;              // Testing the objects
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : COcclusionCuller (Class)
+// Desc : Rasterizes the largest objects on screen into a small depth buffer,
+//        then reduces it into a hierarchy storing the nearest and farthest
+//        depth of each block. Objects are hidden when every block their
+//        screen bounds touch is nearer than the nearest point of their box.
+// Note : Only compiled meshes are used as occluders, though any object may
+//        be tested. Triangles crossing the near plane are skipped, and only
+//        pixels which a triangle covers entirely are written, so the result
+//        is conservative. Occluders are rasterized 4 pixels at a time using
+//        SSE2.
+//        With temporal reuse enabled, the previous frame's occluder depth is
+//        merged in while the view is unchanged. An object moving out from
+//        behind an occluder may then appear a frame late.
+//-----------------------------------------------------------------------------
+class COcclusionCuller
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         COcclusionCuller();
+	virtual ~COcclusionCuller();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Create          ( ULONG Width = OCCLUSION_WIDTH, ULONG Height = OCCLUSION_HEIGHT );
+    void            Release         ( );
+    void            SetTemporal     ( bool bTemporal ) { m_bTemporal = bTemporal; }
+
+    ULONG           Cull            ( const CObject * pObjects, ULONG * pVisible, ULONG VisibleCount,
+                                      const D3DXMATRIX & mtxView, const D3DXMATRIX & mtxProjection );
+
+    void            BeginFrame      ( const D3DXMATRIX & mtxViewProj );
+    void            RenderOccluder  ( const CCompiledMesh * pMesh, const D3DXMATRIX & mtxWorld );
+    void            BuildHierarchy  ( );
+    bool            IsVisible       ( const D3DXVECTOR3 & vecCentre, const D3DXVECTOR3 & vecExtents ) const;
+
+    const OCCLUSION_STATS & GetStats( ) const { return m_Stats; }
+    const float   * GetDepthBuffer  ( ) const { return m_pMaxZ[0]; }
+    ULONG           GetWidth        ( ) const { return m_nWidth; }
+    ULONG           GetHeight       ( ) const { return m_nHeight; }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    void            RasterTriangle  ( const D3DXVECTOR4 & v0, const D3DXVECTOR4 & v1, const D3DXVECTOR4 & v2 );
+    bool            TestRect        ( ULONG Level, LONG x0, LONG y0, LONG x1, LONG y1, float fDepth ) const;
+    float           GetElapsed      ( LARGE_INTEGER * pStart ) const;
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    ULONG               m_nWidth;           // Depth buffer size in pixels
+    ULONG               m_nHeight;
+    float             * m_pDepth;           // Occluder depth rendered this frame
+    float             * m_pPrevDepth;       // Occluder depth rendered last frame
+    float             * m_pLevels;          // Storage for every level of the hierarchy
+    float             * m_pMinZ[ OCCLUSION_MAX_LEVELS ]; // Nearest depth of each block, by level
+    float             * m_pMaxZ[ OCCLUSION_MAX_LEVELS ]; // Farthest depth of each block, by level
+    ULONG               m_nLevelWidth[ OCCLUSION_MAX_LEVELS ];
+    ULONG               m_nLevelHeight[ OCCLUSION_MAX_LEVELS ];
+    ULONG               m_nLevelCount;
+
+    D3DXVECTOR4       * m_pClip;            // Transformed vertices of the current occluder
+    UCHAR             * m_pOutCodes;        // Outcodes of the current occluder's vertices
+    ULONG               m_nClipCapacity;
+    CVertex           * m_pDecoded;         // Expanded vertices of a compact mesh
+    ULONG               m_nDecodedCapacity;
+    const CCompiledMesh * m_pDecodedMesh;   // Mesh m_pDecoded currently holds
+
+    D3DXMATRIX          m_mtxViewProj;      // View * projection for this frame
+    D3DXMATRIX          m_mtxPrevViewProj;  // View * projection m_pPrevDepth was rendered with
+    bool                m_bFrameBuilt;      // Does m_pDepth hold a complete frame ?
+    bool                m_bTemporal;        // Reuse the previous frame's depth ?
+    bool                m_bMergePrev;       // Is m_pPrevDepth being merged this frame ?
+    OCCLUSION_STATS     m_Stats;            // Results of the most recent pass
+    double              m_fTimerScale;      // Milliseconds per performance counter tick
+};
+
+#endif // _COCCLUSIONCULLER_H_
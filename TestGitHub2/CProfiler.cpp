@@ -0,0 +1,318 @@
+//-----------------------------------------------------------------------------
+// File: CProfiler.cpp
+//
+// Desc: Scoped CPU profiling zones, recorded per thread and written out as a
+//       Chrome / Perfetto trace or summarised as a zone tree.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CProfiler Specific Includes
+//-----------------------------------------------------------------------------
+#include "CProfiler.h"
+#include <stdlib.h>
+#include <string.h>
+
+//-----------------------------------------------------------------------------
+// Static Member Definitions
+//-----------------------------------------------------------------------------
+bool            CProfiler::m_bEnabled       = false;
+DWORD           CProfiler::m_TlsIndex       = TLS_OUT_OF_INDEXES;
+PROFILE_THREAD  CProfiler::m_Threads[ PROFILER_MAX_THREADS ];
+volatile LONG   CProfiler::m_nThreads       = 0;
+ULONG           CProfiler::m_MaxEvents      = 0;
+ULONG           CProfiler::m_nFrames        = 0;
+__int64         CProfiler::m_StartTime      = 0;
+double          CProfiler::m_fTickToMS      = 0.0;
+PROFILE_NODE  * CProfiler::m_pNodes         = NULL;
+ULONG           CProfiler::m_nNodeCount     = 0;
+ULONG           CProfiler::m_nNodeCapacity  = 0;
+
+//-----------------------------------------------------------------------------
+// Name : Create () (Static)
+// Desc : Enables profiling, each thread recording up to MaxEvents zones.
+// Note : Must be called before any thread other than the caller opens a
+//        zone, and not while another thread may be recording.
+//-----------------------------------------------------------------------------
+bool CProfiler::Create( ULONG MaxEvents )
+{
+    LARGE_INTEGER Frequency;
+
+    Release();
+
+    // Validate (there would be nothing to record with the zones compiled out)
+    if ( MaxEvents == 0 || !USE_PROFILER ) return false;
+
+    if ( (m_TlsIndex = TlsAlloc()) == TLS_OUT_OF_INDEXES ) return false;
+    ZeroMemory( m_Threads, sizeof(m_Threads) );
+    m_nThreads  = 0;
+    m_MaxEvents = MaxEvents;
+    m_nFrames   = 0;
+
+    QueryPerformanceFrequency( &Frequency );
+    m_fTickToMS = 1000.0 / (double)Frequency.QuadPart;
+    m_StartTime = ReadClock();
+    m_bEnabled  = true;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release () (Static)
+// Desc : Disables profiling and frees every thread's zones.
+//-----------------------------------------------------------------------------
+void CProfiler::Release( )
+{
+    m_bEnabled = false;
+
+    for ( ULONG i = 0; i < PROFILER_MAX_THREADS; i++ )
+    {
+        if ( m_Threads[i].pEvents ) free( m_Threads[i].pEvents );
+        m_Threads[i].pEvents = NULL;
+        m_Threads[i].Count   = 0;
+
+    } // Next Thread
+
+    if ( m_TlsIndex != TLS_OUT_OF_INDEXES ) TlsFree( m_TlsIndex );
+    m_TlsIndex = TLS_OUT_OF_INDEXES;
+    m_nThreads = 0;
+
+    if ( m_pNodes ) free( m_pNodes );
+    m_pNodes        = NULL;
+    m_nNodeCount    = 0;
+    m_nNodeCapacity = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetThread () (Private, Static)
+// Desc : Returns the calling thread's buffer, claiming one if it has none.
+//        Returns NULL once every buffer has been claimed.
+//-----------------------------------------------------------------------------
+PROFILE_THREAD * CProfiler::GetThread( )
+{
+    PROFILE_THREAD * pThread;
+    ULONG            Slot;
+
+    if (( pThread = (PROFILE_THREAD*)TlsGetValue( m_TlsIndex ) )) return pThread;
+
+    // Claim the next buffer
+    Slot = (ULONG)InterlockedIncrement( &m_nThreads ) - 1;
+    if ( Slot >= PROFILER_MAX_THREADS ) return NULL;
+    pThread = &m_Threads[ Slot ];
+    if (!( pThread->pEvents = (PROFILE_EVENT*)malloc( m_MaxEvents * sizeof(PROFILE_EVENT) ) )) return NULL;
+
+    pThread->ThreadId = GetCurrentThreadId();
+    _snprintf( pThread->strName, sizeof(pThread->strName) - 1, "Thread %lu", (unsigned long)pThread->ThreadId );
+    TlsSetValue( m_TlsIndex, pThread );
+    return pThread;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetThreadName () (Static)
+// Desc : Names the calling thread in the trace & zone tree.
+//-----------------------------------------------------------------------------
+void CProfiler::SetThreadName( const char * strName )
+{
+    PROFILE_THREAD * pThread;
+
+    if ( !m_bEnabled || !(pThread = GetThread()) ) return;
+    strncpy( pThread->strName, strName, sizeof(pThread->strName) - 1 );
+}
+
+//-----------------------------------------------------------------------------
+// Name : EnterZone () (Static)
+// Desc : Opens a zone on the calling thread, returning its buffer.
+//-----------------------------------------------------------------------------
+PROFILE_THREAD * CProfiler::EnterZone( )
+{
+    PROFILE_THREAD * pThread;
+
+    if (!( pThread = GetThread() )) return NULL;
+    pThread->Depth++;
+    return pThread;
+}
+
+//-----------------------------------------------------------------------------
+// Name : LeaveZone () (Static)
+// Desc : Closes the innermost zone open on the thread, recording it.
+//-----------------------------------------------------------------------------
+void CProfiler::LeaveZone( PROFILE_THREAD * pThread, const char * strName, __int64 Start )
+{
+    __int64 End = ReadClock();
+    LONG    Count = pThread->Count;
+
+    pThread->Depth--;
+    if ( (ULONG)Count >= m_MaxEvents ) { pThread->Dropped++; return; }
+
+    PROFILE_EVENT & Event = pThread->pEvents[ Count ];
+    Event.strName = strName;
+    Event.Start   = Start;
+    Event.End     = End;
+    Event.Depth   = pThread->Depth;
+    pThread->Count = Count + 1;
+}
+
+//-----------------------------------------------------------------------------
+// Name : WriteTrace () (Static)
+// Desc : Writes every zone recorded to a Chrome trace event file, which
+//        chrome://tracing and Perfetto can load.
+// Note : Times are written in microseconds, to the nearest nanosecond.
+//-----------------------------------------------------------------------------
+bool CProfiler::WriteTrace( LPCTSTR strFileName )
+{
+    FILE  * pFile;
+    ULONG   Threads = ((ULONG)m_nThreads < PROFILER_MAX_THREADS) ? (ULONG)m_nThreads : PROFILER_MAX_THREADS;
+    bool    bFirst  = true;
+    double  fTickToUS = m_fTickToMS * 1000.0;
+
+    if ( !m_bEnabled ) return false;
+    if (!( pFile = _tfopen( strFileName, _T("w") ) )) return false;
+
+    fprintf( pFile, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" );
+    for ( ULONG t = 0; t < Threads; t++ )
+    {
+        const PROFILE_THREAD & Thread = m_Threads[t];
+        if ( !Thread.pEvents ) continue;
+
+        // Thread name metadata
+        fprintf( pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+                 bFirst ? "" : ",\n", (unsigned long)Thread.ThreadId, Thread.strName );
+        bFirst = false;
+
+        // A complete event for each zone
+        for ( LONG e = 0; e < Thread.Count; e++ )
+        {
+            const PROFILE_EVENT & Event = Thread.pEvents[e];
+            fprintf( pFile, ",\n{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+                     Event.strName, (unsigned long)Thread.ThreadId, (double)(Event.Start - m_StartTime) * fTickToUS,
+                     (double)(Event.End - Event.Start) * fTickToUS );
+
+        } // Next Event
+
+    } // Next Thread
+    fprintf( pFile, "\n]}\n" );
+
+    fclose( pFile );
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddNode () (Private, Static)
+// Desc : Returns the child of the node specified with the name given,
+//        adding it if there is none yet. Returns ~0 if out of memory.
+//-----------------------------------------------------------------------------
+ULONG CProfiler::AddNode( ULONG Parent, const char * strName )
+{
+    PROFILE_NODE * pNodes;
+    ULONG          Child, Capacity;
+
+    // Already present?
+    for ( Child = m_pNodes[ Parent ].FirstChild; Child != (ULONG)~0; Child = m_pNodes[ Child ].NextSibling )
+    {
+        if ( m_pNodes[ Child ].strName == strName || strcmp( m_pNodes[ Child ].strName, strName ) == 0 ) return Child;
+
+    } // Next Child
+
+    // Grow by half again, to keep reallocation rare
+    if ( m_nNodeCount == m_nNodeCapacity )
+    {
+        Capacity = (m_nNodeCapacity < 64) ? 64 : m_nNodeCapacity + m_nNodeCapacity / 2;
+        if (!( pNodes = (PROFILE_NODE*)realloc( m_pNodes, Capacity * sizeof(PROFILE_NODE) ) )) return (ULONG)~0;
+        m_pNodes        = pNodes;
+        m_nNodeCapacity = Capacity;
+
+    } // End if full
+
+    // Link in as the parent's first child. Zones are added latest first, so
+    // this leaves the children in the order they are called.
+    Child = m_nNodeCount++;
+    ZeroMemory( &m_pNodes[ Child ], sizeof(PROFILE_NODE) );
+    m_pNodes[ Child ].strName     = strName;
+    m_pNodes[ Child ].Parent      = Parent;
+    m_pNodes[ Child ].FirstChild  = (ULONG)~0;
+    m_pNodes[ Child ].NextSibling = m_pNodes[ Parent ].FirstChild;
+    m_pNodes[ Parent ].FirstChild = Child;
+
+    return Child;
+}
+
+//-----------------------------------------------------------------------------
+// Name : WriteZoneTree () (Static)
+// Desc : Writes each thread's zones as a tree, with the time spent in each
+//        path and its calls averaged per frame.
+// Note : Zones are recorded as they close, so a zone's children precede it.
+//        Walking them backwards, every zone is seen before its children,
+//        and its parent is the last zone seen one level out.
+//-----------------------------------------------------------------------------
+void CProfiler::WriteZoneTree( FILE * pFile )
+{
+    ULONG  Threads = ((ULONG)m_nThreads < PROFILER_MAX_THREADS) ? (ULONG)m_nThreads : PROFILER_MAX_THREADS;
+    ULONG  Path[64], Node, Depth;
+    double fFrames = (m_nFrames > 0) ? (double)m_nFrames : 1.0;
+
+    if ( !m_bEnabled || !pFile ) return;
+
+    fprintf( pFile, "Zone tree, %lu frames          ms/frame  calls/frame    max ms\n", (unsigned long)m_nFrames );
+    for ( ULONG t = 0; t < Threads; t++ )
+    {
+        const PROFILE_THREAD & Thread = m_Threads[t];
+        if ( !Thread.pEvents || Thread.Count == 0 ) continue;
+
+        // Start a new tree with the thread as its root
+        m_nNodeCount = 0;
+        if ( !m_nNodeCapacity )
+        {
+            if (!( m_pNodes = (PROFILE_NODE*)malloc( 64 * sizeof(PROFILE_NODE) ) )) return;
+            m_nNodeCapacity = 64;
+
+        } // End if no nodes
+        ZeroMemory( &m_pNodes[0], sizeof(PROFILE_NODE) );
+        m_pNodes[0].strName     = Thread.strName;
+        m_pNodes[0].FirstChild  = (ULONG)~0;
+        m_pNodes[0].NextSibling = (ULONG)~0;
+        m_nNodeCount = 1;
+
+        // Sum every zone into the node for its path
+        Path[0] = 0;
+        for ( LONG e = Thread.Count - 1; e >= 0; e-- )
+        {
+            const PROFILE_EVENT & Event = Thread.pEvents[e];
+            double fTime = (double)(Event.End - Event.Start) * m_fTickToMS;
+
+            if ( Event.Depth >= 63 ) continue;
+            if ( (Node = AddNode( Path[ Event.Depth ], Event.strName )) == (ULONG)~0 ) return;
+            Path[ Event.Depth + 1 ] = Node;
+            m_pNodes[ Node ].Calls++;
+            m_pNodes[ Node ].fTotal += fTime;
+            if ( fTime > m_pNodes[ Node ].fMax ) m_pNodes[ Node ].fMax = fTime;
+
+        } // Next Event
+
+        // Write it out depth first
+        fprintf( pFile, "%s (%ld zones, %lu dropped)\n", Thread.strName, (long)Thread.Count, (unsigned long)Thread.Dropped );
+        Node  = m_pNodes[0].FirstChild;
+        Depth = 1;
+        while ( Node != (ULONG)~0 )
+        {
+            const PROFILE_NODE & Entry = m_pNodes[ Node ];
+            fprintf( pFile, "%*s%-*s %10.4f %12.2f %9.4f\n", (int)(Depth * 2), "", (int)(34 - Depth * 2), Entry.strName,
+                     Entry.fTotal / fFrames, Entry.Calls / fFrames, Entry.fMax );
+
+            // Down, along, or back up until a sibling is found
+            if ( Entry.FirstChild != (ULONG)~0 ) { Node = Entry.FirstChild; Depth++; continue; }
+            while ( Node != (ULONG)~0 && m_pNodes[ Node ].NextSibling == (ULONG)~0 )
+            {
+                Node = m_pNodes[ Node ].Parent;
+                if ( Node == 0 ) { Node = (ULONG)~0; break; }
+                Depth--;
+
+            } // Next Parent
+            if ( Node != (ULONG)~0 ) Node = m_pNodes[ Node ].NextSibling;
+
+        } // Next Node
+        fprintf( pFile, "\n" );
+
+    } // Next Thread
+}
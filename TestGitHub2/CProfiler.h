@@ -0,0 +1,190 @@
+//-----------------------------------------------------------------------------
+// File: CProfiler.h
+//
+// Desc: Scoped CPU profiling zones, recorded per thread and written out as a
+//       Chrome / Perfetto trace or summarised as a zone tree.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CPROFILER_H_
+#define _CPROFILER_H_
+
+//-----------------------------------------------------------------------------
+// CProfiler Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include <stdio.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+#ifndef USE_PROFILER
+#define USE_PROFILER            1               // Define as 0 to compile every zone out
+#endif
+
+const ULONG PROFILER_MAX_THREADS    = 32;       // Threads which may record zones
+const ULONG PROFILER_MAX_EVENTS     = 131072;   // Zones each thread can record before dropping them
+
+#define PROFILE_JOIN2( a, b )   a##b
+#define PROFILE_JOIN( a, b )    PROFILE_JOIN2( a, b )
+
+#if USE_PROFILER
+#define PROFILE_ZONE( Name )                CProfileZone PROFILE_JOIN( ProfileZone, __LINE__ )( Name )
+#define PROFILE_ZONE_NAMED( Zone, Name )    CProfileZone Zone( Name )
+#define PROFILE_ZONE_END( Zone )            Zone.End()
+#define PROFILE_THREAD( Name )              CProfiler::SetThreadName( Name )
+#define PROFILE_FRAME( )                    CProfiler::BeginFrame()
+#else
+#define PROFILE_ZONE( Name )
+#define PROFILE_ZONE_NAMED( Zone, Name )
+#define PROFILE_ZONE_END( Zone )
+#define PROFILE_THREAD( Name )
+#define PROFILE_FRAME( )
+#endif
+
+//-----------------------------------------------------------------------------
+// Name : PROFILE_EVENT (Struct)
+// Desc : One completed zone, with its times in performance counter ticks.
+//-----------------------------------------------------------------------------
+struct PROFILE_EVENT
+{
+    const char    * strName;            // Zone name (must outlive the profiler)
+    __int64         Start;
+    __int64         End;
+    ULONG           Depth;              // Zones open around this one on its thread
+};
+
+//-----------------------------------------------------------------------------
+// Name : PROFILE_THREAD (Struct)
+// Desc : The zones recorded by one thread. Only the owning thread writes to
+//        its buffer, so no locking is needed while recording.
+//-----------------------------------------------------------------------------
+struct PROFILE_THREAD
+{
+    DWORD           ThreadId;
+    char            strName[32];
+    PROFILE_EVENT * pEvents;
+    volatile LONG   Count;              // Zones completed
+    ULONG           Dropped;            // Zones lost once the buffer filled
+    ULONG           Depth;              // Zones currently open
+};
+
+//-----------------------------------------------------------------------------
+// Name : PROFILE_NODE (Struct)
+// Desc : Zone tree entry, summing every call to a zone along one path.
+//-----------------------------------------------------------------------------
+struct PROFILE_NODE
+{
+    const char    * strName;
+    ULONG           Parent;
+    ULONG           FirstChild;
+    ULONG           NextSibling;
+    ULONG           Calls;
+    double          fTotal;             // Milliseconds
+    double          fMax;               // Longest single call (ms)
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CProfiler (Class)
+// Desc : Collects the zones opened on every thread while profiling is
+//        enabled. Each thread claims a buffer the first time it opens a zone,
+//        and appends to it without locking.
+// Note : All static, so zones may be opened anywhere without access to the
+//        application. The trace & tree may only be written while no other
+//        thread is recording, i.e. once the render thread has stopped and
+//        the workers are idle.
+//-----------------------------------------------------------------------------
+class CProfiler
+{
+public:
+	//-------------------------------------------------------------------------
+	// Public Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static bool     Create          ( ULONG MaxEvents = PROFILER_MAX_EVENTS );
+    static void     Release         ( );
+    static bool     IsEnabled       ( ) { return m_bEnabled; }
+
+    static void     SetThreadName   ( const char * strName );
+    static void     BeginFrame      ( ) { if ( m_bEnabled ) m_nFrames++; }
+    static ULONG    GetFrameCount   ( ) { return m_nFrames; }
+
+    static bool     WriteTrace      ( LPCTSTR strFileName );
+    static void     WriteZoneTree   ( FILE * pFile );
+
+    // Used by CProfileZone
+    static PROFILE_THREAD * EnterZone( );
+    static void     LeaveZone       ( PROFILE_THREAD * pThread, const char * strName, __int64 Start );
+    static __int64  ReadClock       ( ) { LARGE_INTEGER Time; QueryPerformanceCounter( &Time ); return Time.QuadPart; }
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static PROFILE_THREAD * GetThread( );
+    static ULONG    AddNode         ( ULONG Parent, const char * strName );
+
+	//-------------------------------------------------------------------------
+	// Private Static Variables for This Class
+	//-------------------------------------------------------------------------
+    static bool             m_bEnabled;
+    static DWORD            m_TlsIndex;         // Thread local slot holding each thread's buffer
+    static PROFILE_THREAD   m_Threads[ PROFILER_MAX_THREADS ];
+    static volatile LONG    m_nThreads;         // Buffers claimed (may pass the maximum)
+    static ULONG            m_MaxEvents;
+    static ULONG            m_nFrames;          // Frames begun while enabled
+    static __int64          m_StartTime;        // Clock when profiling was enabled
+    static double           m_fTickToMS;        // Milliseconds per clock tick
+    static PROFILE_NODE   * m_pNodes;           // Zone tree being built
+    static ULONG            m_nNodeCount;
+    static ULONG            m_nNodeCapacity;
+};
+
+//-----------------------------------------------------------------------------
+// Name : CProfileZone (Class)
+// Desc : Times the scope it is declared in, as a zone of the name given.
+//        End may be called to close the zone before the scope does.
+// Note : Does nothing unless the profiler is enabled. Use the PROFILE_ZONE
+//        macros, so that zones are compiled out along with the profiler.
+//-----------------------------------------------------------------------------
+class CProfileZone
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+    CProfileZone( const char * strName )
+    {
+        m_strName = strName;
+        m_pThread = CProfiler::IsEnabled() ? CProfiler::EnterZone() : NULL;
+        if ( m_pThread ) m_Start = CProfiler::ReadClock();
+    }
+   ~CProfileZone( ) { End(); }
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    void End( )
+    {
+        if ( !m_pThread ) return;
+        CProfiler::LeaveZone( m_pThread, m_strName, m_Start );
+        m_pThread = NULL;
+    }
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    const char     * m_strName;
+    PROFILE_THREAD * m_pThread;         // Recording thread, or NULL if not recording
+    __int64          m_Start;
+
+    // Zones are tied to their scope, copying is not supported.
+    CProfileZone( const CProfileZone & );
+    CProfileZone & operator=( const CProfileZone & );
+};
+
+#endif // _CPROFILER_H_
@@ -0,0 +1,246 @@
+//-----------------------------------------------------------------------------
+// File: CRenderBackend.cpp
+//
+// Desc: Rendering backend interface through which the application submits
+//       every frame, along with a null backend which only counts the work.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CRenderBackend Specific Includes
+//-----------------------------------------------------------------------------
+#include "CRenderBackend.h"
+#include "CCompiledMesh.h"
+
+//-----------------------------------------------------------------------------
+// IRenderBackend Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : GetVertexCount () (Static)
+// Desc : Returns the number of vertices (or indices) read when drawing
+//        PrimitiveCount primitives of the specified type.
+//-----------------------------------------------------------------------------
+ULONG IRenderBackend::GetVertexCount( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount )
+{
+    if ( PrimitiveCount == 0 ) return 0;
+
+    switch ( Type )
+    {
+        case D3DPT_POINTLIST:       return PrimitiveCount;
+        case D3DPT_LINELIST:        return PrimitiveCount * 2;
+        case D3DPT_LINESTRIP:       return PrimitiveCount + 1;
+        case D3DPT_TRIANGLELIST:    return PrimitiveCount * 3;
+        case D3DPT_TRIANGLESTRIP:
+        case D3DPT_TRIANGLEFAN:     return PrimitiveCount + 2;
+        default:                    return 0;
+
+    } // End Switch
+}
+
+//-----------------------------------------------------------------------------
+// CNullRenderBackend Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CNullRenderBackend () (Constructor)
+// Desc : CNullRenderBackend Class Constructor
+//-----------------------------------------------------------------------------
+CNullRenderBackend::CNullRenderBackend()
+{
+	// Reset / Clear all required values
+    m_bInstancing = true;
+    m_pStreamData = NULL;
+    m_Stream.Create( DYNAMIC_STREAM_SIZE, DYNAMIC_FRAMES_IN_FLIGHT );
+    ResetStats();
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CNullRenderBackend () (Destructor)
+// Desc : CNullRenderBackend Class Destructor
+//-----------------------------------------------------------------------------
+CNullRenderBackend::~CNullRenderBackend()
+{
+    if ( m_pStreamData ) free( m_pStreamData );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetStats ()
+// Desc : Zeroes every counter, and forgets the current device state so that
+//        the next change of each value is counted.
+//-----------------------------------------------------------------------------
+void CNullRenderBackend::ResetStats( )
+{
+    ZeroMemory( &m_Stats, sizeof(RENDER_STATS) );
+    m_Stream.ResetStats();
+    ZeroMemory( m_StateSet, sizeof(m_StateSet) );
+    ZeroMemory( m_TransformSet, sizeof(m_TransformSet) );
+    m_nRedundant = 0;
+    m_FVF        = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Clear ()
+// Desc : Records a clear.
+//-----------------------------------------------------------------------------
+void CNullRenderBackend::Clear( ULONG Flags, D3DCOLOR Color, float fZ )
+{
+    m_Stats.Clears++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Present ()
+// Desc : Records the end of a frame.
+//-----------------------------------------------------------------------------
+bool CNullRenderBackend::Present( )
+{
+    m_Stats.Frames++;
+    m_Stream.EndFrame();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetRenderState ()
+// Desc : Records a render state change, unless the value is already set.
+//-----------------------------------------------------------------------------
+void CNullRenderBackend::SetRenderState( D3DRENDERSTATETYPE State, ULONG Value )
+{
+    if ( (ULONG)State < MAX_RENDER_STATES )
+    {
+        if ( m_StateSet[ State ] && m_RenderStates[ State ] == Value ) { m_nRedundant++; return; }
+        m_RenderStates[ State ] = Value;
+        m_StateSet[ State ]     = true;
+
+    } // End if tracked
+
+    m_Stats.StateChanges++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetTransform ()
+// Desc : Records a transform change, unless the matrix is already set.
+//-----------------------------------------------------------------------------
+void CNullRenderBackend::SetTransform( D3DTRANSFORMSTATETYPE State, const D3DXMATRIX & mtx )
+{
+    if ( (ULONG)State < MAX_TRANSFORMS )
+    {
+        if ( m_TransformSet[ State ] && memcmp( &m_Transforms[ State ], &mtx, sizeof(D3DXMATRIX) ) == 0 ) { m_nRedundant++; return; }
+        m_Transforms[ State ]   = mtx;
+        m_TransformSet[ State ] = true;
+
+    } // End if tracked
+
+    m_Stats.TransformChanges++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetFVF ()
+// Desc : Records a vertex format change, unless the format is already set.
+//-----------------------------------------------------------------------------
+void CNullRenderBackend::SetFVF( ULONG FVF )
+{
+    if ( m_FVF == FVF ) { m_nRedundant++; return; }
+    m_FVF = FVF;
+    m_Stats.StateChanges++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawPrimitiveUP ()
+// Desc : Records a non indexed draw, and the vertex data it would read.
+//-----------------------------------------------------------------------------
+void CNullRenderBackend::DrawPrimitiveUP( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount, const void * pVertices, ULONG Stride )
+{
+    m_Stats.DrawCalls++;
+    m_Stats.Primitives     += PrimitiveCount;
+    m_Stats.BytesSubmitted += (ULONGLONG)GetVertexCount( Type, PrimitiveCount ) * Stride;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawIndexedPrimitiveUP ()
+// Desc : Records an indexed draw, and the vertex & index data it would read.
+//-----------------------------------------------------------------------------
+void CNullRenderBackend::DrawIndexedPrimitiveUP( D3DPRIMITIVETYPE Type, ULONG VertexCount, ULONG PrimitiveCount, const void * pIndices,
+                                                 D3DFORMAT IndexFormat, const void * pVertices, ULONG Stride )
+{
+    ULONG IndexSize = (IndexFormat == D3DFMT_INDEX32) ? 4 : 2;
+
+    m_Stats.DrawCalls++;
+    m_Stats.Primitives     += PrimitiveCount;
+    m_Stats.BytesSubmitted += (ULONGLONG)VertexCount * Stride;
+    m_Stats.BytesSubmitted += (ULONGLONG)GetIndexCount( Type, PrimitiveCount ) * IndexSize;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BeginInstancing ()
+// Desc : The null backend receives instanced draws itself.
+//-----------------------------------------------------------------------------
+IInstanceRenderer * CNullRenderBackend::BeginInstancing( const D3DXMATRIX & mtxViewProj )
+{
+    if ( !m_bInstancing ) return NULL;
+    return this;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawInstances ()
+// Desc : Records a single instanced draw, and the instance data it streams.
+// Note : Mesh buffers are resident on a real device, so only the instance
+//        stream counts towards the bytes submitted.
+//-----------------------------------------------------------------------------
+bool CNullRenderBackend::DrawInstances( const CCompiledMesh * pMesh, const INSTANCE_DATA * pInstances, ULONG Count )
+{
+    // Validate
+    if ( !pMesh || !pInstances || Count == 0 ) return false;
+
+    // Stream the instance data as a device would
+    ULONG  Offset;
+    void * pData = StreamData( Count * sizeof(INSTANCE_DATA), sizeof(INSTANCE_DATA), &Offset );
+    if ( pData ) memcpy( pData, pInstances, Count * sizeof(INSTANCE_DATA) );
+
+    m_Stats.DrawCalls++;
+    m_Stats.Instances      += Count;
+    m_Stats.Primitives     += (ULONGLONG)pMesh->GetTriangleCount() * Count;
+    m_Stats.BytesSubmitted += (ULONGLONG)Count * sizeof(INSTANCE_DATA);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : LockVertices ()
+// Desc : Appends VertexCount vertices to the dynamic stream, returning the
+//        memory to write them to and the index of the first one.
+//-----------------------------------------------------------------------------
+void * CNullRenderBackend::LockVertices( ULONG VertexCount, ULONG Stride, ULONG * pStartVertex )
+{
+    ULONG  Offset;
+    void * pData;
+
+    // Validate
+    if ( VertexCount == 0 || Stride == 0 ) return NULL;
+
+    if (!( pData = StreamData( VertexCount * Stride, Stride, &Offset ) )) return NULL;
+    m_Stats.BytesSubmitted += (ULONGLONG)VertexCount * Stride;
+    *pStartVertex = Offset / Stride;
+    return pData;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawPrimitive ()
+// Desc : Records a draw from the dynamic stream. The data was recorded as
+//        it was streamed.
+//-----------------------------------------------------------------------------
+void CNullRenderBackend::DrawPrimitive( D3DPRIMITIVETYPE Type, ULONG StartVertex, ULONG PrimitiveCount )
+{
+    m_Stats.DrawCalls++;
+    m_Stats.Primitives += PrimitiveCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : StreamData () (Private)
+// Desc : Allocates space in the dynamic stream.
+//-----------------------------------------------------------------------------
+void * CNullRenderBackend::StreamData( ULONG Size, ULONG Alignment, ULONG * pOffset )
+{
+    // Allocate the stream on first use
+    if ( !m_pStreamData && !( m_pStreamData = (UCHAR*)malloc( DYNAMIC_STREAM_SIZE ) ) ) return NULL;
+
+    if ( !m_Stream.Allocate( Size, Alignment, pOffset, NULL ) ) return NULL;
+    return m_pStreamData + *pOffset;
+}
@@ -0,0 +1,183 @@
+//-----------------------------------------------------------------------------
+// File: CRenderBackend.h
+//
+// Desc: Rendering backend interface through which the application submits
+//       every frame, along with a null backend which only counts the work.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CRENDERBACKEND_H_
+#define _CRENDERBACKEND_H_
+
+//-----------------------------------------------------------------------------
+// CRenderBackend Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CInstanceBatcher.h"
+#include "CRingAllocator.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG DYNAMIC_STREAM_SIZE     = 4 * 1024 * 1024;  // Bytes of dynamic vertex & instance data per backend
+const ULONG DYNAMIC_FRAMES_IN_FLIGHT = 3;               // Frames the device may queue before the CPU waits
+
+//-----------------------------------------------------------------------------
+// Name : RENDER_STATS (Struct)
+// Desc : Work submitted to a backend since its statistics were last reset.
+//-----------------------------------------------------------------------------
+struct RENDER_STATS
+{
+    ULONG           Frames;                 // Frames presented
+    ULONG           DrawCalls;              // Draw calls, each instanced group counting once
+    ULONG           Instances;              // Instances drawn by instanced draw calls
+    ULONGLONG       Primitives;             // Primitives drawn
+    ULONGLONG       BytesSubmitted;         // Vertex, index and instance data passed to draws or streamed
+    ULONG           StateChanges;           // Render state & FVF changes
+    ULONG           TransformChanges;       // Transform matrix changes
+    ULONG           Clears;                 // Clear calls
+};
+
+//-----------------------------------------------------------------------------
+// Name : IRenderBackend (Interface)
+// Desc : Everything the application needs from the device in order to
+//        render a frame. The application draws only through this interface,
+//        so that the whole frame can be run against any implementation.
+// Note : Device loss is reported by Present failing. IsLost then remains
+//        true until Restore succeeds, after which all render states and
+//        transforms must be set again.
+//        Geometry is streamed by appending it with LockVertices, then drawing
+//        ranges of it with DrawPrimitive (which uses the stride of the most
+//        recent lock). LockVertices returns NULL if the data can't be
+//        streamed, in which case the user pointer draws should be used.
+//-----------------------------------------------------------------------------
+class IRenderBackend
+{
+public:
+    virtual        ~IRenderBackend() {}
+
+    // Frame
+    virtual void    Clear           ( ULONG Flags, D3DCOLOR Color, float fZ ) = 0;
+    virtual void    BeginScene      ( ) = 0;
+    virtual void    EndScene        ( ) = 0;
+    virtual bool    Present         ( ) = 0;
+
+    // Device
+    virtual bool    IsLost          ( ) const = 0;
+    virtual bool    Restore         ( ) = 0;
+    virtual bool    Resize          ( ULONG Width, ULONG Height ) = 0;
+
+    // State
+    virtual void    SetRenderState  ( D3DRENDERSTATETYPE State, ULONG Value ) = 0;
+    virtual void    SetTransform    ( D3DTRANSFORMSTATETYPE State, const D3DXMATRIX & mtx ) = 0;
+    virtual void    SetFVF          ( ULONG FVF ) = 0;
+
+    // Draw
+    virtual void    DrawPrimitiveUP ( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount, const void * pVertices, ULONG Stride ) = 0;
+    virtual void    DrawIndexedPrimitiveUP( D3DPRIMITIVETYPE Type, ULONG VertexCount, ULONG PrimitiveCount, const void * pIndices,
+                                            D3DFORMAT IndexFormat, const void * pVertices, ULONG Stride ) = 0;
+
+    // Dynamic geometry
+    virtual void *  LockVertices    ( ULONG VertexCount, ULONG Stride, ULONG * pStartVertex ) = 0;
+    virtual void    UnlockVertices  ( ) = 0;
+    virtual void    DrawPrimitive   ( D3DPRIMITIVETYPE Type, ULONG StartVertex, ULONG PrimitiveCount ) = 0;
+
+    // Instancing (BeginInstancing returns NULL if unsupported)
+    virtual bool    SupportsInstancing( ) const = 0;
+    virtual IInstanceRenderer * BeginInstancing( const D3DXMATRIX & mtxViewProj ) = 0;
+    virtual void    EndInstancing   ( ) = 0;
+
+    // Statistics
+    virtual const RENDER_STATS & GetStats( ) const = 0;
+    virtual const RING_STATS & GetStreamStats( ) const = 0;
+    virtual void    ResetStats      ( ) = 0;
+
+    // Helpers
+    static ULONG    GetVertexCount  ( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount );
+    static ULONG    GetIndexCount   ( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount ) { return GetVertexCount( Type, PrimitiveCount ); }
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CNullRenderBackend (Class)
+// Desc : Backend which draws nothing, but records the calls made, the bytes
+//        that would have been submitted and the number of state changes, so
+//        that the complete frame path can be profiled without a device.
+// Note : State and transform changes which set the current value again are
+//        counted separately, as redundant calls. Streamed data is written to
+//        system memory, with the device assumed to be the maximum number of
+//        frames behind. No device is created, but the D3D9 types and D3DX
+//        maths are still used, so this (like /headless) is Windows only.
+//-----------------------------------------------------------------------------
+class CNullRenderBackend : public IRenderBackend, public IInstanceRenderer
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CNullRenderBackend();
+	virtual ~CNullRenderBackend();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    void            SetInstancing   ( bool bEnable ) { m_bInstancing = bEnable; }
+    ULONG           GetRedundantCount( ) const { return m_nRedundant; }
+
+    // IRenderBackend
+    virtual void    Clear           ( ULONG Flags, D3DCOLOR Color, float fZ );
+    virtual void    BeginScene      ( ) {}
+    virtual void    EndScene        ( ) {}
+    virtual bool    Present         ( );
+    virtual bool    IsLost          ( ) const { return false; }
+    virtual bool    Restore         ( ) { return true; }
+    virtual bool    Resize          ( ULONG Width, ULONG Height ) { return true; }
+    virtual void    SetRenderState  ( D3DRENDERSTATETYPE State, ULONG Value );
+    virtual void    SetTransform    ( D3DTRANSFORMSTATETYPE State, const D3DXMATRIX & mtx );
+    virtual void    SetFVF          ( ULONG FVF );
+    virtual void    DrawPrimitiveUP ( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount, const void * pVertices, ULONG Stride );
+    virtual void    DrawIndexedPrimitiveUP( D3DPRIMITIVETYPE Type, ULONG VertexCount, ULONG PrimitiveCount, const void * pIndices,
+                                            D3DFORMAT IndexFormat, const void * pVertices, ULONG Stride );
+    virtual void *  LockVertices    ( ULONG VertexCount, ULONG Stride, ULONG * pStartVertex );
+    virtual void    UnlockVertices  ( ) {}
+    virtual void    DrawPrimitive   ( D3DPRIMITIVETYPE Type, ULONG StartVertex, ULONG PrimitiveCount );
+    virtual bool    SupportsInstancing( ) const { return m_bInstancing; }
+    virtual IInstanceRenderer * BeginInstancing( const D3DXMATRIX & mtxViewProj );
+    virtual void    EndInstancing   ( ) {}
+    virtual const RENDER_STATS & GetStats( ) const { return m_Stats; }
+    virtual const RING_STATS & GetStreamStats( ) const { return m_Stream.GetStats(); }
+    virtual void    ResetStats      ( );
+
+    // IInstanceRenderer
+    virtual bool    DrawInstances   ( const CCompiledMesh * pMesh, const INSTANCE_DATA * pInstances, ULONG Count );
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Constants for This Class
+	//-------------------------------------------------------------------------
+    enum { MAX_RENDER_STATES = 256, MAX_TRANSFORMS = 512 };
+
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    void          * StreamData      ( ULONG Size, ULONG Alignment, ULONG * pOffset );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    RENDER_STATS    m_Stats;                // Work recorded since the last reset
+    ULONG           m_nRedundant;           // Calls which did not change any value
+    bool            m_bInstancing;          // Report support for instancing
+    ULONG           m_FVF;                  // Current FVF
+    ULONG           m_RenderStates[ MAX_RENDER_STATES ];
+    bool            m_StateSet[ MAX_RENDER_STATES ];
+    D3DXMATRIX      m_Transforms[ MAX_TRANSFORMS ];
+    bool            m_TransformSet[ MAX_TRANSFORMS ];
+    CRingAllocator  m_Stream;               // Space in m_pStreamData
+    UCHAR         * m_pStreamData;          // Dynamic stream (allocated on first use)
+};
+
+#endif // _CRENDERBACKEND_H_
@@ -0,0 +1,245 @@
+//-----------------------------------------------------------------------------
+// File: CRenderQueue.cpp
+//
+// Desc: Sortable queue of fixed size render commands, recorded in parallel
+//       and ordered by a 64 bit key before submission.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CRenderQueue Specific Includes
+//-----------------------------------------------------------------------------
+#include "CRenderQueue.h"
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------
+// Name : CRenderQueue () (Constructor)
+// Desc : CRenderQueue Class Constructor
+//-----------------------------------------------------------------------------
+CRenderQueue::CRenderQueue()
+{
+	// Reset / Clear all required values
+    ZeroMemory( m_Contexts, sizeof(m_Contexts) );
+    m_nContextCount    = 0;
+    m_pSorted          = NULL;
+    m_pScratch         = NULL;
+    m_nCount           = 0;
+    m_nSortedCapacity  = 0;
+    m_nScratchCapacity = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CRenderQueue () (Destructor)
+// Desc : CRenderQueue Class Destructor
+//-----------------------------------------------------------------------------
+CRenderQueue::~CRenderQueue()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Begin ()
+// Desc : Empties the queue ready for a new frame, with ContextCount
+//        recording contexts each able to hold ReservePerContext commands
+//        without growing.
+//-----------------------------------------------------------------------------
+bool CRenderQueue::Begin( ULONG ContextCount, ULONG ReservePerContext )
+{
+    // Validate
+    if ( ContextCount == 0 || ContextCount > RENDERQUEUE_MAX_CONTEXTS ) return false;
+
+    // Clear every context, keeping their storage
+    for ( ULONG i = 0; i < RENDERQUEUE_MAX_CONTEXTS; i++ )
+    {
+        COMMAND_BUFFER & Buffer = m_Contexts[i];
+        Buffer.Count = 0;
+        if ( i < ContextCount && !Reserve( &Buffer.pCommands, &Buffer.Capacity, ReservePerContext ) ) return false;
+
+    } // Next Context
+
+    m_nContextCount = ContextCount;
+    m_nCount        = 0;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Record ()
+// Desc : Appends a command to the specified context.
+//-----------------------------------------------------------------------------
+bool CRenderQueue::Record( ULONG Context, ULONGLONG Key, ULONG Object, ULONG Param )
+{
+    // Validate
+    if ( Context >= m_nContextCount ) return false;
+
+    COMMAND_BUFFER & Buffer = m_Contexts[ Context ];
+    if ( Buffer.Count == Buffer.Capacity && !Reserve( &Buffer.pCommands, &Buffer.Capacity, Buffer.Count + 1 ) ) return false;
+
+    RENDER_COMMAND & Command = Buffer.pCommands[ Buffer.Count++ ];
+    Command.Key    = Key;
+    Command.Object = Object;
+    Command.Param  = Param;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Sort ()
+// Desc : Merges every context, and sorts the commands by ascending key.
+// Note : LSD radix sort, one byte per pass. All 8 histograms are built in a
+//        single read, and passes whose byte is the same for every command
+//        are skipped, so typical keys need far fewer than 8 passes. The sort
+//        is stable, so equal keys keep their recording order.
+//-----------------------------------------------------------------------------
+bool CRenderQueue::Sort( )
+{
+    ULONG   i, Total = 0, Pass;
+    ULONG   Histogram[8][256];
+
+    // Gather every context into a single array
+    for ( i = 0; i < m_nContextCount; i++ ) Total += m_Contexts[i].Count;
+    if ( !Reserve( &m_pSorted, &m_nSortedCapacity, Total ) ) return false;
+    if ( !Reserve( &m_pScratch, &m_nScratchCapacity, Total ) ) return false;
+
+    m_nCount = 0;
+    for ( i = 0; i < m_nContextCount; i++ )
+    {
+        if ( m_Contexts[i].Count == 0 ) continue;
+        memcpy( m_pSorted + m_nCount, m_Contexts[i].pCommands, m_Contexts[i].Count * sizeof(RENDER_COMMAND) );
+        m_nCount += m_Contexts[i].Count;
+
+    } // Next Context
+    if ( m_nCount < 2 ) return true;
+
+    // Count the occurrences of every byte value at every position
+    ZeroMemory( Histogram, sizeof(Histogram) );
+    for ( i = 0; i < m_nCount; i++ )
+    {
+        ULONGLONG Key = m_pSorted[i].Key;
+        for ( Pass = 0; Pass < 8; Pass++, Key >>= 8 ) Histogram[ Pass ][ (ULONG)(Key & 0xFF) ]++;
+
+    } // Next Command
+
+    // Distribute by each byte in turn, least significant first
+    for ( Pass = 0; Pass < 8; Pass++ )
+    {
+        ULONG * pCount = Histogram[ Pass ];
+        ULONG   Shift  = Pass * 8, Offset = 0;
+
+        // Skip bytes which do not vary
+        if ( pCount[ (ULONG)((m_pSorted[0].Key >> Shift) & 0xFF) ] == m_nCount ) continue;
+
+        // Convert the counts into starting offsets
+        for ( i = 0; i < 256; i++ )
+        {
+            ULONG Count = pCount[i];
+            pCount[i] = Offset;
+            Offset += Count;
+
+        } // Next Bucket
+
+        for ( i = 0; i < m_nCount; i++ )
+        {
+            const RENDER_COMMAND & Command = m_pSorted[i];
+            m_pScratch[ pCount[ (ULONG)((Command.Key >> Shift) & 0xFF) ]++ ] = Command;
+
+        } // Next Command
+
+        // The scratch buffer now holds the most recent order
+        RENDER_COMMAND * pSwap = m_pSorted; m_pSorted = m_pScratch; m_pScratch = pSwap;
+        ULONG Capacity = m_nSortedCapacity; m_nSortedCapacity = m_nScratchCapacity; m_nScratchCapacity = Capacity;
+
+    } // Next Pass
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Frees all storage.
+//-----------------------------------------------------------------------------
+void CRenderQueue::Release( )
+{
+    for ( ULONG i = 0; i < RENDERQUEUE_MAX_CONTEXTS; i++ )
+    {
+        if ( m_Contexts[i].pCommands ) free( m_Contexts[i].pCommands );
+
+    } // Next Context
+    if ( m_pSorted  ) free( m_pSorted );
+    if ( m_pScratch ) free( m_pScratch );
+
+    ZeroMemory( m_Contexts, sizeof(m_Contexts) );
+    m_nContextCount    = 0;
+    m_pSorted          = NULL;
+    m_pScratch         = NULL;
+    m_nCount           = 0;
+    m_nSortedCapacity  = 0;
+    m_nScratchCapacity = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : MakeKey () (Static)
+// Desc : Builds a sort key. From the most significant bit down:
+//          opaque / overlay : pass(4) state(12) mesh(16) depth(24) unused(8)
+//          translucent      : pass(4) ~depth(24) state(12) mesh(16) unused(8)
+//        so that opaque work is grouped by state and mesh then drawn front
+//        to back, while translucent work is drawn strictly back to front.
+// Note : fDepth is the view space depth. Positive floats order the same as
+//        their bit patterns, so the top 24 bits are used directly.
+//-----------------------------------------------------------------------------
+ULONGLONG CRenderQueue::MakeKey( RENDER_PASS Pass, ULONG State, ULONG Mesh, float fDepth )
+{
+    ULONG     Depth = 0;
+    ULONGLONG Key;
+
+    // Quantise the depth (anything behind the eye sorts as nearest)
+    if ( fDepth > 0.0f ) Depth = (*(ULONG*)&fDepth) >> (32 - RENDERQUEUE_DEPTH_BITS);
+
+    State &= (1 << RENDERQUEUE_STATE_BITS) - 1;
+    Mesh  &= (1 << RENDERQUEUE_MESH_BITS) - 1;
+
+    Key = (ULONGLONG)(Pass & 0xF) << 60;
+    if ( Pass == RENDERPASS_TRANSLUCENT )
+    {
+        Depth = ~Depth & ((1 << RENDERQUEUE_DEPTH_BITS) - 1);
+        Key |= (ULONGLONG)Depth << 36;
+        Key |= (ULONGLONG)State << 24;
+        Key |= (ULONGLONG)Mesh  << 8;
+
+    } // End if back to front
+    else
+    {
+        Key |= (ULONGLONG)State << 48;
+        Key |= (ULONGLONG)Mesh  << 32;
+        Key |= (ULONGLONG)Depth << 8;
+
+    } // End if front to back
+
+    return Key;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Reserve () (Private, Static)
+// Desc : Grows a command array so that it can hold at least Count commands.
+//-----------------------------------------------------------------------------
+bool CRenderQueue::Reserve( RENDER_COMMAND ** ppCommands, ULONG * pCapacity, ULONG Count )
+{
+    ULONG            NewCapacity;
+    RENDER_COMMAND * pNewCommands;
+
+    // Already large enough?
+    if ( Count <= *pCapacity ) return true;
+
+    // Grow by half again, to keep reallocation rare
+    NewCapacity = (*pCapacity < 256) ? 256 : *pCapacity + *pCapacity / 2;
+    if ( NewCapacity < Count ) NewCapacity = Count;
+    if (!( pNewCommands = (RENDER_COMMAND*)realloc( *ppCommands, NewCapacity * sizeof(RENDER_COMMAND) ) )) return false;
+
+    *ppCommands = pNewCommands;
+    *pCapacity  = NewCapacity;
+    return true;
+}
@@ -0,0 +1,115 @@
+//-----------------------------------------------------------------------------
+// File: CRenderQueue.h
+//
+// Desc: Sortable queue of fixed size render commands, recorded in parallel
+//       and ordered by a 64 bit key before submission.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CRENDERQUEUE_H_
+#define _CRENDERQUEUE_H_
+
+//-----------------------------------------------------------------------------
+// CRenderQueue Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CThreadPool.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG RENDERQUEUE_MAX_CONTEXTS    = THREADPOOL_MAX_THREADS;  // Recording buffers available
+const ULONG RENDERQUEUE_STATE_BITS      = 12;       // Render state id bits in a sort key
+const ULONG RENDERQUEUE_MESH_BITS       = 16;       // Mesh id bits in a sort key
+const ULONG RENDERQUEUE_DEPTH_BITS      = 24;       // Depth bits in a sort key
+
+//-----------------------------------------------------------------------------
+// Name : RENDER_PASS (Enum)
+// Desc : Passes in submission order. Occupies the top 4 bits of a sort key.
+//-----------------------------------------------------------------------------
+enum RENDER_PASS
+{
+    RENDERPASS_OPAQUE       = 0,            // Sorted by state, mesh, then front to back
+    RENDERPASS_TRANSLUCENT  = 1,            // Sorted back to front, then by state & mesh
+    RENDERPASS_OVERLAY      = 2             // Sorted as opaque, drawn last
+};
+
+//-----------------------------------------------------------------------------
+// Name : RENDER_COMMAND (Struct)
+// Desc : Single queued draw. Object and Param are interpreted by whoever
+//        submits the queue (e.g. object index and detail level).
+//-----------------------------------------------------------------------------
+struct RENDER_COMMAND
+{
+    ULONGLONG       Key;                    // Sort key (see CRenderQueue::MakeKey)
+    ULONG           Object;                 // Item to draw
+    ULONG           Param;                  // Extra submission data
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CRenderQueue (Class)
+// Desc : Commands are recorded into one of several independent contexts, so
+//        that each thread of a CThreadPool dispatch may record without
+//        locking. Sort merges the contexts and orders every command by key
+//        with an LSD radix sort.
+// Note : Different threads must never record into the same context.
+//-----------------------------------------------------------------------------
+class CRenderQueue
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CRenderQueue();
+	virtual ~CRenderQueue();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Begin           ( ULONG ContextCount, ULONG ReservePerContext = 0 );
+    bool            Record          ( ULONG Context, ULONGLONG Key, ULONG Object, ULONG Param = 0 );
+    bool            Sort            ( );
+    void            Release         ( );
+
+    const RENDER_COMMAND * GetCommands  ( ) const { return m_pSorted; }
+    ULONG           GetCommandCount ( ) const { return m_nCount; }
+    ULONG           GetContextCount ( ) const { return m_nContextCount; }
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static ULONGLONG MakeKey        ( RENDER_PASS Pass, ULONG State, ULONG Mesh, float fDepth );
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Structures for This Class
+	//-------------------------------------------------------------------------
+    struct COMMAND_BUFFER
+    {
+        RENDER_COMMAND * pCommands;
+        ULONG            Count;
+        ULONG            Capacity;
+    };
+
+    //-------------------------------------------------------------------------
+	// Private Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static bool     Reserve         ( RENDER_COMMAND ** ppCommands, ULONG * pCapacity, ULONG Count );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    COMMAND_BUFFER  m_Contexts[ RENDERQUEUE_MAX_CONTEXTS ]; // Per thread recording buffers
+    ULONG           m_nContextCount;    // Contexts in use this frame
+    RENDER_COMMAND *m_pSorted;          // Merged & sorted commands
+    RENDER_COMMAND *m_pScratch;         // Radix sort ping-pong buffer
+    ULONG           m_nCount;           // Commands in m_pSorted
+    ULONG           m_nSortedCapacity;  // Capacity of m_pSorted
+    ULONG           m_nScratchCapacity; // Capacity of m_pScratch
+};
+
+#endif // _CRENDERQUEUE_H_
@@ -0,0 +1,159 @@
+//-----------------------------------------------------------------------------
+// File: CRingAllocator.cpp
+//
+// Desc: Frame fenced ring allocator, handing out offsets into a buffer of
+//       dynamic geometry which is written by the CPU and read by the device.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CRingAllocator Specific Includes
+//-----------------------------------------------------------------------------
+#include "CRingAllocator.h"
+
+//-----------------------------------------------------------------------------
+// Name : CRingAllocator () (Constructor)
+// Desc : CRingAllocator Class Constructor
+//-----------------------------------------------------------------------------
+CRingAllocator::CRingAllocator()
+{
+	// Reset / Clear all required values
+    m_nCapacity   = 0;
+    m_nMaxFrames  = 1;
+    m_nFrame      = 0;
+    Reset();
+    ResetStats();
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CRingAllocator () (Destructor)
+// Desc : CRingAllocator Class Destructor
+//-----------------------------------------------------------------------------
+CRingAllocator::~CRingAllocator()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Sets the size of the buffer being managed, and the number of
+//        frames the device may queue up before it has to catch up.
+//-----------------------------------------------------------------------------
+void CRingAllocator::Create( ULONG Capacity, ULONG MaxFramesInFlight )
+{
+    if ( MaxFramesInFlight < 1 ) MaxFramesInFlight = 1;
+    if ( MaxFramesInFlight > RING_MAX_FRAMES ) MaxFramesInFlight = RING_MAX_FRAMES;
+
+    m_nCapacity  = Capacity;
+    m_nMaxFrames = MaxFramesInFlight;
+    Reset();
+    ResetStats();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Reset ()
+// Desc : Forgets everything in flight, for instance once the buffer has
+//        been recreated. The next allocation starts a new lap.
+//-----------------------------------------------------------------------------
+void CRingAllocator::Reset( )
+{
+    m_Head        = 0;
+    m_Tail        = 0;
+    m_nFenceFirst = 0;
+    m_nFenceCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Allocate ()
+// Desc : Reserves space for Size bytes, starting at a multiple of Alignment
+//        bytes from the start of the buffer.
+// Note : pDiscard is set when the allocation starts a new lap of the buffer,
+//        the caller should then lock with D3DLOCK_DISCARD. Data written to an
+//        earlier allocation must be drawn before the next one is made, as a
+//        discard may orphan it.
+//-----------------------------------------------------------------------------
+bool CRingAllocator::Allocate( ULONG Size, ULONG Alignment, ULONG * pOffset, bool * pDiscard )
+{
+    ULONGLONG Lap, End;
+    ULONG     Offset;
+    bool      bWrap = false;
+
+    // Validate
+    if ( Size == 0 || Size > m_nCapacity ) { m_Stats.Failures++; return false; }
+    if ( Alignment == 0 ) Alignment = 1;
+
+    // Append after the previous allocation
+    Lap    = m_Head - (m_Head % m_nCapacity);
+    Offset = (ULONG)(m_Head % m_nCapacity);
+    Offset = ((Offset + Alignment - 1) / Alignment) * Alignment;
+
+    // Start a new lap if it doesn't fit before the end
+    if ( Offset > m_nCapacity - Size )
+    {
+        Lap   += m_nCapacity;
+        Offset = 0;
+        bWrap  = true;
+        m_Stats.Wraps++;
+
+    } // End if wrap
+    End = Lap + Offset + Size;
+
+    // Would this overwrite data the device may still be reading ?
+    if ( End - m_Tail > m_nCapacity )
+    {
+        // Orphan the buffer (the driver renames it) and start over
+        if ( !bWrap ) { Lap += m_nCapacity; m_Stats.Wraps++; }
+        Offset        = 0;
+        bWrap         = true;
+        End           = Lap + Size;
+        m_Tail        = Lap;
+        m_nFenceCount = 0;
+        m_Stats.WrapStalls++;
+
+    } // End if stall
+
+    // Commit
+    m_Head = End;
+    m_Stats.Allocations++;
+    m_Stats.BytesAllocated += Size;
+    if ( GetUsed() > m_Stats.HighWater ) m_Stats.HighWater = GetUsed();
+
+    *pOffset = Offset;
+    if ( pDiscard ) *pDiscard = bWrap;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndFrame ()
+// Desc : Fences everything allocated so far with the current frame, and
+//        moves on to the next.
+// Note : The device can't fall further behind than the number of frames in
+//        flight, so the oldest frame is assumed complete when that is exceeded.
+//-----------------------------------------------------------------------------
+void CRingAllocator::EndFrame( )
+{
+    // Make room
+    if ( m_nFenceCount == m_nMaxFrames ) RetireFrames( m_Fences[ m_nFenceFirst ].Frame );
+
+    // Fence this frame
+    RING_FENCE & Fence = m_Fences[ (m_nFenceFirst + m_nFenceCount) % RING_MAX_FRAMES ];
+    Fence.Frame = m_nFrame++;
+    Fence.End   = m_Head;
+    m_nFenceCount++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RetireFrames ()
+// Desc : Releases the space used by every frame up to and including the
+//        one specified, which the device has finished with.
+//-----------------------------------------------------------------------------
+void CRingAllocator::RetireFrames( ULONG Frame )
+{
+    while ( m_nFenceCount > 0 && (LONG)(m_Fences[ m_nFenceFirst ].Frame - Frame) <= 0 )
+    {
+        m_Tail        = m_Fences[ m_nFenceFirst ].End;
+        m_nFenceFirst = (m_nFenceFirst + 1) % RING_MAX_FRAMES;
+        m_nFenceCount--;
+
+    } // Next Fence
+}
@@ -0,0 +1,102 @@
+//-----------------------------------------------------------------------------
+// File: CRingAllocator.h
+//
+// Desc: Frame fenced ring allocator, handing out offsets into a buffer of
+//       dynamic geometry which is written by the CPU and read by the device.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CRINGALLOCATOR_H_
+#define _CRINGALLOCATOR_H_
+
+//-----------------------------------------------------------------------------
+// CRingAllocator Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG RING_MAX_FRAMES         = 8;        // Largest number of frames that may be in flight
+
+//-----------------------------------------------------------------------------
+// Name : RING_STATS (Struct)
+// Desc : Allocations made from a ring since its statistics were last reset.
+//-----------------------------------------------------------------------------
+struct RING_STATS
+{
+    ULONG           Allocations;            // Successful allocations
+    ULONG           Failures;               // Allocations larger than the ring
+    ULONGLONG       BytesAllocated;         // Bytes handed out (excluding alignment)
+    ULONG           Wraps;                  // Times the write position returned to the start
+    ULONG           WrapStalls;             // Allocations which reached data still in flight
+    ULONG           HighWater;              // Most bytes in flight at once
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CRingAllocator (Class)
+// Desc : Manages the space in a ring buffer without touching the buffer
+//        itself. Allocations are appended after one another, and everything
+//        allocated before EndFrame is fenced with that frame's number. Space
+//        is only reused once RetireFrames reports the frame complete.
+// Note : An allocation which doesn't fit before the end of the buffer
+//        wraps to the start, and is flagged as a discard so that the caller
+//        can lock with D3DLOCK_DISCARD. All others may use D3DLOCK_NOOVERWRITE.
+//        If a wrapped allocation would still overwrite data in flight, the
+//        stall is recorded and the whole buffer is discarded, leaving the
+//        driver to rename it, rather than waiting on the device.
+//-----------------------------------------------------------------------------
+class CRingAllocator
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CRingAllocator();
+	virtual ~CRingAllocator();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    void            Create          ( ULONG Capacity, ULONG MaxFramesInFlight );
+    void            Reset           ( );
+    bool            Allocate        ( ULONG Size, ULONG Alignment, ULONG * pOffset, bool * pDiscard );
+    void            EndFrame        ( );
+    void            RetireFrames    ( ULONG Frame );
+
+    ULONG           GetCapacity     ( ) const { return m_nCapacity; }
+    ULONG           GetUsed         ( ) const { return (ULONG)(m_Head - m_Tail); }
+    ULONG           GetFrame        ( ) const { return m_nFrame; }
+    ULONG           GetPendingFrames( ) const { return m_nFenceCount; }
+    const RING_STATS & GetStats     ( ) const { return m_Stats; }
+    void            ResetStats      ( ) { ZeroMemory( &m_Stats, sizeof(RING_STATS) ); }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Structures for This Class
+	//-------------------------------------------------------------------------
+    struct RING_FENCE
+    {
+        ULONG       Frame;                  // Frame the allocations belong to
+        ULONGLONG   End;                    // Write position when the frame ended
+    };
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    ULONG           m_nCapacity;            // Size of the buffer in bytes
+    ULONG           m_nMaxFrames;           // Frames that may be in flight at once
+    ULONGLONG       m_Head;                 // Write position (bytes ever allocated, including padding)
+    ULONGLONG       m_Tail;                 // Oldest position still in flight
+    ULONG           m_nFrame;               // Frame currently being recorded
+    RING_FENCE      m_Fences[ RING_MAX_FRAMES ]; // Frames ended but not yet retired, oldest first
+    ULONG           m_nFenceFirst;          // Index of the oldest fence
+    ULONG           m_nFenceCount;          // Number of fences pending
+    RING_STATS      m_Stats;                // Allocations made since the last reset
+};
+
+#endif // _CRINGALLOCATOR_H_
@@ -0,0 +1,275 @@
+//-----------------------------------------------------------------------------
+// File: CSnapshotBuffer.cpp
+//
+// Desc: Triple buffered scene snapshots, passed from the simulation to the
+//       thread which renders them.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CSnapshotBuffer Specific Includes
+//-----------------------------------------------------------------------------
+#include "CSnapshotBuffer.h"
+#include "CProfiler.h"
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------
+// Name : CSnapshotBuffer () (Constructor)
+// Desc : CSnapshotBuffer Class Constructor
+//-----------------------------------------------------------------------------
+CSnapshotBuffer::CSnapshotBuffer()
+{
+    LARGE_INTEGER Frequency;
+
+	// Reset / Clear all required values
+    ZeroMemory( m_Slots, sizeof(m_Slots) );
+    m_bLockCreated = false;
+    m_hReady       = NULL;
+    m_hFree        = NULL;
+
+    QueryPerformanceFrequency( &Frequency );
+    m_fTimerScale = 1000.0 / (double)Frequency.QuadPart;
+    Reset();
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CSnapshotBuffer () (Destructor)
+// Desc : CSnapshotBuffer Class Destructor
+//-----------------------------------------------------------------------------
+CSnapshotBuffer::~CSnapshotBuffer()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Creates the lock & events used to pass snapshots between threads.
+//-----------------------------------------------------------------------------
+bool CSnapshotBuffer::Create( )
+{
+    Release();
+
+    InitializeCriticalSection( &m_Lock );
+    m_bLockCreated = true;
+    if (!( m_hReady = CreateEvent( NULL, TRUE, FALSE, NULL ) )) { Release(); return false; }
+    if (!( m_hFree  = CreateEvent( NULL, TRUE, TRUE, NULL ) )) { Release(); return false; }
+
+    Reset();
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Frees the snapshots, lock & events.
+//-----------------------------------------------------------------------------
+void CSnapshotBuffer::Release( )
+{
+    for ( ULONG i = 0; i < 3; i++ )
+    {
+        if ( m_Slots[i].pDraws ) free( m_Slots[i].pDraws );
+        m_Slots[i].pDraws       = NULL;
+        m_Slots[i].DrawCount    = 0;
+        m_Slots[i].DrawCapacity = 0;
+
+    } // Next Slot
+
+    if ( m_hReady ) CloseHandle( m_hReady );
+    if ( m_hFree  ) CloseHandle( m_hFree );
+    if ( m_bLockCreated ) DeleteCriticalSection( &m_Lock );
+    m_hReady       = NULL;
+    m_hFree        = NULL;
+    m_bLockCreated = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Reset ()
+// Desc : Empties the buffer and reopens it. Neither side may be using it.
+//-----------------------------------------------------------------------------
+void CSnapshotBuffer::Reset( )
+{
+    m_nWrite   = 0;
+    m_nRead    = 1;
+    m_nWaiting = 2;
+    m_bWaiting = false;
+    m_bClosed  = false;
+    m_nFrame   = 0;
+    if ( m_hReady ) ResetEvent( m_hReady );
+    if ( m_hFree  ) SetEvent( m_hFree );
+    ResetStats();
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetStats ()
+// Desc : Clears the timings & latency.
+//-----------------------------------------------------------------------------
+void CSnapshotBuffer::ResetStats( )
+{
+    ZeroMemory( &m_Stats, sizeof(SNAPSHOT_STATS) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : Close ()
+// Desc : Signals that nothing more will be published. The reader receives
+//        any snapshot still waiting, then NULL.
+//-----------------------------------------------------------------------------
+void CSnapshotBuffer::Close( )
+{
+    EnterCriticalSection( &m_Lock );
+    m_bClosed = true;
+    SetEvent( m_hReady );
+    LeaveCriticalSection( &m_Lock );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetElapsed () (Private)
+// Desc : Milliseconds between two performance counter readings.
+//-----------------------------------------------------------------------------
+double CSnapshotBuffer::GetElapsed( const LARGE_INTEGER & Start, const LARGE_INTEGER & End ) const
+{
+    return (double)(End.QuadPart - Start.QuadPart) * m_fTimerScale;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BeginWrite ()
+// Desc : Returns the snapshot for the simulation to fill in, waiting until
+//        the previously published one has been picked up.
+// Note : The draws array keeps its storage, but holds whatever this slot was
+//        last used for.
+//-----------------------------------------------------------------------------
+SCENE_SNAPSHOT * CSnapshotBuffer::BeginWrite( )
+{
+    LARGE_INTEGER Start;
+    SCENE_SNAPSHOT * pSnapshot = &m_Slots[ m_nWrite ];
+    PROFILE_ZONE( "BeginWrite" );
+
+    QueryPerformanceCounter( &Start );
+    WaitForSingleObject( m_hFree, INFINITE );
+    QueryPerformanceCounter( &pSnapshot->SimStart );
+    m_Stats.fSimWait += GetElapsed( Start, pSnapshot->SimStart );
+
+    pSnapshot->Frame     = m_nFrame++;
+    pSnapshot->DrawCount = 0;
+    return pSnapshot;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReserveDraws ()
+// Desc : Makes room for at least Count draws in the snapshot being written.
+//-----------------------------------------------------------------------------
+bool CSnapshotBuffer::ReserveDraws( ULONG Count )
+{
+    SCENE_SNAPSHOT * pSnapshot = &m_Slots[ m_nWrite ];
+    SNAPSHOT_DRAW  * pNewDraws;
+    ULONG            NewCapacity;
+
+    // Already large enough?
+    if ( Count <= pSnapshot->DrawCapacity ) return true;
+
+    // Grow by half again, to keep reallocation rare
+    NewCapacity = (pSnapshot->DrawCapacity < 64) ? 64 : pSnapshot->DrawCapacity + pSnapshot->DrawCapacity / 2;
+    if ( NewCapacity < Count ) NewCapacity = Count;
+    if (!( pNewDraws = (SNAPSHOT_DRAW*)realloc( pSnapshot->pDraws, NewCapacity * sizeof(SNAPSHOT_DRAW) ) )) return false;
+
+    pSnapshot->pDraws       = pNewDraws;
+    pSnapshot->DrawCapacity = NewCapacity;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Publish ()
+// Desc : Hands the snapshot written since BeginWrite to the renderer.
+//-----------------------------------------------------------------------------
+void CSnapshotBuffer::Publish( )
+{
+    LARGE_INTEGER End;
+    ULONG         Slot;
+
+    QueryPerformanceCounter( &End );
+    m_Stats.fLastSimTime = (float)GetElapsed( m_Slots[ m_nWrite ].SimStart, End );
+    m_Stats.fSimTime    += m_Stats.fLastSimTime;
+    m_Stats.Published++;
+
+    // Swap it into the waiting slot
+    EnterCriticalSection( &m_Lock );
+    Slot       = m_nWaiting;
+    m_nWaiting = m_nWrite;
+    m_nWrite   = Slot;
+    m_bWaiting = true;
+    ResetEvent( m_hFree );
+    SetEvent( m_hReady );
+    LeaveCriticalSection( &m_Lock );
+}
+
+//-----------------------------------------------------------------------------
+// Name : Acquire ()
+// Desc : Waits for the next snapshot and takes it for rendering, releasing
+//        the one rendered previously. Returns NULL once the buffer has
+//        been closed and every snapshot taken.
+//-----------------------------------------------------------------------------
+const SCENE_SNAPSHOT * CSnapshotBuffer::Acquire( )
+{
+    LARGE_INTEGER Start;
+    ULONG         Slot;
+    PROFILE_ZONE( "Acquire" );
+
+    QueryPerformanceCounter( &Start );
+    WaitForSingleObject( m_hReady, INFINITE );
+
+    EnterCriticalSection( &m_Lock );
+    if ( !m_bWaiting ) { LeaveCriticalSection( &m_Lock ); return NULL; }
+
+    // Swap it out of the waiting slot
+    Slot       = m_nRead;
+    m_nRead    = m_nWaiting;
+    m_nWaiting = Slot;
+    m_bWaiting = false;
+    if ( !m_bClosed ) ResetEvent( m_hReady );
+    SetEvent( m_hFree );
+    LeaveCriticalSection( &m_Lock );
+
+    QueryPerformanceCounter( &m_ReadStart );
+    m_Stats.fRenderWait += GetElapsed( Start, m_ReadStart );
+    return &m_Slots[ m_nRead ];
+}
+
+//-----------------------------------------------------------------------------
+// Name : Complete ()
+// Desc : Called once the acquired snapshot has been presented, recording
+//        its latency and the draw calls it took.
+//-----------------------------------------------------------------------------
+void CSnapshotBuffer::Complete( ULONG DrawCalls )
+{
+    LARGE_INTEGER End;
+    float         fRenderTime, fLatency;
+
+    QueryPerformanceCounter( &End );
+    fRenderTime = (float)GetElapsed( m_ReadStart, End );
+    fLatency    = (float)GetElapsed( m_Slots[ m_nRead ].SimStart, End );
+
+    // Locked, so that CopyStats sees a consistent set of render figures
+    EnterCriticalSection( &m_Lock );
+    m_Stats.fLastRenderTime = fRenderTime;
+    m_Stats.fRenderTime    += fRenderTime;
+    m_Stats.fLatency       += fLatency;
+    m_Stats.fLastLatency    = fLatency;
+    if ( fLatency > m_Stats.fMaxLatency ) m_Stats.fMaxLatency = fLatency;
+    m_Stats.LastDrawCalls   = DrawCalls;
+    m_Stats.Rendered++;
+    LeaveCriticalSection( &m_Lock );
+}
+
+//-----------------------------------------------------------------------------
+// Name : CopyStats ()
+// Desc : Copies the statistics while the renderer may still be running.
+// Note : For the writer's thread. The simulation side figures are its own,
+//        the render side ones are those of the latest Complete.
+//-----------------------------------------------------------------------------
+void CSnapshotBuffer::CopyStats( SNAPSHOT_STATS * pStats )
+{
+    EnterCriticalSection( &m_Lock );
+    *pStats = m_Stats;
+    LeaveCriticalSection( &m_Lock );
+}
@@ -0,0 +1,142 @@
+//-----------------------------------------------------------------------------
+// File: CSnapshotBuffer.h
+//
+// Desc: Triple buffered scene snapshots, passed from the simulation to the
+//       thread which renders them.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CSNAPSHOTBUFFER_H_
+#define _CSNAPSHOTBUFFER_H_
+
+//-----------------------------------------------------------------------------
+// CSnapshotBuffer Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Name : SNAPSHOT_DRAW (Struct)
+// Desc : One object to draw, in submission order, with the transform it had
+//        when the snapshot was taken.
+//-----------------------------------------------------------------------------
+struct SNAPSHOT_DRAW
+{
+    D3DXMATRIX      mtxWorld;               // Object world matrix
+    ULONG           Object;                 // Object index (for its mesh)
+    ULONG           LOD;                    // Detail level selected
+};
+
+//-----------------------------------------------------------------------------
+// Name : SCENE_SNAPSHOT (Struct)
+// Desc : Everything the renderer needs to draw one simulated frame. Once
+//        published, a snapshot is only read until it is recycled.
+//-----------------------------------------------------------------------------
+struct SCENE_SNAPSHOT
+{
+    ULONG           Frame;                  // Simulation frame number
+    LARGE_INTEGER   SimStart;               // When the frame's simulation began
+    ULONG           ViewWidth;              // Viewport size the frame was simulated for
+    ULONG           ViewHeight;
+    D3DXMATRIX      mtxView;                // View matrix
+    D3DXMATRIX      mtxProjection;          // Projection matrix
+    SNAPSHOT_DRAW * pDraws;                 // Visible objects, sorted
+    ULONG           DrawCount;
+    ULONG           DrawCapacity;
+};
+
+//-----------------------------------------------------------------------------
+// Name : SNAPSHOT_STATS (Struct)
+// Desc : Time spent on either side of the buffer, in milliseconds, and the
+//        latency from the start of simulation to the end of rendering.
+//-----------------------------------------------------------------------------
+struct SNAPSHOT_STATS
+{
+    ULONG           Published;              // Snapshots written
+    ULONG           Rendered;               // Snapshots completed
+    double          fSimTime;               // Writing snapshots
+    double          fSimWait;               // Waiting for a snapshot to write to
+    double          fRenderTime;            // Rendering snapshots
+    double          fRenderWait;            // Waiting for a snapshot to render
+    double          fLatency;               // Summed over every snapshot rendered
+    float           fMaxLatency;            // Longest for any snapshot
+    float           fLastLatency;           // Most recent snapshot
+    float           fLastSimTime;           // Writing the most recent snapshot
+    float           fLastRenderTime;        // Rendering the most recent snapshot
+    ULONG           LastDrawCalls;          // Draw calls made for the most recent snapshot
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CSnapshotBuffer (Class)
+// Desc : Three snapshots, one being written by the simulation, one being
+//        read by the renderer and one published and waiting between them.
+//        The writer may start the next frame as soon as the waiting slot has
+//        been picked up, so simulation runs at most one frame ahead of the
+//        frame being rendered, and neither side waits unless it is faster.
+// Note : Written by one thread and read by one other. Close wakes the reader
+//        once it has taken the last snapshot published.
+//-----------------------------------------------------------------------------
+class CSnapshotBuffer
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CSnapshotBuffer();
+	virtual ~CSnapshotBuffer();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Create          ( );
+    void            Release         ( );
+    void            Reset           ( );
+    void            Close           ( );
+
+    // Simulation side
+    SCENE_SNAPSHOT* BeginWrite      ( );
+    bool            ReserveDraws    ( ULONG Count );
+    void            Publish         ( );
+    HANDLE          GetWriteEvent   ( ) const { return m_hFree; }
+
+    // Render side
+    const SCENE_SNAPSHOT * Acquire  ( );
+    void            Complete        ( ULONG DrawCalls );
+
+    const SNAPSHOT_STATS & GetStats ( ) const { return m_Stats; }
+    void            CopyStats       ( SNAPSHOT_STATS * pStats );
+    void            ResetStats      ( );
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    double          GetElapsed      ( const LARGE_INTEGER & Start, const LARGE_INTEGER & End ) const;
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    SCENE_SNAPSHOT      m_Slots[3];
+    ULONG               m_nWrite;           // Slot owned by the simulation
+    ULONG               m_nRead;            // Slot owned by the renderer
+    ULONG               m_nWaiting;         // Slot published and waiting to be read
+    bool                m_bWaiting;         // Does m_nWaiting hold an unread snapshot ?
+    bool                m_bClosed;          // No further snapshots will be published
+    ULONG               m_nFrame;           // Number given to the next snapshot
+    CRITICAL_SECTION    m_Lock;             // Guards the slot indices & flags, and the render side stats
+    bool                m_bLockCreated;
+    HANDLE              m_hReady;           // Set while a snapshot waits, or once closed
+    HANDLE              m_hFree;            // Set while the waiting slot is empty
+    LARGE_INTEGER       m_ReadStart;        // When the renderer acquired its snapshot
+    SNAPSHOT_STATS      m_Stats;
+    double              m_fTimerScale;      // Milliseconds per performance counter tick
+
+    // Snapshot buffers own their events, copying is not supported.
+    CSnapshotBuffer( const CSnapshotBuffer & );
+    CSnapshotBuffer & operator=( const CSnapshotBuffer & );
+};
+
+#endif // _CSNAPSHOTBUFFER_H_
@@ -0,0 +1,953 @@
+//-----------------------------------------------------------------------------
+// File: CSoftwareRenderBackend.cpp
+//
+// Desc: Tile based, multi-threaded software rasterizer implementing the
+//       rendering backend interface, for machines without a usable GPU.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CSoftwareRenderBackend Specific Includes
+//-----------------------------------------------------------------------------
+#include "CSoftwareRenderBackend.h"
+#include <stdlib.h>
+#include <math.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Local Module Functions
+//-----------------------------------------------------------------------------
+namespace
+{
+    // Vertices are snapped to 1/16th of a pixel
+    const float SUBPIXEL_SCALE = 16.0f;
+
+    //-------------------------------------------------------------------------
+    // Pixel block operations, 8 lanes with AVX2 and 4 with SSE2
+    //-------------------------------------------------------------------------
+#if defined(__AVX2__)
+    typedef __m256  VFLOAT;
+    typedef __m256i VINT;
+    const LONG RASTER_LANES = 8;
+    inline VFLOAT VSet1      ( float f )                 { return _mm256_set1_ps( f ); }
+    inline VFLOAT VLanes     ( )                         { return _mm256_set_ps( 7, 6, 5, 4, 3, 2, 1, 0 ); }
+    inline VFLOAT VAdd       ( VFLOAT a, VFLOAT b )      { return _mm256_add_ps( a, b ); }
+    inline VFLOAT VMul       ( VFLOAT a, VFLOAT b )      { return _mm256_mul_ps( a, b ); }
+    inline VFLOAT VMin       ( VFLOAT a, VFLOAT b )      { return _mm256_min_ps( a, b ); }
+    inline VFLOAT VMax       ( VFLOAT a, VFLOAT b )      { return _mm256_max_ps( a, b ); }
+    inline VFLOAT VRcp       ( VFLOAT a )                { return _mm256_rcp_ps( a ); }
+    inline VFLOAT VGreater   ( VFLOAT a, VFLOAT b )      { return _mm256_cmp_ps( a, b, _CMP_GT_OQ ); }
+    inline VFLOAT VGreaterEq ( VFLOAT a, VFLOAT b )      { return _mm256_cmp_ps( a, b, _CMP_GE_OQ ); }
+    inline VFLOAT VEqual     ( VFLOAT a, VFLOAT b )      { return _mm256_cmp_ps( a, b, _CMP_EQ_OQ ); }
+    inline VFLOAT VLessEq    ( VFLOAT a, VFLOAT b )      { return _mm256_cmp_ps( a, b, _CMP_LE_OQ ); }
+    inline VFLOAT VAnd       ( VFLOAT a, VFLOAT b )      { return _mm256_and_ps( a, b ); }
+    inline VFLOAT VOr        ( VFLOAT a, VFLOAT b )      { return _mm256_or_ps( a, b ); }
+    inline VFLOAT VSelect    ( VFLOAT m, VFLOAT a, VFLOAT b ) { return _mm256_blendv_ps( b, a, m ); }
+    inline int    VAny       ( VFLOAT m )                { return _mm256_movemask_ps( m ); }
+    inline VFLOAT VLoad      ( const float * p )         { return _mm256_loadu_ps( p ); }
+    inline void   VStore     ( float * p, VFLOAT a )     { _mm256_storeu_ps( p, a ); }
+    inline VINT   VToInt     ( VFLOAT a )                { return _mm256_cvtps_epi32( a ); }
+    inline VINT   VPack      ( VINT a, VINT r, VINT g, VINT b )
+    {
+        return _mm256_or_si256( _mm256_or_si256( _mm256_slli_epi32( a, 24 ), _mm256_slli_epi32( r, 16 ) ),
+                                _mm256_or_si256( _mm256_slli_epi32( g, 8 ), b ) );
+    }
+    inline void   VStoreColor( ULONG * p, VFLOAT m, VINT c )
+    {
+        VFLOAT Old = _mm256_loadu_ps( (const float*)p );
+        _mm256_storeu_ps( (float*)p, _mm256_blendv_ps( Old, _mm256_castsi256_ps( c ), m ) );
+    }
+#else
+    typedef __m128  VFLOAT;
+    typedef __m128i VINT;
+    const LONG RASTER_LANES = 4;
+    inline VFLOAT VSet1      ( float f )                 { return _mm_set1_ps( f ); }
+    inline VFLOAT VLanes     ( )                         { return _mm_set_ps( 3, 2, 1, 0 ); }
+    inline VFLOAT VAdd       ( VFLOAT a, VFLOAT b )      { return _mm_add_ps( a, b ); }
+    inline VFLOAT VMul       ( VFLOAT a, VFLOAT b )      { return _mm_mul_ps( a, b ); }
+    inline VFLOAT VMin       ( VFLOAT a, VFLOAT b )      { return _mm_min_ps( a, b ); }
+    inline VFLOAT VMax       ( VFLOAT a, VFLOAT b )      { return _mm_max_ps( a, b ); }
+    inline VFLOAT VRcp       ( VFLOAT a )                { return _mm_rcp_ps( a ); }
+    inline VFLOAT VGreater   ( VFLOAT a, VFLOAT b )      { return _mm_cmpgt_ps( a, b ); }
+    inline VFLOAT VGreaterEq ( VFLOAT a, VFLOAT b )      { return _mm_cmpge_ps( a, b ); }
+    inline VFLOAT VEqual     ( VFLOAT a, VFLOAT b )      { return _mm_cmpeq_ps( a, b ); }
+    inline VFLOAT VLessEq    ( VFLOAT a, VFLOAT b )      { return _mm_cmple_ps( a, b ); }
+    inline VFLOAT VAnd       ( VFLOAT a, VFLOAT b )      { return _mm_and_ps( a, b ); }
+    inline VFLOAT VOr        ( VFLOAT a, VFLOAT b )      { return _mm_or_ps( a, b ); }
+    inline VFLOAT VSelect    ( VFLOAT m, VFLOAT a, VFLOAT b ) { return _mm_or_ps( _mm_and_ps( m, a ), _mm_andnot_ps( m, b ) ); }
+    inline int    VAny       ( VFLOAT m )                { return _mm_movemask_ps( m ); }
+    inline VFLOAT VLoad      ( const float * p )         { return _mm_loadu_ps( p ); }
+    inline void   VStore     ( float * p, VFLOAT a )     { _mm_storeu_ps( p, a ); }
+    inline VINT   VToInt     ( VFLOAT a )                { return _mm_cvtps_epi32( a ); }
+    inline VINT   VPack      ( VINT a, VINT r, VINT g, VINT b )
+    {
+        return _mm_or_si128( _mm_or_si128( _mm_slli_epi32( a, 24 ), _mm_slli_epi32( r, 16 ) ),
+                             _mm_or_si128( _mm_slli_epi32( g, 8 ), b ) );
+    }
+    inline void   VStoreColor( ULONG * p, VFLOAT m, VINT c )
+    {
+        VFLOAT Old = _mm_loadu_ps( (const float*)p );
+        _mm_storeu_ps( (float*)p, VSelect( m, _mm_castsi128_ps( c ), Old ) );
+    }
+#endif
+
+    //-------------------------------------------------------------------------
+    // Name : Min3 () / Max3 ()
+    // Desc : Smallest / largest of three values.
+    //-------------------------------------------------------------------------
+    inline float Min3( float a, float b, float c ) { float m = a < b ? a : b; return m < c ? m : c; }
+    inline float Max3( float a, float b, float c ) { float m = a > b ? a : b; return m > c ? m : c; }
+
+    //-------------------------------------------------------------------------
+    // Name : ClipDistance ()
+    // Desc : Signed distance of a clip space position from one of the planes,
+    //        positive on the inside.
+    //-------------------------------------------------------------------------
+    template <class T> inline float ClipDistance( const T & v, ULONG Plane )
+    {
+        switch ( Plane )
+        {
+            case CLIP_LEFT:   return v.w + v.x;
+            case CLIP_RIGHT:  return v.w - v.x;
+            case CLIP_BOTTOM: return v.w + v.y;
+            case CLIP_TOP:    return v.w - v.y;
+            case CLIP_NEAR:   return v.z;
+            default:          return v.w - v.z;
+
+        } // End Switch
+    }
+
+}; // End Namespace
+
+//-----------------------------------------------------------------------------
+// Name : CSoftwareRenderBackend () (Constructor)
+// Desc : CSoftwareRenderBackend Class Constructor
+//-----------------------------------------------------------------------------
+CSoftwareRenderBackend::CSoftwareRenderBackend( CThreadPool * pThreadPool )
+{
+    LARGE_INTEGER Frequency;
+
+	// Reset / Clear all required values
+    m_pThreadPool       = pThreadPool;
+    m_pColor            = NULL;
+    m_pDepth            = NULL;
+    m_nWidth            = 0;
+    m_nHeight           = 0;
+    m_nPitch            = 0;
+    m_nTilesX           = 0;
+    m_nTilesY           = 0;
+    m_pBins             = NULL;
+    m_pTriangles        = NULL;
+    m_nTriangleCount    = 0;
+    m_nTriangleCapacity = 0;
+    m_pVertices         = NULL;
+    m_nVertexCapacity   = 0;
+    m_pOutCodes         = NULL;
+    m_nOutCodeCapacity  = 0;
+    m_pStreamData       = NULL;
+    m_nStreamStride     = 0;
+    m_FVF               = 0;
+    m_bDepthEnable      = true;
+    m_bDepthWrite       = true;
+    m_CullMode          = D3DCULL_CCW;
+    m_ShadeMode         = D3DSHADE_GOURAUD;
+    m_bTransformDirty   = true;
+    D3DXMatrixIdentity( &m_mtxWorld );
+    D3DXMatrixIdentity( &m_mtxView );
+    D3DXMatrixIdentity( &m_mtxProjection );
+
+    QueryPerformanceFrequency( &Frequency );
+    m_fTimerScale = 1000.0 / (double)Frequency.QuadPart;
+    m_Stream.Create( DYNAMIC_STREAM_SIZE, DYNAMIC_FRAMES_IN_FLIGHT );
+    ResetStats();
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CSoftwareRenderBackend () (Destructor)
+// Desc : CSoftwareRenderBackend Class Destructor
+//-----------------------------------------------------------------------------
+CSoftwareRenderBackend::~CSoftwareRenderBackend()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Allocates the colour & depth buffers, and the tile bins.
+//-----------------------------------------------------------------------------
+bool CSoftwareRenderBackend::Create( ULONG Width, ULONG Height )
+{
+    ULONG Pitch = (Width + 7) & ~7;
+
+    // Validate
+    if ( Width == 0 || Height == 0 ) return false;
+
+    Release();
+
+    // Rows are padded so that the widest pixel block never leaves its row
+    if (!( m_pColor = (ULONG*)malloc( Pitch * Height * sizeof(ULONG) ) )) goto CreateError;
+    if (!( m_pDepth = (float*)malloc( Pitch * Height * sizeof(float) ) )) goto CreateError;
+
+    m_nTilesX = (Width  + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    m_nTilesY = (Height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    if (!( m_pBins = (TILE_BIN*)calloc( m_nTilesX * m_nTilesY, sizeof(TILE_BIN) ) )) goto CreateError;
+
+    m_nWidth  = Width;
+    m_nHeight = Height;
+    m_nPitch  = Pitch;
+    Clear( D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, 0, 1.0f );
+
+    // Success!
+    return true;
+
+CreateError:
+    // Clean up
+    Release();
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Frees the framebuffer and all working storage.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::Release( )
+{
+    if ( m_pBins )
+    {
+        for ( ULONG i = 0; i < m_nTilesX * m_nTilesY; i++ ) if ( m_pBins[i].pTriangles ) free( m_pBins[i].pTriangles );
+        free( m_pBins );
+
+    } // End if bins
+    if ( m_pColor     ) free( m_pColor );
+    if ( m_pDepth     ) free( m_pDepth );
+    if ( m_pTriangles ) free( m_pTriangles );
+    if ( m_pVertices  ) free( m_pVertices );
+    if ( m_pOutCodes  ) free( m_pOutCodes );
+    if ( m_pStreamData ) free( m_pStreamData );
+    m_Stream.Reset();
+
+    m_pColor            = NULL;
+    m_pDepth            = NULL;
+    m_pBins             = NULL;
+    m_pTriangles        = NULL;
+    m_pVertices         = NULL;
+    m_pOutCodes         = NULL;
+    m_pStreamData       = NULL;
+    m_nWidth            = 0;
+    m_nHeight           = 0;
+    m_nPitch            = 0;
+    m_nTilesX           = 0;
+    m_nTilesY           = 0;
+    m_nTriangleCount    = 0;
+    m_nTriangleCapacity = 0;
+    m_nVertexCapacity   = 0;
+    m_nOutCodeCapacity  = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Resize ()
+// Desc : Recreates the framebuffer at the new size.
+//-----------------------------------------------------------------------------
+bool CSoftwareRenderBackend::Resize( ULONG Width, ULONG Height )
+{
+    return Create( Width, Height );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetStats ()
+// Desc : Zeroes the submission counters and the accumulated timings.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::ResetStats( )
+{
+    ZeroMemory( &m_Stats, sizeof(RENDER_STATS) );
+    m_Stream.ResetStats();
+    ZeroMemory( &m_CurrentTimings, sizeof(RASTER_TIMINGS) );
+    ZeroMemory( &m_FrameTimings, sizeof(RASTER_TIMINGS) );
+    ZeroMemory( &m_TotalTimings, sizeof(RASTER_TIMINGS) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddTime () (Private)
+// Desc : Adds the time since *pStart to the specified stage, and restarts
+//        the measurement so that consecutive stages can be chained.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::AddTime( float * pTime, LARGE_INTEGER * pStart )
+{
+    LARGE_INTEGER Now;
+    QueryPerformanceCounter( &Now );
+    *pTime += (float)((double)(Now.QuadPart - pStart->QuadPart) * m_fTimerScale);
+    *pStart = Now;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Clear ()
+// Desc : Clears the colour and / or depth buffer, drawing anything still
+//        pending first.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::Clear( ULONG Flags, D3DCOLOR Color, float fZ )
+{
+    LARGE_INTEGER Start;
+    ULONG         i, Count = m_nPitch * m_nHeight;
+
+    Flush();
+    m_Stats.Clears++;
+
+    QueryPerformanceCounter( &Start );
+    if ( Flags & D3DCLEAR_TARGET ) for ( i = 0; i < Count; i++ ) m_pColor[i] = Color;
+    if ( Flags & D3DCLEAR_ZBUFFER ) for ( i = 0; i < Count; i++ ) m_pDepth[i] = fZ;
+    AddTime( &m_CurrentTimings.fClear, &Start );
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndScene ()
+// Desc : Rasterizes every triangle submitted during the scene.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::EndScene( )
+{
+    Flush();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Present ()
+// Desc : Completes the frame, making its timings available.
+//-----------------------------------------------------------------------------
+bool CSoftwareRenderBackend::Present( )
+{
+    Flush();
+
+    m_FrameTimings = m_CurrentTimings;
+    m_TotalTimings.fClear    += m_CurrentTimings.fClear;
+    m_TotalTimings.fGeometry += m_CurrentTimings.fGeometry;
+    m_TotalTimings.fBinning  += m_CurrentTimings.fBinning;
+    m_TotalTimings.fRaster   += m_CurrentTimings.fRaster;
+    m_TotalTimings.Triangles += m_CurrentTimings.Triangles;
+    m_TotalTimings.Binned    += m_CurrentTimings.Binned;
+    ZeroMemory( &m_CurrentTimings, sizeof(RASTER_TIMINGS) );
+
+    // Every streamed vertex has been consumed by now
+    m_Stream.EndFrame();
+    m_Stream.RetireFrames( m_Stream.GetFrame() - 1 );
+
+    m_Stats.Frames++;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetRenderState ()
+// Desc : Stores the render states the rasterizer implements.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::SetRenderState( D3DRENDERSTATETYPE State, ULONG Value )
+{
+    switch ( State )
+    {
+        case D3DRS_ZENABLE:      m_bDepthEnable = (Value != D3DZB_FALSE); break;
+        case D3DRS_ZWRITEENABLE: m_bDepthWrite  = (Value != FALSE); break;
+        case D3DRS_CULLMODE:     m_CullMode     = Value; break;
+        case D3DRS_SHADEMODE:    m_ShadeMode    = Value; break;
+        default:                 break;
+
+    } // End Switch
+
+    m_Stats.StateChanges++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetTransform ()
+// Desc : Stores a transform matrix.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::SetTransform( D3DTRANSFORMSTATETYPE State, const D3DXMATRIX & mtx )
+{
+    switch ( State )
+    {
+        case D3DTS_WORLD:      m_mtxWorld      = mtx; break;
+        case D3DTS_VIEW:       m_mtxView       = mtx; break;
+        case D3DTS_PROJECTION: m_mtxProjection = mtx; break;
+        default:               return;
+
+    } // End Switch
+
+    m_bTransformDirty = true;
+    m_Stats.TransformChanges++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetFVF ()
+// Desc : Stores the vertex format.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::SetFVF( ULONG FVF )
+{
+    m_FVF = FVF;
+    m_Stats.StateChanges++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawPrimitiveUP ()
+// Desc : Draws non indexed triangles from user memory.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::DrawPrimitiveUP( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount, const void * pVertices, ULONG Stride )
+{
+    m_Stats.DrawCalls++;
+    m_Stats.Primitives     += PrimitiveCount;
+    m_Stats.BytesSubmitted += (ULONGLONG)GetVertexCount( Type, PrimitiveCount ) * Stride;
+
+    DrawVertices( Type, PrimitiveCount, pVertices, Stride );
+}
+
+//-----------------------------------------------------------------------------
+// Name : LockVertices ()
+// Desc : Appends VertexCount vertices to the dynamic stream, returning the
+//        memory to write them to and the index of the first one.
+//-----------------------------------------------------------------------------
+void * CSoftwareRenderBackend::LockVertices( ULONG VertexCount, ULONG Stride, ULONG * pStartVertex )
+{
+    ULONG Offset;
+
+    // Validate
+    if ( VertexCount == 0 || Stride == 0 ) return NULL;
+
+    // Allocate the stream on first use
+    if ( !m_pStreamData && !( m_pStreamData = (UCHAR*)malloc( DYNAMIC_STREAM_SIZE ) ) ) return NULL;
+    if ( !m_Stream.Allocate( VertexCount * Stride, Stride, &Offset, NULL ) ) return NULL;
+
+    m_Stats.BytesSubmitted += (ULONGLONG)VertexCount * Stride;
+    m_nStreamStride = Stride;
+    *pStartVertex   = Offset / Stride;
+    return m_pStreamData + Offset;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawPrimitive ()
+// Desc : Draws non indexed triangles from the dynamic stream.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::DrawPrimitive( D3DPRIMITIVETYPE Type, ULONG StartVertex, ULONG PrimitiveCount )
+{
+    ULONG VertexCount = GetVertexCount( Type, PrimitiveCount );
+
+    m_Stats.DrawCalls++;
+    m_Stats.Primitives += PrimitiveCount;
+
+    // Validate
+    if ( !m_pStreamData || m_nStreamStride == 0 ) return;
+    if ( (ULONGLONG)(StartVertex + VertexCount) * m_nStreamStride > DYNAMIC_STREAM_SIZE ) return;
+
+    DrawVertices( Type, PrimitiveCount, m_pStreamData + StartVertex * m_nStreamStride, m_nStreamStride );
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawVertices () (Private)
+// Desc : Transforms, assembles and bins a non indexed draw.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::DrawVertices( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount, const void * pVertices, ULONG Stride )
+{
+    LARGE_INTEGER Start;
+    ULONG         i, VertexCount = GetVertexCount( Type, PrimitiveCount );
+    ULONG         First = m_nTriangleCount;
+
+    // Transform every vertex
+    QueryPerformanceCounter( &Start );
+    if ( !BeginDraw( pVertices, VertexCount, Stride ) ) return;
+
+    // Assemble the triangles
+    switch ( Type )
+    {
+        case D3DPT_TRIANGLELIST:
+            for ( i = 0; i < PrimitiveCount; i++ ) DrawTriangle( i * 3, i * 3 + 1, i * 3 + 2 );
+            break;
+
+        case D3DPT_TRIANGLESTRIP:
+            for ( i = 0; i < PrimitiveCount; i++ )
+            {
+                if ( i & 1 ) DrawTriangle( i + 1, i, i + 2 ); else DrawTriangle( i, i + 1, i + 2 );
+
+            } // Next Triangle
+            break;
+
+        case D3DPT_TRIANGLEFAN:
+            for ( i = 0; i < PrimitiveCount; i++ ) DrawTriangle( 0, i + 1, i + 2 );
+            break;
+
+        default:
+            // Points & lines are not rasterized
+            break;
+
+    } // End Switch
+    AddTime( &m_CurrentTimings.fGeometry, &Start );
+
+    // Sort the new triangles into tiles
+    BinTriangles( First );
+    AddTime( &m_CurrentTimings.fBinning, &Start );
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawIndexedPrimitiveUP ()
+// Desc : Draws indexed triangles from user memory.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::DrawIndexedPrimitiveUP( D3DPRIMITIVETYPE Type, ULONG VertexCount, ULONG PrimitiveCount, const void * pIndices,
+                                                     D3DFORMAT IndexFormat, const void * pVertices, ULONG Stride )
+{
+    LARGE_INTEGER Start;
+    ULONG         i, Index[3], IndexCount = GetIndexCount( Type, PrimitiveCount );
+    ULONG         First = m_nTriangleCount;
+    bool          b32Bit = (IndexFormat == D3DFMT_INDEX32);
+
+    m_Stats.DrawCalls++;
+    m_Stats.Primitives     += PrimitiveCount;
+    m_Stats.BytesSubmitted += (ULONGLONG)VertexCount * Stride;
+    m_Stats.BytesSubmitted += (ULONGLONG)IndexCount * (b32Bit ? 4 : 2);
+
+    // Only indexed lists are used by the application
+    if ( Type != D3DPT_TRIANGLELIST ) return;
+
+    // Transform every vertex
+    QueryPerformanceCounter( &Start );
+    if ( !BeginDraw( pVertices, VertexCount, Stride ) ) return;
+
+    // Assemble the triangles, skipping any which index past the vertices
+    for ( i = 0; i < PrimitiveCount; i++ )
+    {
+        for ( ULONG k = 0; k < 3; k++ )
+        {
+            Index[k] = b32Bit ? ((const ULONG*)pIndices)[ i * 3 + k ] : ((const USHORT*)pIndices)[ i * 3 + k ];
+
+        } // Next Index
+        if ( Index[0] >= VertexCount || Index[1] >= VertexCount || Index[2] >= VertexCount ) continue;
+        DrawTriangle( Index[0], Index[1], Index[2] );
+
+    } // Next Triangle
+    AddTime( &m_CurrentTimings.fGeometry, &Start );
+
+    // Sort the new triangles into tiles
+    BinTriangles( First );
+    AddTime( &m_CurrentTimings.fBinning, &Start );
+}
+
+//-----------------------------------------------------------------------------
+// Name : BeginDraw () (Private)
+// Desc : Transforms the vertices of a draw into clip space, and classifies
+//        them against the clip planes.
+//-----------------------------------------------------------------------------
+bool CSoftwareRenderBackend::BeginDraw( const void * pVertices, ULONG VertexCount, ULONG Stride )
+{
+    const UCHAR * pSource = (const UCHAR*)pVertices;
+
+    // Validate
+    if ( !m_pColor || !pVertices || VertexCount == 0 ) return false;
+    if ( m_FVF != (D3DFVF_XYZ | D3DFVF_DIFFUSE) || Stride < 16 ) return false;
+    if ( !Reserve( (void**)&m_pVertices, &m_nVertexCapacity, VertexCount, sizeof(CLIP_VERTEX) ) ) return false;
+    if ( !Reserve( (void**)&m_pOutCodes, &m_nOutCodeCapacity, VertexCount, sizeof(UCHAR) ) ) return false;
+
+    // Rebuild the combined transform if anything changed
+    if ( m_bTransformDirty )
+    {
+        D3DXMatrixMultiply( &m_mtxTransform, &m_mtxWorld, &m_mtxView );
+        D3DXMatrixMultiply( &m_mtxTransform, &m_mtxTransform, &m_mtxProjection );
+        m_bTransformDirty = false;
+
+    } // End if dirty
+
+    // Transform the positions straight into the clip vertices
+    CVertexTransform::TransformArray( (D3DXVECTOR4*)&m_pVertices[0].x, sizeof(CLIP_VERTEX), m_pOutCodes,
+                                      pVertices, Stride, VertexCount, m_mtxTransform );
+
+    // Unpack the colours
+    for ( ULONG i = 0; i < VertexCount; i++, pSource += Stride )
+    {
+        ULONG         Color     = *(const ULONG*)(pSource + 12);
+        CLIP_VERTEX & v         = m_pVertices[i];
+
+        v.a = (float)((Color >> 24) & 0xFF);
+        v.r = (float)((Color >> 16) & 0xFF);
+        v.g = (float)((Color >>  8) & 0xFF);
+        v.b = (float)( Color        & 0xFF);
+        v.OutCode = m_pOutCodes[i];
+
+    } // Next Vertex
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawTriangle () (Private)
+// Desc : Clips a triangle of the current draw against the view volume, and
+//        sets up whatever remains.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::DrawTriangle( ULONG i0, ULONG i1, ULONG i2 )
+{
+    const CLIP_VERTEX & v0 = m_pVertices[ i0 ];
+    const CLIP_VERTEX & v1 = m_pVertices[ i1 ];
+    const CLIP_VERTEX & v2 = m_pVertices[ i2 ];
+    CLIP_VERTEX         Polygon[2][ RASTER_MAX_CLIP ];
+    ULONG               Count = 3, Current = 0, Plane, i;
+
+    m_CurrentTimings.Triangles++;
+
+    // Trivially reject, or accept, by the outcodes
+    if ( v0.OutCode & v1.OutCode & v2.OutCode ) return;
+    if ( (v0.OutCode | v1.OutCode | v2.OutCode) == 0 ) { SetupTriangle( &v0, &v1, &v2, &v0 ); return; }
+
+    // Clip against each plane that is crossed (Sutherland-Hodgman)
+    Polygon[0][0] = v0; Polygon[0][1] = v1; Polygon[0][2] = v2;
+    for ( Plane = CLIP_LEFT; Plane <= CLIP_FAR && Count >= 3; Plane <<= 1 )
+    {
+        if ( !((v0.OutCode | v1.OutCode | v2.OutCode) & Plane) ) continue;
+
+        const CLIP_VERTEX * pIn  = Polygon[ Current ];
+        CLIP_VERTEX       * pOut = Polygon[ Current ^ 1 ];
+        ULONG               OutCount = 0;
+
+        for ( i = 0; i < Count; i++ )
+        {
+            const CLIP_VERTEX & a = pIn[i];
+            const CLIP_VERTEX & b = pIn[ (i + 1) % Count ];
+            float da = ClipDistance( a, Plane ), db = ClipDistance( b, Plane );
+
+            if ( da >= 0.0f ) pOut[ OutCount++ ] = a;
+            if ( (da >= 0.0f) != (db >= 0.0f) )
+            {
+                // Add the intersection with the plane
+                float         t = da / (da - db);
+                CLIP_VERTEX & v = pOut[ OutCount++ ];
+                v.x = a.x + (b.x - a.x) * t; v.y = a.y + (b.y - a.y) * t;
+                v.z = a.z + (b.z - a.z) * t; v.w = a.w + (b.w - a.w) * t;
+                v.r = a.r + (b.r - a.r) * t; v.g = a.g + (b.g - a.g) * t;
+                v.b = a.b + (b.b - a.b) * t; v.a = a.a + (b.a - a.a) * t;
+                v.OutCode = 0;
+
+            } // End if crosses
+
+        } // Next Edge
+
+        Count   = OutCount;
+        Current ^= 1;
+
+    } // Next Plane
+
+    // Set up the remaining polygon as a fan
+    for ( i = 1; i + 1 < Count; i++ ) SetupTriangle( &Polygon[ Current ][0], &Polygon[ Current ][i], &Polygon[ Current ][i + 1], &v0 );
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetupTriangle () (Private)
+// Desc : Projects a clipped triangle to the screen, culls it by winding,
+//        and computes its edge functions and interpolation planes.
+// Note : Edges and planes are relative to the first vertex, keeping the
+//        values small and accurate for any position on screen. Flat shaded
+//        triangles take their colour from pFlat.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::SetupTriangle( const CLIP_VERTEX * pV0, const CLIP_VERTEX * pV1, const CLIP_VERTEX * pV2, const CLIP_VERTEX * pFlat )
+{
+    const CLIP_VERTEX * pSource[3] = { pV0, pV1, pV2 };
+    float               x[3], y[3], Attrib[6][3], fArea;
+    float               fHalfWidth = m_nWidth * 0.5f, fHalfHeight = m_nHeight * 0.5f;
+    ULONG               i;
+
+    // Project & snap each vertex
+    for ( i = 0; i < 3; i++ )
+    {
+        const CLIP_VERTEX & v = *pSource[i];
+        if ( v.w <= 1e-6f ) return;
+
+        float fInvW = 1.0f / v.w;
+        x[i] = floorf( (v.x * fInvW + 1.0f) * fHalfWidth  * SUBPIXEL_SCALE + 0.5f ) / SUBPIXEL_SCALE;
+        y[i] = floorf( (1.0f - v.y * fInvW) * fHalfHeight * SUBPIXEL_SCALE + 0.5f ) / SUBPIXEL_SCALE;
+        const CLIP_VERTEX & c = (m_ShadeMode == D3DSHADE_FLAT) ? *pFlat : v;
+        Attrib[0][i] = v.z * fInvW;
+        Attrib[1][i] = fInvW;
+        Attrib[2][i] = c.r * fInvW;
+        Attrib[3][i] = c.g * fInvW;
+        Attrib[4][i] = c.b * fInvW;
+        Attrib[5][i] = c.a * fInvW;
+
+    } // Next Vertex
+
+    // Screen space y points down, so clockwise triangles have a positive area
+    fArea = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if ( fArea == 0.0f ) return;
+    if ( m_CullMode == D3DCULL_CCW && fArea < 0.0f ) return;
+    if ( m_CullMode == D3DCULL_CW  && fArea > 0.0f ) return;
+    if ( fArea < 0.0f )
+    {
+        // Reverse the winding of visible counter-clockwise triangles
+        float fSwap;
+        fSwap = x[1]; x[1] = x[2]; x[2] = fSwap;
+        fSwap = y[1]; y[1] = y[2]; y[2] = fSwap;
+        for ( i = 0; i < 6; i++ ) { fSwap = Attrib[i][1]; Attrib[i][1] = Attrib[i][2]; Attrib[i][2] = fSwap; }
+        fArea = -fArea;
+
+    } // End if counter-clockwise
+
+    // Pixel bounds (pixel centres lie on integer coordinates)
+    LONG MinX = (LONG)ceilf( Min3( x[0], x[1], x[2] ) ), MaxX = (LONG)floorf( Max3( x[0], x[1], x[2] ) );
+    LONG MinY = (LONG)ceilf( Min3( y[0], y[1], y[2] ) ), MaxY = (LONG)floorf( Max3( y[0], y[1], y[2] ) );
+    if ( MinX < 0 ) MinX = 0;
+    if ( MinY < 0 ) MinY = 0;
+    if ( MaxX > (LONG)m_nWidth  - 1 ) MaxX = (LONG)m_nWidth  - 1;
+    if ( MaxY > (LONG)m_nHeight - 1 ) MaxY = (LONG)m_nHeight - 1;
+    if ( MinX > MaxX || MinY > MaxY ) return;
+
+    // Store the triangle
+    if ( !Reserve( (void**)&m_pTriangles, &m_nTriangleCapacity, m_nTriangleCount + 1, sizeof(RASTER_TRIANGLE) ) ) return;
+    RASTER_TRIANGLE & Tri = m_pTriangles[ m_nTriangleCount++ ];
+    Tri.RefX        = x[0];
+    Tri.RefY        = y[0];
+    Tri.MinX        = MinX; Tri.MaxX = MaxX;
+    Tri.MinY        = MinY; Tri.MaxY = MaxY;
+    Tri.bDepthTest  = m_bDepthEnable;
+    Tri.bDepthWrite = m_bDepthEnable && m_bDepthWrite;
+    Tri.TopLeft     = 0;
+
+    // Edge functions, positive inside. Pixels exactly on an edge belong to
+    // only one of the two triangles sharing it.
+    for ( i = 0; i < 3; i++ )
+    {
+        ULONG j = (i + 1) % 3;
+        float A = y[i] - y[j], B = x[j] - x[i];
+        Tri.EdgeA[i] = A;
+        Tri.EdgeB[i] = B;
+        Tri.EdgeC[i] = A * (x[0] - x[i]) + B * (y[0] - y[i]);
+        if ( A > 0.0f || (A == 0.0f && B > 0.0f) ) Tri.TopLeft |= 1 << i;
+
+    } // Next Edge
+
+    // Interpolation planes
+    float dx1 = x[1] - x[0], dy1 = y[1] - y[0], dx2 = x[2] - x[0], dy2 = y[2] - y[0];
+    float fInvArea = 1.0f / fArea;
+    for ( i = 0; i < 6; i++ )
+    {
+        float d1 = Attrib[i][1] - Attrib[i][0], d2 = Attrib[i][2] - Attrib[i][0];
+        Tri.Plane[i][0] = (d1 * dy2 - d2 * dy1) * fInvArea;
+        Tri.Plane[i][1] = (d2 * dx1 - d1 * dx2) * fInvArea;
+        Tri.Plane[i][2] = Attrib[i][0];
+
+    } // Next Attribute
+}
+
+//-----------------------------------------------------------------------------
+// Name : BinTriangles () (Private)
+// Desc : Adds each triangle from First onwards to the bin of every tile
+//        that its edges do not entirely exclude.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::BinTriangles( ULONG First )
+{
+    for ( ULONG t = First; t < m_nTriangleCount; t++ )
+    {
+        const RASTER_TRIANGLE & Tri = m_pTriangles[t];
+        ULONG TileX0 = Tri.MinX / RASTER_TILE_SIZE, TileX1 = Tri.MaxX / RASTER_TILE_SIZE;
+        ULONG TileY0 = Tri.MinY / RASTER_TILE_SIZE, TileY1 = Tri.MaxY / RASTER_TILE_SIZE;
+        bool  bBinned = false;
+
+        for ( ULONG ty = TileY0; ty <= TileY1; ty++ )
+        {
+            for ( ULONG tx = TileX0; tx <= TileX1; tx++ )
+            {
+                // Reject tiles whose most inside corner is outside an edge
+                if ( TileX0 != TileX1 || TileY0 != TileY1 )
+                {
+                    float fMinX = (float)(tx * RASTER_TILE_SIZE) - Tri.RefX, fMaxX = fMinX + (RASTER_TILE_SIZE - 1);
+                    float fMinY = (float)(ty * RASTER_TILE_SIZE) - Tri.RefY, fMaxY = fMinY + (RASTER_TILE_SIZE - 1);
+                    ULONG e;
+                    for ( e = 0; e < 3; e++ )
+                    {
+                        float E = Tri.EdgeA[e] * (Tri.EdgeA[e] > 0.0f ? fMaxX : fMinX) +
+                                  Tri.EdgeB[e] * (Tri.EdgeB[e] > 0.0f ? fMaxY : fMinY) + Tri.EdgeC[e];
+                        if ( E < 0.0f ) break;
+
+                    } // Next Edge
+                    if ( e < 3 ) continue;
+
+                } // End if several tiles
+
+                TILE_BIN & Bin = m_pBins[ ty * m_nTilesX + tx ];
+                if ( Bin.Count == Bin.Capacity && !Reserve( (void**)&Bin.pTriangles, &Bin.Capacity, Bin.Count + 1, sizeof(ULONG) ) ) continue;
+                Bin.pTriangles[ Bin.Count++ ] = t;
+                bBinned = true;
+
+            } // Next Tile
+
+        } // Next Tile Row
+
+        if ( bBinned ) m_CurrentTimings.Binned++;
+
+    } // Next Triangle
+}
+
+//-----------------------------------------------------------------------------
+// Name : Flush () (Private)
+// Desc : Rasterizes every binned triangle, one task per tile, then empties
+//        the bins.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::Flush( )
+{
+    LARGE_INTEGER Start;
+    ULONG         TileCount = m_nTilesX * m_nTilesY;
+
+    if ( m_nTriangleCount == 0 ) return;
+
+    QueryPerformanceCounter( &Start );
+    if ( m_pThreadPool ) m_pThreadPool->Dispatch( RasterTask, this, TileCount );
+    else for ( ULONG i = 0; i < TileCount; i++ ) RasterTile( i );
+    AddTime( &m_CurrentTimings.fRaster, &Start );
+
+    for ( ULONG i = 0; i < TileCount; i++ ) m_pBins[i].Count = 0;
+    m_nTriangleCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RasterTask () (Private, Static)
+// Desc : Thread pool task rasterizing the tile matching the task index.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::RasterTask( void * pContext, ULONG Index )
+{
+    ((CSoftwareRenderBackend*)pContext)->RasterTile( Index );
+}
+
+//-----------------------------------------------------------------------------
+// Name : RasterTile () (Private)
+// Desc : Draws the triangles binned to a single tile, in submission order.
+// Note : Pixel blocks start on a multiple of the block width, and tiles are
+//        a multiple of 8 pixels wide, so no block ever touches another tile.
+//-----------------------------------------------------------------------------
+void CSoftwareRenderBackend::RasterTile( ULONG Tile )
+{
+    const TILE_BIN & Bin   = m_pBins[ Tile ];
+    LONG             TileX = (LONG)((Tile % m_nTilesX) * RASTER_TILE_SIZE);
+    LONG             TileY = (LONG)((Tile / m_nTilesX) * RASTER_TILE_SIZE);
+    VFLOAT           vLanes = VLanes(), vZero = VSet1( 0.0f ), v255 = VSet1( 255.0f );
+
+    for ( ULONG t = 0; t < Bin.Count; t++ )
+    {
+        const RASTER_TRIANGLE & Tri = m_pTriangles[ Bin.pTriangles[t] ];
+        VFLOAT vEdgeA[3], vTopLeft[3], vPlaneX[6];
+        ULONG  i;
+
+        // Restrict the triangle bounds to this tile
+        LONG MinX = Tri.MinX > TileX ? Tri.MinX : TileX, MaxX = Tri.MaxX < TileX + (LONG)RASTER_TILE_SIZE - 1 ? Tri.MaxX : TileX + (LONG)RASTER_TILE_SIZE - 1;
+        LONG MinY = Tri.MinY > TileY ? Tri.MinY : TileY, MaxY = Tri.MaxY < TileY + (LONG)RASTER_TILE_SIZE - 1 ? Tri.MaxY : TileY + (LONG)RASTER_TILE_SIZE - 1;
+        if ( MinX > MaxX || MinY > MaxY ) continue;
+
+        VFLOAT vMinX = VSet1( (float)MinX ), vMaxX = VSet1( (float)MaxX );
+        for ( i = 0; i < 3; i++ )
+        {
+            vEdgeA[i]   = VSet1( Tri.EdgeA[i] );
+            vTopLeft[i] = (Tri.TopLeft & (1 << i)) ? VEqual( vZero, vZero ) : vZero;
+
+        } // Next Edge
+        for ( i = 0; i < 6; i++ ) vPlaneX[i] = VSet1( Tri.Plane[i][0] );
+
+        for ( LONG y = MinY; y <= MaxY; y++ )
+        {
+            float    dy = (float)y - Tri.RefY;
+            VFLOAT   vRowEdge[3], vRow[6];
+            ULONG  * pColorRow = m_pColor + y * m_nPitch;
+            float  * pDepthRow = m_pDepth + y * m_nPitch;
+
+            for ( i = 0; i < 3; i++ ) vRowEdge[i] = VSet1( Tri.EdgeB[i] * dy + Tri.EdgeC[i] );
+            for ( i = 0; i < 6; i++ ) vRow[i] = VSet1( Tri.Plane[i][1] * dy + Tri.Plane[i][2] );
+
+            for ( LONG x = MinX & ~(RASTER_LANES - 1); x <= MaxX; x += RASTER_LANES )
+            {
+                VFLOAT vX   = VAdd( VSet1( (float)x ), vLanes );
+                VFLOAT vDX  = VAdd( VSet1( (float)x - Tri.RefX ), vLanes );
+                VFLOAT Mask = VAnd( VGreaterEq( vX, vMinX ), VLessEq( vX, vMaxX ) );
+
+                // Coverage
+                for ( i = 0; i < 3; i++ )
+                {
+                    VFLOAT E = VAdd( VMul( vEdgeA[i], vDX ), vRowEdge[i] );
+                    Mask = VAnd( Mask, VOr( VGreater( E, vZero ), VAnd( VEqual( E, vZero ), vTopLeft[i] ) ) );
+
+                } // Next Edge
+                if ( !VAny( Mask ) ) continue;
+
+                // Depth test (less or equal)
+                VFLOAT z = VAdd( VMul( vPlaneX[0], vDX ), vRow[0] );
+                VFLOAT OldZ = VLoad( pDepthRow + x );
+                if ( Tri.bDepthTest )
+                {
+                    Mask = VAnd( Mask, VLessEq( z, OldZ ) );
+                    if ( !VAny( Mask ) ) continue;
+
+                } // End if depth test
+                if ( Tri.bDepthWrite ) VStore( pDepthRow + x, VSelect( Mask, z, OldZ ) );
+
+                // Perspective correct colour
+                VFLOAT w = VRcp( VAdd( VMul( vPlaneX[1], vDX ), vRow[1] ) );
+                VFLOAT c[4];
+                for ( i = 0; i < 4; i++ )
+                {
+                    c[i] = VMul( VAdd( VMul( vPlaneX[i + 2], vDX ), vRow[i + 2] ), w );
+                    c[i] = VMin( VMax( c[i], vZero ), v255 );
+
+                } // Next Channel
+                VStoreColor( pColorRow + x, Mask, VPack( VToInt( c[3] ), VToInt( c[0] ), VToInt( c[1] ), VToInt( c[2] ) ) );
+
+            } // Next Block
+
+        } // Next Row
+
+    } // Next Triangle
+}
+
+//-----------------------------------------------------------------------------
+// Name : SaveImage ()
+// Desc : Writes the colour buffer to a 32 bit Windows bitmap file.
+//-----------------------------------------------------------------------------
+bool CSoftwareRenderBackend::SaveImage( LPCTSTR strFileName ) const
+{
+    BITMAPFILEHEADER FileHeader;
+    BITMAPINFOHEADER InfoHeader;
+    FILE           * pFile = NULL;
+    ULONG            RowBytes = m_nWidth * sizeof(ULONG);
+
+    // Validate
+    if ( !m_pColor || !strFileName ) return false;
+
+    ZeroMemory( &FileHeader, sizeof(FileHeader) );
+    ZeroMemory( &InfoHeader, sizeof(InfoHeader) );
+    FileHeader.bfType      = 0x4D42; // 'BM'
+    FileHeader.bfOffBits   = sizeof(FileHeader) + sizeof(InfoHeader);
+    FileHeader.bfSize      = FileHeader.bfOffBits + RowBytes * m_nHeight;
+    InfoHeader.biSize      = sizeof(InfoHeader);
+    InfoHeader.biWidth     = (LONG)m_nWidth;
+    InfoHeader.biHeight    = -(LONG)m_nHeight;   // Top down
+    InfoHeader.biPlanes    = 1;
+    InfoHeader.biBitCount  = 32;
+    InfoHeader.biCompression = BI_RGB;
+
+    if (!( pFile = _tfopen( strFileName, _T("wb") ) )) return false;
+    fwrite( &FileHeader, sizeof(FileHeader), 1, pFile );
+    fwrite( &InfoHeader, sizeof(InfoHeader), 1, pFile );
+    for ( ULONG y = 0; y < m_nHeight; y++ ) fwrite( m_pColor + y * m_nPitch, RowBytes, 1, pFile );
+    fclose( pFile );
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Reserve () (Private, Static)
+// Desc : Grows one of our arrays so that it can hold at least Count entries.
+//-----------------------------------------------------------------------------
+bool CSoftwareRenderBackend::Reserve( void ** ppData, ULONG * pCapacity, ULONG Count, ULONG Stride )
+{
+    ULONG  NewCapacity;
+    void * pNewData;
+
+    // Already large enough?
+    if ( Count <= *pCapacity ) return true;
+
+    // Grow by half again, to keep reallocation rare
+    NewCapacity = (*pCapacity < 64) ? 64 : *pCapacity + *pCapacity / 2;
+    if ( NewCapacity < Count ) NewCapacity = Count;
+    if (!( pNewData = realloc( *ppData, NewCapacity * Stride ) )) return false;
+
+    *ppData    = pNewData;
+    *pCapacity = NewCapacity;
+    return true;
+}
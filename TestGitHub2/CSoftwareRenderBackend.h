@@ -0,0 +1,196 @@
+//-----------------------------------------------------------------------------
+// File: CSoftwareRenderBackend.h
+//
+// Desc: Tile based, multi-threaded software rasterizer implementing the
+//       rendering backend interface, for machines without a usable GPU.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CSOFTWARERENDERBACKEND_H_
+#define _CSOFTWARERENDERBACKEND_H_
+
+//-----------------------------------------------------------------------------
+// CSoftwareRenderBackend Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CRenderBackend.h"
+#include "CThreadPool.h"
+#include "CVertexTransform.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG RASTER_TILE_SIZE    = 64;       // Tile width & height in pixels (multiple of 8)
+const ULONG RASTER_MAX_CLIP     = 9;        // Largest polygon produced by clipping a triangle
+
+//-----------------------------------------------------------------------------
+// Name : RASTER_TIMINGS (Struct)
+// Desc : Time spent in each stage of the rasterizer, in milliseconds.
+//-----------------------------------------------------------------------------
+struct RASTER_TIMINGS
+{
+    float           fClear;                 // Clearing the colour & depth buffers
+    float           fGeometry;              // Vertex transform, clipping & triangle setup
+    float           fBinning;               // Sorting triangles into the tiles they touch
+    float           fRaster;                // Drawing every tile (all threads)
+    ULONG           Triangles;              // Triangles submitted
+    ULONG           Binned;                 // Triangles surviving clipping & culling
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CSoftwareRenderBackend (Class)
+// Desc : Renders into an in-memory framebuffer. Each draw is transformed,
+//        clipped and set up on the calling thread, and the triangles are
+//        binned into screen tiles. The tiles are then rasterized in parallel
+//        by the thread pool when the scene ends, each tile drawing its
+//        triangles in submission order.
+// Note : Implements the states configured by CGameApp::SetupRenderStates,
+//        namely the z-buffer (less or equal), flat / Gouraud colour
+//        interpolation (perspective correct), back face culling and the
+//        XYZ | DIFFUSE vertex format. Lighting is never applied. Pixel
+//        centres follow the Direct3D 9 rules (integer coordinates).
+//        Edge functions are evaluated for 8 pixels at a time when built
+//        with AVX2 enabled (/arch:AVX2), and 4 at a time using SSE2 otherwise.
+//-----------------------------------------------------------------------------
+class CSoftwareRenderBackend : public IRenderBackend
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CSoftwareRenderBackend( CThreadPool * pThreadPool = NULL );
+	virtual ~CSoftwareRenderBackend();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Create          ( ULONG Width, ULONG Height );
+    void            Release         ( );
+    bool            SaveImage       ( LPCTSTR strFileName ) const;
+
+    const ULONG   * GetColorBuffer  ( ) const { return m_pColor; }
+    const float   * GetDepthBuffer  ( ) const { return m_pDepth; }
+    ULONG           GetWidth        ( ) const { return m_nWidth; }
+    ULONG           GetHeight       ( ) const { return m_nHeight; }
+    ULONG           GetPitch        ( ) const { return m_nPitch; }
+    const RASTER_TIMINGS & GetFrameTimings( ) const { return m_FrameTimings; }
+    const RASTER_TIMINGS & GetTotalTimings( ) const { return m_TotalTimings; }
+
+    // IRenderBackend
+    virtual void    Clear           ( ULONG Flags, D3DCOLOR Color, float fZ );
+    virtual void    BeginScene      ( ) {}
+    virtual void    EndScene        ( );
+    virtual bool    Present         ( );
+    virtual bool    IsLost          ( ) const { return false; }
+    virtual bool    Restore         ( ) { return true; }
+    virtual bool    Resize          ( ULONG Width, ULONG Height );
+    virtual void    SetRenderState  ( D3DRENDERSTATETYPE State, ULONG Value );
+    virtual void    SetTransform    ( D3DTRANSFORMSTATETYPE State, const D3DXMATRIX & mtx );
+    virtual void    SetFVF          ( ULONG FVF );
+    virtual void    DrawPrimitiveUP ( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount, const void * pVertices, ULONG Stride );
+    virtual void    DrawIndexedPrimitiveUP( D3DPRIMITIVETYPE Type, ULONG VertexCount, ULONG PrimitiveCount, const void * pIndices,
+                                            D3DFORMAT IndexFormat, const void * pVertices, ULONG Stride );
+    virtual void *  LockVertices    ( ULONG VertexCount, ULONG Stride, ULONG * pStartVertex );
+    virtual void    UnlockVertices  ( ) {}
+    virtual void    DrawPrimitive   ( D3DPRIMITIVETYPE Type, ULONG StartVertex, ULONG PrimitiveCount );
+    virtual bool    SupportsInstancing( ) const { return false; }
+    virtual IInstanceRenderer * BeginInstancing( const D3DXMATRIX & mtxViewProj ) { return NULL; }
+    virtual void    EndInstancing   ( ) {}
+    virtual const RENDER_STATS & GetStats( ) const { return m_Stats; }
+    virtual const RING_STATS & GetStreamStats( ) const { return m_Stream.GetStats(); }
+    virtual void    ResetStats      ( );
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Structures for This Class
+	//-------------------------------------------------------------------------
+    struct CLIP_VERTEX
+    {
+        float       x, y, z, w;             // Clip space position
+        float       r, g, b, a;             // Colour (0 - 255)
+        ULONG       OutCode;                // Clip planes the vertex is outside of
+    };
+
+    struct RASTER_TRIANGLE
+    {
+        float       RefX, RefY;             // Snapped position of the first vertex
+        float       EdgeA[3], EdgeB[3], EdgeC[3]; // E = A*dx + B*dy + C, inside where E >= 0
+        ULONG       TopLeft;                // Edges which own pixels lying exactly on them
+        float       Plane[6][3];            // z, 1/w, r/w, g/w, b/w, a/w = P0*dx + P1*dy + P2
+        LONG        MinX, MinY, MaxX, MaxY; // Pixel bounds (inclusive)
+        bool        bDepthTest;             // Test against the depth buffer
+        bool        bDepthWrite;            // Write to the depth buffer
+    };
+
+    struct TILE_BIN
+    {
+        ULONG     * pTriangles;             // Indices into m_pTriangles, in submission order
+        ULONG       Count;
+        ULONG       Capacity;
+    };
+
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    void            DrawVertices    ( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount, const void * pVertices, ULONG Stride );
+    bool            BeginDraw       ( const void * pVertices, ULONG VertexCount, ULONG Stride );
+    void            DrawTriangle    ( ULONG i0, ULONG i1, ULONG i2 );
+    void            SetupTriangle   ( const CLIP_VERTEX * pV0, const CLIP_VERTEX * pV1, const CLIP_VERTEX * pV2, const CLIP_VERTEX * pFlat );
+    void            BinTriangles    ( ULONG First );
+    void            Flush           ( );
+    void            RasterTile      ( ULONG Tile );
+    void            AddTime         ( float * pTime, LARGE_INTEGER * pStart );
+
+    //-------------------------------------------------------------------------
+	// Private Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static void     RasterTask      ( void * pContext, ULONG Index );
+    static bool     Reserve         ( void ** ppData, ULONG * pCapacity, ULONG Count, ULONG Stride );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    CThreadPool       * m_pThreadPool;      // Workers used to rasterize tiles (optional)
+    ULONG             * m_pColor;           // Colour buffer (A8R8G8B8)
+    float             * m_pDepth;           // Depth buffer
+    ULONG               m_nWidth;           // Framebuffer width in pixels
+    ULONG               m_nHeight;          // Framebuffer height in pixels
+    ULONG               m_nPitch;           // Pixels per row (width rounded up to 8)
+    ULONG               m_nTilesX;          // Tiles across
+    ULONG               m_nTilesY;          // Tiles down
+    TILE_BIN          * m_pBins;            // Triangle list for each tile
+
+    RASTER_TRIANGLE   * m_pTriangles;       // Triangles set up since the last flush
+    ULONG               m_nTriangleCount;
+    ULONG               m_nTriangleCapacity;
+    CLIP_VERTEX       * m_pVertices;        // Transformed vertices of the current draw
+    ULONG               m_nVertexCapacity;
+    UCHAR             * m_pOutCodes;        // Outcodes of the current draw's vertices
+    ULONG               m_nOutCodeCapacity;
+    CRingAllocator      m_Stream;           // Space in m_pStreamData
+    UCHAR             * m_pStreamData;      // Dynamic stream (allocated on first use)
+    ULONG               m_nStreamStride;    // Stride of the most recent LockVertices
+
+    D3DXMATRIX          m_mtxWorld;         // Current transforms
+    D3DXMATRIX          m_mtxView;
+    D3DXMATRIX          m_mtxProjection;
+    D3DXMATRIX          m_mtxTransform;     // World * View * Projection
+    bool                m_bTransformDirty;  // m_mtxTransform must be rebuilt
+    ULONG               m_FVF;              // Current vertex format
+    bool                m_bDepthEnable;     // D3DRS_ZENABLE
+    bool                m_bDepthWrite;      // D3DRS_ZWRITEENABLE
+    ULONG               m_CullMode;         // D3DRS_CULLMODE
+    ULONG               m_ShadeMode;        // D3DRS_SHADEMODE
+
+    RENDER_STATS        m_Stats;            // Work submitted since the last reset
+    RASTER_TIMINGS      m_CurrentTimings;   // Timings of the frame being drawn
+    RASTER_TIMINGS      m_FrameTimings;     // Timings of the most recently presented frame
+    RASTER_TIMINGS      m_TotalTimings;     // Timings summed since the last reset
+    double              m_fTimerScale;      // Milliseconds per performance counter tick
+};
+
+#endif // _CSOFTWARERENDERBACKEND_H_
@@ -0,0 +1,187 @@
+//-----------------------------------------------------------------------------
+// File: CStateCacheBackend.cpp
+//
+// Desc: Rendering backend which shadows the device state, and passes only
+//       the state changes which alter it through to another backend.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CStateCacheBackend Specific Includes
+//-----------------------------------------------------------------------------
+#include "CStateCacheBackend.h"
+
+//-----------------------------------------------------------------------------
+// Name : CStateCacheBackend () (Constructor)
+// Desc : CStateCacheBackend Class Constructor
+//-----------------------------------------------------------------------------
+CStateCacheBackend::CStateCacheBackend( IRenderBackend * pTarget )
+{
+	// Reset / Clear all required values
+    m_pTarget = pTarget;
+    Invalidate();
+    ZeroMemory( &m_CurrentCache, sizeof(STATE_CACHE_STATS) );
+    ZeroMemory( &m_FrameCache, sizeof(STATE_CACHE_STATS) );
+    ZeroMemory( &m_TotalCache, sizeof(STATE_CACHE_STATS) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CStateCacheBackend () (Destructor)
+// Desc : CStateCacheBackend Class Destructor
+//-----------------------------------------------------------------------------
+CStateCacheBackend::~CStateCacheBackend()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetTarget ()
+// Desc : Selects the backend that calls are passed through to. Nothing is
+//        known about its state, so the cache starts out empty.
+//-----------------------------------------------------------------------------
+void CStateCacheBackend::SetTarget( IRenderBackend * pTarget )
+{
+    m_pTarget = pTarget;
+    Invalidate();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Invalidate ()
+// Desc : Forgets every cached value, so that the next call for each state
+//        is passed through regardless of its value.
+//-----------------------------------------------------------------------------
+void CStateCacheBackend::Invalidate( )
+{
+    ZeroMemory( m_StateSet, sizeof(m_StateSet) );
+    ZeroMemory( m_TransformSet, sizeof(m_TransformSet) );
+    m_FVF     = 0;
+    m_bFVFSet = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetStats ()
+// Desc : Zeroes the filtering counters, along with the target's statistics.
+//-----------------------------------------------------------------------------
+void CStateCacheBackend::ResetStats( )
+{
+    m_pTarget->ResetStats();
+    ZeroMemory( &m_CurrentCache, sizeof(STATE_CACHE_STATS) );
+    ZeroMemory( &m_FrameCache, sizeof(STATE_CACHE_STATS) );
+    ZeroMemory( &m_TotalCache, sizeof(STATE_CACHE_STATS) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : Present ()
+// Desc : Presents the frame, making its filtering counts available.
+//-----------------------------------------------------------------------------
+bool CStateCacheBackend::Present( )
+{
+    m_FrameCache = m_CurrentCache;
+    m_TotalCache.StatesIssued       += m_CurrentCache.StatesIssued;
+    m_TotalCache.StatesFiltered     += m_CurrentCache.StatesFiltered;
+    m_TotalCache.TransformsIssued   += m_CurrentCache.TransformsIssued;
+    m_TotalCache.TransformsFiltered += m_CurrentCache.TransformsFiltered;
+    m_TotalCache.FVFsIssued         += m_CurrentCache.FVFsIssued;
+    m_TotalCache.FVFsFiltered       += m_CurrentCache.FVFsFiltered;
+    ZeroMemory( &m_CurrentCache, sizeof(STATE_CACHE_STATS) );
+
+    return m_pTarget->Present();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Restore ()
+// Desc : Restores the target, emptying the cache once its device has been
+//        reset.
+//-----------------------------------------------------------------------------
+bool CStateCacheBackend::Restore( )
+{
+    bool bWasLost = m_pTarget->IsLost();
+
+    if ( !m_pTarget->Restore() ) return false;
+    if ( bWasLost ) Invalidate();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Resize ()
+// Desc : Resizes the target, emptying the cache as the device was reset.
+//-----------------------------------------------------------------------------
+bool CStateCacheBackend::Resize( ULONG Width, ULONG Height )
+{
+    bool bResult = m_pTarget->Resize( Width, Height );
+
+    // Even a failed reset may have discarded the device state
+    Invalidate();
+    return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetRenderState ()
+// Desc : Passes a render state through, unless the value is already set.
+//-----------------------------------------------------------------------------
+void CStateCacheBackend::SetRenderState( D3DRENDERSTATETYPE State, ULONG Value )
+{
+    if ( (ULONG)State < MAX_RENDER_STATES )
+    {
+        if ( m_StateSet[ State ] && m_RenderStates[ State ] == Value ) { m_CurrentCache.StatesFiltered++; return; }
+        m_RenderStates[ State ] = Value;
+        m_StateSet[ State ]     = true;
+
+    } // End if tracked
+
+    m_pTarget->SetRenderState( State, Value );
+    m_CurrentCache.StatesIssued++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetTransform ()
+// Desc : Passes a transform through, unless the matrix is already set.
+//-----------------------------------------------------------------------------
+void CStateCacheBackend::SetTransform( D3DTRANSFORMSTATETYPE State, const D3DXMATRIX & mtx )
+{
+    if ( (ULONG)State < MAX_TRANSFORMS )
+    {
+        if ( m_TransformSet[ State ] && memcmp( &m_Transforms[ State ], &mtx, sizeof(D3DXMATRIX) ) == 0 ) { m_CurrentCache.TransformsFiltered++; return; }
+        m_Transforms[ State ]   = mtx;
+        m_TransformSet[ State ] = true;
+
+    } // End if tracked
+
+    m_pTarget->SetTransform( State, mtx );
+    m_CurrentCache.TransformsIssued++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetFVF ()
+// Desc : Passes a vertex format through, unless the format is already set.
+//-----------------------------------------------------------------------------
+void CStateCacheBackend::SetFVF( ULONG FVF )
+{
+    if ( m_bFVFSet && m_FVF == FVF ) { m_CurrentCache.FVFsFiltered++; return; }
+    m_FVF     = FVF;
+    m_bFVFSet = true;
+
+    m_pTarget->SetFVF( FVF );
+    m_CurrentCache.FVFsIssued++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BeginInstancing ()
+// Desc : Passes through to the target. The instancing renderer replaces the
+//        vertex declaration, so the vertex format is no longer known.
+//-----------------------------------------------------------------------------
+IInstanceRenderer * CStateCacheBackend::BeginInstancing( const D3DXMATRIX & mtxViewProj )
+{
+    m_bFVFSet = false;
+    return m_pTarget->BeginInstancing( mtxViewProj );
+}
+
+//-----------------------------------------------------------------------------
+// Name : EndInstancing ()
+// Desc : Passes through to the target, which sets its own vertex format.
+//-----------------------------------------------------------------------------
+void CStateCacheBackend::EndInstancing( )
+{
+    m_pTarget->EndInstancing();
+    m_bFVFSet = false;
+}
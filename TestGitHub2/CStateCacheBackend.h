@@ -0,0 +1,114 @@
+//-----------------------------------------------------------------------------
+// File: CStateCacheBackend.h
+//
+// Desc: Rendering backend which shadows the device state, and passes only
+//       the state changes which alter it through to another backend.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CSTATECACHEBACKEND_H_
+#define _CSTATECACHEBACKEND_H_
+
+//-----------------------------------------------------------------------------
+// CStateCacheBackend Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CRenderBackend.h"
+
+//-----------------------------------------------------------------------------
+// Name : STATE_CACHE_STATS (Struct)
+// Desc : State changes passed through to the target, and those filtered out
+//        because they set the value already in place.
+//-----------------------------------------------------------------------------
+struct STATE_CACHE_STATS
+{
+    ULONG           StatesIssued;           // Render states passed through
+    ULONG           StatesFiltered;         // Render states dropped
+    ULONG           TransformsIssued;       // Transforms passed through
+    ULONG           TransformsFiltered;     // Transforms dropped
+    ULONG           FVFsIssued;             // Vertex formats passed through
+    ULONG           FVFsFiltered;           // Vertex formats dropped
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CStateCacheBackend (Class)
+// Desc : Sits in front of another backend, remembering the last value of each
+//        render state, transform and the vertex format that was sent to it.
+//        Calls which would set the value already in place are dropped, and
+//        everything else is passed straight through.
+// Note : A reset device loses its state, so the cache is emptied whenever
+//        Restore recovers the device or Resize is called. The vertex format is also forgotten
+//        around instancing, as the instancing renderer replaces it directly.
+//-----------------------------------------------------------------------------
+class CStateCacheBackend : public IRenderBackend
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CStateCacheBackend( IRenderBackend * pTarget = NULL );
+	virtual ~CStateCacheBackend();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    void            SetTarget       ( IRenderBackend * pTarget );
+    IRenderBackend* GetTarget       ( ) const { return m_pTarget; }
+    void            Invalidate      ( );
+
+    const STATE_CACHE_STATS & GetFrameCacheStats( ) const { return m_FrameCache; }
+    const STATE_CACHE_STATS & GetTotalCacheStats( ) const { return m_TotalCache; }
+
+    // IRenderBackend
+    virtual void    Clear           ( ULONG Flags, D3DCOLOR Color, float fZ ) { m_pTarget->Clear( Flags, Color, fZ ); }
+    virtual void    BeginScene      ( ) { m_pTarget->BeginScene(); }
+    virtual void    EndScene        ( ) { m_pTarget->EndScene(); }
+    virtual bool    Present         ( );
+    virtual bool    IsLost          ( ) const { return m_pTarget->IsLost(); }
+    virtual bool    Restore         ( );
+    virtual bool    Resize          ( ULONG Width, ULONG Height );
+    virtual void    SetRenderState  ( D3DRENDERSTATETYPE State, ULONG Value );
+    virtual void    SetTransform    ( D3DTRANSFORMSTATETYPE State, const D3DXMATRIX & mtx );
+    virtual void    SetFVF          ( ULONG FVF );
+    virtual void    DrawPrimitiveUP ( D3DPRIMITIVETYPE Type, ULONG PrimitiveCount, const void * pVertices, ULONG Stride )
+                                    { m_pTarget->DrawPrimitiveUP( Type, PrimitiveCount, pVertices, Stride ); }
+    virtual void    DrawIndexedPrimitiveUP( D3DPRIMITIVETYPE Type, ULONG VertexCount, ULONG PrimitiveCount, const void * pIndices,
+                                            D3DFORMAT IndexFormat, const void * pVertices, ULONG Stride )
+                                    { m_pTarget->DrawIndexedPrimitiveUP( Type, VertexCount, PrimitiveCount, pIndices, IndexFormat, pVertices, Stride ); }
+    virtual void *  LockVertices    ( ULONG VertexCount, ULONG Stride, ULONG * pStartVertex ) { return m_pTarget->LockVertices( VertexCount, Stride, pStartVertex ); }
+    virtual void    UnlockVertices  ( ) { m_pTarget->UnlockVertices(); }
+    virtual void    DrawPrimitive   ( D3DPRIMITIVETYPE Type, ULONG StartVertex, ULONG PrimitiveCount )
+                                    { m_pTarget->DrawPrimitive( Type, StartVertex, PrimitiveCount ); }
+    virtual bool    SupportsInstancing( ) const { return m_pTarget->SupportsInstancing(); }
+    virtual IInstanceRenderer * BeginInstancing( const D3DXMATRIX & mtxViewProj );
+    virtual void    EndInstancing   ( );
+    virtual const RENDER_STATS & GetStats( ) const { return m_pTarget->GetStats(); }
+    virtual const RING_STATS & GetStreamStats( ) const { return m_pTarget->GetStreamStats(); }
+    virtual void    ResetStats      ( );
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Constants for This Class
+	//-------------------------------------------------------------------------
+    enum { MAX_RENDER_STATES = 256, MAX_TRANSFORMS = 512 };
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    IRenderBackend    * m_pTarget;          // Backend the calls are passed through to
+    ULONG               m_RenderStates[ MAX_RENDER_STATES ];
+    bool                m_StateSet[ MAX_RENDER_STATES ];
+    D3DXMATRIX          m_Transforms[ MAX_TRANSFORMS ];
+    bool                m_TransformSet[ MAX_TRANSFORMS ];
+    ULONG               m_FVF;              // Current vertex format
+    bool                m_bFVFSet;          // Is m_FVF known ?
+    STATE_CACHE_STATS   m_CurrentCache;     // Calls made during the frame being drawn
+    STATE_CACHE_STATS   m_FrameCache;       // Calls made during the most recently presented frame
+    STATE_CACHE_STATS   m_TotalCache;       // Calls made since the last reset
+};
+
+#endif // _CSTATECACHEBACKEND_H_
@@ -0,0 +1,207 @@
+//-----------------------------------------------------------------------------
+// File: CTelemetry.cpp
+//
+// Desc: Per frame telemetry, published through a ring in a named file
+//       mapping so that other processes can watch a running game.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CTelemetry Specific Includes
+//-----------------------------------------------------------------------------
+#include "CTelemetry.h"
+
+//-----------------------------------------------------------------------------
+// Name : CTelemetry () (Constructor)
+// Desc : CTelemetry Class Constructor
+//-----------------------------------------------------------------------------
+CTelemetry::CTelemetry()
+{
+	// Reset / Clear all required values
+    m_pHeader     = NULL;
+    m_pRecords    = NULL;
+    m_nCapacity   = 0;
+    m_nSize       = 0;
+    m_bWriter     = false;
+    m_nWriteCount = 0;
+    m_nLost       = 0;
+    m_hMapping    = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CTelemetry () (Destructor)
+// Desc : CTelemetry Class Destructor
+//-----------------------------------------------------------------------------
+CTelemetry::~CTelemetry()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Map () (Private)
+// Desc : Creates (writer) or opens (reader) the named file mapping, and
+//        maps it. Readers map the whole of it, whatever Size is given.
+//-----------------------------------------------------------------------------
+bool CTelemetry::Map( LPCTSTR strName, ULONG Size, bool bWrite )
+{
+    MEMORY_BASIC_INFORMATION Info;
+
+    if ( bWrite )
+        m_hMapping = CreateFileMapping( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, Size, strName );
+    else
+        m_hMapping = OpenFileMapping( FILE_MAP_READ, FALSE, strName );
+    if ( !m_hMapping ) return false;
+
+    if (!( m_pHeader = (TELEMETRY_HEADER*)MapViewOfFile( m_hMapping, bWrite ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0 ) )) return false;
+    if ( !VirtualQuery( m_pHeader, &Info, sizeof(Info) ) ) return false;
+    m_nSize = (ULONG)Info.RegionSize;
+
+    // Success!
+    return m_nSize >= sizeof(TELEMETRY_HEADER);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Creates the ring for the game to write frames to.
+// Note : An existing ring of the same name (left open by a reader, say) is
+//        taken over and emptied.
+//-----------------------------------------------------------------------------
+bool CTelemetry::Create( LPCTSTR strName, ULONG Capacity )
+{
+    ULONG Size;
+
+    Release();
+
+    // Validate (capacity must be a power of two)
+    if ( !strName || Capacity == 0 || (Capacity & (Capacity - 1)) ) return false;
+
+    Size = sizeof(TELEMETRY_HEADER) + Capacity * sizeof(TELEMETRY_RECORD);
+    m_bWriter = true;
+    if ( !Map( strName, Size, true ) || m_nSize < Size ) { Release(); return false; }
+
+    // Hide the ring from readers until it is consistent
+    m_pHeader->Magic = 0;
+    MemoryBarrier();
+    m_pHeader->Version    = TELEMETRY_VERSION;
+    m_pHeader->RecordSize = sizeof(TELEMETRY_RECORD);
+    m_pHeader->Capacity   = Capacity;
+    m_pHeader->ProcessId  = GetCurrentProcessId();
+    m_pHeader->WriteCount = 0;
+    ZeroMemory( m_pHeader->Reserved, sizeof(m_pHeader->Reserved) );
+    MemoryBarrier();
+    m_pHeader->Magic = TELEMETRY_MAGIC;
+
+    m_pRecords    = (TELEMETRY_RECORD*)(m_pHeader + 1);
+    m_nCapacity   = Capacity;
+    m_nWriteCount = 0;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Open ()
+// Desc : Opens a ring created by a running game, to read from. Reading
+//        starts with the oldest record still held.
+//-----------------------------------------------------------------------------
+bool CTelemetry::Open( LPCTSTR strName )
+{
+    ULONG WriteCount;
+
+    Release();
+
+    // Validate
+    if ( !strName ) return false;
+    if ( !Map( strName, 0, false ) ) { Release(); return false; }
+
+    // Is this a ring we understand, and is the mapping large enough to hold it?
+    if ( m_pHeader->Magic != TELEMETRY_MAGIC || m_pHeader->Version != TELEMETRY_VERSION ||
+         m_pHeader->RecordSize != sizeof(TELEMETRY_RECORD) || m_pHeader->Capacity == 0 ||
+         (m_pHeader->Capacity & (m_pHeader->Capacity - 1)) ||
+         m_nSize < sizeof(TELEMETRY_HEADER) + m_pHeader->Capacity * sizeof(TELEMETRY_RECORD) ) { Release(); return false; }
+
+    m_pRecords  = (TELEMETRY_RECORD*)(m_pHeader + 1);
+    m_nCapacity = m_pHeader->Capacity;
+    m_nLost     = 0;
+
+    WriteCount    = (ULONG)m_pHeader->WriteCount;
+    m_nWriteCount = ( WriteCount > m_nCapacity ) ? WriteCount - m_nCapacity : 0;
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Unmaps the ring. The name goes once the last process using it
+//        has closed it.
+//-----------------------------------------------------------------------------
+void CTelemetry::Release( )
+{
+    if ( m_pHeader ) UnmapViewOfFile( m_pHeader );
+    if ( m_hMapping ) CloseHandle( m_hMapping );
+    m_hMapping = NULL;
+
+    m_pHeader     = NULL;
+    m_pRecords    = NULL;
+    m_nCapacity   = 0;
+    m_nSize       = 0;
+    m_bWriter     = false;
+    m_nWriteCount = 0;
+    m_nLost       = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Publish ()
+// Desc : Makes the record filled in since BeginRecord visible to readers.
+//-----------------------------------------------------------------------------
+void CTelemetry::Publish( )
+{
+    // The interlocked exchange orders the record's writes before the count
+    InterlockedExchange( &m_pHeader->WriteCount, (LONG)++m_nWriteCount );
+}
+
+//-----------------------------------------------------------------------------
+// Name : Read ()
+// Desc : Copies up to MaxRecords of the records published since the last
+//        call, oldest first, and returns how many were copied.
+//-----------------------------------------------------------------------------
+ULONG CTelemetry::Read( TELEMETRY_RECORD * pRecords, ULONG MaxRecords )
+{
+    ULONG WriteCount, Available, Count, Stale, i;
+
+    // Validate
+    if ( !m_pHeader || m_bWriter || !pRecords ) return 0;
+
+    // Skip anything already overwritten
+    WriteCount = (ULONG)m_pHeader->WriteCount;
+    MemoryBarrier();
+    Available  = WriteCount - m_nWriteCount;
+    if ( Available > m_nCapacity )
+    {
+        m_nLost       += Available - m_nCapacity;
+        m_nWriteCount  = WriteCount - m_nCapacity;
+        Available      = m_nCapacity;
+
+    } // End if behind
+
+    // Copy what is there
+    Count = ( Available < MaxRecords ) ? Available : MaxRecords;
+    for ( i = 0; i < Count; i++ ) pRecords[i] = m_pRecords[ (m_nWriteCount + i) & (m_nCapacity - 1) ];
+
+    // Drop the copies whose slots the writer may have reached meanwhile
+    MemoryBarrier();
+    WriteCount = (ULONG)m_pHeader->WriteCount;
+    Stale = 0;
+    while ( Stale < Count && WriteCount - (m_nWriteCount + Stale) >= m_nCapacity ) Stale++;
+    if ( Stale > 0 )
+    {
+        for ( i = Stale; i < Count; i++ ) pRecords[ i - Stale ] = pRecords[i];
+        m_nLost += Stale;
+
+    } // End if overwritten
+
+    m_nWriteCount += Count;
+    return Count - Stale;
+}
@@ -0,0 +1,127 @@
+//-----------------------------------------------------------------------------
+// File: CTelemetry.h
+//
+// Desc: Per frame telemetry, published through a ring in a named file
+//       mapping so that other processes can watch a running game.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CTELEMETRY_H_
+#define _CTELEMETRY_H_
+
+//-----------------------------------------------------------------------------
+// CTelemetry Specific Includes
+//-----------------------------------------------------------------------------
+// Needs only windows.h (not Direct3D), so the reader tool can share it.
+#include <windows.h>
+#include <tchar.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG TELEMETRY_MAGIC         = 0x594D4C54;   // 'TLMY'
+const ULONG TELEMETRY_VERSION       = 1;
+const ULONG TELEMETRY_RECORDS       = 4096;         // Default ring size (power of two, about a minute at 60fps)
+
+#define TELEMETRY_DEFAULT_NAME      _T("Local\\TestGitHub2Telemetry")
+
+//-----------------------------------------------------------------------------
+// Name : TELEMETRY_RECORD (Struct)
+// Desc : One frame's timings (milliseconds) and counts.
+// Note : When pipelined, the render time, latency & draw count are those of
+//        the most recent frame the render thread completed.
+//-----------------------------------------------------------------------------
+struct TELEMETRY_RECORD
+{
+    ULONG           Frame;                  // Frame number
+    float           fFrameTime;             // Unsmoothed frame time, from CTimer
+    float           fSimTime;               // Simulating the frame
+    float           fCullTime;              // ... of which culling
+    float           fRenderTime;            // Drawing & presenting a frame
+    float           fLatency;               // From simulation start to present
+    ULONG           DrawCalls;
+    ULONG           Objects;                // Objects drawn
+    ULONG           Allocations;            // Heap allocations made during the frame
+};
+
+//-----------------------------------------------------------------------------
+// Name : TELEMETRY_HEADER (Struct)
+// Desc : Start of the file mapping, followed by the ring of records.
+//-----------------------------------------------------------------------------
+struct TELEMETRY_HEADER
+{
+    ULONG           Magic;                  // TELEMETRY_MAGIC once initialised
+    ULONG           Version;                // TELEMETRY_VERSION
+    ULONG           RecordSize;             // sizeof(TELEMETRY_RECORD)
+    ULONG           Capacity;               // Records in the ring
+    ULONG           ProcessId;              // Process writing the records
+    volatile LONG   WriteCount;             // Records published (wraps, compare by difference)
+    ULONG           Reserved[10];           // Pads the header to 64 bytes
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CTelemetry (Class)
+// Desc : A ring of frame records in a named file mapping (backed by the
+//        paging file). The game creates it and is the only writer; any
+//        number of readers may open it.
+// Note : The writer never waits for readers. Record n is stored in slot
+//        n % Capacity before WriteCount becomes n + 1. A reader copies a
+//        record, then rereads WriteCount, and discards the copy if the
+//        writer may have started on the slot meanwhile (WriteCount has
+//        reached n + Capacity). Readers which fall a whole ring behind skip
+//        ahead, counting the records they lost.
+//-----------------------------------------------------------------------------
+class CTelemetry
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CTelemetry();
+	virtual ~CTelemetry();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    void            Release         ( );
+    bool            IsOpen          ( ) const { return m_pHeader != NULL; }
+
+    // Writer (game) side
+    bool            Create          ( LPCTSTR strName, ULONG Capacity = TELEMETRY_RECORDS );
+    TELEMETRY_RECORD * BeginRecord  ( ) { return &m_pRecords[ m_nWriteCount & (m_nCapacity - 1) ]; }
+    void            Publish         ( );
+
+    // Reader side
+    bool            Open            ( LPCTSTR strName );
+    ULONG           Read            ( TELEMETRY_RECORD * pRecords, ULONG MaxRecords );
+    ULONG           GetLostCount    ( ) const { return m_nLost; }
+    ULONG           GetWriterProcess( ) const { return m_pHeader ? m_pHeader->ProcessId : 0; }
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Map             ( LPCTSTR strName, ULONG Size, bool bWrite );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    TELEMETRY_HEADER  * m_pHeader;          // Start of the mapping
+    TELEMETRY_RECORD  * m_pRecords;         // The ring, following the header
+    ULONG               m_nCapacity;
+    ULONG               m_nSize;            // Bytes mapped
+    bool                m_bWriter;          // Did we create the ring ?
+    ULONG               m_nWriteCount;      // Writer: records published. Reader: next record to read
+    ULONG               m_nLost;            // Reader: records overwritten before they were read
+    HANDLE              m_hMapping;
+
+    // Telemetry rings own their mapping, copying is not supported.
+    CTelemetry( const CTelemetry & );
+    CTelemetry & operator=( const CTelemetry & );
+};
+
+#endif // _CTELEMETRY_H_
@@ -0,0 +1,183 @@
+//-----------------------------------------------------------------------------
+// File: CThreadPool.cpp
+//
+// Desc: Simple pool of worker threads used to spread data parallel work,
+//       such as mesh importing, across every available processor.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CThreadPool Specific Includes
+//-----------------------------------------------------------------------------
+#include "CThreadPool.h"
+#include "CProfiler.h"
+#include <process.h>
+
+//-----------------------------------------------------------------------------
+// Name : CThreadPool () (Constructor)
+// Desc : CThreadPool Class Constructor
+//-----------------------------------------------------------------------------
+CThreadPool::CThreadPool()
+{
+	// Reset / Clear all required values
+    ZeroMemory( m_hThreads, sizeof(m_hThreads) );
+    m_nWorkerCount  = 0;
+    m_hWork         = NULL;
+    m_hDone         = NULL;
+    m_bQuit         = false;
+    m_pTask         = NULL;
+    m_pContext      = NULL;
+    m_nCount        = 0;
+    m_nNext         = 0;
+    m_nPending      = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CThreadPool () (Destructor)
+// Desc : CThreadPool Class Destructor
+//-----------------------------------------------------------------------------
+CThreadPool::~CThreadPool()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Starts the worker threads. ThreadCount includes the calling thread,
+//        and a value of 0 selects one thread per processor.
+//-----------------------------------------------------------------------------
+bool CThreadPool::Create( ULONG ThreadCount )
+{
+    // Release any previous threads
+    Release();
+
+    // Select the number of worker threads
+    if ( ThreadCount == 0 ) ThreadCount = GetProcessorCount();
+    if ( ThreadCount > THREADPOOL_MAX_THREADS ) ThreadCount = THREADPOOL_MAX_THREADS;
+    if ( ThreadCount <= 1 ) return true;
+
+    // Create the synchronisation objects
+    if (!( m_hWork = CreateSemaphore( NULL, 0, THREADPOOL_MAX_THREADS, NULL ) )) { Release(); return false; }
+    if (!( m_hDone = CreateEvent( NULL, FALSE, FALSE, NULL ) )) { Release(); return false; }
+
+    // Start the workers
+    for ( m_nWorkerCount = 0; m_nWorkerCount < ThreadCount - 1; m_nWorkerCount++ )
+    {
+        HANDLE hThread = (HANDLE)_beginthreadex( NULL, 0, WorkerThread, this, 0, NULL );
+        if ( !hThread ) { Release(); return false; }
+        m_hThreads[ m_nWorkerCount ] = hThread;
+
+    } // Next Thread
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Stops and releases all worker threads.
+//-----------------------------------------------------------------------------
+void CThreadPool::Release( )
+{
+    // Wake every worker and wait for them to exit
+    if ( m_nWorkerCount > 0 )
+    {
+        m_bQuit = true;
+        ReleaseSemaphore( m_hWork, m_nWorkerCount, NULL );
+        WaitForMultipleObjects( m_nWorkerCount, m_hThreads, TRUE, INFINITE );
+
+        for ( ULONG i = 0; i < m_nWorkerCount; i++ ) CloseHandle( m_hThreads[i] );
+
+    } // End if workers
+
+    // Release synchronisation objects
+    if ( m_hWork ) CloseHandle( m_hWork );
+    if ( m_hDone ) CloseHandle( m_hDone );
+
+    // Clear variables
+    ZeroMemory( m_hThreads, sizeof(m_hThreads) );
+    m_nWorkerCount  = 0;
+    m_hWork         = NULL;
+    m_hDone         = NULL;
+    m_bQuit         = false;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Dispatch ()
+// Desc : Calls pTask once for every index in [0, Count), spreading the calls
+//        over every thread in the pool, and waits for them all to complete.
+// Note : Every worker checks in and out of each dispatch, so no worker can
+//        still be touching the task once this function returns.
+//-----------------------------------------------------------------------------
+void CThreadPool::Dispatch( THREAD_TASK pTask, void * pContext, ULONG Count )
+{
+    // Validate
+    if ( !pTask || Count == 0 ) return;
+
+    // Describe the work
+    m_pTask     = pTask;
+    m_pContext  = pContext;
+    m_nCount    = Count;
+    m_nPending  = m_nWorkerCount;
+    InterlockedExchange( &m_nNext, 0 );
+
+    // Wake the workers, and help out ourselves
+    if ( m_nWorkerCount > 0 && Count > 1 ) ReleaseSemaphore( m_hWork, m_nWorkerCount, NULL );
+    RunTasks();
+
+    // Wait for every worker to finish
+    if ( m_nWorkerCount > 0 && Count > 1 ) WaitForSingleObject( m_hDone, INFINITE );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetProcessorCount () (Static)
+// Desc : Retrieves the number of logical processors in the system.
+//-----------------------------------------------------------------------------
+ULONG CThreadPool::GetProcessorCount( )
+{
+    SYSTEM_INFO Info;
+    GetSystemInfo( &Info );
+    return (Info.dwNumberOfProcessors > 0) ? Info.dwNumberOfProcessors : 1;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunTasks () (Private)
+// Desc : Processes task indices until none remain.
+//-----------------------------------------------------------------------------
+void CThreadPool::RunTasks( )
+{
+    PROFILE_ZONE( "Tasks" );
+
+    for ( ; ; )
+    {
+        ULONG Index = (ULONG)InterlockedIncrement( &m_nNext ) - 1;
+        if ( Index >= m_nCount ) break;
+        m_pTask( m_pContext, Index );
+
+    } // Next Task
+}
+
+//-----------------------------------------------------------------------------
+// Name : WorkerThread () (Private, Static)
+// Desc : Worker thread entry point.
+//-----------------------------------------------------------------------------
+unsigned __stdcall CThreadPool::WorkerThread( void * pParam )
+{
+    CThreadPool * pPool = (CThreadPool*)pParam;
+    PROFILE_THREAD( "Worker" );
+
+    for ( ; ; )
+    {
+        // Wait for work
+        WaitForSingleObject( pPool->m_hWork, INFINITE );
+        if ( pPool->m_bQuit ) break;
+
+        // Process tasks, and check out of this dispatch
+        pPool->RunTasks();
+        if ( InterlockedDecrement( &pPool->m_nPending ) == 0 ) SetEvent( pPool->m_hDone );
+
+    } // Next Dispatch
+
+    return 0;
+}
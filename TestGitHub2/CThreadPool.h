@@ -0,0 +1,89 @@
+//-----------------------------------------------------------------------------
+// File: CThreadPool.h
+//
+// Desc: Simple pool of worker threads used to spread data parallel work,
+//       such as mesh importing, across every available processor.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CTHREADPOOL_H_
+#define _CTHREADPOOL_H_
+
+//-----------------------------------------------------------------------------
+// CThreadPool Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG THREADPOOL_MAX_THREADS = 64;        // Largest number of threads supported
+
+// Task callback, called once for each index in [0, Count) passed to Dispatch
+typedef void (*THREAD_TASK)( void * pContext, ULONG Index );
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CThreadPool (Class)
+// Desc : Fixed set of worker threads. Dispatch hands out task indices to the
+//        workers and the calling thread alike, and returns once every index
+//        has been processed.
+// Note : Dispatch must only be called from one thread at a time.
+//-----------------------------------------------------------------------------
+class CThreadPool
+{
+public:
+    //-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	         CThreadPool();
+	virtual ~CThreadPool();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+    bool            Create          ( ULONG ThreadCount = 0 );
+    void            Release         ( );
+    void            Dispatch        ( THREAD_TASK pTask, void * pContext, ULONG Count );
+    ULONG           GetThreadCount  ( ) const { return m_nWorkerCount + 1; }
+
+	//-------------------------------------------------------------------------
+	// Public Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static ULONG    GetProcessorCount( );
+
+private:
+    //-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+    void            RunTasks        ( );
+
+    //-------------------------------------------------------------------------
+	// Private Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static unsigned __stdcall WorkerThread( void * pParam );
+
+    //-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+    HANDLE          m_hThreads[ THREADPOOL_MAX_THREADS ];  // Worker thread handles
+    ULONG           m_nWorkerCount;     // Number of worker threads (excludes caller)
+    HANDLE          m_hWork;            // Semaphore released once per worker per dispatch
+    HANDLE          m_hDone;            // Signalled when the last worker checks out
+    volatile bool   m_bQuit;            // Workers should exit
+
+    THREAD_TASK     m_pTask;            // Task currently being dispatched
+    void           *m_pContext;         // Context for the current task
+    ULONG           m_nCount;           // Number of task indices
+    volatile LONG   m_nNext;            // Next task index to hand out
+    volatile LONG   m_nPending;         // Workers yet to finish the current dispatch
+
+    // Thread pools own threads, copying is not supported.
+    CThreadPool( const CThreadPool & );
+    CThreadPool & operator=( const CThreadPool & );
+};
+
+#endif // _CTHREADPOOL_H_
@@ -12,7 +12,14 @@
 // CTimer Specific Includes
 //-----------------------------------------------------------------------------
 #include "CTimer.h"
+#include "CProfiler.h"
+#include <math.h>
 #include <mmsystem.h>
+#include <chrono>
+
+#if !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
 
 //-----------------------------------------------------------------------------
 // Name : CTimer () (Constructor)
@@ -23,24 +30,34 @@ CTimer::CTimer()
 	// Query performance hardware and setup time scaling values
 	if (QueryPerformanceFrequency((LARGE_INTEGER *)&m_PerfFreq)) 
     { 
-		m_PerfHardware		= TRUE;
-		QueryPerformanceCounter((LARGE_INTEGER *) &m_LastTime); 
+		m_Clock				= TIMERCLOCK_PERFCOUNTER;
 		m_TimeScale			= 1.0f / m_PerfFreq;
 	} 
     else 
     { 
 		// no performance counter, read in using timeGetTime 
-		m_PerfHardware		= FALSE;
-		m_LastTime			= timeGetTime(); 
+		m_Clock				= TIMERCLOCK_MULTIMEDIA;
+		m_PerfFreq			= 1000;
 		m_TimeScale			= 0.001f;
 	
     } // End If No Hardware
+    m_LastTime          = ReadClock();
 
 	// Clear any needed values
-    m_SampleCount       = 0;
+    m_pFrameTime        = NULL;
+    m_SampleWindow      = 0;
+    m_TimeElapsed       = 0.0f;
+    m_FrameTime         = 0.0f;
 	m_FrameRate			= 0;
 	m_FPSFrameCount		= 0;
 	m_FPSTimeElapsed	= 0.0f;
+    m_Pacing            = TIMERPACE_SPIN;
+    m_NextDeadline      = 0;
+    m_fSleepMargin      = TIMER_SLEEP_MARGIN;
+    m_hSleepTimer       = NULL;
+    m_bTimerPeriod      = false;
+    SetSampleWindow( DEFAULT_SAMPLE_COUNT );
+    ResetPacingStats();
 }
 
 //-----------------------------------------------------------------------------
@@ -49,33 +66,131 @@ CTimer::CTimer()
 //-----------------------------------------------------------------------------
 CTimer::~CTimer()
 {
+    if ( m_pFrameTime ) delete []m_pFrameTime;
+    m_pFrameTime = NULL;
+
+    // Release the sleep timer & restore the system timer resolution
+    if ( m_hSleepTimer ) CloseHandle( m_hSleepTimer );
+    if ( m_bTimerPeriod ) timeEndPeriod( 1 );
+    m_hSleepTimer  = NULL;
+    m_bTimerPeriod = false;
 }
 
 //-----------------------------------------------------------------------------
-// Name : Tick () 
-// Desc : Function which signals that frame has advanced
-// Note : You can specify a number of frames per second to lock the frame rate
-//        to. This will simply soak up the remaining time to hit that target.
+// Name : ReadClock () (Private)
+// Desc : Reads the current time from the clock selected, in clock ticks.
 //-----------------------------------------------------------------------------
-void CTimer::Tick( float fLockFPS )
+__int64 CTimer::ReadClock() const
 {
-    float fTimeElapsed; 
+    __int64 Time;
 
     // Is performance hardware available?
-	if ( m_PerfHardware ) 
+    if ( m_Clock == TIMERCLOCK_PERFCOUNTER )
     {
         // Query high-resolution performance hardware
-		QueryPerformanceCounter((LARGE_INTEGER *)&m_CurrentTime);
-	} 
-    else 
+        QueryPerformanceCounter((LARGE_INTEGER *)&Time);
+        return Time;
+
+    } // End if performance counter
+
+    // Portable monotonic clock, read in nanoseconds
+    if ( m_Clock == TIMERCLOCK_STEADY )
     {
-        // Fall back to less accurate timer
-		m_CurrentTime = timeGetTime();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
 
-	} // End If no hardware available
+    } // End if steady clock
 
-	// Calculate elapsed time in seconds
-	fTimeElapsed = (m_CurrentTime - m_LastTime) * m_TimeScale;
+    // Fall back to less accurate timer
+    return timeGetTime();
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetSampleWindow ()
+// Desc : Sets the number of frames averaged for the elapsed time, and
+//        measured by GetFrameStats. Any samples held are discarded.
+//-----------------------------------------------------------------------------
+bool CTimer::SetSampleWindow( ULONG Count )
+{
+    float * pFrameTime;
+
+    // Validate
+    if ( Count == 0 ) return false;
+
+    if (!( pFrameTime = new float[ Count ] )) return false;
+    if ( m_pFrameTime ) delete []m_pFrameTime;
+    m_pFrameTime   = pFrameTime;
+    m_SampleWindow = Count;
+    ResetSamples();
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetClock ()
+// Desc : Switches the timer to the clock specified. Any samples held are
+//        discarded, and the next frame is timed from now.
+//-----------------------------------------------------------------------------
+bool CTimer::SetClock( TIMER_CLOCK Clock )
+{
+    __int64 Frequency = 0;
+
+    switch ( Clock )
+    {
+        case TIMERCLOCK_PERFCOUNTER:
+            if ( !QueryPerformanceFrequency( (LARGE_INTEGER*)&Frequency ) ) return false;
+            break;
+
+        case TIMERCLOCK_MULTIMEDIA:
+            Frequency = 1000;
+            break;
+
+        case TIMERCLOCK_STEADY:
+            Frequency = 1000000000;
+            break;
+
+        default:
+            return false;
+
+    } // End Switch
+
+    m_Clock        = Clock;
+    m_PerfFreq     = Frequency;
+    m_TimeScale    = 1.0f / (float)Frequency;
+    m_LastTime     = ReadClock();
+    m_NextDeadline = 0;
+    ResetSamples();
+
+    // Success!
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetSamples () (Private)
+// Desc : Empties the sample ring & histogram.
+//-----------------------------------------------------------------------------
+void CTimer::ResetSamples()
+{
+    m_SampleCount = 0;
+    m_NextSample  = 0;
+    m_SampleSum   = 0.0;
+    ZeroMemory( m_Histogram, sizeof(m_Histogram) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : Tick () 
+// Desc : Function which signals that frame has advanced
+// Note : You can specify a number of frames per second to lock the frame rate
+//        to. The remaining time is slept or spun away, depending on the
+//        pacing selected.
+//-----------------------------------------------------------------------------
+void CTimer::Tick( float fLockFPS )
+{
+    float fTimeElapsed; 
+    PROFILE_ZONE( "Tick" );
+
+    // Read the current time
+	m_CurrentTime = ReadClock();
 
     // Smoothly ramp up frame rate to prevent jittering
     //if ( fLockFPS == 0.0f ) fLockFPS = (1.0f / GetTimeElapsed()) + 20.0f;
@@ -83,26 +198,22 @@ void CTimer::Tick( float fLockFPS )
     // Should we lock the frame rate ?
     if ( fLockFPS > 0.0f )
     {
-        while ( fTimeElapsed < (1.0f / fLockFPS))
-        {
-            // Is performance hardware available?
-	        if ( m_PerfHardware ) 
-            {
-                // Query high-resolution performance hardware
-		        QueryPerformanceCounter((LARGE_INTEGER*)&m_CurrentTime);
-	        } 
-            else 
-            {
-                // Fall back to less accurate timer
-		        m_CurrentTime = timeGetTime();
-
-	        } // End If no hardware available
-
-	        // Calculate elapsed time in seconds
-	        fTimeElapsed = (m_CurrentTime - m_LastTime) * m_TimeScale;
-
-        } // End While
+        __int64 Period = (__int64)((double)m_PerfFreq / fLockFPS);
+        if ( Period < 1 ) Period = 1;
+
+        if ( m_Pacing == TIMERPACE_SLEEP ) SleepForFrame( Period ); else SpinForFrame( Period );
+
     } // End If
+    else
+    {
+        // Start the deadlines afresh if the frame rate is locked again
+        m_NextDeadline = 0;
+
+    } // End if unlocked
+
+	// Calculate elapsed time in seconds
+	fTimeElapsed = (m_CurrentTime - m_LastTime) * m_TimeScale;
+    m_FrameTime  = fTimeElapsed;
 
 	// Save current frame time
 	m_LastTime = m_CurrentTime;
@@ -110,10 +221,29 @@ void CTimer::Tick( float fLockFPS )
     // Filter out values wildly different from current average
     if ( fabsf(fTimeElapsed - m_TimeElapsed) < 1.0f  )
     {
-        // Wrap FIFO frame time buffer.
-        memmove( &m_FrameTime[1], m_FrameTime, (MAX_SAMPLE_COUNT - 1) * sizeof(float) );
-        m_FrameTime[ 0 ] = fTimeElapsed;
-        if ( m_SampleCount < MAX_SAMPLE_COUNT ) m_SampleCount++;
+        // Retire the oldest sample once the ring is full
+        if ( m_SampleCount == m_SampleWindow )
+        {
+            float fOldest = m_pFrameTime[ m_NextSample ];
+            m_SampleSum -= fOldest;
+            m_Histogram[ GetBin( fOldest * 1000.0f ) ]--;
+
+        } // End if full
+        else m_SampleCount++;
+
+        // Store the new one in its place
+        m_pFrameTime[ m_NextSample ] = fTimeElapsed;
+        m_SampleSum += fTimeElapsed;
+        m_Histogram[ GetBin( fTimeElapsed * 1000.0f ) ]++;
+
+        // Resum once per lap, so that rounding can't build up in the running sum
+        if ( ++m_NextSample == m_SampleWindow )
+        {
+            m_NextSample = 0;
+            m_SampleSum  = 0.0;
+            for ( ULONG i = 0; i < m_SampleCount; i++ ) m_SampleSum += m_pFrameTime[ i ];
+
+        } // End if wrapped
 
     } // End if
     
@@ -128,11 +258,191 @@ void CTimer::Tick( float fLockFPS )
 		m_FPSTimeElapsed	= 0.0f;
 	} // End If Second Elapsed
 
-    // Count up the new average elapsed time
-    m_TimeElapsed = 0.0f;
-    for ( ULONG i = 0; i < m_SampleCount; i++ ) m_TimeElapsed += m_FrameTime[ i ];
-    if ( m_SampleCount > 0 ) m_TimeElapsed /= m_SampleCount;
+    // Take the new average elapsed time from the running sum
+    m_TimeElapsed = ( m_SampleCount > 0 ) ? (float)(m_SampleSum / m_SampleCount) : 0.0f;
+
+}
+
+//-----------------------------------------------------------------------------
+// Name : SpinForFrame () (Private)
+// Desc : Spins until a whole frame has passed since the previous one.
+// Note : The original frame lock, kept for comparison. Any time lost reading
+//        the clock is added to every frame, and the core is never released.
+//-----------------------------------------------------------------------------
+void CTimer::SpinForFrame( __int64 Period )
+{
+    __int64 Start    = m_CurrentTime;
+    __int64 Deadline = m_LastTime + Period;
+    double  fTickMS  = 1000.0 / (double)m_PerfFreq;
+    float   fError;
+
+    while ( m_CurrentTime < Deadline )
+    {
+        // Read the current time
+        m_CurrentTime = ReadClock();
+
+    } // End While
 
+    // Record how late the frame began
+    fError = (float)((m_CurrentTime - Deadline) * fTickMS);
+    if ( Start > Deadline ) m_PaceStats.Missed++;
+    m_PaceHistogram[ GetBin( fError ) ]++;
+    m_PaceStats.Frames++;
+    m_PaceStats.fWaitTime += (m_CurrentTime - Start) * fTickMS;
+    m_PaceStats.fSpinTime += (m_CurrentTime - Start) * fTickMS;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SleepForFrame () (Private)
+// Desc : Sleeps until the sleep margin before the next deadline, then spins
+//        the rest of the way, and moves the deadline on by one frame.
+// Note : A frame more than a whole frame late starts the deadlines again
+//        from now, rather than running the next few frames back to back.
+//        Its lateness is still measured against the deadline it missed.
+//-----------------------------------------------------------------------------
+void CTimer::SleepForFrame( __int64 Period )
+{
+    __int64 Start   = m_CurrentTime;
+    __int64 Target, Woke, Margin, Due;
+    double  fTickMS = 1000.0 / (double)m_PerfFreq;
+    float   fError;
+
+    // Place the first deadline a frame after the previous one
+    if ( m_NextDeadline == 0 ) m_NextDeadline = m_LastTime + Period;
+    Due = m_NextDeadline;
+
+    // Already late ?
+    if ( m_CurrentTime > m_NextDeadline )
+    {
+        m_PaceStats.Missed++;
+        if ( m_CurrentTime - m_NextDeadline > Period ) m_NextDeadline = m_CurrentTime;
+
+    } // End if late
+
+    // Sleep until the margin before the deadline (again, if woken early)
+    for ( ;; )
+    {
+        Margin = (__int64)(m_fSleepMargin * 0.001 * (double)m_PerfFreq);
+        Target = m_NextDeadline - Margin;
+        if ( m_CurrentTime >= Target ) break;
+
+        SleepUntil( Target );
+        Woke = ReadClock();
+        CalibrateMargin( (float)((Woke - Target) * fTickMS) );
+        m_PaceStats.fSleepTime += (Woke - m_CurrentTime) * fTickMS;
+        m_CurrentTime = Woke;
+
+    } // Next Sleep
+
+    // Spin the remainder
+    Woke = m_CurrentTime;
+    while ( m_CurrentTime < m_NextDeadline ) m_CurrentTime = ReadClock();
+    m_PaceStats.fSpinTime += (m_CurrentTime - Woke) * fTickMS;
+
+    // Record how late the frame began
+    fError = (float)((m_CurrentTime - Due) * fTickMS);
+    m_PaceHistogram[ GetBin( fError ) ]++;
+    m_PaceStats.Frames++;
+    m_PaceStats.fWaitTime += (m_CurrentTime - Start) * fTickMS;
+
+    // The next frame is due one frame after this one was, however late it is
+    m_NextDeadline += Period;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SleepUntil () (Private)
+// Desc : Suspends the thread until roughly the time given, in clock ticks.
+// Note : Sleeps on a waitable timer, high resolution where the OS supports
+//        it, otherwise a standard one with the system timer raised to 1ms.
+//        The thread may wake a little early or, more often, late.
+//-----------------------------------------------------------------------------
+void CTimer::SleepUntil( __int64 Target )
+{
+    LARGE_INTEGER DueTime;
+    __int64       Remaining = Target - ReadClock();
+
+    if ( Remaining <= 0 ) return;
+
+    // Create the timer the first time we sleep
+    if ( !m_hSleepTimer && !m_bTimerPeriod )
+    {
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0600
+        m_hSleepTimer = CreateWaitableTimerEx( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+#endif
+        if ( !m_hSleepTimer )
+        {
+            m_hSleepTimer = CreateWaitableTimer( NULL, TRUE, NULL );
+
+            // Standard timers only fire on the system timer interrupt
+            m_bTimerPeriod = ( timeBeginPeriod( 1 ) == TIMERR_NOERROR );
+
+        } // End if no high resolution timer
+
+    } // End if first sleep
+
+    // Relative due time, in 100ns units
+    if ( m_hSleepTimer )
+    {
+        DueTime.QuadPart = -(LONGLONG)(Remaining * 10000000 / m_PerfFreq);
+        if ( DueTime.QuadPart < 0 && SetWaitableTimer( m_hSleepTimer, &DueTime, 0, NULL, NULL, FALSE ) )
+        {
+            WaitForSingleObject( m_hSleepTimer, INFINITE );
+            return;
+
+        } // End if timer set
+
+    } // End if timer
+
+    // No timer, sleep for whole milliseconds
+    Sleep( (DWORD)(Remaining * 1000 / m_PerfFreq) );
+}
+
+//-----------------------------------------------------------------------------
+// Name : CalibrateMargin () (Private)
+// Desc : Adjusts the sleep margin given how late (ms) a sleep woke.
+// Note : The margin jumps straight past any oversleep longer than it, so the
+//        next frame is unlikely to miss too, and eases back down towards
+//        the oversleeps seen once they shorten.
+//-----------------------------------------------------------------------------
+void CTimer::CalibrateMargin( float fOversleep )
+{
+    float fWanted = fOversleep * 1.25f;
+
+    if ( fWanted < TIMER_SLEEP_MARGIN_MIN ) fWanted = TIMER_SLEEP_MARGIN_MIN;
+    if ( fWanted > TIMER_SLEEP_MARGIN_MAX ) fWanted = TIMER_SLEEP_MARGIN_MAX;
+
+    if ( fWanted > m_fSleepMargin ) m_fSleepMargin = fWanted;
+    else m_fSleepMargin += (fWanted - m_fSleepMargin) * (1.0f / 64.0f);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPacingStats ()
+// Desc : Retrieves how closely locked frames have kept to their deadlines,
+//        and the time spent sleeping & spinning to do so.
+//-----------------------------------------------------------------------------
+void CTimer::GetPacingStats( PACING_STATS * pStats ) const
+{
+    // Validate
+    if ( !pStats ) return;
+
+    *pStats = m_PaceStats;
+    pStats->fMargin = m_fSleepMargin;
+    if ( m_PaceStats.Frames == 0 ) return;
+
+    pStats->fErrP50 = GetPercentile( m_PaceHistogram, m_PaceStats.Frames, 0.50f );
+    pStats->fErrP95 = GetPercentile( m_PaceHistogram, m_PaceStats.Frames, 0.95f );
+    pStats->fErrP99 = GetPercentile( m_PaceHistogram, m_PaceStats.Frames, 0.99f );
+    pStats->fErrMax = GetPercentile( m_PaceHistogram, m_PaceStats.Frames, 1.0f );
+}
+
+//-----------------------------------------------------------------------------
+// Name : ResetPacingStats ()
+// Desc : Clears the pacing statistics. The sleep margin is kept.
+//-----------------------------------------------------------------------------
+void CTimer::ResetPacingStats()
+{
+    ZeroMemory( &m_PaceStats, sizeof(PACING_STATS) );
+    ZeroMemory( m_PaceHistogram, sizeof(m_PaceHistogram) );
 }
 
 //-----------------------------------------------------------------------------
@@ -171,3 +481,88 @@ float CTimer::GetTimeElapsed() const
     return m_TimeElapsed;
 
 }
+
+//-----------------------------------------------------------------------------
+// Name : GetFrameStats ()
+// Desc : Retrieves the mean, range and percentiles of the frame times in the
+//        sample window (milliseconds).
+//-----------------------------------------------------------------------------
+void CTimer::GetFrameStats( FRAME_TIME_STATS * pStats ) const
+{
+    // Validate
+    if ( !pStats ) return;
+    ZeroMemory( pStats, sizeof(FRAME_TIME_STATS) );
+    if ( m_SampleCount == 0 ) return;
+
+    pStats->Samples = m_SampleCount;
+    pStats->fMean   = (float)(m_SampleSum * 1000.0 / m_SampleCount);
+    pStats->fMin    = GetPercentile( m_Histogram, m_SampleCount, 0.0f );
+    pStats->fMax    = GetPercentile( m_Histogram, m_SampleCount, 1.0f );
+    pStats->fP50    = GetPercentile( m_Histogram, m_SampleCount, 0.50f );
+    pStats->fP95    = GetPercentile( m_Histogram, m_SampleCount, 0.95f );
+    pStats->fP99    = GetPercentile( m_Histogram, m_SampleCount, 0.99f );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetClockName ()
+// Desc : Returns a description of the clock being read.
+//-----------------------------------------------------------------------------
+LPCTSTR CTimer::GetClockName() const
+{
+    switch ( m_Clock )
+    {
+        case TIMERCLOCK_PERFCOUNTER: return _T("QueryPerformanceCounter");
+        case TIMERCLOCK_MULTIMEDIA:  return _T("timeGetTime");
+        case TIMERCLOCK_STEADY:      return _T("std::chrono::steady_clock");
+
+    } // End Switch
+
+    return _T("Unknown");
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPercentile () (Private, Static)
+// Desc : Returns the time (ms) which the fraction specified of the samples
+//        counted in a histogram do not exceed, at the centre of its bin.
+//-----------------------------------------------------------------------------
+float CTimer::GetPercentile( const ULONG * pHistogram, ULONG Samples, float fFraction )
+{
+    ULONG Rank, Count = 0, Bin;
+
+    // Find the rank of the sample wanted, counting from 1
+    Rank = (ULONG)ceilf( fFraction * Samples );
+    if ( Rank < 1 ) Rank = 1;
+    if ( Rank > Samples ) Rank = Samples;
+
+    for ( Bin = 0; Bin < TIMER_HISTOGRAM_BINS - 1; Bin++ )
+    {
+        Count += pHistogram[ Bin ];
+        if ( Count >= Rank ) break;
+
+    } // Next Bin
+
+    return GetBinTime( Bin );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBin () (Private, Static)
+// Desc : Returns the histogram bin a frame time (ms) is counted in. Bins are
+//        spaced logarithmically, and the last also holds anything longer.
+//-----------------------------------------------------------------------------
+ULONG CTimer::GetBin( float fTime )
+{
+    float fBin;
+
+    if ( fTime <= TIMER_HISTOGRAM_MIN ) return 0;
+    fBin = logf( fTime / TIMER_HISTOGRAM_MIN ) * (TIMER_BINS_PER_OCTAVE / 0.693147181f);
+    return ( fBin >= (float)(TIMER_HISTOGRAM_BINS - 1) ) ? TIMER_HISTOGRAM_BINS - 1 : (ULONG)fBin;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBinTime () (Private, Static)
+// Desc : Returns the frame time (ms) at the geometric centre of a bin.
+//-----------------------------------------------------------------------------
+float CTimer::GetBinTime( ULONG Bin )
+{
+    return TIMER_HISTOGRAM_MIN * expf( (Bin + 0.5f) * (0.693147181f / TIMER_BINS_PER_OCTAVE) );
+}
@@ -19,16 +19,93 @@
 //-----------------------------------------------------------------------------
 // Definitions, Macros & Constants
 //-----------------------------------------------------------------------------
-const ULONG MAX_SAMPLE_COUNT = 50; // Maximum frame time sample count
+const ULONG DEFAULT_SAMPLE_COUNT    = 50;       // Default frame time sample window
+const ULONG TIMER_HISTOGRAM_BINS    = 384;      // Frame time histogram bins
+const ULONG TIMER_BINS_PER_OCTAVE   = 16;       // Bins each time a frame time doubles (~4.4% wide)
+const float TIMER_HISTOGRAM_MIN     = 0.001f;   // Frame time (ms) at the bottom of the first bin
+const float TIMER_SLEEP_MARGIN      = 2.0f;     // Time (ms) left to spin after sleeping, before calibration
+const float TIMER_SLEEP_MARGIN_MIN  = 0.05f;    // Smallest margin calibration may settle on
+const float TIMER_SLEEP_MARGIN_MAX  = 20.0f;    // Largest margin calibration may grow to
+
+//-----------------------------------------------------------------------------
+// Name : TIMER_CLOCK (Enum)
+// Desc : Source the timer reads from.
+// Note : The steady clock is the portable C++ one. The v110 library builds
+//        it on the system time, so QueryPerformanceCounter remains the
+//        default wherever it is available.
+//-----------------------------------------------------------------------------
+enum TIMER_CLOCK
+{
+    TIMERCLOCK_PERFCOUNTER  = 0,            // QueryPerformanceCounter
+    TIMERCLOCK_MULTIMEDIA   = 1,            // timeGetTime (millisecond resolution)
+    TIMERCLOCK_STEADY       = 2             // std::chrono::steady_clock
+};
+
+//-----------------------------------------------------------------------------
+// Name : TIMER_PACING (Enum)
+// Desc : How Tick waits out the remainder of a locked frame.
+//-----------------------------------------------------------------------------
+enum TIMER_PACING
+{
+    TIMERPACE_SPIN          = 0,            // Spin until a frame time has passed since the last frame (default)
+    TIMERPACE_SLEEP         = 1             // Sleep towards a fixed deadline, then spin the last of it
+};
+
+//-----------------------------------------------------------------------------
+// Name : PACING_STATS (Struct)
+// Desc : How closely locked frames kept to their deadlines, and what the
+//        waiting cost, since the pacing statistics were last reset. Times are
+//        in milliseconds.
+// Note : Spinning keeps a core busy for the whole wait, so the time spent
+//        asleep is the CPU time saved over the spin loop.
+//-----------------------------------------------------------------------------
+struct PACING_STATS
+{
+    ULONG           Frames;                 // Frames paced
+    ULONG           Missed;                 // Frames which began after their deadline
+    float           fErrP50;                // Time past the deadline at which frames began
+    float           fErrP95;
+    float           fErrP99;
+    float           fErrMax;
+    double          fWaitTime;              // Time spent waiting for deadlines
+    double          fSleepTime;             // ... asleep
+    double          fSpinTime;              // ... spinning
+    float           fMargin;                // Current sleep margin
+};
+
+//-----------------------------------------------------------------------------
+// Name : FRAME_TIME_STATS (Struct)
+// Desc : Frame times over the sample window, in milliseconds. Percentiles,
+//        along with the minimum & maximum, are read from the histogram so
+//        are accurate to within half a bin.
+//-----------------------------------------------------------------------------
+struct FRAME_TIME_STATS
+{
+    ULONG           Samples;                // Frames in the window
+    float           fMean;
+    float           fMin;
+    float           fMax;
+    float           fP50;
+    float           fP95;
+    float           fP99;
+};
 
 //-----------------------------------------------------------------------------
 // Main Class Declarations
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // Name : CTimer (Class)
-// Desc : Game Timer class, queries performance hardware if available, and 
+// Desc : Game Timer class, queries performance hardware if available, and
 //        calculates all the various values required for frame rate based
 //        vector / value scaling.
+// Note : Frame times are kept in a ring with a running sum, and counted into
+//        a log scaled histogram as they enter and leave it, so each Tick costs
+//        the same whatever the window size.
+//        When sleeping to a locked frame rate, deadlines are spaced exactly one
+//        frame apart, so a frame which wakes late takes the time from the next
+//        rather than pushing every later frame back. Only the final margin
+//        before each deadline is spun, and the margin is adjusted to the
+//        longest the OS has been seen to oversleep.
 //-----------------------------------------------------------------------------
 class CTimer
 {
@@ -45,28 +122,69 @@ public:
 	void	        Tick( float fLockFPS = 0.0f );
     unsigned long   GetFrameRate( LPTSTR lpszString = NULL ) const;
     float           GetTimeElapsed() const;
+    float           GetFrameTime() const { return m_FrameTime; }
+
+    bool            SetSampleWindow( ULONG Count );
+    ULONG           GetSampleWindow() const { return m_SampleWindow; }
+    void            GetFrameStats( FRAME_TIME_STATS * pStats ) const;
+    bool            SetClock( TIMER_CLOCK Clock );
+    TIMER_CLOCK     GetClock() const { return m_Clock; }
+    LPCTSTR         GetClockName() const;
+
+    void            SetPacing( TIMER_PACING Pacing ) { m_Pacing = Pacing; m_NextDeadline = 0; }
+    TIMER_PACING    GetPacing() const { return m_Pacing; }
+    void            GetPacingStats( PACING_STATS * pStats ) const;
+    void            ResetPacingStats();
 
 private:
+	//------------------------------------------------------------
+	// Private Functions For This Class
+	//------------------------------------------------------------
+    __int64         ReadClock() const;
+    void            ResetSamples();
+    void            SpinForFrame( __int64 Period );
+    void            SleepForFrame( __int64 Period );
+    void            SleepUntil( __int64 Target );
+    void            CalibrateMargin( float fOversleep );
+
+    static float    GetPercentile( const ULONG * pHistogram, ULONG Samples, float fFraction );
+
+    static ULONG    GetBin( float fTime );
+    static float    GetBinTime( ULONG Bin );
+
 	//------------------------------------------------------------
 	// Private Variables For This Class
 	//------------------------------------------------------------
-    bool            m_PerfHardware;             // Has Performance Counter
+    TIMER_CLOCK     m_Clock;                    // Clock being read
 	float           m_TimeScale;                // Amount to scale counter
 	float           m_TimeElapsed;              // Time elapsed since previous frame
+    float           m_FrameTime;                // Unsmoothed time taken by the previous frame
     __int64         m_CurrentTime;              // Current Performance Counter
     __int64         m_LastTime;                 // Performance Counter last frame
 	__int64         m_PerfFreq;                 // Performance Frequency
 
-    float           m_FrameTime[MAX_SAMPLE_COUNT];
-    ULONG           m_SampleCount;
+    float          *m_pFrameTime;               // Ring of recent frame times (seconds)
+    ULONG           m_SampleWindow;             // Size of m_pFrameTime
+    ULONG           m_SampleCount;              // Samples held
+    ULONG           m_NextSample;               // Slot the next sample is written to
+    double          m_SampleSum;                // Sum of the samples held
+    ULONG           m_Histogram[TIMER_HISTOGRAM_BINS]; // Samples held in each bin
+
+    TIMER_PACING    m_Pacing;                   // How locked frames are waited for
+    __int64         m_NextDeadline;             // Time the next locked frame is due (0 to start again)
+    float           m_fSleepMargin;             // Time (ms) left to spin after sleeping
+    HANDLE          m_hSleepTimer;              // Waitable timer slept on
+    bool            m_bTimerPeriod;             // Has the system timer resolution been raised ?
+    ULONG           m_PaceHistogram[TIMER_HISTOGRAM_BINS]; // Pacing error of each frame paced
+    PACING_STATS    m_PaceStats;                // Counts & times, percentiles filled in on request
 
     unsigned long   m_FrameRate;                // Stores current framerate
 	unsigned long   m_FPSFrameCount;            // Elapsed frames in any given second
 	float           m_FPSTimeElapsed;           // How much time has passed during FPS sample
-	
-	//------------------------------------------------------------
-	// Private Functions For This Class
-	//------------------------------------------------------------
+
+    // Timers own their sample ring & sleep timer, copying is not supported.
+    CTimer( const CTimer & );
+    CTimer & operator=( const CTimer & );
 };
 
-#endif // _CTIMER_H_
\ No newline at end of file
+#endif // _CTIMER_H_
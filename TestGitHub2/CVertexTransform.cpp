@@ -0,0 +1,517 @@
+//-----------------------------------------------------------------------------
+// File: CVertexTransform.cpp
+//
+// Desc: Batched transformation of vertex arrays into clip space, with the
+//       code path selected at runtime for the processor in use.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CVertexTransform Specific Includes
+//-----------------------------------------------------------------------------
+#include "CVertexTransform.h"
+#include <math.h>
+#include <intrin.h>
+#include <immintrin.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+// The compiler accepts intrinsics for any instruction set, so each path is
+// always built and only called if the processor supports it. AVX-512
+// intrinsics were added in Visual Studio 2017.
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define TRANSFORM_BUILD_AVX2
+#endif
+#if (defined(_MSC_VER) && _MSC_VER >= 1910) || defined(__AVX512F__)
+#define TRANSFORM_BUILD_AVX512
+#endif
+
+namespace
+{
+    // Largest relative difference from the scalar path accepted by Benchmark
+    const float TRANSFORM_TOLERANCE = 1e-5f;
+
+    // Path chosen by GetBestPath, once detected
+    volatile LONG g_BestPath = -1;
+
+    //-------------------------------------------------------------------------
+    // Name : TransformScalar ()
+    // Desc : Reference implementation, one vertex at a time.
+    //-------------------------------------------------------------------------
+    void TransformScalar( UCHAR * pOut, ULONG OutStride, UCHAR * pOutCodes, const UCHAR * pSource,
+                          ULONG VertexStride, ULONG Count, const D3DXMATRIX & m )
+    {
+        for ( ULONG i = 0; i < Count; i++, pOut += OutStride, pSource += VertexStride )
+        {
+            const float * p = (const float*)pSource;
+            D3DXVECTOR4 & v = *(D3DXVECTOR4*)pOut;
+            ULONG      Code = 0;
+
+            v.x = p[0] * m._11 + p[1] * m._21 + p[2] * m._31 + m._41;
+            v.y = p[0] * m._12 + p[1] * m._22 + p[2] * m._32 + m._42;
+            v.z = p[0] * m._13 + p[1] * m._23 + p[2] * m._33 + m._43;
+            v.w = p[0] * m._14 + p[1] * m._24 + p[2] * m._34 + m._44;
+
+            if ( v.x < -v.w ) Code |= CLIP_LEFT;
+            if ( v.x >  v.w ) Code |= CLIP_RIGHT;
+            if ( v.y < -v.w ) Code |= CLIP_BOTTOM;
+            if ( v.y >  v.w ) Code |= CLIP_TOP;
+            if ( v.z <  0.0f) Code |= CLIP_NEAR;
+            if ( v.z >  v.w ) Code |= CLIP_FAR;
+            pOutCodes[i] = (UCHAR)Code;
+
+        } // Next Vertex
+    }
+
+    //-------------------------------------------------------------------------
+    // Name : TransformSSE2 ()
+    // Desc : Four vertices per step, returns the number transformed.
+    //-------------------------------------------------------------------------
+    ULONG TransformSSE2( UCHAR * pOut, ULONG OutStride, UCHAR * pOutCodes, const UCHAR * pSource,
+                         ULONG VertexStride, ULONG Count, const D3DXMATRIX & m )
+    {
+        const __m128 SignMask = _mm_castsi128_ps( _mm_set1_epi32( 0x80000000 ) );
+        const __m128 Zero     = _mm_setzero_ps();
+        __m128 m11 = _mm_set1_ps( m._11 ), m12 = _mm_set1_ps( m._12 ), m13 = _mm_set1_ps( m._13 ), m14 = _mm_set1_ps( m._14 );
+        __m128 m21 = _mm_set1_ps( m._21 ), m22 = _mm_set1_ps( m._22 ), m23 = _mm_set1_ps( m._23 ), m24 = _mm_set1_ps( m._24 );
+        __m128 m31 = _mm_set1_ps( m._31 ), m32 = _mm_set1_ps( m._32 ), m33 = _mm_set1_ps( m._33 ), m34 = _mm_set1_ps( m._34 );
+        __m128 m41 = _mm_set1_ps( m._41 ), m42 = _mm_set1_ps( m._42 ), m43 = _mm_set1_ps( m._43 ), m44 = _mm_set1_ps( m._44 );
+        ULONG  i;
+
+        for ( i = 0; i + 4 <= Count; i += 4, pSource += VertexStride * 4, pOut += OutStride * 4 )
+        {
+            // Load four vertices and transpose them into x, y & z registers
+            __m128 r0 = _mm_loadu_ps( (const float*)(pSource) );
+            __m128 r1 = _mm_loadu_ps( (const float*)(pSource + VertexStride) );
+            __m128 r2 = _mm_loadu_ps( (const float*)(pSource + VertexStride * 2) );
+            __m128 r3 = _mm_loadu_ps( (const float*)(pSource + VertexStride * 3) );
+            __m128 t0 = _mm_unpacklo_ps( r0, r1 ), t1 = _mm_unpacklo_ps( r2, r3 );
+            __m128 t2 = _mm_unpackhi_ps( r0, r1 ), t3 = _mm_unpackhi_ps( r2, r3 );
+            __m128 x  = _mm_movelh_ps( t0, t1 ), y = _mm_movehl_ps( t1, t0 ), z = _mm_movelh_ps( t2, t3 );
+
+            // Transform
+            __m128 cx = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m11 ), _mm_mul_ps( y, m21 ) ), _mm_mul_ps( z, m31 ) ), m41 );
+            __m128 cy = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m12 ), _mm_mul_ps( y, m22 ) ), _mm_mul_ps( z, m32 ) ), m42 );
+            __m128 cz = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m13 ), _mm_mul_ps( y, m23 ) ), _mm_mul_ps( z, m33 ) ), m43 );
+            __m128 cw = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m14 ), _mm_mul_ps( y, m24 ) ), _mm_mul_ps( z, m34 ) ), m44 );
+
+            // Outcodes, one byte per vertex
+            __m128 nw = _mm_xor_ps( cw, SignMask );
+            __m128i Codes = _mm_and_si128( _mm_castps_si128( _mm_cmplt_ps( cx, nw ) ), _mm_set1_epi32( CLIP_LEFT ) );
+            Codes = _mm_or_si128( Codes, _mm_and_si128( _mm_castps_si128( _mm_cmpgt_ps( cx, cw ) ), _mm_set1_epi32( CLIP_RIGHT ) ) );
+            Codes = _mm_or_si128( Codes, _mm_and_si128( _mm_castps_si128( _mm_cmplt_ps( cy, nw ) ), _mm_set1_epi32( CLIP_BOTTOM ) ) );
+            Codes = _mm_or_si128( Codes, _mm_and_si128( _mm_castps_si128( _mm_cmpgt_ps( cy, cw ) ), _mm_set1_epi32( CLIP_TOP ) ) );
+            Codes = _mm_or_si128( Codes, _mm_and_si128( _mm_castps_si128( _mm_cmplt_ps( cz, Zero ) ), _mm_set1_epi32( CLIP_NEAR ) ) );
+            Codes = _mm_or_si128( Codes, _mm_and_si128( _mm_castps_si128( _mm_cmpgt_ps( cz, cw ) ), _mm_set1_epi32( CLIP_FAR ) ) );
+            Codes = _mm_packs_epi32( Codes, Codes );
+            int Packed = _mm_cvtsi128_si32( _mm_packus_epi16( Codes, Codes ) );
+            memcpy( pOutCodes + i, &Packed, 4 );
+
+            // Transpose back and store
+            t0 = _mm_unpacklo_ps( cx, cy ); t1 = _mm_unpacklo_ps( cz, cw );
+            t2 = _mm_unpackhi_ps( cx, cy ); t3 = _mm_unpackhi_ps( cz, cw );
+            _mm_storeu_ps( (float*)(pOut), _mm_movelh_ps( t0, t1 ) );
+            _mm_storeu_ps( (float*)(pOut + OutStride), _mm_movehl_ps( t1, t0 ) );
+            _mm_storeu_ps( (float*)(pOut + OutStride * 2), _mm_movelh_ps( t2, t3 ) );
+            _mm_storeu_ps( (float*)(pOut + OutStride * 3), _mm_movehl_ps( t3, t2 ) );
+
+        } // Next Block
+        return i;
+    }
+
+#if defined(TRANSFORM_BUILD_AVX2)
+    //-------------------------------------------------------------------------
+    // Name : TransformAVX2 ()
+    // Desc : Eight vertices per step, returns the number transformed. Each
+    //        128 bit lane holds four of them, transposed as in the SSE2 path.
+    //-------------------------------------------------------------------------
+    ULONG TransformAVX2( UCHAR * pOut, ULONG OutStride, UCHAR * pOutCodes, const UCHAR * pSource,
+                         ULONG VertexStride, ULONG Count, const D3DXMATRIX & m )
+    {
+        const __m256 SignMask = _mm256_castsi256_ps( _mm256_set1_epi32( 0x80000000 ) );
+        const __m256 Zero     = _mm256_setzero_ps();
+        __m256 m11 = _mm256_set1_ps( m._11 ), m12 = _mm256_set1_ps( m._12 ), m13 = _mm256_set1_ps( m._13 ), m14 = _mm256_set1_ps( m._14 );
+        __m256 m21 = _mm256_set1_ps( m._21 ), m22 = _mm256_set1_ps( m._22 ), m23 = _mm256_set1_ps( m._23 ), m24 = _mm256_set1_ps( m._24 );
+        __m256 m31 = _mm256_set1_ps( m._31 ), m32 = _mm256_set1_ps( m._32 ), m33 = _mm256_set1_ps( m._33 ), m34 = _mm256_set1_ps( m._34 );
+        __m256 m41 = _mm256_set1_ps( m._41 ), m42 = _mm256_set1_ps( m._42 ), m43 = _mm256_set1_ps( m._43 ), m44 = _mm256_set1_ps( m._44 );
+        __m256 r[4];
+        ULONG  i, j;
+
+        for ( i = 0; i + 8 <= Count; i += 8, pSource += VertexStride * 8, pOut += OutStride * 8 )
+        {
+            // Vertex j in the low lane, vertex j + 4 in the high lane
+            for ( j = 0; j < 4; j++ )
+            {
+                __m128 Low  = _mm_loadu_ps( (const float*)(pSource + VertexStride * j) );
+                __m128 High = _mm_loadu_ps( (const float*)(pSource + VertexStride * (j + 4)) );
+                r[j] = _mm256_insertf128_ps( _mm256_castps128_ps256( Low ), High, 1 );
+
+            } // Next Register
+
+            // Transpose within each lane
+            __m256 t0 = _mm256_unpacklo_ps( r[0], r[1] ), t1 = _mm256_unpacklo_ps( r[2], r[3] );
+            __m256 t2 = _mm256_unpackhi_ps( r[0], r[1] ), t3 = _mm256_unpackhi_ps( r[2], r[3] );
+            __m256 x  = _mm256_shuffle_ps( t0, t1, 0x44 ), y = _mm256_shuffle_ps( t0, t1, 0xEE ), z = _mm256_shuffle_ps( t2, t3, 0x44 );
+
+            // Transform
+            __m256 cx = _mm256_add_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( x, m11 ), _mm256_mul_ps( y, m21 ) ), _mm256_mul_ps( z, m31 ) ), m41 );
+            __m256 cy = _mm256_add_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( x, m12 ), _mm256_mul_ps( y, m22 ) ), _mm256_mul_ps( z, m32 ) ), m42 );
+            __m256 cz = _mm256_add_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( x, m13 ), _mm256_mul_ps( y, m23 ) ), _mm256_mul_ps( z, m33 ) ), m43 );
+            __m256 cw = _mm256_add_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( x, m14 ), _mm256_mul_ps( y, m24 ) ), _mm256_mul_ps( z, m34 ) ), m44 );
+
+            // Outcodes, one byte per vertex
+            __m256 nw = _mm256_xor_ps( cw, SignMask );
+            __m256i Codes = _mm256_and_si256( _mm256_castps_si256( _mm256_cmp_ps( cx, nw, _CMP_LT_OQ ) ), _mm256_set1_epi32( CLIP_LEFT ) );
+            Codes = _mm256_or_si256( Codes, _mm256_and_si256( _mm256_castps_si256( _mm256_cmp_ps( cx, cw, _CMP_GT_OQ ) ), _mm256_set1_epi32( CLIP_RIGHT ) ) );
+            Codes = _mm256_or_si256( Codes, _mm256_and_si256( _mm256_castps_si256( _mm256_cmp_ps( cy, nw, _CMP_LT_OQ ) ), _mm256_set1_epi32( CLIP_BOTTOM ) ) );
+            Codes = _mm256_or_si256( Codes, _mm256_and_si256( _mm256_castps_si256( _mm256_cmp_ps( cy, cw, _CMP_GT_OQ ) ), _mm256_set1_epi32( CLIP_TOP ) ) );
+            Codes = _mm256_or_si256( Codes, _mm256_and_si256( _mm256_castps_si256( _mm256_cmp_ps( cz, Zero, _CMP_LT_OQ ) ), _mm256_set1_epi32( CLIP_NEAR ) ) );
+            Codes = _mm256_or_si256( Codes, _mm256_and_si256( _mm256_castps_si256( _mm256_cmp_ps( cz, cw, _CMP_GT_OQ ) ), _mm256_set1_epi32( CLIP_FAR ) ) );
+            __m128i Codes16 = _mm_packs_epi32( _mm256_castsi256_si128( Codes ), _mm256_extracti128_si256( Codes, 1 ) );
+            _mm_storel_epi64( (__m128i*)(pOutCodes + i), _mm_packus_epi16( Codes16, Codes16 ) );
+
+            // Transpose back, lane 0 holds vertex j and lane 1 vertex j + 4
+            t0 = _mm256_unpacklo_ps( cx, cy ); t1 = _mm256_unpacklo_ps( cz, cw );
+            t2 = _mm256_unpackhi_ps( cx, cy ); t3 = _mm256_unpackhi_ps( cz, cw );
+            r[0] = _mm256_shuffle_ps( t0, t1, 0x44 ); r[1] = _mm256_shuffle_ps( t0, t1, 0xEE );
+            r[2] = _mm256_shuffle_ps( t2, t3, 0x44 ); r[3] = _mm256_shuffle_ps( t2, t3, 0xEE );
+            for ( j = 0; j < 4; j++ )
+            {
+                _mm_storeu_ps( (float*)(pOut + OutStride * j), _mm256_castps256_ps128( r[j] ) );
+                _mm_storeu_ps( (float*)(pOut + OutStride * (j + 4)), _mm256_extractf128_ps( r[j], 1 ) );
+
+            } // Next Register
+
+        } // Next Block
+        _mm256_zeroupper();
+        return i;
+    }
+#endif // TRANSFORM_BUILD_AVX2
+
+#if defined(TRANSFORM_BUILD_AVX512)
+    //-------------------------------------------------------------------------
+    // Name : TransformAVX512 ()
+    // Desc : Sixteen vertices per step, returns the number transformed. Each
+    //        128 bit lane k holds vertices 4k to 4k + 3.
+    //-------------------------------------------------------------------------
+    ULONG TransformAVX512( UCHAR * pOut, ULONG OutStride, UCHAR * pOutCodes, const UCHAR * pSource,
+                           ULONG VertexStride, ULONG Count, const D3DXMATRIX & m )
+    {
+        const __m512 Zero = _mm512_setzero_ps();
+        __m512 m11 = _mm512_set1_ps( m._11 ), m12 = _mm512_set1_ps( m._12 ), m13 = _mm512_set1_ps( m._13 ), m14 = _mm512_set1_ps( m._14 );
+        __m512 m21 = _mm512_set1_ps( m._21 ), m22 = _mm512_set1_ps( m._22 ), m23 = _mm512_set1_ps( m._23 ), m24 = _mm512_set1_ps( m._24 );
+        __m512 m31 = _mm512_set1_ps( m._31 ), m32 = _mm512_set1_ps( m._32 ), m33 = _mm512_set1_ps( m._33 ), m34 = _mm512_set1_ps( m._34 );
+        __m512 m41 = _mm512_set1_ps( m._41 ), m42 = _mm512_set1_ps( m._42 ), m43 = _mm512_set1_ps( m._43 ), m44 = _mm512_set1_ps( m._44 );
+        __m512 r[4];
+        ULONG  i, j;
+
+        for ( i = 0; i + 16 <= Count; i += 16, pSource += VertexStride * 16, pOut += OutStride * 16 )
+        {
+            // Register j holds vertices j, j + 4, j + 8 & j + 12
+            for ( j = 0; j < 4; j++ )
+            {
+                r[j] = _mm512_castps128_ps512( _mm_loadu_ps( (const float*)(pSource + VertexStride * j) ) );
+                r[j] = _mm512_insertf32x4( r[j], _mm_loadu_ps( (const float*)(pSource + VertexStride * (j + 4)) ), 1 );
+                r[j] = _mm512_insertf32x4( r[j], _mm_loadu_ps( (const float*)(pSource + VertexStride * (j + 8)) ), 2 );
+                r[j] = _mm512_insertf32x4( r[j], _mm_loadu_ps( (const float*)(pSource + VertexStride * (j + 12)) ), 3 );
+
+            } // Next Register
+
+            // Transpose within each lane
+            __m512 t0 = _mm512_unpacklo_ps( r[0], r[1] ), t1 = _mm512_unpacklo_ps( r[2], r[3] );
+            __m512 t2 = _mm512_unpackhi_ps( r[0], r[1] ), t3 = _mm512_unpackhi_ps( r[2], r[3] );
+            __m512 x  = _mm512_shuffle_ps( t0, t1, 0x44 ), y = _mm512_shuffle_ps( t0, t1, 0xEE ), z = _mm512_shuffle_ps( t2, t3, 0x44 );
+
+            // Transform
+            __m512 cx = _mm512_add_ps( _mm512_add_ps( _mm512_add_ps( _mm512_mul_ps( x, m11 ), _mm512_mul_ps( y, m21 ) ), _mm512_mul_ps( z, m31 ) ), m41 );
+            __m512 cy = _mm512_add_ps( _mm512_add_ps( _mm512_add_ps( _mm512_mul_ps( x, m12 ), _mm512_mul_ps( y, m22 ) ), _mm512_mul_ps( z, m32 ) ), m42 );
+            __m512 cz = _mm512_add_ps( _mm512_add_ps( _mm512_add_ps( _mm512_mul_ps( x, m13 ), _mm512_mul_ps( y, m23 ) ), _mm512_mul_ps( z, m33 ) ), m43 );
+            __m512 cw = _mm512_add_ps( _mm512_add_ps( _mm512_add_ps( _mm512_mul_ps( x, m14 ), _mm512_mul_ps( y, m24 ) ), _mm512_mul_ps( z, m34 ) ), m44 );
+
+            // Outcodes, the compares produce one mask bit per vertex
+            __m512  nw    = _mm512_sub_ps( Zero, cw );
+            __m512i Codes = _mm512_setzero_si512();
+            Codes = _mm512_mask_or_epi32( Codes, _mm512_cmp_ps_mask( cx, nw, _CMP_LT_OQ ), Codes, _mm512_set1_epi32( CLIP_LEFT ) );
+            Codes = _mm512_mask_or_epi32( Codes, _mm512_cmp_ps_mask( cx, cw, _CMP_GT_OQ ), Codes, _mm512_set1_epi32( CLIP_RIGHT ) );
+            Codes = _mm512_mask_or_epi32( Codes, _mm512_cmp_ps_mask( cy, nw, _CMP_LT_OQ ), Codes, _mm512_set1_epi32( CLIP_BOTTOM ) );
+            Codes = _mm512_mask_or_epi32( Codes, _mm512_cmp_ps_mask( cy, cw, _CMP_GT_OQ ), Codes, _mm512_set1_epi32( CLIP_TOP ) );
+            Codes = _mm512_mask_or_epi32( Codes, _mm512_cmp_ps_mask( cz, Zero, _CMP_LT_OQ ), Codes, _mm512_set1_epi32( CLIP_NEAR ) );
+            Codes = _mm512_mask_or_epi32( Codes, _mm512_cmp_ps_mask( cz, cw, _CMP_GT_OQ ), Codes, _mm512_set1_epi32( CLIP_FAR ) );
+            _mm_storeu_si128( (__m128i*)(pOutCodes + i), _mm512_cvtepi32_epi8( Codes ) );
+
+            // Transpose back, lane k of register j holds vertex 4k + j
+            t0 = _mm512_unpacklo_ps( cx, cy ); t1 = _mm512_unpacklo_ps( cz, cw );
+            t2 = _mm512_unpackhi_ps( cx, cy ); t3 = _mm512_unpackhi_ps( cz, cw );
+            r[0] = _mm512_shuffle_ps( t0, t1, 0x44 ); r[1] = _mm512_shuffle_ps( t0, t1, 0xEE );
+            r[2] = _mm512_shuffle_ps( t2, t3, 0x44 ); r[3] = _mm512_shuffle_ps( t2, t3, 0xEE );
+            for ( j = 0; j < 4; j++ )
+            {
+                _mm_storeu_ps( (float*)(pOut + OutStride * j), _mm512_castps512_ps128( r[j] ) );
+                _mm_storeu_ps( (float*)(pOut + OutStride * (j + 4)), _mm512_extractf32x4_ps( r[j], 1 ) );
+                _mm_storeu_ps( (float*)(pOut + OutStride * (j + 8)), _mm512_extractf32x4_ps( r[j], 2 ) );
+                _mm_storeu_ps( (float*)(pOut + OutStride * (j + 12)), _mm512_extractf32x4_ps( r[j], 3 ) );
+
+            } // Next Register
+
+        } // Next Block
+        _mm256_zeroupper();
+        return i;
+    }
+#endif // TRANSFORM_BUILD_AVX512
+
+    //-------------------------------------------------------------------------
+    // Name : DetectBestPath ()
+    // Desc : Queries the processor (and operating system) for the widest
+    //        vector registers that can be used.
+    //-------------------------------------------------------------------------
+    TRANSFORM_PATH DetectBestPath( )
+    {
+        int            Info[4];
+        int            MaxLeaf;
+        unsigned __int64 XCR0 = 0;
+        TRANSFORM_PATH Path = TRANSFORM_SCALAR;
+
+        __cpuid( Info, 0 );
+        MaxLeaf = Info[0];
+        if ( MaxLeaf < 1 ) return Path;
+
+        // SSE2 (EDX bit 26)
+        __cpuid( Info, 1 );
+        if ( Info[3] & (1 << 26) ) Path = TRANSFORM_SSE2;
+
+        // The OS must save the upper register state (OSXSAVE, ECX bit 27)
+        if ( !(Info[2] & (1 << 27)) || MaxLeaf < 7 ) return Path;
+        XCR0 = _xgetbv( 0 );
+        __cpuidex( Info, 7, 0 );
+
+#if defined(TRANSFORM_BUILD_AVX2)
+        // AVX2 (EBX bit 5), with XMM & YMM state enabled
+        if ( (Info[1] & (1 << 5)) && (XCR0 & 0x06) == 0x06 ) Path = TRANSFORM_AVX2;
+#endif
+
+#if defined(TRANSFORM_BUILD_AVX512)
+        // AVX-512 Foundation (EBX bit 16), with the opmask & ZMM state enabled
+        if ( (Info[1] & (1 << 16)) && (XCR0 & 0xE6) == 0xE6 ) Path = TRANSFORM_AVX512;
+#endif
+
+        // Done
+        return Path;
+    }
+
+}; // End Namespace
+
+//-----------------------------------------------------------------------------
+// Name : TransformArray () (Static)
+// Desc : Transforms the position (leading three floats) of each vertex by
+//        the matrix specified, writing the clip space result & outcode.
+// Note : Vertex strides of less than 16 bytes can't be loaded a register at
+//        a time, so use the scalar path. Any vertices left over after the
+//        last full block are also transformed by the scalar path.
+//-----------------------------------------------------------------------------
+void CVertexTransform::TransformArray( D3DXVECTOR4 * pOut, ULONG OutStride, UCHAR * pOutCodes, const void * pVertices,
+                                       ULONG VertexStride, ULONG Count, const D3DXMATRIX & mtx, TRANSFORM_PATH Path )
+{
+    UCHAR       * pDest   = (UCHAR*)pOut;
+    const UCHAR * pSource = (const UCHAR*)pVertices;
+    ULONG         Done    = 0;
+
+    // Pick the path
+    if ( Path == TRANSFORM_BEST ) Path = GetBestPath();
+    else if ( !IsSupported( Path ) ) Path = GetBestPath();
+    if ( VertexStride < 16 || OutStride < sizeof(D3DXVECTOR4) ) Path = TRANSFORM_SCALAR;
+
+    // Transform whole blocks
+    switch ( Path )
+    {
+#if defined(TRANSFORM_BUILD_AVX512)
+        case TRANSFORM_AVX512:
+            Done = TransformAVX512( pDest, OutStride, pOutCodes, pSource, VertexStride, Count, mtx );
+            break;
+#endif
+#if defined(TRANSFORM_BUILD_AVX2)
+        case TRANSFORM_AVX2:
+            Done = TransformAVX2( pDest, OutStride, pOutCodes, pSource, VertexStride, Count, mtx );
+            break;
+#endif
+        case TRANSFORM_SSE2:
+            Done = TransformSSE2( pDest, OutStride, pOutCodes, pSource, VertexStride, Count, mtx );
+            break;
+
+        default:
+            break;
+
+    } // End Switch
+
+    // Finish off the remainder
+    TransformScalar( pDest + Done * OutStride, OutStride, pOutCodes + Done, pSource + Done * VertexStride,
+                     VertexStride, Count - Done, mtx );
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsSupported () (Static)
+// Desc : Determines whether the path specified can be used on this machine.
+//-----------------------------------------------------------------------------
+bool CVertexTransform::IsSupported( TRANSFORM_PATH Path )
+{
+    return Path < TRANSFORM_PATH_COUNT && Path <= GetBestPath();
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetBestPath () (Static)
+// Desc : Retrieves the fastest path supported by this machine.
+// Note : Detected on first use. Concurrent first calls simply detect twice.
+//-----------------------------------------------------------------------------
+TRANSFORM_PATH CVertexTransform::GetBestPath( )
+{
+    if ( g_BestPath < 0 ) InterlockedExchange( &g_BestPath, (LONG)DetectBestPath() );
+    return (TRANSFORM_PATH)g_BestPath;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPathName () (Static)
+// Desc : Retrieves a printable name for the path specified.
+//-----------------------------------------------------------------------------
+LPCTSTR CVertexTransform::GetPathName( TRANSFORM_PATH Path )
+{
+    switch ( Path )
+    {
+        case TRANSFORM_SCALAR: return _T("Scalar");
+        case TRANSFORM_SSE2:   return _T("SSE2");
+        case TRANSFORM_AVX2:   return _T("AVX2");
+        case TRANSFORM_AVX512: return _T("AVX-512");
+        case TRANSFORM_BEST:   return GetPathName( GetBestPath() );
+        default:               break;
+
+    } // End Switch
+    return _T("Unknown");
+}
+
+//-----------------------------------------------------------------------------
+// Name : Benchmark () (Static)
+// Desc : Transforms a randomly generated vertex array through every path
+//        supported, checks each against the scalar path, and writes the best
+//        throughput of each to the report file specified.
+// Note : Returns false if any path differs from the scalar results by more
+//        than TRANSFORM_TOLERANCE (relative), or produces different outcodes.
+//-----------------------------------------------------------------------------
+bool CVertexTransform::Benchmark( ULONG VertexCount, LPCTSTR strReportFile, ULONG Iterations )
+{
+    CVertex       * pVertices   = NULL;
+    D3DXVECTOR4   * pReference  = NULL, * pOut = NULL;
+    UCHAR         * pRefCodes   = NULL, * pOutCodes = NULL;
+    FILE          * pFile       = NULL;
+    D3DXMATRIX      mtxWorld, mtxView, mtxProj, mtx;
+    D3DXVECTOR3     vecEye( 0.0f, 20.0f, -150.0f ), vecAt( 0.0f, 0.0f, 0.0f ), vecUp( 0.0f, 1.0f, 0.0f );
+    LARGE_INTEGER   Frequency, Start, End;
+    double          fBest[ TRANSFORM_PATH_COUNT ];
+    float           fError[ TRANSFORM_PATH_COUNT ];
+    ULONG           CodeErrors[ TRANSFORM_PATH_COUNT ];
+    bool            bResult = true;
+    ULONG           i, Path;
+
+    if ( VertexCount == 0 ) VertexCount = 1;
+    if ( Iterations  == 0 ) Iterations  = 1;
+
+    // Allocate the buffers
+    if (!( pVertices  = new CVertex[ VertexCount ] )) goto BenchError;
+    if (!( pReference = new D3DXVECTOR4[ VertexCount ] )) goto BenchError;
+    if (!( pOut       = new D3DXVECTOR4[ VertexCount ] )) goto BenchError;
+    if (!( pRefCodes  = new UCHAR[ VertexCount ] )) goto BenchError;
+    if (!( pOutCodes  = new UCHAR[ VertexCount ] )) goto BenchError;
+
+    // Random vertices around the origin, viewed so that some lie outside
+    srand( 1 );
+    for ( i = 0; i < VertexCount; i++ )
+    {
+        pVertices[i].x = (rand() / (float)RAND_MAX) * 200.0f - 100.0f;
+        pVertices[i].y = (rand() / (float)RAND_MAX) * 200.0f - 100.0f;
+        pVertices[i].z = (rand() / (float)RAND_MAX) * 200.0f - 100.0f;
+
+    } // Next Vertex
+    D3DXMatrixRotationYawPitchRoll( &mtxWorld, 0.3f, 0.2f, 0.1f );
+    D3DXMatrixLookAtLH( &mtxView, &vecEye, &vecAt, &vecUp );
+    D3DXMatrixPerspectiveFovLH( &mtxProj, D3DXToRadian( 60.0f ), 4.0f / 3.0f, 1.01f, 1000.0f );
+    mtx = mtxWorld * mtxView * mtxProj;
+
+    // Reference results
+    Transform( pReference, pRefCodes, pVertices, VertexCount, mtx, TRANSFORM_SCALAR );
+
+    // Time each supported path
+    QueryPerformanceFrequency( &Frequency );
+    for ( Path = 0; Path < TRANSFORM_PATH_COUNT; Path++ )
+    {
+        fBest[ Path ] = 0.0; fError[ Path ] = 0.0f; CodeErrors[ Path ] = 0;
+        if ( !IsSupported( (TRANSFORM_PATH)Path ) ) continue;
+
+        for ( ULONG Iteration = 0; Iteration < Iterations; Iteration++ )
+        {
+            QueryPerformanceCounter( &Start );
+            Transform( pOut, pOutCodes, pVertices, VertexCount, mtx, (TRANSFORM_PATH)Path );
+            QueryPerformanceCounter( &End );
+
+            double fSeconds = (double)(End.QuadPart - Start.QuadPart) / (double)Frequency.QuadPart;
+            if ( Iteration == 0 || fSeconds < fBest[ Path ] ) fBest[ Path ] = fSeconds;
+
+        } // Next Iteration
+
+        // Compare against the reference
+        for ( i = 0; i < VertexCount; i++ )
+        {
+            const float * a = pOut[i], * b = pReference[i];
+            for ( ULONG Component = 0; Component < 4; Component++ )
+            {
+                float fScale = fabsf( b[ Component ] ) > 1.0f ? fabsf( b[ Component ] ) : 1.0f;
+                float fDiff  = fabsf( a[ Component ] - b[ Component ] ) / fScale;
+                if ( fDiff > fError[ Path ] ) fError[ Path ] = fDiff;
+
+            } // Next Component
+            if ( pOutCodes[i] != pRefCodes[i] ) CodeErrors[ Path ]++;
+
+        } // Next Vertex
+        if ( fError[ Path ] > TRANSFORM_TOLERANCE || CodeErrors[ Path ] ) bResult = false;
+
+    } // Next Path
+
+    // Write the report
+    if (!( pFile = _tfopen( strReportFile, _T("w") ) )) goto BenchError;
+    _ftprintf( pFile, _T("Vertex transform benchmark\n") );
+    _ftprintf( pFile, _T("Vertices    : %lu\n"), (unsigned long)VertexCount );
+    _ftprintf( pFile, _T("Best path   : %s\n"), GetPathName( GetBestPath() ) );
+    _ftprintf( pFile, _T("Iterations  : %lu (best of)\n\n"), (unsigned long)Iterations );
+    _ftprintf( pFile, _T("Path        Time (ms)   MVerts/s   Speedup    Max Error   Outcodes   Result\n") );
+    for ( Path = 0; Path < TRANSFORM_PATH_COUNT; Path++ )
+    {
+        if ( !IsSupported( (TRANSFORM_PATH)Path ) )
+        {
+            _ftprintf( pFile, _T("%-8s    (not supported)\n"), GetPathName( (TRANSFORM_PATH)Path ) );
+            continue;
+
+        } // End if unsupported
+
+        _ftprintf( pFile, _T("%-8s   %10.3f   %8.1f   %6.2fx   %10.3g   %8lu   %s\n"), GetPathName( (TRANSFORM_PATH)Path ),
+                   fBest[ Path ] * 1000.0, (fBest[ Path ] > 0.0) ? VertexCount / fBest[ Path ] / 1000000.0 : 0.0,
+                   (fBest[ Path ] > 0.0) ? fBest[0] / fBest[ Path ] : 0.0, fError[ Path ], (unsigned long)CodeErrors[ Path ],
+                   (fError[ Path ] > TRANSFORM_TOLERANCE || CodeErrors[ Path ]) ? _T("FAIL") : _T("OK") );
+
+    } // Next Path
+    fclose( pFile );
+
+    // Clean up
+    delete []pVertices;
+    delete []pReference;
+    delete []pOut;
+    delete []pRefCodes;
+    delete []pOutCodes;
+    return bResult;
+
+BenchError:
+    // Clean up and fail
+    if ( pVertices  ) delete []pVertices;
+    if ( pReference ) delete []pReference;
+    if ( pOut       ) delete []pOut;
+    if ( pRefCodes  ) delete []pRefCodes;
+    if ( pOutCodes  ) delete []pOutCodes;
+    return false;
+}
@@ -0,0 +1,72 @@
+//-----------------------------------------------------------------------------
+// File: CVertexTransform.h
+//
+// Desc: Batched transformation of vertex arrays into clip space, with the
+//       code path selected at runtime for the processor in use.
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+#ifndef _CVERTEXTRANSFORM_H_
+#define _CVERTEXTRANSFORM_H_
+
+//-----------------------------------------------------------------------------
+// CVertexTransform Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "CObject.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+// Clip plane outcodes
+const ULONG CLIP_LEFT   = 0x01, CLIP_RIGHT = 0x02, CLIP_BOTTOM = 0x04;
+const ULONG CLIP_TOP    = 0x08, CLIP_NEAR  = 0x10, CLIP_FAR    = 0x20;
+
+//-----------------------------------------------------------------------------
+// Name : TRANSFORM_PATH (Enum)
+// Desc : Implementations of the transform, slowest first.
+//-----------------------------------------------------------------------------
+enum TRANSFORM_PATH
+{
+    TRANSFORM_SCALAR    = 0,                // Reference implementation
+    TRANSFORM_SSE2      = 1,                // 4 vertices per step
+    TRANSFORM_AVX2      = 2,                // 8 vertices per step
+    TRANSFORM_AVX512    = 3,                // 16 vertices per step
+    TRANSFORM_PATH_COUNT = 4,
+    TRANSFORM_BEST      = 0xFF              // Fastest path supported by this processor
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CVertexTransform (Class)
+// Desc : Transforms the positions of a vertex array by a single matrix
+//        (normally world * view * projection), writing the clip space
+//        positions along with the planes that each lies outside of.
+// Note : Vertices are loaded four at a time and transposed so that each
+//        register holds one component of several vertices. The products are
+//        summed in the same order as the scalar path, so every path gives
+//        the same results on processors using SSE arithmetic. AVX-512
+//        requires Visual Studio 2017 or later to build.
+//-----------------------------------------------------------------------------
+class CVertexTransform
+{
+public:
+	//-------------------------------------------------------------------------
+	// Public Static Functions for This Class
+	//-------------------------------------------------------------------------
+    static void     TransformArray  ( D3DXVECTOR4 * pOut, ULONG OutStride, UCHAR * pOutCodes, const void * pVertices,
+                                      ULONG VertexStride, ULONG Count, const D3DXMATRIX & mtx, TRANSFORM_PATH Path = TRANSFORM_BEST );
+    static void     Transform       ( D3DXVECTOR4 * pOut, UCHAR * pOutCodes, const CVertex * pVertices, ULONG Count,
+                                      const D3DXMATRIX & mtx, TRANSFORM_PATH Path = TRANSFORM_BEST )
+                        { TransformArray( pOut, sizeof(D3DXVECTOR4), pOutCodes, pVertices, sizeof(CVertex), Count, mtx, Path ); }
+
+    static bool     IsSupported     ( TRANSFORM_PATH Path );
+    static TRANSFORM_PATH GetBestPath( );
+    static LPCTSTR  GetPathName     ( TRANSFORM_PATH Path );
+    static bool     Benchmark       ( ULONG VertexCount, LPCTSTR strReportFile, ULONG Iterations = 5 );
+};
+
+#endif // _CVERTEXTRANSFORM_H_
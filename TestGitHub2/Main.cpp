@@ -11,11 +11,71 @@
 //-----------------------------------------------------------------------------
 #include "Main.h"
 #include "CGameApp.h"
+#include <stdlib.h>
+#include <new>
 
 //-----------------------------------------------------------------------------
 // Global Variable Definitions
 //-----------------------------------------------------------------------------
 CGameApp    g_App;      // Core game application processing engine
+volatile LONG g_nAllocations = 0;
+volatile bool g_bCountAllocations = false;
+
+//-----------------------------------------------------------------------------
+// Name : operator new () (Global)
+// Desc : Replaces the global allocation functions, only to count the
+//        allocations made each frame for the frame telemetry.
+// Note : Nothing is counted (so no interlocked operation is made) unless
+//        telemetry is being published.
+//-----------------------------------------------------------------------------
+void * operator new( size_t Size )
+{
+    void * pMemory;
+
+    if ( g_bCountAllocations ) InterlockedIncrement( &g_nAllocations );
+    if (!( pMemory = malloc( Size ? Size : 1 ) )) throw std::bad_alloc();
+    return pMemory;
+}
+
+void * operator new[]( size_t Size )
+{
+    return operator new( Size );
+}
+
+void * operator new( size_t Size, const std::nothrow_t & )
+{
+    if ( g_bCountAllocations ) InterlockedIncrement( &g_nAllocations );
+    return malloc( Size ? Size : 1 );
+}
+
+void * operator new[]( size_t Size, const std::nothrow_t & Tag )
+{
+    return operator new( Size, Tag );
+}
+
+//-----------------------------------------------------------------------------
+// Name : operator delete () (Global)
+// Desc : Frees memory allocated by the operator new replacements above.
+//-----------------------------------------------------------------------------
+void operator delete( void * pMemory )
+{
+    free( pMemory );
+}
+
+void operator delete[]( void * pMemory )
+{
+    free( pMemory );
+}
+
+void operator delete( void * pMemory, const std::nothrow_t & )
+{
+    free( pMemory );
+}
+
+void operator delete[]( void * pMemory, const std::nothrow_t & )
+{
+    free( pMemory );
+}
 
 //-----------------------------------------------------------------------------
 // Name : WinMain() (Application Entry Point)
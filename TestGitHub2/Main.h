@@ -21,4 +21,10 @@
 
 #define RANDOM_COLOR 0xFF000000 | ((rand() * 0xFFFFFF) / RAND_MAX)
 
+//-----------------------------------------------------------------------------
+// Global Variable Declarations
+//-----------------------------------------------------------------------------
+extern volatile LONG g_nAllocations;    // Heap allocations made through operator new (wraps)
+extern volatile bool g_bCountAllocations; // Is g_nAllocations being counted (telemetry only) ?
+
 #endif // _MAIN_H_
\ No newline at end of file
@@ -0,0 +1,168 @@
+//-----------------------------------------------------------------------------
+// File: TelemetryReader.cpp
+//
+// Desc: Console tool which attaches to a running game's frame telemetry and
+//       prints frame time percentiles over a sliding window of frames.
+//
+//       Usage: TelemetryReader [name] [/window:<frames>] [/interval:<ms>]
+//                              [/count:<lines>]
+//
+// Copyright (c) 1997-2002 Adam Hoult & Gary Simmons. All rights reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// TelemetryReader Specific Includes
+//-----------------------------------------------------------------------------
+#include "CTelemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONG READER_WINDOW       = 600;      // Default frames the percentiles cover
+const ULONG READER_INTERVAL     = 1000;     // Default time (ms) between reports
+
+//-----------------------------------------------------------------------------
+// Name : FRAME_PERCENTILES (Struct)
+// Desc : Distribution of one of the record timings over the window.
+//-----------------------------------------------------------------------------
+struct FRAME_PERCENTILES
+{
+    float           fP50;
+    float           fP95;
+    float           fP99;
+    float           fMax;
+};
+
+//-----------------------------------------------------------------------------
+// Name : CompareFloat ()
+// Desc : qsort comparison, ascending.
+//-----------------------------------------------------------------------------
+static int CompareFloat( const void * pA, const void * pB )
+{
+    float a = *(const float*)pA, b = *(const float*)pB;
+    return ( a < b ) ? -1 : ( a > b ) ? 1 : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPercentiles ()
+// Desc : Sorts the values given (in place) and reads off the percentiles.
+//-----------------------------------------------------------------------------
+static void GetPercentiles( float * pValues, ULONG Count, FRAME_PERCENTILES * pOut )
+{
+    qsort( pValues, Count, sizeof(float), CompareFloat );
+    pOut->fP50 = pValues[ (ULONG)((Count - 1) * 0.50f) ];
+    pOut->fP95 = pValues[ (ULONG)((Count - 1) * 0.95f) ];
+    pOut->fP99 = pValues[ (ULONG)((Count - 1) * 0.99f) ];
+    pOut->fMax = pValues[ Count - 1 ];
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetOption ()
+// Desc : Retrieves a numeric "/name:value" option, if this argument is it.
+//-----------------------------------------------------------------------------
+static bool GetOption( LPCTSTR strArg, LPCTSTR strSwitch, ULONG * pValue )
+{
+    size_t Length = _tcslen( strSwitch );
+    if ( _tcsnicmp( strArg, strSwitch, Length ) != 0 ) return false;
+    *pValue = _tcstoul( strArg + Length, NULL, 10 );
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : _tmain() (Application Entry Point)
+// Desc : Entry point for the reader.
+//-----------------------------------------------------------------------------
+int _tmain( int argc, TCHAR * argv[] )
+{
+    CTelemetry          Telemetry;
+    TELEMETRY_RECORD  * pWindow = NULL, * pRead = NULL;
+    float             * pValues = NULL;
+    LPCTSTR             strName = TELEMETRY_DEFAULT_NAME;
+    ULONG               Window = READER_WINDOW, Interval = READER_INTERVAL, Lines = 0;
+    ULONG               Held = 0, Next = 0, Count, Line, i;
+    int                 a;
+
+    // Retrieve the options
+    for ( a = 1; a < argc; a++ )
+    {
+        if ( GetOption( argv[a], _T("/window:"), &Window ) ) continue;
+        if ( GetOption( argv[a], _T("/interval:"), &Interval ) ) continue;
+        if ( GetOption( argv[a], _T("/count:"), &Lines ) ) continue;
+
+        // Anything else is the name of the mapping
+        strName = argv[a];
+
+    } // Next Argument
+    if ( Window < 1 ) Window = 1;
+
+    // Wait for the game to start publishing
+    if ( !Telemetry.Open( strName ) )
+    {
+        _tprintf( _T("Waiting for telemetry '%s' (start the game with /telemetry)...\n"), strName );
+        fflush( stdout );
+        while ( !Telemetry.Open( strName ) ) Sleep( 250 );
+
+    } // End if not yet running
+    _tprintf( _T("Reading telemetry '%s' from process %lu\n\n"), strName, Telemetry.GetWriterProcess() );
+    _tprintf( _T("%8s %6s | %-27s | %-27s | %-27s | %6s %6s %5s %5s\n"), _T("Frame"), _T("Frames"), _T("Frame ms  p50/p95/p99/max"),
+              _T("Sim ms    p50/p95/p99/max"), _T("Render ms p50/p95/p99/max"), _T("Draws"), _T("Objs"), _T("Alloc"), _T("Lost") );
+
+    // Window of recent frames, and the scratch space to read & sort into
+    pWindow = (TELEMETRY_RECORD*)malloc( Window * sizeof(TELEMETRY_RECORD) );
+    pRead   = (TELEMETRY_RECORD*)malloc( TELEMETRY_RECORDS * sizeof(TELEMETRY_RECORD) );
+    pValues = (float*)malloc( Window * sizeof(float) );
+    if ( !pWindow || !pRead || !pValues ) { free( pWindow ); free( pRead ); free( pValues ); return 1; }
+
+    for ( Line = 0; Lines == 0 || Line < Lines; Line++ )
+    {
+        FRAME_PERCENTILES Frame, Sim, Render;
+        double            fDraws = 0, fObjects = 0, fAllocations = 0;
+
+        Sleep( Interval );
+
+        // Take everything published since the last report into the window
+        while (( Count = Telemetry.Read( pRead, TELEMETRY_RECORDS ) ))
+        {
+            for ( i = 0; i < Count; i++ )
+            {
+                pWindow[ Next ] = pRead[i];
+                Next = ( Next + 1 ) % Window;
+                if ( Held < Window ) Held++;
+
+            } // Next Record
+
+        } // Next Read
+        if ( Held == 0 ) { _tprintf( _T("No frames yet\n") ); continue; }
+
+        // Report
+        for ( i = 0; i < Held; i++ ) pValues[i] = pWindow[i].fFrameTime;
+        GetPercentiles( pValues, Held, &Frame );
+        for ( i = 0; i < Held; i++ ) pValues[i] = pWindow[i].fSimTime;
+        GetPercentiles( pValues, Held, &Sim );
+        for ( i = 0; i < Held; i++ ) pValues[i] = pWindow[i].fRenderTime;
+        GetPercentiles( pValues, Held, &Render );
+
+        for ( i = 0; i < Held; i++ )
+        {
+            fDraws       += pWindow[i].DrawCalls;
+            fObjects     += pWindow[i].Objects;
+            fAllocations += pWindow[i].Allocations;
+
+        } // Next Record
+
+        _tprintf( _T("%8lu %6lu | %6.2f %6.2f %6.2f %6.2f | %6.2f %6.2f %6.2f %6.2f | %6.2f %6.2f %6.2f %6.2f | %6.0f %6.0f %5.1f %5lu\n"),
+                  pWindow[ (Next + Window - 1) % Window ].Frame, Held,
+                  Frame.fP50, Frame.fP95, Frame.fP99, Frame.fMax, Sim.fP50, Sim.fP95, Sim.fP99, Sim.fMax,
+                  Render.fP50, Render.fP95, Render.fP99, Render.fMax,
+                  fDraws / Held, fObjects / Held, fAllocations / Held, Telemetry.GetLostCount() );
+        fflush( stdout );
+
+    } // Next Line
+
+    free( pWindow );
+    free( pRead );
+    free( pValues );
+    return 0;
+}